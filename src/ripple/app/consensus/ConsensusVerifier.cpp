@@ -0,0 +1,187 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/app/consensus/ConsensusVerifier.h>
+#include <ripple/basics/Log.h>
+#include <ripple/beast/core/CurrentThreadName.h>
+#include <exception>
+#include <string>
+
+namespace ripple {
+
+ConsensusVerifier::ConsensusVerifier (Stoppable& parent,
+        Setup const& setup, beast::Journal journal)
+    : Stoppable ("ConsensusVerifier", parent)
+    , setup_ (setup)
+    , journal_ (journal)
+{
+    threads_.reserve (setup_.threads);
+    for (std::size_t i = 0; i < setup_.threads; ++i)
+        threads_.emplace_back (&ConsensusVerifier::run, this, i);
+}
+
+ConsensusVerifier::~ConsensusVerifier ()
+{
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all ();
+    for (auto& thread : threads_)
+    {
+        if (thread.joinable ())
+            thread.join ();
+    }
+}
+
+bool
+ConsensusVerifier::check (bool trusted, Check check, Callback callback)
+{
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        if (! stop_ && enabled ())
+        {
+            if (trusted)
+            {
+                trusted_.push_back ({ std::move (check),
+                    std::move (callback) });
+            }
+            else
+            {
+                if (untrusted_.size () >= setup_.maxUntrusted)
+                {
+                    ++dropped_;
+                    return false;
+                }
+                untrusted_.push_back ({ std::move (check),
+                    std::move (callback) });
+            }
+            cond_.notify_one ();
+            return true;
+        }
+    }
+
+    Item item { std::move (check), std::move (callback) };
+    invoke (item);
+    return true;
+}
+
+ConsensusVerifier::Counts
+ConsensusVerifier::counts () const
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    Counts c;
+    c.trusted = trusted_.size ();
+    c.untrusted = untrusted_.size ();
+    c.dropped = dropped_;
+    return c;
+}
+
+void
+ConsensusVerifier::onStop ()
+{
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all ();
+
+    // Checks already queued are run before stopping
+    for (auto& thread : threads_)
+    {
+        if (thread.joinable ())
+            thread.join ();
+    }
+    stopped ();
+}
+
+void
+ConsensusVerifier::run (std::size_t index)
+{
+    beast::setCurrentThreadName (
+        "ConsensusVerifier #" + std::to_string (index + 1));
+
+    std::vector<Item> batch;
+
+    std::unique_lock<std::mutex> lock (mutex_);
+    for (;;)
+    {
+        cond_.wait (lock, [this]
+        {
+            return stop_ || ! trusted_.empty () || ! untrusted_.empty ();
+        });
+
+        // Trusted checks first, then untrusted ones to fill the batch
+        for (auto queue : { &trusted_, &untrusted_ })
+        {
+            while (! queue->empty () && batch.size () < setup_.batchSize)
+            {
+                batch.push_back (std::move (queue->front ()));
+                queue->pop_front ();
+            }
+        }
+
+        if (batch.empty ())
+            return;
+        lock.unlock ();
+
+        for (auto& item : batch)
+            invoke (item);
+        batch.clear ();
+
+        lock.lock ();
+    }
+}
+
+void
+ConsensusVerifier::invoke (Item& item)
+{
+    bool valid = false;
+    try
+    {
+        valid = item.check ();
+    }
+    catch (std::exception const& e)
+    {
+        JLOG (journal_.debug()) <<
+            "Signature check failed: " << e.what ();
+    }
+    if (item.callback)
+        item.callback (valid);
+}
+
+//------------------------------------------------------------------------------
+
+ConsensusVerifier::Setup
+setup_ConsensusVerifier (Config const& config)
+{
+    ConsensusVerifier::Setup setup;
+    auto const& section = config.section ("consensus_verify");
+    setup.threads = 2;
+    set (setup.threads, "threads", section);
+    set (setup.maxUntrusted, "untrusted_limit", section);
+    set (setup.batchSize, "batch_size", section);
+
+    if (setup.batchSize < 1)
+        setup.batchSize = 1;
+    return setup;
+}
+
+} // ripple
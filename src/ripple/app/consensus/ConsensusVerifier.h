@@ -0,0 +1,139 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_APP_CONSENSUS_CONSENSUSVERIFIER_H_INCLUDED
+#define RIPPLE_APP_CONSENSUS_CONSENSUSVERIFIER_H_INCLUDED
+
+#include <ripple/core/Config.h>
+#include <ripple/core/Stoppable.h>
+#include <ripple/beast/utility/Journal.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ripple {
+
+/** Checks the signatures of proposals and validations from peers.
+
+    Messages pass through three stages. Duplicates are suppressed
+    through the HashRouter before a message reaches the verifier. The
+    verifier then checks signatures on its own threads, taking messages
+    from trusted validators before any others. Finally the callback hands
+    each checked message to the job queue, where consensus processes it
+    without checking the signature again.
+
+    Checks for untrusted messages are dropped once too many of them are
+    waiting, so a flood of untrusted validations cannot delay trusted
+    ones or use up the job queue's threads.
+*/
+class ConsensusVerifier : public Stoppable
+{
+public:
+    struct Setup
+    {
+        // Threads checking signatures. When zero, signatures
+        // are checked by the jobs processing the messages.
+        std::size_t threads = 0;
+
+        // The most untrusted checks waiting
+        std::size_t maxUntrusted = 1024;
+
+        // The most checks a thread takes at once
+        std::size_t batchSize = 8;
+    };
+
+    /** Returns `true` if a signature is valid. */
+    using Check = std::function<bool()>;
+
+    /** Called with the result of a check. */
+    using Callback = std::function<void(bool)>;
+
+    struct Counts
+    {
+        std::size_t trusted = 0;
+        std::size_t untrusted = 0;
+        std::uint64_t dropped = 0;
+    };
+
+    ConsensusVerifier (Stoppable& parent, Setup const& setup,
+        beast::Journal journal);
+
+    ~ConsensusVerifier ();
+
+    /** Returns `true` if signatures are checked by the verifier. */
+    bool
+    enabled () const
+    {
+        return setup_.threads > 0;
+    }
+
+    /** Queue a signature check.
+
+        The callback is invoked with the result on one of the
+        verifier's threads. When the verifier is disabled or has
+        stopped, the check and callback are run before this returns.
+
+        @param trusted `true` if the signer is a trusted validator.
+        @return `false` if the check was dropped, because too many
+                untrusted checks are waiting.
+    */
+    bool
+    check (bool trusted, Check check, Callback callback);
+
+    /** Returns the number of checks waiting, and dropped. */
+    Counts
+    counts () const;
+
+private:
+    struct Item
+    {
+        Check check;
+        Callback callback;
+    };
+
+    void onStop () override;
+    void run (std::size_t index);
+
+    // Run a check and its callback. A check that throws fails.
+    void invoke (Item& item);
+
+    Setup const setup_;
+    beast::Journal journal_;
+
+    std::mutex mutable mutex_;
+    std::condition_variable cond_;
+    std::deque<Item> trusted_;
+    std::deque<Item> untrusted_;
+    std::uint64_t dropped_ = 0;
+    bool stop_ = false;
+    std::vector<std::thread> threads_;
+};
+
+/** Returns the settings from the [consensus_verify] section. */
+ConsensusVerifier::Setup
+setup_ConsensusVerifier (Config const& config);
+
+} // ripple
+
+#endif
@@ -22,6 +22,7 @@
 #include <ripple/app/ledger/AcceptedLedger.h>
 #include <ripple/app/ledger/InboundLedgers.h>
 #include <ripple/app/ledger/LedgerMaster.h>
+#include <ripple/app/ledger/LedgerSQLWriter.h>
 #include <ripple/consensus/LedgerTiming.h>
 #include <ripple/app/ledger/LedgerToJson.h>
 #include <ripple/app/ledger/OrderBookDB.h>
@@ -40,13 +41,16 @@
 #include <ripple/core/SociDB.h>
 #include <ripple/json/to_string.h>
 #include <ripple/nodestore/Database.h>
+#include <ripple/nodestore/DatabaseShard.h>
 #include <ripple/protocol/digest.h>
 #include <ripple/protocol/Indexes.h>
 #include <ripple/protocol/JsonFields.h>
 #include <ripple/protocol/PublicKey.h>
 #include <ripple/protocol/SecretKey.h>
 #include <ripple/protocol/HashPrefix.h>
+#include <ripple/protocol/TxFormats.h>
 #include <ripple/protocol/types.h>
+#include <ripple/shamap/SHAMapMissingNode.h>
 #include <ripple/beast/core/LexicalCast.h>
 #include <boost/optional.hpp>
 #include <cassert>
@@ -796,10 +800,65 @@ void Ledger::updateSkipList ()
         rawReplace(sle);
 }
 
+// Collect the SQL rows recording a ledger and its transactions
+static
+std::shared_ptr<LedgerSQLRows>
+makeLedgerSQLRows (Application& app, AcceptedLedger const& aLedger,
+    std::shared_ptr<Ledger const> const& ledger, beast::Journal j)
+{
+    auto const seq = ledger->info().seq;
+
+    auto rows = std::make_shared<LedgerSQLRows>();
+    rows->info = ledger->info();
+    rows->transactions.reserve (aLedger.getMap ().size ());
+
+    for (auto const& vt : aLedger.getMap ())
+    {
+        uint256 transactionID = vt.second->getTransactionID ();
+
+        app.getMasterTransaction ().inLedger (
+            transactionID, seq);
+
+        auto const& txn = vt.second->getTxn ();
+        auto const format =
+            TxFormats::getInstance().findByType (txn->getTxnType ());
+        assert (format != nullptr);
+
+        LedgerSQLRows::Transaction row;
+        row.id = transactionID;
+        row.type = format->getName ();
+        row.account = txn->getAccountID (sfAccount);
+        row.accountSeq = txn->getSequence ();
+        row.txnSeq = vt.second->getTxnSeq ();
+        {
+            Serializer s;
+            txn->add (s);
+            row.raw = std::move (s.modData ());
+        }
+        row.meta = vt.second->getRawMeta ();
+
+        auto const& accts = vt.second->getAffected ();
+        if (accts.empty ())
+        {
+            JLOG (j.warn())
+                << "Transaction in ledger " << seq
+                << " affects no accounts";
+            JLOG (j.warn())
+                << txn->getJson(0);
+        }
+        row.affected.assign (accts.begin (), accts.end ());
+
+        rows->transactions.push_back (std::move (row));
+    }
+
+    return rows;
+}
+
 static bool saveValidatedLedger (
     Application& app,
     std::shared_ptr<Ledger const> const& ledger,
-    bool current)
+    bool current,
+    bool synchronous)
 {
     auto j = app.journal ("Ledger");
 
@@ -810,18 +869,9 @@ static bool saveValidatedLedger (
         return true;
     }
 
-    // TODO(tom): Fix this hard-coded SQL!
     JLOG (j.trace())
         << "saveValidatedLedger "
         << (current ? "" : "fromAcquire ") << ledger->info().seq;
-    static boost::format deleteLedger (
-        "DELETE FROM Ledgers WHERE LedgerSeq = %u;");
-    static boost::format deleteTrans1 (
-        "DELETE FROM Transactions WHERE LedgerSeq = %u;");
-    static boost::format deleteTrans2 (
-        "DELETE FROM AccountTransactions WHERE LedgerSeq = %u;");
-    static boost::format deleteAcctTrans (
-        "DELETE FROM AccountTransactions WHERE TransID = '%s';");
 
     auto seq = ledger->info().seq;
 
@@ -873,141 +923,26 @@ static bool saveValidatedLedger (
         return false;
     }
 
-    {
-        auto db = app.getLedgerDB ().checkoutDb();
-        *db << boost::str (deleteLedger % seq);
-    }
+    auto const rows = makeLedgerSQLRows (app, *aLedger, ledger, j);
 
+    auto const finish = [&app, seq, hash = ledger->info().hash](bool written)
     {
-        auto db = app.getTxnDB ().checkoutDb ();
-
-        soci::transaction tr(*db);
-
-        *db << boost::str (deleteTrans1 % seq);
-        *db << boost::str (deleteTrans2 % seq);
-
-        std::string const ledgerSeq (std::to_string (seq));
-
-        for (auto const& vt : aLedger->getMap ())
-        {
-            uint256 transactionID = vt.second->getTransactionID ();
-
-            app.getMasterTransaction ().inLedger (
-                transactionID, seq);
-
-            std::string const txnId (to_string (transactionID));
-            std::string const txnSeq (std::to_string (vt.second->getTxnSeq ()));
+        if (! written)
+            app.getLedgerMaster().failedSave(seq, hash);
 
-            *db << boost::str (deleteAcctTrans % transactionID);
-
-            auto const& accts = vt.second->getAffected ();
-
-            if (!accts.empty ())
-            {
-                std::string sql (
-                    "INSERT INTO AccountTransactions "
-                    "(TransID, Account, LedgerSeq, TxnSeq) VALUES ");
-
-                // Try to make an educated guess on how much space we'll need
-                // for our arguments. In argument order we have:
-                // 64 + 34 + 10 + 10 = 118 + 10 extra = 128 bytes
-                sql.reserve (sql.length () + (accts.size () * 128));
-
-                bool first = true;
-                for (auto const& account : accts)
-                {
-                    if (!first)
-                        sql += ", ('";
-                    else
-                    {
-                        sql += "('";
-                        first = false;
-                    }
-
-                    sql += txnId;
-                    sql += "','";
-                    sql += app.accountIDCache().toBase58(account);
-                    sql += "',";
-                    sql += ledgerSeq;
-                    sql += ",";
-                    sql += txnSeq;
-                    sql += ")";
-                }
-                sql += ";";
-                JLOG (j.trace()) << "ActTx: " << sql;
-                *db << sql;
-            }
-            else
-            {
-                JLOG (j.warn())
-                    << "Transaction in ledger " << seq
-                    << " affects no accounts";
-                JLOG (j.warn())
-                    << vt.second->getTxn()->getJson(0);
-            }
-
-            *db <<
-               (STTx::getMetaSQLInsertReplaceHeader () +
-                vt.second->getTxn ()->getMetaSQL (
-                    seq, vt.second->getEscMeta ()) + ";");
-        }
-
-        tr.commit ();
-    }
+        // Clients can now trust the database for
+        // information about this ledger sequence.
+        app.pendingSaves().finishWork(seq);
+    };
 
+    if (synchronous)
     {
-        static std::string addLedger(
-            R"sql(INSERT OR REPLACE INTO Ledgers
-                (LedgerHash,LedgerSeq,PrevHash,TotalCoins,ClosingTime,PrevClosingTime,
-                CloseTimeRes,CloseFlags,AccountSetHash,TransSetHash)
-            VALUES
-                (:ledgerHash,:ledgerSeq,:prevHash,:totalCoins,:closingTime,:prevClosingTime,
-                :closeTimeRes,:closeFlags,:accountSetHash,:transSetHash);)sql");
-        static std::string updateVal(
-            R"sql(UPDATE Validations SET LedgerSeq = :ledgerSeq, InitialSeq = :initialSeq
-                WHERE LedgerHash = :ledgerHash;)sql");
-
-        auto db (app.getLedgerDB ().checkoutDb ());
-
-        soci::transaction tr(*db);
-
-        auto const hash = to_string (ledger->info().hash);
-        auto const parentHash = to_string (ledger->info().parentHash);
-        auto const drops = to_string (ledger->info().drops);
-        auto const closeTime =
-            ledger->info().closeTime.time_since_epoch().count();
-        auto const parentCloseTime =
-            ledger->info().parentCloseTime.time_since_epoch().count();
-        auto const closeTimeResolution =
-            ledger->info().closeTimeResolution.count();
-        auto const closeFlags = ledger->info().closeFlags;
-        auto const accountHash = to_string (ledger->info().accountHash);
-        auto const txHash = to_string (ledger->info().txHash);
-
-        *db << addLedger,
-            soci::use(hash),
-            soci::use(seq),
-            soci::use(parentHash),
-            soci::use(drops),
-            soci::use(closeTime),
-            soci::use(parentCloseTime),
-            soci::use(closeTimeResolution),
-            soci::use(closeFlags),
-            soci::use(accountHash),
-            soci::use(txHash);
-
-
-        *db << updateVal,
-            soci::use(seq),
-            soci::use(seq),
-            soci::use(hash);
-
-        tr.commit();
+        bool const written = app.getLedgerSQLWriter().writeNow (*rows);
+        finish (written);
+        return written;
     }
 
-    // Clients can now trust the database for
-    // information about this ledger sequence.
-    app.pendingSaves().finishWork(seq);
+    app.getLedgerSQLWriter().write (rows, finish);
     return true;
 }
 
@@ -1056,14 +991,89 @@ bool pendSaveValidated (
     if (!isSynchronous &&
         app.getJobQueue().addJob (jobType, jobName,
         [&app, ledger, isCurrent] (Job&) {
-            saveValidatedLedger(app, ledger, isCurrent);
+            saveValidatedLedger(app, ledger, isCurrent, false);
         }))
     {
         return true;
     }
 
     // The JobQueue won't do the Job.  Do the save synchronously.
-    return saveValidatedLedger(app, ledger, isCurrent);
+    return saveValidatedLedger(app, ledger, isCurrent, true);
+}
+
+// Store the nodes of a map that the shard does not have yet.
+// Children are stored before their parents, so a subtree whose
+// root is in the shard is complete and need not be visited.
+static
+void
+storeMapInShard (NodeStore::DatabaseShard& shards, SHAMap const& map,
+    NodeObjectType type, std::uint32_t seq)
+{
+    if (map.getHash ().isZero ())
+        return;
+    if (shards.fetch (map.getHash ().as_uint256 (), seq))
+        return;
+
+    auto const store = [&](SHAMapAbstractNode& node)
+    {
+        Serializer s;
+        node.addRaw (s, snfPREFIX);
+        shards.store (type, std::move (s.modData ()),
+            node.getNodeHash ().as_uint256 (), seq);
+    };
+
+    for (int branch = 0; branch < 16; ++branch)
+    {
+        map.visitSubtree (branch,
+            [&](SHAMapAbstractNode& node)
+            {
+                if (shards.fetch (node.getNodeHash ().as_uint256 (), seq))
+                    return true;
+                if (node.isLeaf ())
+                    store (node);
+                return false;
+            },
+            [&](SHAMapInnerNode& node)
+            {
+                store (node);
+            });
+    }
+
+    Serializer s;
+    map.getRootNode (s, snfPREFIX);
+    shards.store (type, std::move (s.modData ()),
+        map.getHash ().as_uint256 (), seq);
+}
+
+bool
+storeLedgerInShard (NodeStore::DatabaseShard& shards,
+    Ledger const& ledger, beast::Journal j)
+{
+    auto const seq = ledger.info().seq;
+    if (shards.contains (seq))
+        return true;
+
+    try
+    {
+        storeMapInShard (shards, ledger.stateMap (), hotACCOUNT_NODE, seq);
+        storeMapInShard (shards, ledger.txMap (), hotTRANSACTION_NODE, seq);
+    }
+    catch (SHAMapMissingNode const& e)
+    {
+        JLOG (j.warn()) <<
+            "Ledger " << seq << " not stored in shard: " << e.what ();
+        return false;
+    }
+
+    Serializer s (128);
+    s.add32 (HashPrefix::ledgerMaster);
+    addRaw (ledger.info(), s);
+    shards.store (hotLEDGER, std::move (s.modData ()),
+        ledger.info().hash, seq);
+
+    shards.setStored (seq);
+    JLOG (j.debug()) << "Ledger " << seq << " stored in shard";
+    return true;
 }
 
 void
@@ -42,6 +42,8 @@ class TransactionMaster;
 
 class SqliteStatement;
 
+namespace NodeStore { class DatabaseShard; }
+
 struct create_genesis_t {};
 extern create_genesis_t const create_genesis;
 
@@ -348,6 +350,18 @@ pendSaveValidated(
     bool isSynchronous,
     bool isCurrent);
 
+/** Store a validated ledger in the shard store.
+
+    Only the nodes the shard does not have yet are written. Once the
+    ledger header is written the ledger is marked as stored.
+
+    @return `false` if a node of the ledger is missing.
+*/
+extern
+bool
+storeLedgerInShard (NodeStore::DatabaseShard& shards,
+    Ledger const& ledger, beast::Journal j);
+
 extern
 std::shared_ptr<Ledger>
 loadByIndex (std::uint32_t ledgerIndex,
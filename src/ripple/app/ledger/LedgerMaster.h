@@ -37,6 +37,7 @@
 #include <ripple/core/Stoppable.h>
 #include <ripple/protocol/Protocol.h>
 #include <ripple/beast/utility/PropertyStream.h>
+#include <map>
 #include <mutex>
 
 #include "ripple.pb.h"
@@ -274,6 +275,9 @@ private:
 
     void updatePaths(Job& job);
 
+    // Store the pending ledgers in the shard store, oldest first
+    void storeShards();
+
     // Returns true if work started.  Always called with m_mutex locked.
     // The passed ScopedLockType is a reminder to callers.
     bool newPFWork(const char *name, ScopedLockType&);
@@ -314,6 +318,12 @@ private:
 
     std::unique_ptr <detail::LedgerCleaner> mLedgerCleaner;
 
+    // Ledgers waiting to be stored in the shard store. A single
+    // job stores them, so only their hashes are held meanwhile.
+    std::mutex mShardLock;
+    std::map <LedgerIndex, uint256> mShardPending;
+    bool mShardJob {false};
+
     uint256 mLastValidateHash;
     std::uint32_t mLastValidateSeq {0};
 
@@ -0,0 +1,127 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#ifndef RIPPLE_APP_LEDGER_LEDGERSQLWRITER_H_INCLUDED
+#define RIPPLE_APP_LEDGER_LEDGERSQLWRITER_H_INCLUDED
+
+#include <ripple/basics/Blob.h>
+#include <ripple/core/DatabaseCon.h>
+#include <ripple/core/Stoppable.h>
+#include <ripple/ledger/ReadView.h>
+#include <ripple/protocol/AccountID.h>
+#include <ripple/beast/utility/Journal.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ripple {
+
+/** The SQL rows recording a validated ledger and its transactions. */
+struct LedgerSQLRows
+{
+    struct Transaction
+    {
+        uint256 id;
+        std::string type;
+        AccountID account;
+        std::uint32_t accountSeq = 0;
+        std::uint32_t txnSeq = 0;
+        Blob raw;
+        Blob meta;
+
+        // The accounts affected by the transaction
+        std::vector<AccountID> affected;
+    };
+
+    LedgerInfo info;
+    std::vector<Transaction> transactions;
+};
+
+class HistoryStore;
+
+/** Writes the SQL rows of validated ledgers on a dedicated thread.
+
+    The ledger header is written to the ledger database with statements
+    prepared once and reused for every ledger. The transactions are
+    recorded in the history store.
+*/
+class LedgerSQLWriter : public Stoppable
+{
+public:
+    /** Called once a ledger's rows are written, or failed to be. */
+    using Callback = std::function<void(bool)>;
+
+    LedgerSQLWriter (Stoppable& parent, DatabaseCon& ledgerDB,
+        HistoryStore& history, beast::Journal journal);
+
+    ~LedgerSQLWriter ();
+
+    /** Queue the rows of a ledger to be written.
+        Once the writer has stopped, the rows are written before
+        this returns.
+    */
+    void write (std::shared_ptr<LedgerSQLRows const> rows,
+        Callback callback);
+
+    /** Write the rows of a ledger before returning.
+        @return `true` if the rows were written.
+    */
+    bool writeNow (LedgerSQLRows const& rows);
+
+    /** Returns the number of ledgers waiting to be written. */
+    std::size_t pending () const;
+
+    /** Rows inserted by each multi-row AccountTransactions statement
+        when the history is kept in SQLite.
+    */
+    static std::size_t constexpr accountRowsPerInsert = 32;
+
+private:
+    class LedgerStatements;
+
+    void onStop () override;
+    void run ();
+    void doWrite (LedgerSQLRows const& rows);
+
+    DatabaseCon& ledgerDB_;
+    HistoryStore& history_;
+    beast::Journal journal_;
+
+    // Serializes writes, and guards the prepared statements
+    std::mutex writeMutex_;
+    std::unique_ptr<LedgerStatements> ledgerStatements_;
+
+    std::mutex mutable mutex_;
+    std::condition_variable cond_;
+    std::deque<std::pair<
+        std::shared_ptr<LedgerSQLRows const>, Callback>> queue_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+} // ripple
+
+#endif
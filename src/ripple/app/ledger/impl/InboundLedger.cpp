@@ -33,6 +33,7 @@
 #include <ripple/protocol/HashPrefix.h>
 #include <ripple/protocol/JsonFields.h>
 #include <ripple/nodestore/Database.h>
+#include <ripple/nodestore/DatabaseShard.h>
 #include <algorithm>
 
 namespace ripple {
@@ -244,6 +245,18 @@ bool InboundLedger::tryLocal ()
         // Nothing we can do without the ledger header
         auto node = app_.getNodeStore ().fetch (mHash);
 
+        // An old ledger may be held by the shard store
+        bool inShard = false;
+        if (!node && mSeq != 0)
+        {
+            auto const shards = app_.getShardStore ();
+            if (shards && shards->contains (mSeq))
+            {
+                node = shards->fetch (mHash, mSeq);
+                inShard = (node != nullptr);
+            }
+        }
+
         if (!node)
         {
             auto data = app_.getLedgerMaster().getFetchPack(mHash);
@@ -267,6 +280,11 @@ bool InboundLedger::tryLocal ()
                 deserializeHeader (makeSlice (node->getData()), true),
                 app_.config(),
                 app_.family());
+
+            // The shard holds every node of the ledger, so
+            // its maps are read from there as well
+            if (inShard)
+                mLedger->setFull ();
         }
 
         if (mLedger->info().hash != mHash)
@@ -775,7 +793,10 @@ void InboundLedger::filterNodes (
         nodes.erase (dup, nodes.end());
     }
 
-    std::size_t const limit = (reason == TriggerReason::reply)
+    // While the node store is behind on writes, ask
+    // for as few nodes after a reply as at other times
+    std::size_t const limit = (reason == TriggerReason::reply &&
+            ! app_.getNodeStore ().isWriteBacklogged ())
         ? reqNodesReply
         : reqNodes;
 
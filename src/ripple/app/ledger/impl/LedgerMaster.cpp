@@ -39,6 +39,7 @@
 #include <ripple/basics/Log.h>
 #include <ripple/basics/TaggedCache.h>
 #include <ripple/basics/UptimeTimer.h>
+#include <ripple/nodestore/DatabaseShard.h>
 #include <ripple/core/TimeKeeper.h>
 #include <ripple/overlay/Overlay.h>
 #include <ripple/overlay/Peer.h>
@@ -213,6 +214,7 @@ LedgerMaster::setValidLedger(
                     app_.getMaxDisallowedLedger());
     (void) max_ledger_difference_;
     mValidLedgerSeq = l->info().seq;
+    app_.getJobQueue ().setLedgerSeq (l->info().seq);
 
     app_.getOPs().updateLocalTx (*l);
     app_.getSHAMapStore().onLedgerClosed (getValidatedLedger());
@@ -602,6 +604,34 @@ LedgerMaster::fixMismatch (ReadView const& ledger)
     }
 }
 
+void
+LedgerMaster::storeShards ()
+{
+    auto const shards = app_.getShardStore ();
+    auto const j = app_.journal ("ShardStore");
+
+    for (;;)
+    {
+        std::pair <LedgerIndex, uint256> next;
+        {
+            std::lock_guard <std::mutex> lock (mShardLock);
+            if (mShardPending.empty () || isStopping ())
+            {
+                mShardJob = false;
+                return;
+            }
+            next = *mShardPending.begin ();
+            mShardPending.erase (mShardPending.begin ());
+        }
+
+        if (auto const ledger = getLedgerByHash (next.second))
+            storeLedgerInShard (*shards, *ledger, j);
+        else
+            JLOG (j.warn()) <<
+                "Ledger " << next.first << " is not available to store";
+    }
+}
+
 void
 LedgerMaster::setFullLedger (
     std::shared_ptr<Ledger const> const& ledger,
@@ -630,6 +660,21 @@ LedgerMaster::setFullLedger (
 
     pendSaveValidated (app_, ledger, isSynchronous, isCurrent);
 
+    if (auto const shards = app_.getShardStore ())
+    {
+        if (! shards->contains (ledger->info().seq))
+        {
+            std::lock_guard <std::mutex> lock (mShardLock);
+            mShardPending.emplace (ledger->info().seq, ledger->info().hash);
+            if (! mShardJob)
+            {
+                mShardJob = app_.getJobQueue ().addJob (
+                    jtSHARD, "storeShard",
+                    [this] (Job&) { storeShards (); });
+            }
+        }
+    }
+
     {
         ScopedLockType ml (mCompleteLock);
         mCompleteLedgers.insert (ledger->info().seq);
@@ -1528,6 +1573,7 @@ void LedgerMaster::doAdvance (ScopedLockType& sl)
         if (pubLedgers.empty())
         {
             if (!standalone_ && !app_.getFeeTrack().isLoadedLocal() &&
+                !app_.getNodeStore().isWriteBacklogged() &&
                 (app_.getJobQueue().getJobCount(jtPUBOLDLEDGER) < 10) &&
                 (mValidLedgerSeq == mPubLedgerSeq) &&
                 (getValidatedLedgerAge() < MAX_LEDGER_AGE_ACQUIRE))
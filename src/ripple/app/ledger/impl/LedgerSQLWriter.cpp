@@ -0,0 +1,239 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <ripple/app/ledger/LedgerSQLWriter.h>
+#include <ripple/app/misc/HistoryStore.h>
+#include <ripple/basics/Log.h>
+#include <ripple/beast/core/CurrentThreadName.h>
+#include <ripple/core/SociDB.h>
+#include <exception>
+
+namespace ripple {
+
+// Statements on the ledger database, and the values bound to them
+class LedgerSQLWriter::LedgerStatements
+{
+public:
+    std::uint32_t seq = 0;
+    std::string hash;
+    std::string parentHash;
+    std::string drops;
+    std::uint32_t closeTime = 0;
+    std::uint32_t parentCloseTime = 0;
+    std::uint32_t closeTimeResolution = 0;
+    int closeFlags = 0;
+    std::string accountHash;
+    std::string txHash;
+
+    soci::statement deleteLedger;
+    soci::statement insertLedger;
+    soci::statement updateValidations;
+
+    explicit
+    LedgerStatements (soci::session& session)
+        : deleteLedger (session)
+        , insertLedger (session)
+        , updateValidations (session)
+    {
+        prepare (deleteLedger,
+            "DELETE FROM Ledgers WHERE LedgerSeq = :ledgerSeq;",
+            soci::use (seq));
+        prepare (insertLedger,
+            R"sql(INSERT OR REPLACE INTO Ledgers
+                (LedgerHash,LedgerSeq,PrevHash,TotalCoins,ClosingTime,
+                PrevClosingTime,CloseTimeRes,CloseFlags,AccountSetHash,
+                TransSetHash)
+            VALUES
+                (:ledgerHash,:ledgerSeq,:prevHash,:totalCoins,:closingTime,
+                :prevClosingTime,:closeTimeRes,:closeFlags,:accountSetHash,
+                :transSetHash);)sql",
+            soci::use (hash),
+            soci::use (seq),
+            soci::use (parentHash),
+            soci::use (drops),
+            soci::use (closeTime),
+            soci::use (parentCloseTime),
+            soci::use (closeTimeResolution),
+            soci::use (closeFlags),
+            soci::use (accountHash),
+            soci::use (txHash));
+        prepare (updateValidations,
+            R"sql(UPDATE Validations SET LedgerSeq = :ledgerSeq,
+                InitialSeq = :initialSeq WHERE LedgerHash = :ledgerHash;)sql",
+            soci::use (seq),
+            soci::use (seq),
+            soci::use (hash));
+    }
+};
+
+//------------------------------------------------------------------------------
+
+LedgerSQLWriter::LedgerSQLWriter (Stoppable& parent, DatabaseCon& ledgerDB,
+        HistoryStore& history, beast::Journal journal)
+    : Stoppable ("LedgerSQLWriter", parent)
+    , ledgerDB_ (ledgerDB)
+    , history_ (history)
+    , journal_ (journal)
+{
+    thread_ = std::thread (&LedgerSQLWriter::run, this);
+}
+
+LedgerSQLWriter::~LedgerSQLWriter ()
+{
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all ();
+    if (thread_.joinable ())
+        thread_.join ();
+
+    // The statements must be finalized before the database closes
+    std::lock_guard<std::mutex> lock (writeMutex_);
+    auto db = ledgerDB_.checkoutDb ();
+    ledgerStatements_.reset ();
+}
+
+void
+LedgerSQLWriter::write (std::shared_ptr<LedgerSQLRows const> rows,
+    Callback callback)
+{
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        if (! stop_)
+        {
+            queue_.emplace_back (std::move (rows), std::move (callback));
+            cond_.notify_one ();
+            return;
+        }
+    }
+
+    bool const written = writeNow (*rows);
+    if (callback)
+        callback (written);
+}
+
+bool
+LedgerSQLWriter::writeNow (LedgerSQLRows const& rows)
+{
+    try
+    {
+        doWrite (rows);
+        return true;
+    }
+    catch (std::exception const& e)
+    {
+        JLOG (journal_.error()) <<
+            "Failed to save ledger " << rows.info.seq << ": " << e.what ();
+    }
+    return false;
+}
+
+std::size_t
+LedgerSQLWriter::pending () const
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    return queue_.size ();
+}
+
+void
+LedgerSQLWriter::onStop ()
+{
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all ();
+
+    // Ledgers already queued are written before stopping
+    if (thread_.joinable ())
+        thread_.join ();
+    stopped ();
+}
+
+void
+LedgerSQLWriter::run ()
+{
+    beast::setCurrentThreadName ("LedgerSQLWriter");
+
+    std::unique_lock<std::mutex> lock (mutex_);
+    for (;;)
+    {
+        cond_.wait (lock, [this]{ return stop_ || ! queue_.empty (); });
+        if (queue_.empty ())
+            return;
+
+        auto work = std::move (queue_.front ());
+        queue_.pop_front ();
+        lock.unlock ();
+
+        bool const written = writeNow (*work.first);
+        if (work.second)
+            work.second (written);
+
+        lock.lock ();
+    }
+}
+
+void
+LedgerSQLWriter::doWrite (LedgerSQLRows const& rows)
+{
+    std::lock_guard<std::mutex> lock (writeMutex_);
+
+    auto const seq = rows.info.seq;
+
+    {
+        auto db = ledgerDB_.checkoutDb ();
+        if (! ledgerStatements_)
+            ledgerStatements_ = std::make_unique<LedgerStatements> (*db);
+        ledgerStatements_->seq = seq;
+        ledgerStatements_->deleteLedger.execute (true);
+    }
+
+    history_.saveTransactions (rows);
+
+    {
+        auto db = ledgerDB_.checkoutDb ();
+        auto& st = *ledgerStatements_;
+
+        soci::transaction tr (*db);
+
+        auto const& info = rows.info;
+        st.seq = seq;
+        st.hash = to_string (info.hash);
+        st.parentHash = to_string (info.parentHash);
+        st.drops = to_string (info.drops);
+        st.closeTime = info.closeTime.time_since_epoch ().count ();
+        st.parentCloseTime =
+            info.parentCloseTime.time_since_epoch ().count ();
+        st.closeTimeResolution = info.closeTimeResolution.count ();
+        st.closeFlags = info.closeFlags;
+        st.accountHash = to_string (info.accountHash);
+        st.txHash = to_string (info.txHash);
+
+        st.insertLedger.execute (true);
+        st.updateValidations.execute (true);
+
+        tr.commit ();
+    }
+}
+
+} // ripple
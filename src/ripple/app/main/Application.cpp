@@ -20,12 +20,14 @@
 #include <BeastConfig.h>
 #include <ripple/app/main/Application.h>
 #include <ripple/core/DatabaseCon.h>
+#include <ripple/app/consensus/ConsensusVerifier.h>
 #include <ripple/app/consensus/RCLValidations.h>
 #include <ripple/app/main/DBInit.h>
 #include <ripple/app/main/BasicApp.h>
 #include <ripple/app/main/Tuning.h>
 #include <ripple/app/ledger/InboundLedgers.h>
 #include <ripple/app/ledger/LedgerMaster.h>
+#include <ripple/app/ledger/LedgerSQLWriter.h>
 #include <ripple/app/ledger/LedgerToJson.h>
 #include <ripple/app/ledger/OpenLedger.h>
 #include <ripple/app/ledger/OrderBookDB.h>
@@ -37,6 +39,7 @@
 #include <ripple/app/main/NodeStoreScheduler.h>
 #include <ripple/app/misc/AmendmentTable.h>
 #include <ripple/app/misc/HashRouter.h>
+#include <ripple/app/misc/HistoryStore.h>
 #include <ripple/app/misc/LoadFeeTrack.h>
 #include <ripple/app/misc/NetworkOPs.h>
 #include <ripple/app/misc/SHAMapStore.h>
@@ -45,10 +48,12 @@
 #include <ripple/app/misc/ValidatorKeys.h>
 #include <ripple/app/paths/PathRequests.h>
 #include <ripple/app/tx/apply.h>
+#include <ripple/app/tx/BatchVerifier.h>
 #include <ripple/basics/ResolverAsio.h>
 #include <ripple/basics/Sustain.h>
 #include <ripple/json/json_reader.h>
 #include <ripple/nodestore/DummyScheduler.h>
+#include <ripple/nodestore/Manager.h>
 #include <ripple/overlay/Cluster.h>
 #include <ripple/overlay/make_Overlay.h>
 #include <ripple/protocol/STParsedJSON.h>
@@ -60,6 +65,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <thread>
 
 namespace ripple {
 
@@ -107,7 +113,8 @@ public:
             CollectorManager& collectorManager)
         : app_ (app)
         , treecache_ ("TreeNodeCache", 65536, 60, stopwatch(),
-            app.journal("TaggedCache"))
+            app.journal("TaggedCache"), beast::insight::NullCollector::New (),
+                db.getCachePolicy ())
         , fullbelow_ ("full_below", stopwatch(),
             collectorManager.collector(),
                 fullBelowTargetSize, fullBelowExpirationSeconds)
@@ -158,6 +165,12 @@ public:
         return db_;
     }
 
+    NodeStore::DatabaseShard*
+    shardDb() override
+    {
+        return app_.getShardStore ();
+    }
+
     void
     missing_node (std::uint32_t seq) override
     {
@@ -202,6 +215,19 @@ public:
     {
         acquire (hash, 0);
     }
+
+    std::size_t
+    flushFanout() const override
+    {
+        return app_.config().FLUSH_FANOUT;
+    }
+
+    void
+    dispatch (std::function<void()> task) override
+    {
+        app_.getJobQueue().addJob (jtFLUSH, "SHAMap::flush",
+            [task = std::move(task)] (Job&) { task(); });
+    }
 };
 
 
@@ -315,6 +341,7 @@ public:
     // These are Stoppable-related
     std::unique_ptr <JobQueue> m_jobQueue;
     std::unique_ptr <NodeStore::Database> m_nodeStore;
+    std::unique_ptr <NodeStore::Database> m_shardStore;
     detail::AppFamily family_;
     // VFALCO TODO Make OrderBookDB abstract
     OrderBookDB m_orderBookDB;
@@ -333,6 +360,8 @@ public:
     std::unique_ptr <AmendmentTable> m_amendmentTable;
     std::unique_ptr <LoadFeeTrack> mFeeTrack;
     std::unique_ptr <HashRouter> mHashRouter;
+    std::unique_ptr <BatchVerifier> batchVerifier_;
+    std::unique_ptr <ConsensusVerifier> consensusVerifier_;
     RCLValidations mValidations;
     std::unique_ptr <LoadManager> m_loadManager;
     std::unique_ptr <TxQ> txQ_;
@@ -344,6 +373,8 @@ public:
     std::unique_ptr <DatabaseCon> mTxnDB;
     std::unique_ptr <DatabaseCon> mLedgerDB;
     std::unique_ptr <DatabaseCon> mWalletDB;
+    std::unique_ptr <HistoryStore> historyStore_;
+    std::unique_ptr <LedgerSQLWriter> m_ledgerSQLWriter;
     std::unique_ptr <Overlay> m_overlay;
     std::vector <std::unique_ptr<Stoppable>> websocketServers_;
 
@@ -410,7 +441,8 @@ public:
         //
         , m_jobQueue (std::make_unique<JobQueue>(
             m_collectorManager->group ("jobq"), m_nodeStoreScheduler,
-            logs_->journal("JobQueue"), *logs_))
+            logs_->journal("JobQueue"), *logs_,
+            setup_JobQueue (*config_)))
 
         //
         // Anything which calls addJob must be a descendant of the JobQueue
@@ -418,6 +450,12 @@ public:
         , m_nodeStore (
             m_shaMapStore->makeDatabase ("NodeStore.main", 4, *m_jobQueue))
 
+        , m_shardStore (config_->exists (ConfigSection::shardDatabase ()) ?
+            NodeStore::Manager::instance ().make_DatabaseShard (
+                "ShardStore", m_nodeStoreScheduler, 1, *m_jobQueue,
+                    config_->section (ConfigSection::shardDatabase ()),
+                        logs_->journal ("ShardStore")) : nullptr)
+
         , family_ (*this, *m_nodeStore, *m_collectorManager)
 
         , m_orderBookDB (*this, *m_jobQueue)
@@ -478,6 +516,14 @@ public:
             stopwatch(), HashRouter::getDefaultHoldTime (),
             HashRouter::getDefaultRecoverLimit ()))
 
+        , batchVerifier_ (std::make_unique<BatchVerifier> (*m_jobQueue,
+            setup_BatchVerifier (*config_),
+            *mHashRouter, logs_->journal("BatchVerifier")))
+
+        , consensusVerifier_ (std::make_unique<ConsensusVerifier> (
+            *m_jobQueue, setup_ConsensusVerifier (*config_),
+            logs_->journal("ConsensusVerifier")))
+
         , mValidations (ValidationParms(),stopwatch(), logs_->journal("Validations"),
             *this)
 
@@ -519,6 +565,8 @@ public:
 
         // VFALCO HACK
         m_nodeStoreScheduler.setJobQueue (*m_jobQueue);
+        m_nodeStoreScheduler.setCollector (
+            m_collectorManager->group ("nodestore"));
 
         add (m_ledgerMaster->getPropertySource ());
     }
@@ -639,6 +687,12 @@ public:
         return *m_nodeStore;
     }
 
+    NodeStore::DatabaseShard* getShardStore () override
+    {
+        return dynamic_cast <NodeStore::DatabaseShard*> (
+            m_shardStore.get ());
+    }
+
     Application::MutexType& getMasterMutex () override
     {
         return m_masterMutex;
@@ -685,6 +739,16 @@ public:
         return *mHashRouter;
     }
 
+    BatchVerifier& getBatchVerifier () override
+    {
+        return *batchVerifier_;
+    }
+
+    ConsensusVerifier& getConsensusVerifier () override
+    {
+        return *consensusVerifier_;
+    }
+
     RCLValidations& getValidations () override
     {
         return mValidations;
@@ -769,6 +833,16 @@ public:
         assert (mWalletDB.get() != nullptr);
         return *mWalletDB;
     }
+    HistoryStore& getHistoryStore () override
+    {
+        assert (historyStore_.get() != nullptr);
+        return *historyStore_;
+    }
+    LedgerSQLWriter& getLedgerSQLWriter () override
+    {
+        assert (m_ledgerSQLWriter.get() != nullptr);
+        return *m_ledgerSQLWriter;
+    }
 
     bool serverOkay (std::string& reason) override;
 
@@ -788,6 +862,13 @@ public:
                 LedgerDBInit, LedgerDBCount);
         mWalletDB = std::make_unique <DatabaseCon> (setup, "wallet.db",
                 WalletDBInit, WalletDBCount);
+        historyStore_ = make_HistoryStore (
+            config_->section (ConfigSection::historyDatabase ()),
+                setup, *mTxnDB, accountIDCache_,
+                    logs_->journal ("HistoryStore"));
+        m_ledgerSQLWriter = std::make_unique <LedgerSQLWriter> (
+            *m_jobQueue, *mLedgerDB, *historyStore_,
+                logs_->journal ("LedgerSQLWriter"));
 
         return
             mTxnDB.get () != nullptr &&
@@ -998,6 +1079,8 @@ public:
         family().fullbelow().sweep ();
         getMasterTransaction().sweep();
         getNodeStore().sweep();
+        if (m_shardStore)
+            m_shardStore->sweep();
         getLedgerMaster().sweep();
         getTempNodeCache().sweep();
         getValidations().expire();
@@ -1100,6 +1183,7 @@ bool ApplicationImp::setup()
                             (config_->getSize (siTxnDBCache) * 1024));
 
     mTxnDB->setupCheckpointing (m_jobQueue.get(), logs());
+    historyStore_->setupCheckpointing (m_jobQueue.get(), logs());
     mLedgerDB->setupCheckpointing (m_jobQueue.get(), logs());
 
     if (!updateTables ())
@@ -1210,6 +1294,25 @@ bool ApplicationImp::setup()
     family().treecache().setTargetSize (config_->getSize (siTreeCacheSize));
     family().treecache().setTargetAge (config_->getSize (siTreeCacheAge));
 
+    if (config_->MEMORY_LIMIT != 0)
+    {
+        // Share the memory limit between the caches by weight.
+        // A share of 0 would mean no limit, so the least is 1 byte.
+        auto const total = config_->NODE_CACHE_WEIGHT +
+            config_->TREE_CACHE_WEIGHT + config_->FULL_BELOW_WEIGHT;
+        auto const share = [&](std::uint32_t weight)
+        {
+            return std::max<std::size_t> (static_cast<std::size_t> (
+                config_->MEMORY_LIMIT * weight / total), 1);
+        };
+
+        m_nodeStore->setCacheBytes (share (config_->NODE_CACHE_WEIGHT));
+        family().treecache().setTargetBytes (
+            share (config_->TREE_CACHE_WEIGHT));
+        family().fullbelow().setTargetBytes (
+            share (config_->FULL_BELOW_WEIGHT));
+    }
+
     //----------------------------------------------------------------------
     //
     // Server
@@ -1368,6 +1471,11 @@ int ApplicationImp::fdlimit() const
     // doubled if online delete is enabled).
     needed += std::max(5, m_shaMapStore->fdlimit());
 
+    // shard backends are opened as they are used, so allow
+    // for at least the one being built.
+    if (m_shardStore)
+        needed += std::max(5, m_shardStore->fdlimit());
+
     // One fd per incoming connection a port can accept, or
     // if no limit is set, assume it'll handle 256 clients.
     for(auto const& p : serverHandler_->setup().ports)
@@ -1996,11 +2104,21 @@ bool ApplicationImp::updateTables ()
                 scheduler, 0, *m_jobQueue,
                 config_->section(ConfigSection::importNodeDatabase ()), j);
 
+        auto const& section =
+            config_->section (ConfigSection::importNodeDatabase ());
+        NodeStore::ImportOptions options;
+        options.writeThreads = std::max (1, std::min (32, get<int> (section,
+            "write_threads", std::thread::hardware_concurrency ())));
+        options.checkpoint = get<std::string> (section, "checkpoint",
+            (boost::filesystem::path (config_->legacy ("database_path")) /
+                "import.checkpoint").string ());
+
         JLOG (j.warn())
             << "Node import from '" << source->getName () << "' to '"
-            << getNodeStore ().getName () << "'.";
+            << getNodeStore ().getName () << "' with "
+            << options.writeThreads << " writers.";
 
-        getNodeStore().import (*source);
+        getNodeStore().import (*source, options);
     }
 
     return true;
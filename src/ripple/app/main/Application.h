@@ -35,12 +35,14 @@ namespace ripple {
 
 namespace unl { class Manager; }
 namespace Resource { class Manager; }
-namespace NodeStore { class Database; }
+namespace NodeStore { class Database; class DatabaseShard; }
 
 // VFALCO TODO Fix forward declares required for header dependency loops
 class AmendmentTable;
+class BatchVerifier;
 class CachedSLEs;
 class CollectorManager;
+class ConsensusVerifier;
 class Family;
 class HashRouter;
 class Logs;
@@ -50,6 +52,8 @@ class InboundLedgers;
 class InboundTransactions;
 class AcceptedLedger;
 class LedgerMaster;
+class LedgerSQLWriter;
+class HistoryStore;
 class LoadManager;
 class ManifestCache;
 class NetworkOPs;
@@ -127,6 +131,8 @@ public:
     virtual CachedSLEs&             cachedSLEs() = 0;
     virtual AmendmentTable&         getAmendmentTable() = 0;
     virtual HashRouter&             getHashRouter () = 0;
+    virtual BatchVerifier&          getBatchVerifier () = 0;
+    virtual ConsensusVerifier&      getConsensusVerifier () = 0;
     virtual LoadFeeTrack&           getFeeTrack () = 0;
     virtual LoadManager&            getLoadManager () = 0;
     virtual Overlay&                overlay () = 0;
@@ -138,6 +144,8 @@ public:
     virtual Cluster&                cluster () = 0;
     virtual RCLValidations&         getValidations () = 0;
     virtual NodeStore::Database&    getNodeStore () = 0;
+    /** The shard store, or nullptr if none is configured. */
+    virtual NodeStore::DatabaseShard* getShardStore () = 0;
     virtual InboundLedgers&         getInboundLedgers () = 0;
     virtual InboundTransactions&    getInboundTransactions () = 0;
     virtual TaggedCache <uint256, AcceptedLedger>&
@@ -164,6 +172,8 @@ public:
     virtual OpenLedger const&       openLedger() const = 0;
     virtual DatabaseCon& getTxnDB () = 0;
     virtual DatabaseCon& getLedgerDB () = 0;
+    virtual LedgerSQLWriter& getLedgerSQLWriter () = 0;
+    virtual HistoryStore& getHistoryStore () = 0;
 
     virtual std::chrono::milliseconds getIOLatency () = 0;
 
@@ -32,6 +32,7 @@
 #include <ripple/crypto/csprng.h>
 #include <ripple/json/to_string.h>
 #include <ripple/net/RPCCall.h>
+#include <ripple/nodestore/Manager.h>
 #include <ripple/resource/Fees.h>
 #include <ripple/rpc/RPCHandler.h>
 #include <ripple/protocol/BuildInfo.h>
@@ -140,6 +141,7 @@ void printHelp (const po::options_description& desc)
            "     fetch_info [clear]\n"
            "     gateway_balances [<ledger>] <issuer_account> [ <hotwallet> [ <hotwallet> ]]\n"
            "     get_counts\n"
+           "     job_latency\n"
            "     json <method> <json>\n"
            "     ledger [<id>|current|closed|validated] [full]\n"
            "     ledger_accept\n"
@@ -242,6 +244,8 @@ int run (int argc, char** argv)
     ("debug", "Enable normally suppressed debug logging")
     ("fg", "Run in the foreground.")
     ("import", importText.c_str ())
+    ("train_dictionary", "Train compression dictionaries from the objects "
+        "in the NuDB node database and add them to its dictionary file.")
     ("version", "Display the build version.")
     ;
 
@@ -310,6 +314,21 @@ int run (int argc, char** argv)
             crypto_prng().load_state(entropy.string ());
     }
 
+    if (vm.count ("train_dictionary"))
+    {
+        try
+        {
+            NodeStore::trainDictionaries (config->section (
+                ConfigSection::nodeDatabase ()), 20000, 32 * 1024, std::cout);
+        }
+        catch (std::exception const& e)
+        {
+            std::cerr << "Dictionary training failed: " << e.what () << '\n';
+            return -1;
+        }
+        return 0;
+    }
+
     if (vm.count ("start"))
         config->START_UP = Config::FRESH;
 
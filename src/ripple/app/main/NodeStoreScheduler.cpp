@@ -33,6 +33,14 @@ void NodeStoreScheduler::setJobQueue (JobQueue& jobQueue)
     m_jobQueue = &jobQueue;
 }
 
+void NodeStoreScheduler::setCollector (
+    beast::insight::Group::ptr const& group)
+{
+    m_writeLatency = group->make_event ("write_latency");
+    m_writeBatch = group->make_event ("write_batch");
+    m_writeQueue = group->make_event ("write_queue");
+}
+
 void NodeStoreScheduler::onStop ()
 {
 }
@@ -84,6 +92,11 @@ void NodeStoreScheduler::onBatchWrite (NodeStore::BatchWriteReport const& report
 {
     m_jobQueue->addLoadEvents (jtNS_WRITE,
         report.writeCount, report.elapsed);
+
+    using value_type = beast::insight::Event::value_type;
+    m_writeLatency.notify (report.elapsed);
+    m_writeBatch.notify (value_type (report.writeCount));
+    m_writeQueue.notify (value_type (report.queueDepth));
 }
 
 } // ripple
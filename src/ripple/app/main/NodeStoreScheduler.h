@@ -23,6 +23,8 @@
 #include <ripple/nodestore/Scheduler.h>
 #include <ripple/core/JobQueue.h>
 #include <ripple/core/Stoppable.h>
+#include <ripple/beast/insight/Event.h>
+#include <ripple/beast/insight/Group.h>
 #include <atomic>
 
 namespace ripple {
@@ -40,6 +42,9 @@ public:
     //
     void setJobQueue (JobQueue& jobQueue);
 
+    /** Report batch writes to the insight metrics in a group. */
+    void setCollector (beast::insight::Group::ptr const& group);
+
     void onStop () override;
     void onChildrenStopped () override;
     void scheduleTask (NodeStore::Task& task) override;
@@ -51,6 +56,13 @@ private:
 
     JobQueue* m_jobQueue {nullptr};
     std::atomic <int> m_taskCount {0};
+
+    // Milliseconds taken by each batch write
+    beast::insight::Event m_writeLatency;
+    // Objects in each batch write
+    beast::insight::Event m_writeBatch;
+    // Objects waiting to be written when each batch started
+    beast::insight::Event m_writeQueue;
 };
 
 } // ripple
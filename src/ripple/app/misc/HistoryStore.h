@@ -0,0 +1,171 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#ifndef RIPPLE_APP_MISC_HISTORYSTORE_H_INCLUDED
+#define RIPPLE_APP_MISC_HISTORYSTORE_H_INCLUDED
+
+#include <ripple/basics/BasicConfig.h>
+#include <ripple/basics/Blob.h>
+#include <ripple/basics/base_uint.h>
+#include <ripple/core/DatabaseCon.h>
+#include <ripple/protocol/AccountID.h>
+#include <ripple/protocol/Protocol.h>
+#include <ripple/beast/utility/Journal.h>
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ripple {
+
+struct LedgerSQLRows;
+
+/** Stores the transactions of validated ledgers, indexed by account.
+
+    This holds what the Transactions and AccountTransactions tables
+    hold in the transaction database. Transactions are ordered within
+    an account's history by ledger sequence and then by their index
+    in the ledger.
+
+    @note All functions may be called concurrently.
+*/
+class HistoryStore
+{
+public:
+    /** A transaction and where it was applied.
+        The transaction's index in its ledger is only known when
+        it was found through an account's history.
+    */
+    struct Tx
+    {
+        std::uint32_t ledgerSeq = 0;
+        std::uint32_t txnSeq = 0;
+        boost::optional<std::string> status;
+        Blob raw;
+        Blob meta;
+    };
+
+    /** The position of a transaction in an account's history. */
+    struct Position
+    {
+        std::uint32_t ledgerSeq = 0;
+        std::uint32_t txnSeq = 0;
+    };
+
+    virtual ~HistoryStore() = default;
+
+    /** Get the human-readable name of the store. */
+    virtual
+    std::string
+    getName() = 0;
+
+    /** Checkpoint the write-ahead logs of the store's SQLite
+        databases using the job queue.
+    */
+    virtual
+    void
+    setupCheckpointing (JobQueue*, Logs&)
+    {
+    }
+
+    /** Record the transactions of a validated ledger.
+        Transactions previously recorded for the same ledger
+        sequence are replaced.
+        @note This is never called concurrently with itself.
+        @throws std::exception if the transactions were not recorded.
+    */
+    virtual
+    void
+    saveTransactions (LedgerSQLRows const& rows) = 0;
+
+    /** Returns a transaction, if it was recorded.
+        The metadata may not be returned.
+    */
+    virtual
+    boost::optional<Tx>
+    getTransaction (uint256 const& id) = 0;
+
+    /** Visit the transactions affecting an account in order.
+
+        @param minLedger The first ledger to include.
+        @param maxLedger The last ledger to include.
+        @param forward `true` to visit the oldest transactions first.
+        @param start If set, the position of the first transaction
+                     to visit.
+        @param limit The largest number of transactions to visit.
+        @param f Called with the position and details of each
+                 transaction.
+    */
+    virtual
+    void
+    forEachAccountTx (AccountID const& account,
+        std::uint32_t minLedger, std::uint32_t maxLedger,
+        bool forward, boost::optional<Position> const& start,
+        std::uint32_t limit, std::function<void(Tx&&)> const& f) = 0;
+
+    /** Returns the transactions affecting an account in order,
+        skipping the first `offset` of them.
+    */
+    virtual
+    std::vector<Tx>
+    getAccountTxs (AccountID const& account,
+        std::uint32_t minLedger, std::uint32_t maxLedger,
+        bool descending, std::uint32_t offset, std::uint32_t limit) = 0;
+
+    /** Returns recent transactions, newest first, skipping the
+        first `offset` of them. The metadata may not be returned.
+    */
+    virtual
+    std::vector<Tx>
+    getTxHistory (std::uint32_t offset, std::uint32_t limit) = 0;
+
+    /** Returns the lowest ledger sequence with recorded transactions. */
+    virtual
+    boost::optional<LedgerIndex>
+    getMinLedgerSeq() = 0;
+
+    /** Remove the transactions of every ledger before `seq`. */
+    virtual
+    void
+    deleteBeforeLedgerSeq (LedgerIndex seq) = 0;
+};
+
+//------------------------------------------------------------------------------
+
+/** Create the history store described by the [history_db] section.
+
+    The default type, "sqlite", uses the tables of the transaction
+    database, or a database for each range of ledgers if
+    `ledgers_per_partition` is set. The "rocksdb" type keeps an embedded
+    key/value database in `path`, or in the database path if unset.
+*/
+std::unique_ptr<HistoryStore>
+make_HistoryStore (
+    Section const& section,
+    DatabaseCon::Setup const& setup,
+    DatabaseCon& txnDB,
+    AccountIDCache const& idCache,
+    beast::Journal journal);
+
+} // ripple
+
+#endif
@@ -33,7 +33,9 @@
 #include <ripple/app/ledger/TransactionMaster.h>
 #include <ripple/app/main/LoadManager.h>
 #include <ripple/app/misc/HashRouter.h>
+#include <ripple/app/misc/HistoryStore.h>
 #include <ripple/app/misc/LoadFeeTrack.h>
+#include <ripple/app/misc/SHAMapStore.h>
 #include <ripple/app/misc/Transaction.h>
 #include <ripple/app/misc/TxQ.h>
 #include <ripple/app/misc/ValidatorKeys.h>
@@ -46,6 +48,7 @@
 #include <ripple/crypto/csprng.h>
 #include <ripple/crypto/RFC1751.h>
 #include <ripple/json/to_string.h>
+#include <ripple/nodestore/DatabaseShard.h>
 #include <ripple/overlay/Cluster.h>
 #include <ripple/overlay/Overlay.h>
 #include <ripple/overlay/predicates.h>
@@ -374,12 +377,12 @@ public:
         return m_localTX->size ();
     }
 
-    //Helper function to generate SQL query to get transactions.
-    std::string transactionsSQL (
-        std::string selection, AccountID const& account,
+    // Helper function to get a page of an account's transactions.
+    std::vector<HistoryStore::Tx> accountTxs (
+        AccountID const& account,
         std::int32_t minLedger, std::int32_t maxLedger,
         bool descending, std::uint32_t offset, int limit,
-        bool binary, bool count, bool bUnlimited);
+        bool binary, bool bUnlimited);
 
     // Client information retrieval functions.
     using NetworkOPs::AccountTxs;
@@ -1858,23 +1861,18 @@ void NetworkOPsImp::setMode (OperatingMode om)
 }
 
 
-std::string
-NetworkOPsImp::transactionsSQL (
-    std::string selection, AccountID const& account,
+std::vector<HistoryStore::Tx>
+NetworkOPsImp::accountTxs (
+    AccountID const& account,
     std::int32_t minLedger, std::int32_t maxLedger, bool descending,
-    std::uint32_t offset, int limit,
-    bool binary, bool count, bool bUnlimited)
+    std::uint32_t offset, int limit, bool binary, bool bUnlimited)
 {
     std::uint32_t NONBINARY_PAGE_LENGTH = 200;
     std::uint32_t BINARY_PAGE_LENGTH = 500;
 
     std::uint32_t numberOfResults;
 
-    if (count)
-    {
-        numberOfResults = 1000000000;
-    }
-    else if (limit < 0)
+    if (limit < 0)
     {
         numberOfResults = binary ? BINARY_PAGE_LENGTH : NONBINARY_PAGE_LENGTH;
     }
@@ -1889,57 +1887,11 @@ NetworkOPsImp::transactionsSQL (
         numberOfResults = limit;
     }
 
-    std::string maxClause = "";
-    std::string minClause = "";
-
-    if (maxLedger != -1)
-    {
-        maxClause = boost::str (boost::format (
-            "AND AccountTransactions.LedgerSeq <= '%u'") % maxLedger);
-    }
-
-    if (minLedger != -1)
-    {
-        minClause = boost::str (boost::format (
-            "AND AccountTransactions.LedgerSeq >= '%u'") % minLedger);
-    }
-
-    std::string sql;
-
-    if (count)
-        sql =
-            boost::str (boost::format (
-                "SELECT %s FROM AccountTransactions "
-                "WHERE Account = '%s' %s %s LIMIT %u, %u;")
-            % selection
-            % app_.accountIDCache().toBase58(account)
-            % maxClause
-            % minClause
-            % beast::lexicalCastThrow <std::string> (offset)
-            % beast::lexicalCastThrow <std::string> (numberOfResults)
-        );
-    else
-        sql =
-            boost::str (boost::format (
-                "SELECT %s FROM "
-                "AccountTransactions INNER JOIN Transactions "
-                "ON Transactions.TransID = AccountTransactions.TransID "
-                "WHERE Account = '%s' %s %s "
-                "ORDER BY AccountTransactions.LedgerSeq %s, "
-                "AccountTransactions.TxnSeq %s, AccountTransactions.TransID %s "
-                "LIMIT %u, %u;")
-                    % selection
-                    % app_.accountIDCache().toBase58(account)
-                    % maxClause
-                    % minClause
-                    % (descending ? "DESC" : "ASC")
-                    % (descending ? "DESC" : "ASC")
-                    % (descending ? "DESC" : "ASC")
-                    % beast::lexicalCastThrow <std::string> (offset)
-                    % beast::lexicalCastThrow <std::string> (numberOfResults)
-                   );
-    JLOG(m_journal.trace()) << "txSQL query: " << sql;
-    return sql;
+    return app_.getHistoryStore().getAccountTxs (account,
+        minLedger == -1 ? 0 : minLedger,
+        maxLedger == -1 ?
+            std::numeric_limits<std::uint32_t>::max () : maxLedger,
+        descending, offset, numberOfResults);
 }
 
 NetworkOPs::AccountTxs NetworkOPsImp::getAccountTxs (
@@ -1950,61 +1902,27 @@ NetworkOPs::AccountTxs NetworkOPsImp::getAccountTxs (
     // can be called with no locks
     AccountTxs ret;
 
-    std::string sql = transactionsSQL (
-        "AccountTransactions.LedgerSeq,Status,RawTxn,TxnMeta", account,
-        minLedger, maxLedger, descending, offset, limit, false, false,
-        bUnlimited);
-
+    for (auto const& tx : accountTxs (account, minLedger, maxLedger,
+        descending, offset, limit, false, bUnlimited))
     {
-        auto db = app_.getTxnDB ().checkoutDb ();
-
-        boost::optional<std::uint64_t> ledgerSeq;
-        boost::optional<std::string> status;
-        soci::blob sociTxnBlob (*db), sociTxnMetaBlob (*db);
-        soci::indicator rti, tmi;
-        Blob rawTxn, txnMeta;
-
-        soci::statement st =
-                (db->prepare << sql,
-                 soci::into(ledgerSeq),
-                 soci::into(status),
-                 soci::into(sociTxnBlob, rti),
-                 soci::into(sociTxnMetaBlob, tmi));
-
-        st.execute ();
-        while (st.fetch ())
-        {
-            if (soci::i_ok == rti)
-                convert(sociTxnBlob, rawTxn);
-            else
-                rawTxn.clear ();
-
-            if (soci::i_ok == tmi)
-                convert (sociTxnMetaBlob, txnMeta);
-            else
-                txnMeta.clear ();
-
-            auto txn = Transaction::transactionFromSQL (
-                ledgerSeq, status, rawTxn, app_);
-
-            if (txnMeta.empty ())
-            { // Work around a bug that could leave the metadata missing
-                auto const seq = rangeCheckedCast<std::uint32_t>(
-                    ledgerSeq.value_or (0));
+        auto txn = Transaction::transactionFromSQL (
+            boost::optional<std::uint64_t> (tx.ledgerSeq), tx.status,
+            tx.raw, app_);
 
-                JLOG(m_journal.warn()) <<
-                    "Recovering ledger " << seq <<
-                    ", txn " << txn->getID();
-
-                if (auto l = m_ledgerMaster.getLedgerBySeq(seq))
-                    pendSaveValidated(app_, l, false, false);
-            }
+        if (tx.meta.empty ())
+        { // Work around a bug that could leave the metadata missing
+            JLOG(m_journal.warn()) <<
+                "Recovering ledger " << tx.ledgerSeq <<
+                ", txn " << txn->getID();
 
-            if (txn)
-                ret.emplace_back (txn, std::make_shared<TxMeta> (
-                    txn->getID (), txn->getLedger (), txnMeta,
-                        app_.journal("TxMeta")));
+            if (auto l = m_ledgerMaster.getLedgerBySeq(tx.ledgerSeq))
+                pendSaveValidated(app_, l, false, false);
         }
+
+        if (txn)
+            ret.emplace_back (txn, std::make_shared<TxMeta> (
+                txn->getID (), txn->getLedger (), tx.meta,
+                    app_.journal("TxMeta")));
     }
 
     return ret;
@@ -2018,42 +1936,11 @@ std::vector<NetworkOPsImp::txnMetaLedgerType> NetworkOPsImp::getAccountTxsB (
     // can be called with no locks
     std::vector<txnMetaLedgerType> ret;
 
-    std::string sql = transactionsSQL (
-        "AccountTransactions.LedgerSeq,Status,RawTxn,TxnMeta", account,
-        minLedger, maxLedger, descending, offset, limit, true/*binary*/, false,
-        bUnlimited);
-
+    for (auto const& tx : accountTxs (account, minLedger, maxLedger,
+        descending, offset, limit, true/*binary*/, bUnlimited))
     {
-        auto db = app_.getTxnDB ().checkoutDb ();
-
-        boost::optional<std::uint64_t> ledgerSeq;
-        boost::optional<std::string> status;
-        soci::blob sociTxnBlob (*db), sociTxnMetaBlob (*db);
-        soci::indicator rti, tmi;
-
-        soci::statement st =
-                (db->prepare << sql,
-                 soci::into(ledgerSeq),
-                 soci::into(status),
-                 soci::into(sociTxnBlob, rti),
-                 soci::into(sociTxnMetaBlob, tmi));
-
-        st.execute ();
-        while (st.fetch ())
-        {
-            Blob rawTxn;
-            if (soci::i_ok == rti)
-                convert (sociTxnBlob, rawTxn);
-            Blob txnMeta;
-            if (soci::i_ok == tmi)
-                convert (sociTxnMetaBlob, txnMeta);
-
-            auto const seq =
-                rangeCheckedCast<std::uint32_t>(ledgerSeq.value_or (0));
-
-            ret.emplace_back (
-                strHex (rawTxn), strHex (txnMeta), seq);
-        }
+        ret.emplace_back (
+            strHex (tx.raw), strHex (tx.meta), tx.ledgerSeq);
     }
 
     return ret;
@@ -2072,7 +1959,7 @@ NetworkOPsImp::getTxsAccount (
 
     auto bound = [&ret, &app](
         std::uint32_t ledger_index,
-        std::string const& status,
+        boost::optional<std::string> const& status,
         Blob const& rawTxn,
         Blob const& rawMeta)
     {
@@ -2080,7 +1967,7 @@ NetworkOPsImp::getTxsAccount (
             ret, ledger_index, status, rawTxn, rawMeta, app);
     };
 
-    accountTxPage(app_.getTxnDB (), app_.accountIDCache(),
+    accountTxPage(app_.getHistoryStore (),
         std::bind(saveLedgerAsync, std::ref(app_),
             std::placeholders::_1), bound, account, minLedger,
                 maxLedger, forward, token, limit, bUnlimited,
@@ -2101,14 +1988,14 @@ NetworkOPsImp::getTxsAccountB (
 
     auto bound = [&ret](
         std::uint32_t ledgerIndex,
-        std::string const& status,
+        boost::optional<std::string> const& status,
         Blob const& rawTxn,
         Blob const& rawMeta)
     {
         ret.emplace_back (strHex(rawTxn), strHex (rawMeta), ledgerIndex);
     };
 
-    accountTxPage(app_.getTxnDB (), app_.accountIDCache(),
+    accountTxPage(app_.getHistoryStore (),
         std::bind(saveLedgerAsync, std::ref(app_),
             std::placeholders::_1), bound, account, minLedger,
                 maxLedger, forward, token, limit, bUnlimited,
@@ -2202,8 +2089,17 @@ Json::Value NetworkOPsImp::getServerInfo (bool human, bool admin)
     //  info[jss::consensus] = mConsensus.getJson();
 
     if (admin)
+    {
         info[jss::load] = m_job_queue.getJson ();
 
+        auto onlineDelete = app_.getSHAMapStore().getJson();
+        if (! onlineDelete.isNull())
+            info[jss::online_delete] = std::move (onlineDelete);
+
+        if (auto const shards = app_.getShardStore ())
+            info[jss::complete_shards] = shards->getCompleteShards ();
+    }
+
     auto const escalationMetrics = app_.getTxQ().getMetrics(
         *app_.openLedger().current());
 
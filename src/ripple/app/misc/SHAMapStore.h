@@ -48,6 +48,7 @@ public:
         std::uint32_t deleteBatch = 100;
         std::uint32_t backOff = 100;
         std::int32_t ageThreshold = 60;
+        std::uint32_t copyThreads = 4;
     };
 
     SHAMapStore (Stoppable& parent) : Stoppable ("SHAMapStore", parent) {}
@@ -77,6 +78,9 @@ public:
 
     /** The number of files that are needed. */
     virtual int fdlimit() const = 0;
+
+    /** Online delete status, or null if online delete is disabled. */
+    virtual Json::Value getJson() = 0;
 };
 
 //------------------------------------------------------------------------------
@@ -23,6 +23,7 @@
 #include <ripple/app/ledger/TransactionMaster.h>
 #include <ripple/app/misc/NetworkOPs.h>
 #include <ripple/core/ConfigSections.h>
+#include <ripple/protocol/JsonFields.h>
 #include <ripple/beast/core/CurrentThreadName.h>
 
 namespace ripple {
@@ -239,6 +240,10 @@ SHAMapStoreImp::makeDatabase (std::string const& name,
         fdlimit_ = db->fdlimit();
     }
 
+    std::string trace;
+    if (get_if_exists (setup_.nodeDatabase, "trace", trace) && ! trace.empty())
+        db->setTrace (std::make_unique <NodeStore::TraceWriter> (trace));
+
     return db;
 }
 
@@ -273,19 +278,201 @@ SHAMapStoreImp::fdlimit () const
     return fdlimit_;
 }
 
+Json::Value
+SHAMapStoreImp::getJson()
+{
+    if (! setup_.deleteInterval)
+        return Json::nullValue;
+
+    Json::Value ret (Json::objectValue);
+    ret[jss::last_rotated] = state_db_.getState().lastRotated;
+
+    std::lock_guard <std::mutex> lock (mutex_);
+    if (! progress_.state)
+        return ret;
+
+    // A copy that is still running has no end time
+    auto const end = progress_.end < progress_.start ?
+        clock_type::now() : progress_.end;
+    auto const elapsed = std::chrono::duration_cast<
+        std::chrono::microseconds> (end - progress_.start);
+    std::uint64_t const visited = progress_.visited;
+
+    Json::Value& copy = ret[jss::state_copy] = Json::objectValue;
+    copy[jss::state] = progress_.state;
+    copy[jss::ledger_index] = progress_.seq;
+    copy[jss::branches_done] = progress_.branches.load();
+    copy[jss::nodes_visited] = static_cast<Json::UInt> (visited);
+    copy[jss::nodes_copied] = static_cast<Json::UInt> (progress_.copied);
+    copy[jss::subtrees_skipped] = static_cast<Json::UInt> (progress_.skipped);
+    copy[jss::duration_us] = std::to_string (elapsed.count());
+    copy[jss::nodes_per_second] = static_cast<Json::UInt> (
+        elapsed.count() ? visited * 1000000 / elapsed.count() : 0);
+    return ret;
+}
+
 bool
-SHAMapStoreImp::copyNode (std::uint64_t& nodeCount,
-        SHAMapAbstractNode const& node)
+SHAMapStoreImp::copyState (SHAMap const& map, LedgerIndex seq)
 {
-    // Copy a single record from node to database_
-    database_->fetchNode (node.getNodeHash().as_uint256());
-    if (! (++nodeCount % checkHealthInterval_))
     {
-        if (health())
-            return true;
+        std::lock_guard <std::mutex> lock (mutex_);
+        progress_.seq = seq;
+        progress_.state = "running";
+        progress_.start = clock_type::now();
+        progress_.end = {};
+    }
+    progress_.visited = 0;
+    progress_.copied = 0;
+    progress_.skipped = 0;
+    progress_.branches = 0;
+
+    auto const rootHash = map.getHash().as_uint256();
+
+    std::atomic<bool> stop {false};
+    std::atomic<bool> failed {false};
+    std::atomic<int> next {0};
+
+    // Each thread takes the subtrees below the root's branches in turn
+    auto copy = [&](std::vector<uint256>& complete)
+    {
+        std::vector<uint256> batch;
+        std::vector<uint256> pending;
+        int depth = 0;
+
+        batch.reserve (copyBatchSize_);
+
+        // Subtrees only count as copied once their records are written
+        auto flush = [&]
+        {
+            if (! batch.empty())
+            {
+                progress_.copied += database_->copyNodes (batch);
+                batch.clear();
+            }
+            complete.insert (complete.end(), pending.begin(), pending.end());
+            pending.clear();
+        };
+
+        auto visit = [&](SHAMapAbstractNode& node)
+        {
+            if (stop)
+                return true;
+
+            auto const& hash = node.getNodeHash().as_uint256();
+            ++progress_.visited;
+            if (node.isInner())
+            {
+                if (copied_.count (hash))
+                {
+                    ++progress_.skipped;
+                    return true;
+                }
+                ++depth;
+            }
+
+            batch.push_back (hash);
+            if (batch.size() >= copyBatchSize_)
+                flush();
+            return false;
+        };
+
+        auto done = [&](SHAMapInnerNode& node)
+        {
+            // Once stopped, children may have been skipped
+            if (depth-- <= copiedDepth_ && ! stop)
+                pending.push_back (node.getNodeHash().as_uint256());
+        };
+
+        try
+        {
+            int branch;
+            while (! stop && (branch = next++) < 16)
+            {
+                map.visitSubtree (branch, visit, done);
+                if (! stop)
+                    ++progress_.branches;
+            }
+            flush();
+        }
+        catch (std::exception const& e)
+        {
+            JLOG(journal_.warn()) << "copy of ledger " << seq <<
+                " failed: " << e.what();
+            failed = true;
+            stop = true;
+        }
+    };
+
+    if (! copied_.count (rootHash))
+    {
+        auto const threads = setup_.copyThreads;
+        std::vector<std::vector<uint256>> complete (threads);
+        std::vector<std::thread> workers;
+        std::mutex m;
+        std::condition_variable cv;
+        std::size_t running = threads;
+
+        workers.reserve (threads);
+        for (std::size_t i = 0; i < threads; ++i)
+        {
+            workers.emplace_back (
+                [&, i]
+                {
+                    beast::setCurrentThreadName (
+                        "SHAMapStore copy #" + std::to_string (i));
+                    copy (complete[i]);
+                    {
+                        std::lock_guard <std::mutex> lock (m);
+                        --running;
+                    }
+                    cv.notify_one();
+                });
+        }
+
+        {
+            std::unique_lock <std::mutex> lock (m);
+            while (! cv.wait_for (lock, checkHealthPeriod_,
+                [&] { return running == 0; }))
+            {
+                lock.unlock();
+                if (health())
+                    stop = true;
+                lock.lock();
+            }
+        }
+
+        for (auto& worker : workers)
+            worker.join();
+
+        for (auto const& c : complete)
+            copied_.insert (c.begin(), c.end());
+
+        if (! stop)
+        {
+            ++progress_.visited;
+            progress_.copied += database_->copyNodes ({rootHash});
+            copied_.insert (rootHash);
+        }
+    }
+    else
+    {
+        progress_.branches = 16;
+    }
+
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        progress_.state = failed ? "failed" :
+            stop ? "aborted" : "complete";
+        progress_.end = clock_type::now();
     }
 
-    return false;
+    JLOG(journal_.debug()) << "copied ledger " << seq <<
+        (failed ? " (failed)" : stop ? " (aborted)" : "") <<
+        " visited " << progress_.visited <<
+        " copied " << progress_.copied <<
+        " skipped " << progress_.skipped;
+
+    return stop;
 }
 
 void
@@ -297,7 +484,7 @@ SHAMapStoreImp::run()
     ledgerMaster_ = &app_.getLedgerMaster();
     fullBelowCache_ = &app_.family().fullbelow();
     treeNodeCache_ = &app_.family().treecache();
-    transactionDb_ = &app_.getTxnDB();
+    history_ = &app_.getHistoryStore();
     ledgerDb_ = &app_.getLedgerDB();
 
     if (setup_.advisoryDelete)
@@ -366,13 +553,8 @@ SHAMapStoreImp::run()
                     ;
             }
 
-            std::uint64_t nodeCount = 0;
-            validatedLedger->stateMap().snapShot (
-                    false)->visitNodes (
-                    std::bind (&SHAMapStoreImp::copyNode, this,
-                    std::ref(nodeCount), std::placeholders::_1));
-            JLOG(journal_.debug()) << "copied ledger " << validatedSeq
-                    << " nodecount " << nodeCount;
+            bool const aborted = copyState (
+                *validatedLedger->stateMap().snapShot (false), validatedSeq);
             switch (health())
             {
                 case Health::stopping:
@@ -384,6 +566,8 @@ SHAMapStoreImp::run()
                 default:
                     ;
             }
+            if (aborted)
+                continue;
 
             freshenCaches();
             JLOG(journal_.debug()) << validatedSeq << " freshened caches";
@@ -429,6 +613,7 @@ SHAMapStoreImp::run()
                 clearCaches (validatedSeq);
                 oldBackend = database_->rotateBackends (newBackend);
             }
+            copied_.clear();
             JLOG(journal_.debug()) << "finished rotation " << validatedSeq;
 
             oldBackend->setDeletePath();
@@ -529,7 +714,8 @@ SHAMapStoreImp::makeDatabaseRotating (std::string const& name,
 {
     return NodeStore::Manager::instance().make_DatabaseRotating (
         name, scheduler_, readThreads, parent,
-        writableBackend, archiveBackend, nodeStoreJournal_);
+        writableBackend, archiveBackend,
+        getCachePolicy (setup_.nodeDatabase), nodeStoreJournal_);
 }
 
 bool
@@ -573,6 +759,29 @@ SHAMapStoreImp::clearSql (DatabaseCon& database,
     return true;
 }
 
+bool
+SHAMapStoreImp::clearHistory (LedgerIndex lastRotated)
+{
+    auto min = history_->getMinLedgerSeq ();
+    if (! min || *min > lastRotated || health() != Health::ok)
+        return false;
+
+    JLOG(journal_.debug()) << "start: clearing " << history_->getName () <<
+        " history from " << *min << " to " << lastRotated;
+    while (*min < lastRotated)
+    {
+        *min = std::min(lastRotated, *min + setup_.deleteBatch);
+        history_->deleteBeforeLedgerSeq (*min);
+        if (health())
+            return true;
+        if (*min < lastRotated)
+            std::this_thread::sleep_for (
+                    std::chrono::milliseconds (setup_.backOff));
+    }
+    JLOG(journal_.debug()) << "finished: clearing history";
+    return true;
+}
+
 void
 SHAMapStoreImp::clearCaches (LedgerIndex validatedSeq)
 {
@@ -719,15 +928,7 @@ SHAMapStoreImp::clearPrior (LedgerIndex lastRotated)
     if (health())
         return;
 
-    clearSql (*transactionDb_, lastRotated,
-        "SELECT MIN(LedgerSeq) FROM Transactions;",
-        "DELETE FROM Transactions WHERE LedgerSeq < %u;");
-    if (health())
-        return;
-
-    clearSql (*transactionDb_, lastRotated,
-        "SELECT MIN(LedgerSeq) FROM AccountTransactions;",
-        "DELETE FROM AccountTransactions WHERE LedgerSeq < %u;");
+    clearHistory (lastRotated);
     if (health())
         return;
 }
@@ -824,6 +1025,8 @@ setup_SHAMapStore (Config const& c)
     get_if_exists (setup.nodeDatabase, "delete_batch", setup.deleteBatch);
     get_if_exists (setup.nodeDatabase, "backOff", setup.backOff);
     get_if_exists (setup.nodeDatabase, "age_threshold", setup.ageThreshold);
+    get_if_exists (setup.nodeDatabase, "copy_threads", setup.copyThreads);
+    setup.copyThreads = std::max (1u, std::min (setup.copyThreads, 16u));
 
     return setup;
 }
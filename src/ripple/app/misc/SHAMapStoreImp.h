@@ -22,8 +22,12 @@
 
 #include <ripple/app/misc/SHAMapStore.h>
 #include <ripple/app/ledger/LedgerMaster.h>
+#include <ripple/app/misc/HistoryStore.h>
+#include <ripple/basics/UnorderedContainers.h>
 #include <ripple/core/DatabaseCon.h>
 #include <ripple/nodestore/DatabaseRotating.h>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <thread>
 
@@ -49,6 +53,23 @@ private:
         unhealthy
     };
 
+    using clock_type = std::chrono::steady_clock;
+
+    // Progress of copying the validated state map to the writable backend
+    struct CopyProgress
+    {
+        std::atomic<std::uint64_t> visited {0};
+        std::atomic<std::uint64_t> copied {0};
+        std::atomic<std::uint64_t> skipped {0};
+        std::atomic<int> branches {0};
+
+        // protected by mutex_
+        LedgerIndex seq = 0;
+        char const* state = nullptr;
+        clock_type::time_point start;
+        clock_type::time_point end;
+    };
+
     class SavedStateDB
     {
     public:
@@ -78,6 +99,12 @@ private:
     std::string const dbPrefix_ = "rippledb";
     // check health/stop status as records are copied
     std::uint64_t const checkHealthInterval_ = 1000;
+    // check health/stop status while the state map is copied
+    std::chrono::milliseconds const checkHealthPeriod_ {100};
+    // number of records copied to the writable backend at a time
+    std::size_t const copyBatchSize_ = 256;
+    // deepest inner nodes whose copied subtrees are remembered
+    int const copiedDepth_ = 4;
     // minimum # of ledgers to maintain for health of network
     static std::uint32_t const minimumDeletionInterval_ = 256;
     // minimum # of ledgers required for standalone mode.
@@ -99,13 +126,17 @@ private:
     std::atomic<bool> working_;
     TransactionMaster& transactionMaster_;
     std::atomic <LedgerIndex> canDelete_;
+    // Inner nodes whose subtrees are all in the writable backend. Kept
+    // between attempts at a rotation, so an aborted copy resumes.
+    hash_set<uint256> copied_;
+    CopyProgress progress_;
     // these do not exist upon SHAMapStore creation, but do exist
     // as of onPrepare() or before
     NetworkOPs* netOPs_ = nullptr;
     LedgerMaster* ledgerMaster_ = nullptr;
     FullBelowCache* fullBelowCache_ = nullptr;
     TreeNodeCache* treeNodeCache_ = nullptr;
-    DatabaseCon* transactionDb_ = nullptr;
+    HistoryStore* history_ = nullptr;
     DatabaseCon* ledgerDb_ = nullptr;
     int fdlimit_ = 0;
 
@@ -170,10 +201,14 @@ public:
 
     void rendezvous() const override;
     int fdlimit() const override;
+    Json::Value getJson() override;
 
 private:
-    // callback for visitNodes
-    bool copyNode (std::uint64_t& nodeCount, SHAMapAbstractNode const &node);
+    /** Copy the nodes of a state map that are missing from the writable
+        backend, with a thread for each of setup_.copyThreads.
+        @return true if the copy was stopped or failed before finishing.
+    */
+    bool copyState (SHAMap const& map, LedgerIndex seq);
     void run();
     void dbPaths();
     std::shared_ptr <NodeStore::Backend> makeBackendRotating (
@@ -219,6 +254,8 @@ private:
      */
     bool clearSql (DatabaseCon& database, LedgerIndex lastRotated,
                    std::string const& minQuery, std::string const& deleteQuery);
+    /** delete from the history store in batches, as with clearSql */
+    bool clearHistory (LedgerIndex lastRotated);
     void clearCaches (LedgerIndex validatedSeq);
     void freshenCaches();
     void clearPrior (LedgerIndex lastRotated);
@@ -21,11 +21,11 @@
 #include <ripple/app/ledger/LedgerToJson.h>
 #include <ripple/app/ledger/LedgerMaster.h>
 #include <ripple/app/main/Application.h>
+#include <ripple/app/misc/HistoryStore.h>
 #include <ripple/app/misc/Transaction.h>
 #include <ripple/app/misc/impl/AccountTxPaging.h>
 #include <ripple/protocol/Serializer.h>
 #include <ripple/protocol/types.h>
-#include <boost/format.hpp>
 #include <memory>
 
 namespace ripple {
@@ -34,7 +34,7 @@ void
 convertBlobsToTxResult (
     NetworkOPs::AccountTxs& to,
     std::uint32_t ledger_index,
-    std::string const& status,
+    boost::optional<std::string> const& status,
     Blob const& rawTxn,
     Blob const& rawMeta,
     Application& app)
@@ -63,11 +63,10 @@ saveLedgerAsync (Application& app, std::uint32_t seq)
 
 void
 accountTxPage (
-    DatabaseCon& connection,
-    AccountIDCache const& idCache,
+    HistoryStore& history,
     std::function<void (std::uint32_t)> const& onUnsavedLedger,
     std::function<void (std::uint32_t,
-                        std::string const&,
+                        boost::optional<std::string> const&,
                         Blob const&,
                         Blob const&)> const& onTransaction,
     AccountID const& account,
@@ -94,7 +93,7 @@ accountTxPage (
     // than the limit), then we return an opaque marker that can be supplied in
     // a subsequent query.
     std::uint32_t queryLimit = numberOfResults + 1;
-    std::uint32_t findLedger = 0, findSeq = 0;
+    boost::optional<HistoryStore::Position> start;
 
     if (lookingForMarker)
     {
@@ -102,8 +101,9 @@ accountTxPage (
         {
             if (!token.isMember(jss::ledger) || !token.isMember(jss::seq))
                 return;
-            findLedger = token[jss::ledger].asInt();
-            findSeq = token[jss::seq].asInt();
+            start.emplace();
+            start->ledgerSeq = token[jss::ledger].asInt();
+            start->txnSeq = token[jss::seq].asInt();
         }
         catch (std::exception const&)
         {
@@ -115,151 +115,39 @@ accountTxPage (
     // we need to clear it in between.
     token = Json::nullValue;
 
-    static std::string const prefix (
-        R"(SELECT AccountTransactions.LedgerSeq,AccountTransactions.TxnSeq,
-          Status,RawTxn,TxnMeta
-          FROM AccountTransactions INNER JOIN Transactions
-          ON Transactions.TransID = AccountTransactions.TransID
-          AND AccountTransactions.Account = '%s' WHERE
-          )");
-
-    std::string sql;
-
-    // SQL's BETWEEN uses a closed interval ([a,b])
-
-    if (forward && (findLedger == 0))
-    {
-        sql = boost::str (boost::format(
-            prefix +
-            (R"(AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u'
-             ORDER BY AccountTransactions.LedgerSeq ASC,
-             AccountTransactions.TxnSeq ASC
-             LIMIT %u;)"))
-            % idCache.toBase58(account)
-            % minLedger
-            % maxLedger
-            % queryLimit);
-    }
-    else if (forward && (findLedger != 0))
-    {
-        sql = boost::str (boost::format(
-            prefix +
-            (R"(
-            AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u' OR
-            ( AccountTransactions.LedgerSeq = '%u' AND
-              AccountTransactions.TxnSeq >= '%u' )
-            ORDER BY AccountTransactions.LedgerSeq ASC,
-            AccountTransactions.TxnSeq ASC
-            LIMIT %u;
-            )"))
-        % idCache.toBase58(account)
-        % (findLedger + 1)
-        % maxLedger
-        % findLedger
-        % findSeq
-        % queryLimit);
-    }
-    else if (!forward && (findLedger == 0))
-    {
-        sql = boost::str (boost::format(
-            prefix +
-            (R"(AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u'
-             ORDER BY AccountTransactions.LedgerSeq DESC,
-             AccountTransactions.TxnSeq DESC
-             LIMIT %u;)"))
-            % idCache.toBase58(account)
-            % minLedger
-            % maxLedger
-            % queryLimit);
-    }
-    else if (!forward && (findLedger != 0))
-    {
-        sql = boost::str (boost::format(
-            prefix +
-            (R"(AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u' OR
-             (AccountTransactions.LedgerSeq = '%u' AND
-              AccountTransactions.TxnSeq <= '%u')
-             ORDER BY AccountTransactions.LedgerSeq DESC,
-             AccountTransactions.TxnSeq DESC
-             LIMIT %u;)"))
-            % idCache.toBase58(account)
-            % minLedger
-            % (findLedger - 1)
-            % findLedger
-            % findSeq
-            % queryLimit);
-    }
-    else
-    {
-        assert (false);
-        // sql is empty
-        return;
-    }
-
-    {
-        auto db (connection.checkoutDb());
-
-        Blob rawData;
-        Blob rawMeta;
-
-        boost::optional<std::uint64_t> ledgerSeq;
-        boost::optional<std::uint32_t> txnSeq;
-        boost::optional<std::string> status;
-        soci::blob txnData (*db);
-        soci::blob txnMeta (*db);
-        soci::indicator dataPresent, metaPresent;
-
-        soci::statement st = (db->prepare << sql,
-            soci::into (ledgerSeq),
-            soci::into (txnSeq),
-            soci::into (status),
-            soci::into (txnData, dataPresent),
-            soci::into (txnMeta, metaPresent));
-
-        st.execute ();
-
-        while (st.fetch ())
+    history.forEachAccountTx (account, minLedger, maxLedger, forward,
+        start, queryLimit,
+        [&](HistoryStore::Tx&& tx)
         {
             if (lookingForMarker)
             {
-                if (findLedger == ledgerSeq.value_or (0) &&
-                    findSeq == txnSeq.value_or (0))
+                if (start->ledgerSeq == tx.ledgerSeq &&
+                    start->txnSeq == tx.txnSeq)
                 {
                     lookingForMarker = false;
                 }
             }
             else if (numberOfResults == 0)
             {
-                token = Json::objectValue;
-                token[jss::ledger] = rangeCheckedCast<std::uint32_t>(ledgerSeq.value_or (0));
-                token[jss::seq] = txnSeq.value_or (0);
-                break;
+                if (token.isNull())
+                {
+                    token = Json::objectValue;
+                    token[jss::ledger] = tx.ledgerSeq;
+                    token[jss::seq] = tx.txnSeq;
+                }
+                return;
             }
 
             if (!lookingForMarker)
             {
-                if (dataPresent == soci::i_ok)
-                    convert (txnData, rawData);
-                else
-                    rawData.clear ();
-
-                if (metaPresent == soci::i_ok)
-                    convert (txnMeta, rawMeta);
-                else
-                    rawMeta.clear ();
-
                 // Work around a bug that could leave the metadata missing
-                if (rawMeta.size() == 0)
-                    onUnsavedLedger(ledgerSeq.value_or (0));
+                if (tx.meta.size() == 0)
+                    onUnsavedLedger(tx.ledgerSeq);
 
-                onTransaction(rangeCheckedCast<std::uint32_t>(ledgerSeq.value_or (0)),
-                    *status, rawData, rawMeta);
+                onTransaction(tx.ledgerSeq, tx.status, tx.raw, tx.meta);
                 --numberOfResults;
             }
-        }
-    }
-
-    return;
+        });
 }
 
 }
@@ -20,8 +20,8 @@
 #ifndef RIPPLE_APP_MISC_IMPL_ACCOUNTTXPAGING_H_INCLUDED
 #define RIPPLE_APP_MISC_IMPL_ACCOUNTTXPAGING_H_INCLUDED
 
-#include <ripple/core/DatabaseCon.h>
 #include <ripple/app/misc/NetworkOPs.h>
+#include <boost/optional.hpp>
 #include <cstdint>
 #include <string>
 #include <utility>
@@ -31,11 +31,13 @@
 
 namespace ripple {
 
+class HistoryStore;
+
 void
 convertBlobsToTxResult (
     NetworkOPs::AccountTxs& to,
     std::uint32_t ledger_index,
-    std::string const& status,
+    boost::optional<std::string> const& status,
     Blob const& rawTxn,
     Blob const& rawMeta,
     Application& app);
@@ -45,11 +47,10 @@ saveLedgerAsync (Application& app, std::uint32_t seq);
 
 void
 accountTxPage (
-    DatabaseCon& database,
-    AccountIDCache const& idCache,
+    HistoryStore& history,
     std::function<void (std::uint32_t)> const& onUnsavedLedger,
     std::function<void (std::uint32_t,
-                        std::string const&,
+                        boost::optional<std::string> const&,
                         Blob const&,
                         Blob const&)> const&,
     AccountID const& account,
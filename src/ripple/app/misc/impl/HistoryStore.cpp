@@ -0,0 +1,83 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <ripple/app/misc/impl/HistoryStoreImp.h>
+#include <ripple/basics/contract.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem/path.hpp>
+
+namespace ripple {
+
+std::unique_ptr<HistoryStore>
+make_HistoryStore (
+    Section const& section,
+    DatabaseCon::Setup const& setup,
+    DatabaseCon& txnDB,
+    AccountIDCache const& idCache,
+    beast::Journal journal)
+{
+    auto const type = get<std::string>(section, "type", "sqlite");
+
+    if (boost::iequals (type, "sqlite"))
+    {
+        auto const ledgersPerPartition =
+            get<std::uint32_t>(section, "ledgers_per_partition", 0);
+        if (ledgersPerPartition == 0)
+            return make_SQLiteHistoryStore (txnDB, idCache, journal);
+
+        // The partitions go in `path`, if set
+        auto partitions = setup;
+        std::string path;
+        if (get_if_exists (section, "path", path))
+            partitions.dataDir = path;
+        else if (setup.dataDir.empty () && ! setup.useTempFiles ())
+            Throw<std::runtime_error> (
+                "[history_db] path must be set when there is "
+                "no database_path");
+        return make_PartitionedHistoryStore (partitions, ledgersPerPartition,
+            get<std::size_t>(section, "open_partitions", 8),
+            idCache, journal);
+    }
+
+    if (boost::iequals (type, "rocksdb"))
+    {
+        std::string path;
+        if (! get_if_exists (section, "path", path))
+        {
+            if (setup.dataDir.empty ())
+                Throw<std::runtime_error> (
+                    "[history_db] path must be set when there is "
+                    "no database_path");
+            path = (setup.dataDir / "history.rocksdb").string ();
+        }
+
+        if (auto store = make_RocksDBHistoryStore (section, path, journal))
+            return store;
+
+        Throw<std::runtime_error> (
+            "RocksDB is not available for the [history_db]");
+    }
+
+    Throw<std::runtime_error> (
+        "Unknown [history_db] type: " + type);
+}
+
+} // ripple
@@ -0,0 +1,51 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#ifndef RIPPLE_APP_MISC_HISTORYSTOREIMP_H_INCLUDED
+#define RIPPLE_APP_MISC_HISTORYSTOREIMP_H_INCLUDED
+
+#include <ripple/app/misc/HistoryStore.h>
+
+namespace ripple {
+
+std::unique_ptr<HistoryStore>
+make_SQLiteHistoryStore (
+    DatabaseCon& txnDB,
+    AccountIDCache const& idCache,
+    beast::Journal journal);
+
+std::unique_ptr<HistoryStore>
+make_PartitionedHistoryStore (
+    DatabaseCon::Setup const& setup,
+    std::uint32_t ledgersPerPartition,
+    std::size_t maxOpen,
+    AccountIDCache const& idCache,
+    beast::Journal journal);
+
+/** Returns `nullptr` if RocksDB is not available. */
+std::unique_ptr<HistoryStore>
+make_RocksDBHistoryStore (
+    Section const& section,
+    std::string const& path,
+    beast::Journal journal);
+
+} // ripple
+
+#endif
@@ -0,0 +1,589 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <ripple/app/ledger/LedgerSQLWriter.h>
+#include <ripple/app/main/DBInit.h>
+#include <ripple/app/misc/impl/HistoryStoreImp.h>
+#include <ripple/basics/Log.h>
+#include <ripple/core/SociDB.h>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <list>
+#include <map>
+#include <mutex>
+
+namespace ripple {
+
+// Stores the transactions of each range of ledgers in a transaction
+// database of its own. A database is only opened once it is used, the
+// least recently used ones are closed when too many are open, and
+// whole ranges are removed by deleting their files.
+class PartitionedHistoryStore : public HistoryStore
+{
+private:
+    // An open partition database. It stays open while in use
+    // after the partition closes it.
+    struct Open
+    {
+        std::unique_ptr<DatabaseCon> db;
+        std::unique_ptr<HistoryStore> store;
+    };
+
+    class Partition
+    {
+    private:
+        PartitionedHistoryStore& owner_;
+        std::string const name_;
+        std::mutex mutex_;
+        std::shared_ptr<Open> open_;
+        bool deletePath_ = false;
+
+    public:
+        std::uint32_t const first;
+        std::uint32_t const last;
+
+        Partition (PartitionedHistoryStore& owner, std::uint32_t index);
+
+        ~Partition ();
+
+        // Opens the database if it is closed
+        std::shared_ptr<Open>
+        open ();
+
+        void
+        close ();
+
+        void
+        setupCheckpointing ();
+
+        // Remove the database files once the partition is destroyed
+        void
+        setDeletePath ()
+        {
+            deletePath_ = true;
+        }
+    };
+
+    using Partitions = std::vector<std::shared_ptr<Partition>>;
+
+    // A transaction saved again in another ledger is removed from the
+    // partitions holding ledgers this close to that one. Transactions
+    // only move between competing ledgers near the validated one.
+    static std::uint32_t constexpr moveWindow = 256;
+
+    DatabaseCon::Setup const setup_;
+    std::uint32_t const ledgersPerPartition_;
+    std::size_t const maxOpen_;
+    AccountIDCache const& idCache_;
+    beast::Journal journal_;
+
+    std::mutex mutex_;
+    std::map<std::uint32_t, std::shared_ptr<Partition>> partitions_;
+
+    // The partitions that may be open, most recently used first
+    std::list<std::shared_ptr<Partition>> recent_;
+
+    JobQueue* jobQueue_ = nullptr;
+    Logs* logs_ = nullptr;
+
+    static
+    std::string
+    partitionName (std::uint32_t index)
+    {
+        return "transaction." + std::to_string (index) + ".db";
+    }
+
+    // The partitions holding ledgers in [minLedger, maxLedger] in order
+    Partitions
+    partitions (std::uint32_t minLedger, std::uint32_t maxLedger,
+        bool forward);
+
+    // Marks a partition as used, closing the least recently used
+    // partitions beyond the limit, and returns its open database
+    std::shared_ptr<Open>
+    use (std::shared_ptr<Partition> const& partition);
+
+    // Removes the transactions with these IDs, in any ledger
+    static
+    void
+    eraseTransactions (DatabaseCon& db, std::vector<uint256> const& ids);
+
+public:
+    PartitionedHistoryStore (DatabaseCon::Setup const& setup,
+        std::uint32_t ledgersPerPartition, std::size_t maxOpen,
+        AccountIDCache const& idCache, beast::Journal journal);
+
+    std::string
+    getName() override
+    {
+        return "sqlite partitions";
+    }
+
+    void
+    setupCheckpointing (JobQueue* q, Logs& l) override;
+
+    void
+    saveTransactions (LedgerSQLRows const& rows) override;
+
+    boost::optional<Tx>
+    getTransaction (uint256 const& id) override;
+
+    void
+    forEachAccountTx (AccountID const& account,
+        std::uint32_t minLedger, std::uint32_t maxLedger,
+        bool forward, boost::optional<Position> const& start,
+        std::uint32_t limit, std::function<void(Tx&&)> const& f) override;
+
+    std::vector<Tx>
+    getAccountTxs (AccountID const& account,
+        std::uint32_t minLedger, std::uint32_t maxLedger,
+        bool descending, std::uint32_t offset, std::uint32_t limit) override;
+
+    std::vector<Tx>
+    getTxHistory (std::uint32_t offset, std::uint32_t limit) override;
+
+    boost::optional<LedgerIndex>
+    getMinLedgerSeq() override;
+
+    void
+    deleteBeforeLedgerSeq (LedgerIndex seq) override;
+};
+
+//------------------------------------------------------------------------------
+
+PartitionedHistoryStore::Partition::Partition (
+        PartitionedHistoryStore& owner, std::uint32_t index)
+    : owner_ (owner)
+    , name_ (partitionName (index))
+    , first (index * owner.ledgersPerPartition_)
+    , last (static_cast<std::uint32_t> (std::min<std::uint64_t> (
+        std::uint64_t (index + 1) * owner.ledgersPerPartition_ - 1,
+        std::numeric_limits<std::uint32_t>::max ())))
+{
+}
+
+PartitionedHistoryStore::Partition::~Partition ()
+{
+    open_.reset ();
+
+    if (deletePath_ && ! owner_.setup_.useTempFiles ())
+    {
+        auto const path = owner_.setup_.dataDir / name_;
+        for (auto const& suffix : { "", "-wal", "-shm" })
+        {
+            boost::system::error_code ec;
+            boost::filesystem::remove (path.string () + suffix, ec);
+            if (ec)
+                JLOG(owner_.journal_.error()) <<
+                    "Unable to remove " << path.string () << suffix <<
+                    ": " << ec.message ();
+        }
+        JLOG(owner_.journal_.info()) << "Removed " << path.string ();
+    }
+}
+
+auto
+PartitionedHistoryStore::Partition::open () -> std::shared_ptr<Open>
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    if (! open_)
+    {
+        JLOG(owner_.journal_.debug()) <<
+            "Opening " << name_ << " for ledgers " <<
+            first << " to " << last;
+        auto open = std::make_shared<Open> ();
+        open->db = std::make_unique<DatabaseCon> (
+            owner_.setup_, name_, TxnDBInit, TxnDBCount);
+        open->store = make_SQLiteHistoryStore (
+            *open->db, owner_.idCache_, owner_.journal_);
+        if (owner_.jobQueue_)
+            open->db->setupCheckpointing (owner_.jobQueue_, *owner_.logs_);
+        open_ = std::move (open);
+    }
+    return open_;
+}
+
+void
+PartitionedHistoryStore::Partition::close ()
+{
+    std::shared_ptr<Open> open;
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        open = std::move (open_);
+    }
+
+    if (open)
+        JLOG(owner_.journal_.debug()) << "Closing " << name_;
+}
+
+void
+PartitionedHistoryStore::Partition::setupCheckpointing ()
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    if (open_)
+        open_->db->setupCheckpointing (owner_.jobQueue_, *owner_.logs_);
+}
+
+//------------------------------------------------------------------------------
+
+PartitionedHistoryStore::PartitionedHistoryStore (
+        DatabaseCon::Setup const& setup, std::uint32_t ledgersPerPartition,
+        std::size_t maxOpen, AccountIDCache const& idCache,
+        beast::Journal journal)
+    : setup_ (setup)
+    , ledgersPerPartition_ (ledgersPerPartition)
+    , maxOpen_ (std::max<std::size_t> (maxOpen, 1))
+    , idCache_ (idCache)
+    , journal_ (journal)
+{
+    if (setup_.useTempFiles ())
+        return;
+
+    namespace fs = boost::filesystem;
+
+    if (! fs::exists (setup_.dataDir))
+    {
+        fs::create_directories (setup_.dataDir);
+        return;
+    }
+
+    // Find the partitions saved before
+    std::string const prefix = "transaction.";
+    std::string const suffix = ".db";
+    for (auto const& entry : fs::directory_iterator (setup_.dataDir))
+    {
+        auto const name = entry.path ().filename ().string ();
+        if (name.size () <= prefix.size () + suffix.size () ||
+            name.compare (0, prefix.size (), prefix) != 0 ||
+            name.compare (name.size () - suffix.size (),
+                suffix.size (), suffix) != 0)
+            continue;
+
+        auto const digits = name.substr (prefix.size (),
+            name.size () - prefix.size () - suffix.size ());
+        if (digits.size () > 9 ||
+            ! std::all_of (digits.begin (), digits.end (),
+                [](char c) { return std::isdigit (
+                    static_cast<unsigned char> (c)); }))
+            continue;
+
+        auto const index = static_cast<std::uint32_t> (std::stoul (digits));
+        partitions_.emplace (index,
+            std::make_shared<Partition> (*this, index));
+    }
+
+    JLOG(journal_.info()) << "Found " << partitions_.size () <<
+        " partitions of " << ledgersPerPartition_ << " ledgers";
+}
+
+void
+PartitionedHistoryStore::setupCheckpointing (JobQueue* q, Logs& l)
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    jobQueue_ = q;
+    logs_ = &l;
+    for (auto const& p : partitions_)
+        p.second->setupCheckpointing ();
+}
+
+auto
+PartitionedHistoryStore::partitions (std::uint32_t minLedger,
+    std::uint32_t maxLedger, bool forward) -> Partitions
+{
+    Partitions ret;
+    if (minLedger > maxLedger)
+        return ret;
+
+    std::lock_guard<std::mutex> lock (mutex_);
+    auto const begin = partitions_.lower_bound (
+        minLedger / ledgersPerPartition_);
+    auto const end = partitions_.upper_bound (
+        maxLedger / ledgersPerPartition_);
+    for (auto iter = begin; iter != end; ++iter)
+        ret.push_back (iter->second);
+    if (! forward)
+        std::reverse (ret.begin (), ret.end ());
+    return ret;
+}
+
+auto
+PartitionedHistoryStore::use (
+    std::shared_ptr<Partition> const& partition) -> std::shared_ptr<Open>
+{
+    auto open = partition->open ();
+
+    std::vector<std::shared_ptr<Partition>> idle;
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        auto const iter = std::find (
+            recent_.begin (), recent_.end (), partition);
+        if (iter != recent_.end ())
+            recent_.splice (recent_.begin (), recent_, iter);
+        else
+            recent_.push_front (partition);
+
+        while (recent_.size () > maxOpen_)
+        {
+            idle.push_back (std::move (recent_.back ()));
+            recent_.pop_back ();
+        }
+    }
+
+    // Reads in progress keep their database open until they finish
+    for (auto const& p : idle)
+        p->close ();
+
+    return open;
+}
+
+void
+PartitionedHistoryStore::eraseTransactions (
+    DatabaseCon& db, std::vector<uint256> const& ids)
+{
+    if (ids.empty ())
+        return;
+
+    std::string list;
+    for (auto const& id : ids)
+    {
+        if (! list.empty ())
+            list += ",";
+        list += "'" + to_string (id) + "'";
+    }
+
+    auto session = db.checkoutDb ();
+    soci::transaction tr (*session);
+    *session << ("DELETE FROM AccountTransactions WHERE TransID IN (" +
+        list + ");");
+    *session << ("DELETE FROM Transactions WHERE TransID IN (" +
+        list + ");");
+    tr.commit ();
+}
+
+void
+PartitionedHistoryStore::saveTransactions (LedgerSQLRows const& rows)
+{
+    auto const seq = rows.info.seq;
+    auto const index = seq / ledgersPerPartition_;
+
+    std::shared_ptr<Partition> partition;
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        auto& p = partitions_[index];
+        if (! p)
+            p = std::make_shared<Partition> (*this, index);
+        partition = p;
+    }
+
+    // A partition only replaces the transactions it holds, so those
+    // saved before in a nearby partition are removed from it
+    std::vector<uint256> ids;
+    ids.reserve (rows.transactions.size ());
+    for (auto const& txn : rows.transactions)
+        ids.push_back (txn.id);
+
+    auto const minLedger = (seq > moveWindow) ? seq - moveWindow : 0;
+    auto const maxLedger =
+        (seq < std::numeric_limits<std::uint32_t>::max () - moveWindow)
+            ? seq + moveWindow
+            : std::numeric_limits<std::uint32_t>::max ();
+    for (auto const& p : partitions (minLedger, maxLedger, true))
+    {
+        if (p != partition)
+            eraseTransactions (*use (p)->db, ids);
+    }
+
+    use (partition)->store->saveTransactions (rows);
+}
+
+boost::optional<HistoryStore::Tx>
+PartitionedHistoryStore::getTransaction (uint256 const& id)
+{
+    // Recent transactions are the most likely to be asked for
+    for (auto const& p : partitions (0,
+        std::numeric_limits<std::uint32_t>::max (), false))
+    {
+        if (auto tx = use (p)->store->getTransaction (id))
+            return tx;
+    }
+    return boost::none;
+}
+
+void
+PartitionedHistoryStore::forEachAccountTx (AccountID const& account,
+    std::uint32_t minLedger, std::uint32_t maxLedger,
+    bool forward, boost::optional<Position> const& start,
+    std::uint32_t limit, std::function<void(Tx&&)> const& f)
+{
+    // A position is always in the partition holding its ledger, so
+    // the partitions before the one holding `start` are skipped
+    if (start)
+    {
+        if (forward)
+            minLedger = std::max (minLedger, start->ledgerSeq);
+        else
+            maxLedger = std::min (maxLedger, start->ledgerSeq);
+    }
+
+    for (auto const& p : partitions (minLedger, maxLedger, forward))
+    {
+        auto const first = std::max (minLedger, p->first);
+        auto const last = std::min (maxLedger, p->last);
+
+        boost::optional<Position> from;
+        if (start && start->ledgerSeq >= first && start->ledgerSeq <= last)
+            from = start;
+
+        use (p)->store->forEachAccountTx (account, first, last, forward,
+            from, limit, [&limit, &f](Tx&& tx)
+            {
+                --limit;
+                f (std::move (tx));
+            });
+
+        if (limit == 0)
+            return;
+    }
+}
+
+std::vector<HistoryStore::Tx>
+PartitionedHistoryStore::getAccountTxs (AccountID const& account,
+    std::uint32_t minLedger, std::uint32_t maxLedger,
+    bool descending, std::uint32_t offset, std::uint32_t limit)
+{
+    std::vector<Tx> ret;
+    for (auto const& p : partitions (minLedger, maxLedger, ! descending))
+    {
+        if (ret.size () >= limit)
+            break;
+
+        // The offset can only be applied once the number of
+        // transactions in the earlier partitions is known
+        auto const wanted = static_cast<std::uint32_t> (
+            std::min<std::uint64_t> (
+                std::uint64_t (offset) + limit - ret.size (),
+                std::numeric_limits<std::uint32_t>::max ()));
+        auto txs = use (p)->store->getAccountTxs (account,
+            std::max (minLedger, p->first), std::min (maxLedger, p->last),
+            descending, 0, wanted);
+
+        if (txs.size () <= offset)
+        {
+            offset -= txs.size ();
+            continue;
+        }
+
+        std::move (txs.begin () + offset, txs.end (),
+            std::back_inserter (ret));
+        offset = 0;
+    }
+    return ret;
+}
+
+std::vector<HistoryStore::Tx>
+PartitionedHistoryStore::getTxHistory (
+    std::uint32_t offset, std::uint32_t limit)
+{
+    std::vector<Tx> ret;
+    for (auto const& p : partitions (0,
+        std::numeric_limits<std::uint32_t>::max (), false))
+    {
+        if (ret.size () >= limit)
+            break;
+
+        auto const wanted = static_cast<std::uint32_t> (
+            std::min<std::uint64_t> (
+                std::uint64_t (offset) + limit - ret.size (),
+                std::numeric_limits<std::uint32_t>::max ()));
+        auto txs = use (p)->store->getTxHistory (0, wanted);
+
+        if (txs.size () <= offset)
+        {
+            offset -= txs.size ();
+            continue;
+        }
+
+        std::move (txs.begin () + offset, txs.end (),
+            std::back_inserter (ret));
+        offset = 0;
+    }
+    return ret;
+}
+
+boost::optional<LedgerIndex>
+PartitionedHistoryStore::getMinLedgerSeq()
+{
+    for (auto const& p : partitions (0,
+        std::numeric_limits<std::uint32_t>::max (), true))
+    {
+        if (auto const seq = use (p)->store->getMinLedgerSeq ())
+            return seq;
+    }
+    return boost::none;
+}
+
+void
+PartitionedHistoryStore::deleteBeforeLedgerSeq (LedgerIndex seq)
+{
+    auto const index = seq / ledgersPerPartition_;
+
+    std::shared_ptr<Partition> partial;
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+
+        // Partitions entirely before `seq` are dropped. Their files
+        // are removed once any reads in progress have finished.
+        auto const end = partitions_.lower_bound (index);
+        for (auto iter = partitions_.begin (); iter != end;)
+        {
+            JLOG(journal_.debug()) << "Dropping ledgers " <<
+                iter->second->first << " to " << iter->second->last;
+            iter->second->setDeletePath ();
+            recent_.remove (iter->second);
+            iter = partitions_.erase (iter);
+        }
+
+        if (end != partitions_.end () && end->first == index &&
+            seq != end->second->first)
+            partial = end->second;
+    }
+
+    if (partial)
+        use (partial)->store->deleteBeforeLedgerSeq (seq);
+}
+
+//------------------------------------------------------------------------------
+
+std::unique_ptr<HistoryStore>
+make_PartitionedHistoryStore (
+    DatabaseCon::Setup const& setup,
+    std::uint32_t ledgersPerPartition,
+    std::size_t maxOpen,
+    AccountIDCache const& idCache,
+    beast::Journal journal)
+{
+    return std::make_unique<PartitionedHistoryStore> (
+        setup, ledgersPerPartition, maxOpen, idCache, journal);
+}
+
+} // ripple
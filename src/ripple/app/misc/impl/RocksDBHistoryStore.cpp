@@ -0,0 +1,597 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <ripple/app/misc/impl/HistoryStoreImp.h>
+#include <ripple/unity/rocksdb.h>
+
+#if RIPPLE_ROCKSDB_AVAILABLE
+
+#include <ripple/app/ledger/LedgerSQLWriter.h>
+#include <ripple/basics/contract.h>
+#include <ripple/protocol/Serializer.h>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <map>
+#include <mutex>
+
+namespace ripple {
+
+/*  Stores transactions in a RocksDB database.
+
+    Integers in keys are big-endian, so that keys sort numerically:
+
+        'A' account ledgerSeq txnSeq    ->  txID
+        'L' ledgerSeq txnSeq            ->  txID account...
+        'T' txID                        ->  ledgerSeq txnSeq status raw meta
+
+    The 'A' keys hold each account's history in order, so a page of it
+    is read with one seek whatever the size of the database. The 'L'
+    keys record what was stored for each ledger, so that it can be
+    replaced or deleted.
+
+    getAccountTxs counts pages by offset. Stepping over `offset` keys
+    would make each page slower than the last, so the store remembers
+    where recent pages ended and seeks to the 'A' key following the
+    nearest one, as account_tx does with a marker. Page ends which a
+    change to the history would shift are forgotten, so the results
+    are the same as counting from the first transaction.
+*/
+class RocksDBHistoryStore : public HistoryStore
+{
+private:
+    enum : char
+    {
+        accountPrefix = 'A',
+        ledgerPrefix = 'L',
+        txPrefix = 'T'
+    };
+
+    static std::size_t constexpr accountKeySize = 1 + 20 + 4 + 4;
+    static std::size_t constexpr ledgerKeySize = 1 + 4 + 4;
+    static std::size_t constexpr txKeySize = 1 + 32;
+
+    // The most page ends remembered for getAccountTxs
+    static std::size_t constexpr maxPageEnds = 1024;
+
+    beast::Journal journal_;
+    std::string path_;
+    std::unique_ptr<rocksdb::DB> db_;
+
+    // Where recent getAccountTxs pages ended, by pageKey, and the
+    // order in which they were added
+    std::mutex pageMutex_;
+    std::map<std::string, Position> pageEnds_;
+    std::deque<std::string> pageOrder_;
+
+    static
+    void
+    append32 (std::string& key, std::uint32_t v)
+    {
+        key.push_back (static_cast<char>(v >> 24));
+        key.push_back (static_cast<char>(v >> 16));
+        key.push_back (static_cast<char>(v >> 8));
+        key.push_back (static_cast<char>(v));
+    }
+
+    static
+    std::uint32_t
+    read32 (char const* p)
+    {
+        auto const u = reinterpret_cast<unsigned char const*>(p);
+        return (std::uint32_t (u[0]) << 24) | (std::uint32_t (u[1]) << 16) |
+            (std::uint32_t (u[2]) << 8) | std::uint32_t (u[3]);
+    }
+
+    static
+    std::string
+    accountKey (AccountID const& account,
+        std::uint32_t ledgerSeq, std::uint32_t txnSeq)
+    {
+        std::string key;
+        key.reserve (accountKeySize);
+        key.push_back (accountPrefix);
+        key.append (reinterpret_cast<char const*>(account.data ()),
+            account.size ());
+        append32 (key, ledgerSeq);
+        append32 (key, txnSeq);
+        return key;
+    }
+
+    static
+    std::string
+    ledgerKey (std::uint32_t ledgerSeq, std::uint32_t txnSeq)
+    {
+        std::string key;
+        key.reserve (ledgerKeySize);
+        key.push_back (ledgerPrefix);
+        append32 (key, ledgerSeq);
+        append32 (key, txnSeq);
+        return key;
+    }
+
+    static
+    std::string
+    txKey (void const* id)
+    {
+        std::string key;
+        key.reserve (txKeySize);
+        key.push_back (txPrefix);
+        key.append (static_cast<char const*>(id), 32);
+        return key;
+    }
+
+    // Identifies an offset into the results of a getAccountTxs query.
+    // Everything but the offset forms a prefix, and offsets sort in
+    // order after it.
+    static
+    std::string
+    pageKey (AccountID const& account, std::uint32_t minLedger,
+        std::uint32_t maxLedger, bool forward, std::uint32_t offset)
+    {
+        auto key = accountKey (account, minLedger, maxLedger);
+        key.push_back (forward ? 'F' : 'B');
+        append32 (key, offset);
+        return key;
+    }
+
+    void
+    check (rocksdb::Status const& status)
+    {
+        if (! status.ok ())
+            Throw<std::runtime_error> (
+                "RocksDB history store: " + status.ToString ());
+    }
+
+    // Remove a ledger entry and the keys which refer to it
+    void
+    erase (rocksdb::WriteBatch& wb, rocksdb::Slice const& key,
+        rocksdb::Slice const& value)
+    {
+        auto const ledgerSeq = read32 (key.data () + 1);
+        auto const txnSeq = read32 (key.data () + 5);
+
+        wb.Delete (key);
+        wb.Delete (txKey (value.data ()));
+
+        AccountID account;
+        for (std::size_t i = 32; i + account.size () <= value.size ();
+            i += account.size ())
+        {
+            std::memcpy (account.data (), value.data () + i, account.size ());
+            wb.Delete (accountKey (account, ledgerSeq, txnSeq));
+        }
+    }
+
+    // Remove the ledgers in [first, last), returning the number of
+    // transactions removed
+    std::size_t
+    eraseLedgers (rocksdb::WriteBatch& wb,
+        std::uint32_t first, std::uint32_t last)
+    {
+        std::size_t erased = 0;
+        auto const end = ledgerKey (last, 0);
+        std::unique_ptr<rocksdb::Iterator> it (
+            db_->NewIterator (rocksdb::ReadOptions ()));
+        for (it->Seek (ledgerKey (first, 0)); it->Valid (); it->Next ())
+        {
+            auto const key = it->key ();
+            if (key.compare (end) >= 0)
+                break;
+            erase (wb, key, it->value ());
+            ++erased;
+        }
+        check (it->status ());
+        return erased;
+    }
+
+    // Forget the page ends which a new ledger lands before, since it
+    // shifts their offsets. If transactions were removed, every page
+    // end is forgotten.
+    void
+    forgetPages (std::uint32_t seq, bool removed)
+    {
+        std::lock_guard<std::mutex> lock (pageMutex_);
+        if (removed)
+        {
+            pageEnds_.clear ();
+            pageOrder_.clear ();
+            return;
+        }
+
+        for (auto iter = pageEnds_.begin (); iter != pageEnds_.end ();)
+        {
+            auto const p = iter->first.data () + 21;
+            auto const minLedger = read32 (p);
+            auto const maxLedger = read32 (p + 4);
+            bool const forward = p[8] == 'F';
+            auto const end = iter->second.ledgerSeq;
+            if (seq >= minLedger && seq <= maxLedger &&
+                (forward ? seq < end : seq > end))
+                iter = pageEnds_.erase (iter);
+            else
+                ++iter;
+        }
+
+        // Keys no longer remembered are skipped when evicting
+        if (pageOrder_.size () > 2 * pageEnds_.size () + maxPageEnds)
+        {
+            pageOrder_.erase (std::remove_if (pageOrder_.begin (),
+                pageOrder_.end (), [this](std::string const& key)
+                { return pageEnds_.count (key) == 0; }), pageOrder_.end ());
+        }
+    }
+
+    boost::optional<Tx>
+    fetch (void const* id)
+    {
+        std::string value;
+        auto const status = db_->Get (
+            rocksdb::ReadOptions (), txKey (id), &value);
+        if (status.IsNotFound ())
+            return boost::none;
+        check (status);
+
+        SerialIter sit (value.data (), value.size ());
+        Tx tx;
+        tx.ledgerSeq = sit.get32 ();
+        tx.txnSeq = sit.get32 ();
+        if (auto const c = sit.get8 ())
+            tx.status = std::string (1, static_cast<char>(c));
+        tx.raw = sit.getVL ();
+        tx.meta = sit.getVL ();
+        return tx;
+    }
+
+    // Visit an account's history, as described by forEachAccountTx.
+    // Returns the position of the next transaction if `limit` stopped
+    // the visit.
+    boost::optional<Position>
+    visit (AccountID const& account,
+        std::uint32_t minLedger, std::uint32_t maxLedger,
+        bool forward, boost::optional<Position> const& start,
+        std::uint32_t offset, std::uint32_t limit,
+        std::function<void(Tx&&)> const& f)
+    {
+        auto const prefix = accountKey (account, 0, 0).substr (0, 21);
+
+        std::unique_ptr<rocksdb::Iterator> it (
+            db_->NewIterator (rocksdb::ReadOptions ()));
+
+        if (forward)
+        {
+            it->Seek (start ?
+                accountKey (account, start->ledgerSeq, start->txnSeq) :
+                accountKey (account, minLedger, 0));
+        }
+        else
+        {
+            auto const key = start ?
+                accountKey (account, start->ledgerSeq, start->txnSeq) :
+                accountKey (account, maxLedger,
+                    std::numeric_limits<std::uint32_t>::max ());
+            it->Seek (key);
+            if (! it->Valid ())
+                it->SeekToLast ();
+            else if (it->key ().compare (key) > 0)
+                it->Prev ();
+        }
+
+        std::uint32_t visited = 0;
+        for (; it->Valid () && visited < limit;
+            forward ? it->Next () : it->Prev ())
+        {
+            auto const key = it->key ();
+            if (! key.starts_with (prefix))
+                break;
+
+            auto const ledgerSeq = read32 (key.data () + 21);
+            if (forward ? ledgerSeq > maxLedger : ledgerSeq < minLedger)
+                break;
+
+            if (offset != 0)
+            {
+                --offset;
+                continue;
+            }
+
+            auto tx = fetch (it->value ().data ());
+            if (! tx)
+            {
+                JLOG (journal_.warn()) << "Missing transaction in ledger " <<
+                    ledgerSeq;
+                continue;
+            }
+
+            f (std::move (*tx));
+            ++visited;
+        }
+        check (it->status ());
+
+        if (! it->Valid () || ! it->key ().starts_with (prefix))
+            return boost::none;
+
+        Position next;
+        next.ledgerSeq = read32 (it->key ().data () + 21);
+        next.txnSeq = read32 (it->key ().data () + 25);
+        if (forward ? next.ledgerSeq > maxLedger : next.ledgerSeq < minLedger)
+            return boost::none;
+        return next;
+    }
+
+public:
+    RocksDBHistoryStore (Section const& section, std::string const& path,
+            beast::Journal journal)
+        : journal_ (journal)
+        , path_ (path)
+    {
+        rocksdb::Options options;
+        rocksdb::BlockBasedTableOptions table_options;
+        options.create_if_missing = true;
+
+        if (section.exists ("cache_mb"))
+            table_options.block_cache = rocksdb::NewLRUCache (
+                get<int>(section, "cache_mb") * 1024L * 1024L);
+
+        table_options.filter_policy.reset (rocksdb::NewBloomFilterPolicy (
+            get<int>(section, "filter_bits", 10)));
+
+        get_if_exists (section, "open_files", options.max_open_files);
+
+        if (section.exists ("compression") &&
+            (get<int>(section, "compression") == 0))
+        {
+            options.compression = rocksdb::kNoCompression;
+        }
+
+        options.table_factory.reset (
+            rocksdb::NewBlockBasedTableFactory (table_options));
+
+        rocksdb::DB* db = nullptr;
+        auto const status = rocksdb::DB::Open (options, path_, &db);
+        if (! status.ok () || ! db)
+            Throw<std::runtime_error> (
+                "Unable to open/create RocksDB history store: " +
+                    status.ToString());
+        db_.reset (db);
+    }
+
+    std::string
+    getName() override
+    {
+        return path_;
+    }
+
+    void
+    saveTransactions (LedgerSQLRows const& rows) override
+    {
+        auto const seq = rows.info.seq;
+
+        rocksdb::WriteBatch wb;
+        bool removed = eraseLedgers (wb, seq, seq + 1) != 0;
+
+        for (auto const& txn : rows.transactions)
+        {
+            // A transaction recorded in another ledger is moved
+            if (auto const old = fetch (txn.id.data ()))
+            {
+                if (old->ledgerSeq != seq)
+                {
+                    auto const key = ledgerKey (old->ledgerSeq, old->txnSeq);
+                    std::string value;
+                    auto const status = db_->Get (
+                        rocksdb::ReadOptions (), key, &value);
+                    if (! status.IsNotFound ())
+                    {
+                        check (status);
+                        erase (wb, key, value);
+                        removed = true;
+                    }
+                }
+            }
+
+            Serializer s (
+                4 + 4 + 1 + txn.raw.size () + txn.meta.size () + 8);
+            s.add32 (seq);
+            s.add32 (txn.txnSeq);
+            s.add8 (TXN_SQL_VALIDATED);
+            s.addVL (txn.raw);
+            s.addVL (txn.meta);
+            wb.Put (txKey (txn.id.data ()), rocksdb::Slice (
+                reinterpret_cast<char const*>(s.data ()), s.size ()));
+
+            std::string ids (
+                reinterpret_cast<char const*>(txn.id.data ()), txn.id.size ());
+            for (auto const& account : txn.affected)
+            {
+                ids.append (reinterpret_cast<char const*>(account.data ()),
+                    account.size ());
+                wb.Put (accountKey (account, seq, txn.txnSeq),
+                    rocksdb::Slice (ids.data (), txn.id.size ()));
+            }
+            wb.Put (ledgerKey (seq, txn.txnSeq), ids);
+        }
+
+        check (db_->Write (rocksdb::WriteOptions (), &wb));
+        forgetPages (seq, removed);
+    }
+
+    boost::optional<Tx>
+    getTransaction (uint256 const& id) override
+    {
+        return fetch (id.data ());
+    }
+
+    void
+    forEachAccountTx (AccountID const& account,
+        std::uint32_t minLedger, std::uint32_t maxLedger,
+        bool forward, boost::optional<Position> const& start,
+        std::uint32_t limit, std::function<void(Tx&&)> const& f) override
+    {
+        visit (account, minLedger, maxLedger, forward, start, 0, limit, f);
+    }
+
+    std::vector<Tx>
+    getAccountTxs (AccountID const& account,
+        std::uint32_t minLedger, std::uint32_t maxLedger,
+        bool descending, std::uint32_t offset, std::uint32_t limit) override
+    {
+        bool const forward = ! descending;
+
+        // Start from the end of the nearest earlier page
+        boost::optional<Position> start;
+        std::uint32_t skip = offset;
+        if (offset != 0)
+        {
+            auto const prefix = pageKey (
+                account, minLedger, maxLedger, forward, 0);
+            auto const key = pageKey (
+                account, minLedger, maxLedger, forward, offset);
+
+            std::lock_guard<std::mutex> lock (pageMutex_);
+            auto iter = pageEnds_.upper_bound (key);
+            if (iter != pageEnds_.begin () &&
+                (--iter)->first.compare (0, prefix.size () - 4,
+                    prefix, 0, prefix.size () - 4) == 0)
+            {
+                start = iter->second;
+                skip = offset - read32 (
+                    iter->first.data () + prefix.size () - 4);
+            }
+        }
+
+        std::vector<Tx> ret;
+        auto const next = visit (account, minLedger, maxLedger, forward,
+            start, skip, limit,
+            [&ret](Tx&& tx) { ret.push_back (std::move (tx)); });
+
+        if (next)
+        {
+            auto key = pageKey (account, minLedger, maxLedger, forward,
+                offset + static_cast<std::uint32_t>(ret.size ()));
+
+            std::lock_guard<std::mutex> lock (pageMutex_);
+            auto const result = pageEnds_.emplace (key, *next);
+            if (result.second)
+            {
+                pageOrder_.push_back (std::move (key));
+                while (pageEnds_.size () > maxPageEnds)
+                {
+                    pageEnds_.erase (pageOrder_.front ());
+                    pageOrder_.pop_front ();
+                }
+            }
+            else
+            {
+                result.first->second = *next;
+            }
+        }
+        return ret;
+    }
+
+    std::vector<Tx>
+    getTxHistory (std::uint32_t offset, std::uint32_t limit) override
+    {
+        std::vector<Tx> ret;
+
+        std::unique_ptr<rocksdb::Iterator> it (
+            db_->NewIterator (rocksdb::ReadOptions ()));
+
+        // The last ledger key
+        it->Seek (std::string (1, static_cast<char>(ledgerPrefix + 1)));
+        if (it->Valid ())
+            it->Prev ();
+        else
+            it->SeekToLast ();
+
+        for (; it->Valid () && ret.size () < limit; it->Prev ())
+        {
+            if (it->key ()[0] != ledgerPrefix)
+                break;
+
+            if (offset != 0)
+            {
+                --offset;
+                continue;
+            }
+
+            if (auto tx = fetch (it->value ().data ()))
+                ret.push_back (std::move (*tx));
+        }
+        check (it->status ());
+
+        return ret;
+    }
+
+    boost::optional<LedgerIndex>
+    getMinLedgerSeq() override
+    {
+        std::unique_ptr<rocksdb::Iterator> it (
+            db_->NewIterator (rocksdb::ReadOptions ()));
+        it->Seek (std::string (1, ledgerPrefix));
+        check (it->status ());
+        if (! it->Valid () || it->key ()[0] != ledgerPrefix)
+            return boost::none;
+        return read32 (it->key ().data () + 1);
+    }
+
+    void
+    deleteBeforeLedgerSeq (LedgerIndex seq) override
+    {
+        rocksdb::WriteBatch wb;
+        eraseLedgers (wb, 0, seq);
+        check (db_->Write (rocksdb::WriteOptions (), &wb));
+
+        // The remembered offsets counted the deleted transactions
+        forgetPages (seq, true);
+    }
+};
+
+//------------------------------------------------------------------------------
+
+std::unique_ptr<HistoryStore>
+make_RocksDBHistoryStore (
+    Section const& section,
+    std::string const& path,
+    beast::Journal journal)
+{
+    return std::make_unique<RocksDBHistoryStore> (section, path, journal);
+}
+
+} // ripple
+
+#else
+
+namespace ripple {
+
+std::unique_ptr<HistoryStore>
+make_RocksDBHistoryStore (
+    Section const& section,
+    std::string const& path,
+    beast::Journal journal)
+{
+    return nullptr;
+}
+
+} // ripple
+
+#endif
@@ -0,0 +1,531 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <ripple/app/ledger/LedgerSQLWriter.h>
+#include <ripple/app/misc/impl/HistoryStoreImp.h>
+#include <ripple/core/SociDB.h>
+#include <ripple/protocol/STTx.h>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <mutex>
+
+namespace ripple {
+
+// Stores transactions in the Transactions and AccountTransactions
+// tables of the transaction database
+class SQLiteHistoryStore : public HistoryStore
+{
+private:
+    // Statements used to save transactions, and the values bound to them
+    class SaveStatements
+    {
+    public:
+        struct AccountRow
+        {
+            std::string txnId;
+            std::string account;
+            std::uint32_t ledgerSeq = 0;
+            std::uint32_t txnSeq = 0;
+        };
+
+        std::uint32_t seq = 0;
+        std::string txnId;
+        std::string txnType;
+        std::string account;
+        std::uint32_t accountSeq = 0;
+        std::string const status = std::string (1, TXN_SQL_VALIDATED);
+        soci::blob raw;
+        soci::blob meta;
+        std::array<AccountRow, LedgerSQLWriter::accountRowsPerInsert> accounts;
+
+        soci::statement deleteTransactions;
+        soci::statement deleteLedgerAccounts;
+        soci::statement deleteTxnAccounts;
+        soci::statement insertTransaction;
+        soci::statement insertAccount;
+        soci::statement insertAccounts;
+
+        explicit
+        SaveStatements (soci::session& session);
+    };
+
+    DatabaseCon& db_;
+    AccountIDCache const& idCache_;
+    beast::Journal journal_;
+
+    // Only used by saveTransactions, which is not called concurrently
+    std::unique_ptr<SaveStatements> save_;
+
+    std::vector<Tx>
+    query (std::string const& sql);
+
+public:
+    SQLiteHistoryStore (DatabaseCon& db, AccountIDCache const& idCache,
+            beast::Journal journal)
+        : db_ (db)
+        , idCache_ (idCache)
+        , journal_ (journal)
+    {
+    }
+
+    ~SQLiteHistoryStore ()
+    {
+        // The statements must be finalized before the database closes
+        auto db = db_.checkoutDb ();
+        save_.reset ();
+    }
+
+    std::string
+    getName() override
+    {
+        return "sqlite";
+    }
+
+    void
+    saveTransactions (LedgerSQLRows const& rows) override;
+
+    boost::optional<Tx>
+    getTransaction (uint256 const& id) override;
+
+    void
+    forEachAccountTx (AccountID const& account,
+        std::uint32_t minLedger, std::uint32_t maxLedger,
+        bool forward, boost::optional<Position> const& start,
+        std::uint32_t limit, std::function<void(Tx&&)> const& f) override;
+
+    std::vector<Tx>
+    getAccountTxs (AccountID const& account,
+        std::uint32_t minLedger, std::uint32_t maxLedger,
+        bool descending, std::uint32_t offset, std::uint32_t limit) override;
+
+    std::vector<Tx>
+    getTxHistory (std::uint32_t offset, std::uint32_t limit) override;
+
+    boost::optional<LedgerIndex>
+    getMinLedgerSeq() override;
+
+    void
+    deleteBeforeLedgerSeq (LedgerIndex seq) override;
+};
+
+//------------------------------------------------------------------------------
+
+SQLiteHistoryStore::SaveStatements::SaveStatements (soci::session& session)
+    : raw (session)
+    , meta (session)
+    , deleteTransactions (session)
+    , deleteLedgerAccounts (session)
+    , deleteTxnAccounts (session)
+    , insertTransaction (session)
+    , insertAccount (session)
+    , insertAccounts (session)
+{
+    prepare (deleteTransactions,
+        "DELETE FROM Transactions WHERE LedgerSeq = :ledgerSeq;",
+        soci::use (seq));
+    prepare (deleteLedgerAccounts,
+        "DELETE FROM AccountTransactions WHERE LedgerSeq = :ledgerSeq;",
+        soci::use (seq));
+    prepare (deleteTxnAccounts,
+        "DELETE FROM AccountTransactions WHERE TransID = :transID;",
+        soci::use (txnId));
+    prepare (insertTransaction,
+        STTx::getMetaSQLInsertReplaceHeader () +
+            "(:transID, :transType, :fromAcct, :fromSeq, :ledgerSeq, "
+            ":status, :rawTxn, :txnMeta);",
+        soci::use (txnId),
+        soci::use (txnType),
+        soci::use (account),
+        soci::use (accountSeq),
+        soci::use (seq),
+        soci::use (status),
+        soci::use (raw),
+        soci::use (meta));
+
+    std::string const header =
+        "INSERT INTO AccountTransactions "
+        "(TransID, Account, LedgerSeq, TxnSeq) VALUES ";
+    prepare (insertAccount, header +
+        "(:transID, :account, :ledgerSeq, :txnSeq);",
+        soci::use (accounts[0].txnId),
+        soci::use (accounts[0].account),
+        soci::use (accounts[0].ledgerSeq),
+        soci::use (accounts[0].txnSeq));
+
+    std::string sql = header;
+    for (std::size_t i = 0; i < accounts.size (); ++i)
+    {
+        auto const n = std::to_string (i);
+        if (i != 0)
+            sql += ", ";
+        sql += "(:transID" + n + ", :account" + n +
+            ", :ledgerSeq" + n + ", :txnSeq" + n + ")";
+        insertAccounts.exchange (soci::use (accounts[i].txnId));
+        insertAccounts.exchange (soci::use (accounts[i].account));
+        insertAccounts.exchange (soci::use (accounts[i].ledgerSeq));
+        insertAccounts.exchange (soci::use (accounts[i].txnSeq));
+    }
+    prepare (insertAccounts, sql + ";");
+}
+
+void
+SQLiteHistoryStore::saveTransactions (LedgerSQLRows const& rows)
+{
+    auto db = db_.checkoutDb ();
+    if (! save_)
+        save_ = std::make_unique<SaveStatements> (*db);
+    auto& st = *save_;
+
+    soci::transaction tr (*db);
+
+    auto const seq = rows.info.seq;
+    st.seq = seq;
+    st.deleteTransactions.execute (true);
+    st.deleteLedgerAccounts.execute (true);
+
+    std::size_t n = 0;
+    auto const flush = [&st, &n](std::size_t count)
+    {
+        if (count == st.accounts.size ())
+        {
+            st.insertAccounts.execute (true);
+        }
+        else
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (i != 0)
+                    st.accounts[0] = std::move (st.accounts[i]);
+                st.insertAccount.execute (true);
+            }
+        }
+        n = 0;
+    };
+
+    for (auto const& txn : rows.transactions)
+    {
+        st.txnId = to_string (txn.id);
+        st.txnType = txn.type;
+        st.account = idCache_.toBase58 (txn.account);
+        st.accountSeq = txn.accountSeq;
+        st.raw.trim (0);
+        convert (txn.raw, st.raw);
+        st.meta.trim (0);
+        convert (txn.meta, st.meta);
+
+        st.deleteTxnAccounts.execute (true);
+        st.insertTransaction.execute (true);
+
+        for (auto const& account : txn.affected)
+        {
+            auto& row = st.accounts[n];
+            row.txnId = st.txnId;
+            row.account = idCache_.toBase58 (account);
+            row.ledgerSeq = seq;
+            row.txnSeq = txn.txnSeq;
+            if (++n == st.accounts.size ())
+                flush (n);
+        }
+    }
+    if (n != 0)
+        flush (n);
+
+    tr.commit ();
+}
+
+boost::optional<HistoryStore::Tx>
+SQLiteHistoryStore::getTransaction (uint256 const& id)
+{
+    std::string sql = "SELECT LedgerSeq,Status,RawTxn "
+            "FROM Transactions WHERE TransID='";
+    sql.append (to_string (id));
+    sql.append ("';");
+
+    boost::optional<std::uint64_t> ledgerSeq;
+    Tx tx;
+    {
+        auto db = db_.checkoutDb ();
+        soci::blob sociRawTxnBlob (*db);
+        soci::indicator rti;
+
+        *db << sql, soci::into (ledgerSeq), soci::into (tx.status),
+                soci::into (sociRawTxnBlob, rti);
+        if (!db->got_data () || rti != soci::i_ok)
+            return boost::none;
+
+        convert(sociRawTxnBlob, tx.raw);
+    }
+
+    tx.ledgerSeq = rangeCheckedCast<std::uint32_t>(ledgerSeq.value_or (0));
+    return tx;
+}
+
+// Run a query selecting LedgerSeq, TxnSeq, Status, RawTxn and TxnMeta
+std::vector<HistoryStore::Tx>
+SQLiteHistoryStore::query (std::string const& sql)
+{
+    JLOG(journal_.trace()) << "query: " << sql;
+
+    std::vector<Tx> ret;
+
+    auto db = db_.checkoutDb ();
+
+    boost::optional<std::uint64_t> ledgerSeq;
+    boost::optional<std::uint32_t> txnSeq;
+    boost::optional<std::string> status;
+    soci::blob txnData (*db);
+    soci::blob txnMeta (*db);
+    soci::indicator dataPresent, metaPresent;
+
+    soci::statement st = (db->prepare << sql,
+        soci::into (ledgerSeq),
+        soci::into (txnSeq),
+        soci::into (status),
+        soci::into (txnData, dataPresent),
+        soci::into (txnMeta, metaPresent));
+
+    st.execute ();
+
+    while (st.fetch ())
+    {
+        Tx tx;
+        tx.ledgerSeq =
+            rangeCheckedCast<std::uint32_t>(ledgerSeq.value_or (0));
+        tx.txnSeq = txnSeq.value_or (0);
+        tx.status = status;
+        if (dataPresent == soci::i_ok)
+            convert (txnData, tx.raw);
+        if (metaPresent == soci::i_ok)
+            convert (txnMeta, tx.meta);
+        ret.push_back (std::move (tx));
+    }
+
+    return ret;
+}
+
+void
+SQLiteHistoryStore::forEachAccountTx (AccountID const& account,
+    std::uint32_t minLedger, std::uint32_t maxLedger,
+    bool forward, boost::optional<Position> const& start,
+    std::uint32_t limit, std::function<void(Tx&&)> const& f)
+{
+    static std::string const prefix (
+        R"(SELECT AccountTransactions.LedgerSeq,AccountTransactions.TxnSeq,
+          Status,RawTxn,TxnMeta
+          FROM AccountTransactions INNER JOIN Transactions
+          ON Transactions.TransID = AccountTransactions.TransID
+          AND AccountTransactions.Account = '%s' WHERE
+          )");
+
+    std::string sql;
+
+    // SQL's BETWEEN uses a closed interval ([a,b])
+
+    if (forward && ! start)
+    {
+        sql = boost::str (boost::format(
+            prefix +
+            (R"(AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u'
+             ORDER BY AccountTransactions.LedgerSeq ASC,
+             AccountTransactions.TxnSeq ASC
+             LIMIT %u;)"))
+            % idCache_.toBase58(account)
+            % minLedger
+            % maxLedger
+            % limit);
+    }
+    else if (forward && start)
+    {
+        sql = boost::str (boost::format(
+            prefix +
+            (R"(
+            AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u' OR
+            ( AccountTransactions.LedgerSeq = '%u' AND
+              AccountTransactions.TxnSeq >= '%u' )
+            ORDER BY AccountTransactions.LedgerSeq ASC,
+            AccountTransactions.TxnSeq ASC
+            LIMIT %u;
+            )"))
+        % idCache_.toBase58(account)
+        % (start->ledgerSeq + 1)
+        % maxLedger
+        % start->ledgerSeq
+        % start->txnSeq
+        % limit);
+    }
+    else if (! forward && ! start)
+    {
+        sql = boost::str (boost::format(
+            prefix +
+            (R"(AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u'
+             ORDER BY AccountTransactions.LedgerSeq DESC,
+             AccountTransactions.TxnSeq DESC
+             LIMIT %u;)"))
+            % idCache_.toBase58(account)
+            % minLedger
+            % maxLedger
+            % limit);
+    }
+    else
+    {
+        sql = boost::str (boost::format(
+            prefix +
+            (R"(AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u' OR
+             (AccountTransactions.LedgerSeq = '%u' AND
+              AccountTransactions.TxnSeq <= '%u')
+             ORDER BY AccountTransactions.LedgerSeq DESC,
+             AccountTransactions.TxnSeq DESC
+             LIMIT %u;)"))
+            % idCache_.toBase58(account)
+            % minLedger
+            % (start->ledgerSeq - 1)
+            % start->ledgerSeq
+            % start->txnSeq
+            % limit);
+    }
+
+    for (auto& tx : query (sql))
+        f (std::move (tx));
+}
+
+std::vector<HistoryStore::Tx>
+SQLiteHistoryStore::getAccountTxs (AccountID const& account,
+    std::uint32_t minLedger, std::uint32_t maxLedger,
+    bool descending, std::uint32_t offset, std::uint32_t limit)
+{
+    std::string maxClause = "";
+    std::string minClause = "";
+
+    if (maxLedger != std::numeric_limits<std::uint32_t>::max ())
+    {
+        maxClause = boost::str (boost::format (
+            "AND AccountTransactions.LedgerSeq <= '%u'") % maxLedger);
+    }
+
+    if (minLedger != 0)
+    {
+        minClause = boost::str (boost::format (
+            "AND AccountTransactions.LedgerSeq >= '%u'") % minLedger);
+    }
+
+    auto const order = descending ? "DESC" : "ASC";
+
+    return query (boost::str (boost::format (
+        "SELECT AccountTransactions.LedgerSeq,AccountTransactions.TxnSeq,"
+        "Status,RawTxn,TxnMeta FROM "
+        "AccountTransactions INNER JOIN Transactions "
+        "ON Transactions.TransID = AccountTransactions.TransID "
+        "WHERE Account = '%s' %s %s "
+        "ORDER BY AccountTransactions.LedgerSeq %s, "
+        "AccountTransactions.TxnSeq %s, AccountTransactions.TransID %s "
+        "LIMIT %u, %u;")
+            % idCache_.toBase58(account)
+            % maxClause
+            % minClause
+            % order
+            % order
+            % order
+            % offset
+            % limit));
+}
+
+std::vector<HistoryStore::Tx>
+SQLiteHistoryStore::getTxHistory (std::uint32_t offset, std::uint32_t limit)
+{
+    std::string sql =
+        boost::str (boost::format (
+            "SELECT LedgerSeq, Status, RawTxn "
+            "FROM Transactions ORDER BY LedgerSeq desc LIMIT %u,%u;")
+                    % offset
+                    % limit);
+
+    std::vector<Tx> ret;
+
+    auto db = db_.checkoutDb ();
+
+    boost::optional<std::uint64_t> ledgerSeq;
+    boost::optional<std::string> status;
+    soci::blob sociRawTxnBlob (*db);
+    soci::indicator rti;
+
+    soci::statement st = (db->prepare << sql,
+                          soci::into (ledgerSeq),
+                          soci::into (status),
+                          soci::into (sociRawTxnBlob, rti));
+
+    st.execute ();
+    while (st.fetch ())
+    {
+        Tx tx;
+        tx.ledgerSeq =
+            rangeCheckedCast<std::uint32_t>(ledgerSeq.value_or (0));
+        tx.status = status;
+        if (soci::i_ok == rti)
+            convert(sociRawTxnBlob, tx.raw);
+        ret.push_back (std::move (tx));
+    }
+
+    return ret;
+}
+
+boost::optional<LedgerIndex>
+SQLiteHistoryStore::getMinLedgerSeq()
+{
+    boost::optional<std::uint64_t> txns;
+    boost::optional<std::uint64_t> accounts;
+    {
+        auto db = db_.checkoutDb ();
+        *db << "SELECT MIN(LedgerSeq) FROM Transactions;",
+            soci::into(txns);
+        *db << "SELECT MIN(LedgerSeq) FROM AccountTransactions;",
+            soci::into(accounts);
+    }
+    if (! txns && ! accounts)
+        return boost::none;
+    return rangeCheckedCast<LedgerIndex>(std::min (
+        txns.value_or (accounts.value_or (0)),
+        accounts.value_or (txns.value_or (0))));
+}
+
+void
+SQLiteHistoryStore::deleteBeforeLedgerSeq (LedgerIndex seq)
+{
+    auto db = db_.checkoutDb ();
+    *db << boost::str (boost::format (
+        "DELETE FROM Transactions WHERE LedgerSeq < %u;") % seq);
+    *db << boost::str (boost::format (
+        "DELETE FROM AccountTransactions WHERE LedgerSeq < %u;") % seq);
+}
+
+//------------------------------------------------------------------------------
+
+std::unique_ptr<HistoryStore>
+make_SQLiteHistoryStore (
+    DatabaseCon& txnDB,
+    AccountIDCache const& idCache,
+    beast::Journal journal)
+{
+    return std::make_unique<SQLiteHistoryStore> (txnDB, idCache, journal);
+}
+
+} // ripple
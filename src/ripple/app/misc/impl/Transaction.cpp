@@ -25,6 +25,7 @@
 #include <ripple/app/ledger/LedgerMaster.h>
 #include <ripple/app/main/Application.h>
 #include <ripple/app/misc/HashRouter.h>
+#include <ripple/app/misc/HistoryStore.h>
 #include <ripple/protocol/Feature.h>
 #include <ripple/protocol/JsonFields.h>
 #include <boost/optional.hpp>
@@ -119,29 +120,13 @@ Transaction::pointer Transaction::transactionFromSQLValidated(
 
 Transaction::pointer Transaction::load(uint256 const& id, Application& app)
 {
-    std::string sql = "SELECT LedgerSeq,Status,RawTxn "
-            "FROM Transactions WHERE TransID='";
-    sql.append (to_string (id));
-    sql.append ("';");
-
-    boost::optional<std::uint64_t> ledgerSeq;
-    boost::optional<std::string> status;
-    Blob rawTxn;
-    {
-        auto db = app.getTxnDB ().checkoutDb ();
-        soci::blob sociRawTxnBlob (*db);
-        soci::indicator rti;
-
-        *db << sql, soci::into (ledgerSeq), soci::into (status),
-                soci::into (sociRawTxnBlob, rti);
-        if (!db->got_data () || rti != soci::i_ok)
-            return {};
-
-        convert(sociRawTxnBlob, rawTxn);
-    }
+    auto const tx = app.getHistoryStore ().getTransaction (id);
+    if (! tx)
+        return {};
 
     return Transaction::transactionFromSQLValidated (
-        ledgerSeq, status, rawTxn, app);
+        boost::optional<std::uint64_t> (tx->ledgerSeq), tx->status,
+            tx->raw, app);
 }
 
 // options 1 to include the date of the transaction
@@ -0,0 +1,123 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#ifndef RIPPLE_TX_BATCHVERIFIER_H_INCLUDED
+#define RIPPLE_TX_BATCHVERIFIER_H_INCLUDED
+
+#include <ripple/core/Config.h>
+#include <ripple/core/Stoppable.h>
+#include <ripple/protocol/STTx.h>
+#include <ripple/beast/utility/Journal.h>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ripple {
+
+class HashRouter;
+
+/** Checks the signatures of inbound transactions on a pool of threads.
+
+    Signatures are checked by threads dedicated to the task, so they do
+    not compete with other work for the job queue's threads. Each thread
+    takes up to a batch of the waiting transactions at a time. The results
+    are cached in the HashRouter, where checkValidity finds them.
+
+    @see checkSignatures
+*/
+class BatchVerifier : public Stoppable
+{
+public:
+    struct Setup
+    {
+        // Threads checking signatures. When zero, signatures
+        // are left for checkValidity.
+        std::size_t threads = 0;
+
+        // The most transactions a thread takes at once
+        std::size_t batchSize = 64;
+    };
+
+    /** Called once the signature of a transaction is checked. */
+    using Callback = std::function<void()>;
+
+    BatchVerifier (Stoppable& parent, Setup const& setup,
+        HashRouter& router, beast::Journal journal);
+
+    ~BatchVerifier ();
+
+    /** Returns `true` if signatures are checked by the pool. */
+    bool
+    enabled () const
+    {
+        return setup_.threads > 0;
+    }
+
+    /** Queue a transaction to have its signature checked.
+
+        The callback is invoked on one of the verifier's threads once
+        the result is cached. When the verifier is disabled or has
+        stopped, the callback is invoked before this returns and the
+        signature is left for checkValidity.
+    */
+    void
+    check (std::shared_ptr<STTx const> tx, Callback callback);
+
+    /** Check the signature of a transaction before returning. */
+    void
+    check (std::shared_ptr<STTx const> tx);
+
+    /** Returns the number of transactions waiting to be checked. */
+    std::size_t
+    pending () const;
+
+private:
+    struct Item
+    {
+        std::shared_ptr<STTx const> tx;
+        Callback callback;
+    };
+
+    void onStop () override;
+    void run (std::size_t index);
+
+    Setup const setup_;
+    HashRouter& router_;
+    beast::Journal journal_;
+
+    std::mutex mutable mutex_;
+    std::condition_variable cond_;
+    std::deque<Item> queue_;
+    bool stop_ = false;
+    std::vector<std::thread> threads_;
+};
+
+/** Returns the settings from the [signature_batch] section. */
+BatchVerifier::Setup
+setup_BatchVerifier (Config const& config);
+
+} // ripple
+
+#endif
@@ -27,6 +27,7 @@
 #include <ripple/beast/utility/Journal.h>
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace ripple {
 
@@ -66,6 +67,18 @@ checkValidity(HashRouter& router,
         Config const& config);
 
 
+/** Checks the signatures of a group of single-signed transactions.
+
+    The results are cached for checkValidity. Transactions whose
+    signature is already known, and multi-signed transactions, are
+    left for checkValidity to check.
+
+    @see checkValidity
+*/
+void
+checkSignatures(HashRouter& router,
+    std::vector<std::shared_ptr<STTx const>> const& txs);
+
 /** Sets the validity of a given transaction in the cache.
 
     @warning Use with extreme care.
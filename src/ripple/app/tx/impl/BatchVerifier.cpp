@@ -0,0 +1,182 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <ripple/app/tx/BatchVerifier.h>
+#include <ripple/app/tx/apply.h>
+#include <ripple/basics/Log.h>
+#include <ripple/beast/core/CurrentThreadName.h>
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace ripple {
+
+BatchVerifier::BatchVerifier (Stoppable& parent, Setup const& setup,
+        HashRouter& router, beast::Journal journal)
+    : Stoppable ("BatchVerifier", parent)
+    , setup_ (setup)
+    , router_ (router)
+    , journal_ (journal)
+{
+    threads_.reserve (setup_.threads);
+    for (std::size_t i = 0; i < setup_.threads; ++i)
+        threads_.emplace_back (&BatchVerifier::run, this, i);
+}
+
+BatchVerifier::~BatchVerifier ()
+{
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all ();
+    for (auto& thread : threads_)
+    {
+        if (thread.joinable ())
+            thread.join ();
+    }
+}
+
+void
+BatchVerifier::check (std::shared_ptr<STTx const> tx, Callback callback)
+{
+    if (enabled ())
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        if (! stop_)
+        {
+            queue_.push_back ({ std::move (tx), std::move (callback) });
+            cond_.notify_one ();
+            return;
+        }
+    }
+
+    if (callback)
+        callback ();
+}
+
+void
+BatchVerifier::check (std::shared_ptr<STTx const> tx)
+{
+    if (! enabled ())
+        return;
+
+    auto done = std::make_shared<std::promise<void>> ();
+    auto checked = done->get_future ();
+    check (std::move (tx), [done]{ done->set_value (); });
+    checked.wait ();
+}
+
+std::size_t
+BatchVerifier::pending () const
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    return queue_.size ();
+}
+
+void
+BatchVerifier::onStop ()
+{
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all ();
+
+    // Transactions already queued are checked before stopping
+    for (auto& thread : threads_)
+    {
+        if (thread.joinable ())
+            thread.join ();
+    }
+    stopped ();
+}
+
+void
+BatchVerifier::run (std::size_t index)
+{
+    beast::setCurrentThreadName (
+        "BatchVerifier #" + std::to_string (index + 1));
+
+    std::vector<Item> batch;
+    std::vector<std::shared_ptr<STTx const>> txs;
+
+    std::unique_lock<std::mutex> lock (mutex_);
+    for (;;)
+    {
+        cond_.wait (lock, [this]{ return stop_ || ! queue_.empty (); });
+        if (queue_.empty ())
+            return;
+
+        // Share the waiting transactions between the threads
+        auto const n = std::min (setup_.batchSize,
+            (queue_.size () + setup_.threads - 1) / setup_.threads);
+        batch.assign (std::make_move_iterator (queue_.begin ()),
+            std::make_move_iterator (queue_.begin () + n));
+        queue_.erase (queue_.begin (), queue_.begin () + n);
+        lock.unlock ();
+
+        txs.clear ();
+        for (auto const& item : batch)
+            txs.push_back (item.tx);
+
+        try
+        {
+            checkSignatures (router_, txs);
+        }
+        catch (std::exception const& e)
+        {
+            // checkValidity will check the signatures instead
+            JLOG (journal_.warn()) <<
+                "Failed to check " << n << " signatures: " << e.what ();
+        }
+
+        for (auto& item : batch)
+        {
+            if (item.callback)
+                item.callback ();
+        }
+        batch.clear ();
+
+        lock.lock ();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+BatchVerifier::Setup
+setup_BatchVerifier (Config const& config)
+{
+    BatchVerifier::Setup setup;
+    auto const& section = config.section ("signature_batch");
+    setup.threads = std::thread::hardware_concurrency ();
+    set (setup.threads, "threads", section);
+    set (setup.batchSize, "batch_size", section);
+
+    if (setup.batchSize < 1)
+        setup.batchSize = 1;
+    return setup;
+}
+
+} // ripple
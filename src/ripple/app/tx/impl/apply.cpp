@@ -82,6 +82,24 @@ checkValidity(HashRouter& router,
     return {Validity::Valid, ""};
 }
 
+void
+checkSignatures(HashRouter& router,
+    std::vector<std::shared_ptr<STTx const>> const& txs)
+{
+    for (auto const& tx : txs)
+    {
+        auto const id = tx->getTransactionID();
+        if (router.getFlags(id) & (SF_SIGBAD | SF_SIGGOOD))
+            // Signature state already known
+            continue;
+        if (tx->getSigningPubKey().empty())
+            // Multi-signed. Whether that is allowed depends on the rules.
+            continue;
+        router.setFlags(id,
+            tx->checkSign(false).first ? SF_SIGGOOD : SF_SIGBAD);
+    }
+}
+
 void
 forceValidity(HashRouter& router, uint256 const& txid,
     Validity validity)
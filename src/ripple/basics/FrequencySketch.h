@@ -0,0 +1,129 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_BASICS_FREQUENCYSKETCH_H_INCLUDED
+#define RIPPLE_BASICS_FREQUENCYSKETCH_H_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ripple {
+
+/** Estimates how often each key has been seen recently.
+
+    This is the count-min sketch used by TinyLFU: every key increments
+    one small saturating counter in each of four rows, and its estimate
+    is the smallest of those counters. Once the number of increments
+    reaches ten times the capacity, every counter is halved, so the
+    estimates favor recent history.
+
+    Keys are identified by a hash, which should already be well mixed.
+
+    @note This class is not thread safe.
+*/
+class FrequencySketch
+{
+public:
+    /** The largest value an estimate can have. */
+    static std::uint8_t constexpr maxFrequency = 15;
+
+    explicit
+    FrequencySketch (std::size_t capacity = 0)
+    {
+        resize (capacity);
+    }
+
+    /** Size the sketch for the given number of keys and forget the counts. */
+    void
+    resize (std::size_t capacity)
+    {
+        // Sixteen counters per key keep the counters from saturating
+        // before they are halved.
+        std::size_t width = 16;
+        while (width < 16 * capacity)
+            width <<= 1;
+
+        table_.assign (width, 0);
+        mask_ = width - 1;
+        additions_ = 0;
+        sampleSize_ = 10 * std::max<std::size_t> (capacity, 1);
+    }
+
+    /** Record an occurrence of the key. */
+    void
+    increment (std::size_t hash)
+    {
+        bool added = false;
+        for (int i = 0; i < depth; ++i)
+        {
+            auto& counter = table_[index (hash, i)];
+            if (counter < maxFrequency)
+            {
+                ++counter;
+                added = true;
+            }
+        }
+
+        if (added && ++additions_ >= sampleSize_)
+            reset ();
+    }
+
+    /** Return the estimated number of recent occurrences of the key. */
+    std::uint8_t
+    estimate (std::size_t hash) const
+    {
+        std::uint8_t frequency = maxFrequency;
+        for (int i = 0; i < depth; ++i)
+            frequency = std::min (frequency, table_[index (hash, i)]);
+        return frequency;
+    }
+
+private:
+    static int constexpr depth = 4;
+
+    std::size_t
+    index (std::size_t hash, int row) const
+    {
+        static std::array<std::uint64_t, depth> constexpr seeds {{
+            0xc3a5c85c97cb3127ull, 0xb492b66fbe98f273ull,
+            0x9ae16a3b2f90404full, 0xcbf29ce484222325ull }};
+
+        std::uint64_t h = (hash + seeds[row]) * seeds[row];
+        return static_cast<std::size_t> (h ^ (h >> 32)) & mask_;
+    }
+
+    void
+    reset ()
+    {
+        for (auto& counter : table_)
+            counter >>= 1;
+        additions_ /= 2;
+    }
+
+    std::vector<std::uint8_t> table_;
+    std::size_t mask_;
+    std::size_t additions_;
+    std::size_t sampleSize_;
+};
+
+}
+
+#endif
@@ -24,6 +24,7 @@
 #include <ripple/basics/UnorderedContainers.h>
 #include <ripple/beast/clock/abstract_clock.h>
 #include <ripple/beast/insight/Insight.h>
+#include <algorithm>
 #include <mutex>
 
 namespace ripple {
@@ -167,6 +168,28 @@ public:
         m_target_age = std::chrono::seconds (s);
     }
 
+    /** Returns the approximate memory used by the entries. */
+    std::size_t bytes () const
+    {
+        return size () * entryBytes ();
+    }
+
+    /** Bound the target size by the memory the entries may use.
+        Every entry is the same size, so this is a target size. The
+        lower of it and the current target size takes effect.
+        0 means no limit from memory.
+    */
+    void setTargetBytes (std::size_t bytes)
+    {
+        if (bytes == 0)
+            return;
+
+        auto const size = std::max<size_type> (bytes / entryBytes (), 1);
+        lock_guard lock (m_mutex);
+        if (m_target_size == 0 || size < m_target_size)
+            m_target_size = size;
+    }
+
     /** Returns `true` if the key was found.
         Does not update the last access time.
     */
@@ -282,6 +305,12 @@ public:
     }
 
 private:
+    static std::size_t entryBytes ()
+    {
+        // The map node holds the key, the entry and the bucket links
+        return sizeof (typename map_type::value_type) + 2 * sizeof (void*);
+    }
+
     void collect_metrics ()
     {
         m_stats.size.set (size ());
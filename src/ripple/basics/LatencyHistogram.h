@@ -0,0 +1,182 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_BASICS_LATENCYHISTOGRAM_H_INCLUDED
+#define RIPPLE_BASICS_LATENCYHISTOGRAM_H_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace ripple {
+
+/** A distribution of durations, for reporting percentiles.
+
+    Durations are counted in microseconds, in log-linear buckets as in an
+    HDR histogram: values below 32 have a bucket each, and every power of
+    two above that is split into 16 buckets. A percentile is reported as
+    the top of its bucket, which is at most 1/16 above the true value.
+    Durations over about 71 minutes are counted as 71 minutes.
+
+    Samples are added without locks to one of several stripes, chosen by
+    the calling thread, so threads rarely share a cache line. The stripes
+    are merged when a snapshot is taken.
+
+    @note This class is thread safe.
+*/
+class LatencyHistogram
+{
+public:
+    using duration = std::chrono::microseconds;
+
+    static int constexpr subBits = 4;
+    static int constexpr maxBits = 32;
+    static std::size_t constexpr subBuckets = std::size_t{1} << subBits;
+    static std::size_t constexpr buckets = (maxBits - subBits + 1) * subBuckets;
+
+    /** The merged counts of a histogram. */
+    struct Snapshot
+    {
+        std::array<std::uint64_t, buckets> counts {};
+        std::uint64_t count = 0;
+        duration max {0};
+
+        /** Returns the duration at or below which `p` of the samples fall.
+            @param p A fraction between 0 and 1.
+        */
+        duration
+        percentile (double p) const
+        {
+            if (count == 0)
+                return duration {0};
+
+            auto const rank = std::max<std::uint64_t> (1,
+                static_cast<std::uint64_t> (std::ceil (p * count)));
+
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < buckets; ++i)
+            {
+                seen += counts[i];
+                if (seen >= rank)
+                    return std::min (duration (upper (i)), max);
+            }
+            return max;
+        }
+    };
+
+    LatencyHistogram () = default;
+    LatencyHistogram (LatencyHistogram const&) = delete;
+    LatencyHistogram& operator= (LatencyHistogram const&) = delete;
+
+    /** Add a sample. */
+    template <class Rep, class Period>
+    void
+    insert (std::chrono::duration<Rep, Period> const& d)
+    {
+        auto const us = std::chrono::duration_cast<duration> (d).count ();
+        auto const value = static_cast<std::uint64_t> (std::max<
+            decltype(us)> (us, 0));
+
+        auto& stripe = stripes_[home () % stripeCount];
+        stripe.counts[bucket (value)].fetch_add (
+            1, std::memory_order_relaxed);
+
+        auto max = stripe.max.load (std::memory_order_relaxed);
+        while (value > max && ! stripe.max.compare_exchange_weak (
+                max, value, std::memory_order_relaxed))
+            ;
+    }
+
+    /** Returns the counts of every stripe added together. */
+    Snapshot
+    snapshot () const
+    {
+        Snapshot result;
+        std::uint64_t max = 0;
+        for (auto const& stripe : stripes_)
+        {
+            for (std::size_t i = 0; i < buckets; ++i)
+            {
+                auto const n = stripe.counts[i].load (
+                    std::memory_order_relaxed);
+                result.counts[i] += n;
+                result.count += n;
+            }
+            max = std::max (max,
+                stripe.max.load (std::memory_order_relaxed));
+        }
+        result.max = duration (max);
+        return result;
+    }
+
+    /** Returns the bucket counting a value. */
+    static
+    std::size_t
+    bucket (std::uint64_t value)
+    {
+        auto const top = (std::uint64_t{1} << maxBits) - 1;
+        value = std::min (value, top);
+
+        // The number of low bits dropped from the value
+        int shift = 0;
+        while ((value >> shift) >= 2 * subBuckets)
+            ++shift;
+        return shift * subBuckets + static_cast<std::size_t> (value >> shift);
+    }
+
+    /** Returns the largest value counted by a bucket. */
+    static
+    std::uint64_t
+    upper (std::size_t index)
+    {
+        if (index < 2 * subBuckets)
+            return index;
+        auto const shift = index / subBuckets - 1;
+        auto const mantissa = index - shift * subBuckets;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+private:
+    static std::size_t constexpr stripeCount = 4;
+
+    struct Stripe
+    {
+        std::array<std::atomic<std::uint64_t>, buckets> counts {};
+        std::atomic<std::uint64_t> max {0};
+    };
+
+    static
+    std::size_t
+    home ()
+    {
+        static std::atomic<std::size_t> next {0};
+        static thread_local std::size_t const index = next++;
+        return index;
+    }
+
+    std::array<Stripe, stripeCount> stripes_;
+};
+
+} // ripple
+
+#endif
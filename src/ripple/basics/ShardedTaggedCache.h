@@ -0,0 +1,574 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_BASICS_SHARDEDTAGGEDCACHE_H_INCLUDED
+#define RIPPLE_BASICS_SHARDEDTAGGEDCACHE_H_INCLUDED
+
+#include <ripple/basics/BasicConfig.h>
+#include <ripple/basics/contract.h>
+#include <ripple/basics/FrequencySketch.h>
+#include <ripple/basics/TaggedCache.h>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace ripple {
+
+/** How a ShardedTaggedCache decides which objects to keep.
+
+    lru
+        Every object is cached, and objects are expired by age,
+        faster as the cache grows past its target size.
+
+    tinylfu
+        New objects go into a small window, about one percent of the
+        target size, which is expired in the same way. An object moves
+        into the main cache once it has been requested more than once
+        recently, according to a frequency sketch. A one-time scan of
+        many objects then fills and ages the window, not the main cache,
+        so the working set survives it.
+*/
+enum class CachePolicy
+{
+    lru,
+    tinylfu
+};
+
+inline
+std::string
+to_string (CachePolicy policy)
+{
+    return policy == CachePolicy::tinylfu ? "tinylfu" : "lru";
+}
+
+/** Return the policy named by the "cache_policy" key of a section.
+    The default is lru. Throws if the name is not recognized.
+*/
+inline
+CachePolicy
+getCachePolicy (Section const& section)
+{
+    auto const name = get<std::string> (section, "cache_policy", "lru");
+    if (name == "lru")
+        return CachePolicy::lru;
+    if (name == "tinylfu")
+        return CachePolicy::tinylfu;
+    Throw<std::runtime_error> ("Unknown cache_policy '" + name + "'");
+    return CachePolicy::lru;
+}
+
+/** A TaggedCache split into independently locked shards.
+
+    Each key is assigned to one of the shards by its hash, and each shard
+    is a complete TaggedCache with its own mutex, so threads working on
+    different keys rarely contend for the same lock. The target size is
+    divided evenly between the shards.
+
+    A sweep visits the shards one at a time and only holds the lock of
+    the shard being swept, so lookups into the other shards proceed.
+
+    The interface matches TaggedCache, except that there is no single
+    mutex to expose.
+
+    @see CachePolicy
+*/
+template <
+    class Key,
+    class T,
+    class Hash = hardened_hash <>,
+    class KeyEqual = std::equal_to <Key>,
+    class Mutex = std::recursive_mutex
+>
+class ShardedTaggedCache
+{
+public:
+    using shard_type = TaggedCache <Key, T, Hash, KeyEqual, Mutex>;
+    using key_type = Key;
+    using mapped_type = T;
+    using weak_mapped_ptr = std::weak_ptr <mapped_type>;
+    using mapped_ptr = std::shared_ptr <mapped_type>;
+    using clock_type = typename shard_type::clock_type;
+
+    /** The number of shards used unless another count is requested. */
+    static std::size_t constexpr defaultShards = 16;
+
+public:
+    ShardedTaggedCache (std::string const& name, int size,
+        typename clock_type::rep expiration_seconds, clock_type& clock,
+            beast::Journal journal,
+                beast::insight::Collector::ptr const& collector =
+                    beast::insight::NullCollector::New (),
+                        CachePolicy policy = CachePolicy::lru,
+                            std::size_t shards = defaultShards)
+        : m_journal (journal)
+        , m_clock (clock)
+        , m_stats (name,
+            std::bind (&ShardedTaggedCache::collect_metrics, this),
+                collector)
+        , m_name (name)
+        , m_policy (policy)
+        , m_target_size (size)
+        , m_target_bytes (0)
+    {
+        assert (shards > 0);
+
+        m_shards.reserve (shards);
+        for (std::size_t i = 0; i < shards; ++i)
+        {
+            m_shards.emplace_back (std::make_unique <Shard> (
+                name, shardTargetSize (size, shards), expiration_seconds,
+                    clock, journal));
+
+            if (m_policy == CachePolicy::tinylfu)
+            {
+                auto& s = *m_shards.back ();
+                s.window = std::make_unique <shard_type> (name + ".window",
+                    shardTargetSize (windowSize (size), shards),
+                        expiration_seconds, clock, journal);
+                s.sketch.resize (shardTargetSize (size, shards));
+            }
+        }
+    }
+
+public:
+    /** Return the clock associated with the cache. */
+    clock_type& clock ()
+    {
+        return m_clock;
+    }
+
+    /** Return the admission policy. */
+    CachePolicy policy () const
+    {
+        return m_policy;
+    }
+
+    /** Return the number of shards. */
+    std::size_t shards () const
+    {
+        return m_shards.size ();
+    }
+
+    int getTargetSize () const
+    {
+        return m_target_size;
+    }
+
+    void setTargetSize (int s)
+    {
+        m_target_size = s;
+
+        auto const n = m_shards.size ();
+        for (auto& shard : m_shards)
+        {
+            shard->cache.setTargetSize (shardTargetSize (s, n));
+            if (shard->window)
+            {
+                shard->window->setTargetSize (
+                    shardTargetSize (windowSize (s), n));
+
+                std::lock_guard <std::mutex> lock (shard->mutex);
+                shard->sketch.resize (shardTargetSize (s, n));
+            }
+        }
+
+        JLOG(m_journal.debug()) <<
+            m_name << " target size set to " << s;
+    }
+
+    std::size_t getTargetBytes () const
+    {
+        return m_target_bytes;
+    }
+
+    /** Set the approximate memory the cached objects may use.
+        @see TaggedCache::setTargetBytes
+    */
+    void setTargetBytes (std::size_t bytes)
+    {
+        m_target_bytes = bytes;
+
+        // The window's share is taken out of the main cache's
+        auto const n = m_shards.size ();
+        auto const window = bytes / 100;
+        for (auto& shard : m_shards)
+        {
+            if (shard->window)
+            {
+                shard->cache.setTargetBytes ((bytes - window) / n);
+                shard->window->setTargetBytes (window / n);
+            }
+            else
+            {
+                shard->cache.setTargetBytes (bytes / n);
+            }
+        }
+
+        JLOG(m_journal.debug()) <<
+            m_name << " target bytes set to " << bytes;
+    }
+
+    typename clock_type::rep getTargetAge () const
+    {
+        return m_shards.front ()->cache.getTargetAge ();
+    }
+
+    void setTargetAge (typename clock_type::rep s)
+    {
+        for (auto& shard : m_shards)
+        {
+            shard->cache.setTargetAge (s);
+            if (shard->window)
+                shard->window->setTargetAge (s);
+        }
+    }
+
+    int getCacheSize () const
+    {
+        int size = 0;
+        for (auto const& shard : m_shards)
+        {
+            size += shard->cache.getCacheSize ();
+            if (shard->window)
+                size += shard->window->getCacheSize ();
+        }
+        return size;
+    }
+
+    /** Return the approximate memory used by the cached objects. */
+    std::size_t getCacheBytes () const
+    {
+        std::size_t bytes = 0;
+        for (auto const& shard : m_shards)
+        {
+            bytes += shard->cache.getCacheBytes ();
+            if (shard->window)
+                bytes += shard->window->getCacheBytes ();
+        }
+        return bytes;
+    }
+
+    int getTrackSize () const
+    {
+        int size = 0;
+        for (auto const& shard : m_shards)
+        {
+            size += shard->cache.getTrackSize ();
+            if (shard->window)
+                size += shard->window->getTrackSize ();
+        }
+        return size;
+    }
+
+    float getHitRate ()
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        for (auto const& shard : m_shards)
+        {
+            hits += shard->hits.load (std::memory_order_relaxed);
+            misses += shard->misses.load (std::memory_order_relaxed);
+        }
+        auto const total = static_cast<float> (hits + misses);
+        return hits * (100.0f / std::max (1.0f, total));
+    }
+
+    void clearStats ()
+    {
+        for (auto& shard : m_shards)
+        {
+            shard->hits = 0;
+            shard->misses = 0;
+        }
+    }
+
+    void clear ()
+    {
+        for (auto& shard : m_shards)
+        {
+            shard->cache.clear ();
+            if (shard->window)
+                shard->window->clear ();
+        }
+    }
+
+    /** Sweep every shard, one at a time. */
+    void sweep ()
+    {
+        for (auto& shard : m_shards)
+            sweep (*shard);
+    }
+
+    bool del (key_type const& key, bool valid)
+    {
+        auto& s = shard (key);
+        auto const lock = lockPolicy (s);
+        bool ret = s.cache.del (key, valid);
+        if (s.window && s.window->del (key, valid))
+            ret = true;
+        return ret;
+    }
+
+    /** Replace aliased objects with originals.
+        @see TaggedCache::canonicalize
+    */
+    bool canonicalize (key_type const& key, std::shared_ptr<T>& data,
+        bool replace = false)
+    {
+        auto const h = hash (key);
+        auto& s = *m_shards[h % m_shards.size ()];
+
+        if (! s.window)
+            return s.cache.canonicalize (key, data, replace);
+
+        std::lock_guard <std::mutex> lock (s.mutex);
+        if (s.cache.refreshIfPresent (key))
+            return s.cache.canonicalize (key, data, replace);
+
+        if (s.sketch.estimate (h) < admitFrequency)
+            return s.window->canonicalize (key, data, replace);
+
+        // Admitted: settle on the window's copy, if it has one, so
+        // that every caller still shares the same object
+        bool const ret = s.window->canonicalize (key, data, replace);
+        s.cache.canonicalize (key, data);
+        s.window->del (key, false);
+        return ret;
+    }
+
+    std::shared_ptr<T> fetch (key_type const& key)
+    {
+        auto const h = hash (key);
+        auto& s = *m_shards[h % m_shards.size ()];
+
+        std::shared_ptr<T> p;
+        if (s.window)
+        {
+            std::lock_guard <std::mutex> lock (s.mutex);
+            s.sketch.increment (h);
+            p = lookup (s, key, s.sketch.estimate (h));
+        }
+        else
+        {
+            p = lookup (s, key, 0);
+        }
+
+        if (p)
+            s.hits.fetch_add (1, std::memory_order_relaxed);
+        else
+            s.misses.fetch_add (1, std::memory_order_relaxed);
+        return p;
+    }
+
+    /** Fetch an object without counting the request.
+
+        The request does not count toward the hit rate, nor toward the
+        object's admission into the main cache. This is meant for
+        checks made on behalf of a later request, such as a prefetch.
+    */
+    std::shared_ptr<T> peek (key_type const& key)
+    {
+        auto& s = shard (key);
+        auto const lock = lockPolicy (s);
+        return lookup (s, key, 0);
+    }
+
+    bool insert (key_type const& key, T const& value)
+    {
+        mapped_ptr p (std::make_shared <T> (
+            std::cref (value)));
+        return canonicalize (key, p);
+    }
+
+    bool retrieve (key_type const& key, T& data)
+    {
+        mapped_ptr entry = fetch (key);
+
+        if (!entry)
+            return false;
+
+        data = *entry;
+        return true;
+    }
+
+    bool refreshIfPresent (key_type const& key)
+    {
+        auto& s = shard (key);
+        auto const lock = lockPolicy (s);
+        return s.cache.refreshIfPresent (key) ||
+            (s.window && s.window->refreshIfPresent (key));
+    }
+
+    std::vector <key_type> getKeys ()
+    {
+        std::vector <key_type> v;
+        for (auto& shard : m_shards)
+        {
+            auto keys = shard->cache.getKeys ();
+            v.insert (v.end (), keys.begin (), keys.end ());
+            if (shard->window)
+            {
+                keys = shard->window->getKeys ();
+                v.insert (v.end (), keys.begin (), keys.end ());
+            }
+        }
+        return v;
+    }
+
+private:
+    struct Shard
+    {
+        Shard (std::string const& name, int size,
+            typename clock_type::rep expiration_seconds, clock_type& clock,
+                beast::Journal journal)
+            : cache (name, size, expiration_seconds, clock, journal)
+            , hits (0)
+            , misses (0)
+        {
+        }
+
+        // Objects admitted by the policy
+        shard_type cache;
+
+        // New objects, when the policy is tinylfu
+        std::unique_ptr <shard_type> window;
+        FrequencySketch sketch;
+
+        // Guards the sketch, and makes each lookup, admission and
+        // promotion one step, so that callers racing on a key never
+        // settle on different copies in the window and the main cache
+        std::mutex mutex;
+
+        std::atomic <std::uint64_t> hits;
+        std::atomic <std::uint64_t> misses;
+    };
+
+    // The estimated frequency at which an object is admitted
+    static std::uint8_t constexpr admitFrequency = 2;
+
+    static int shardTargetSize (int size, std::size_t shards)
+    {
+        // 0 means no target, so never round a real target down to it
+        if (size <= 0)
+            return size;
+        return static_cast<int> ((size + shards - 1) / shards);
+    }
+
+    static int windowSize (int size)
+    {
+        if (size <= 0)
+            return size;
+        return std::max (size / 100, 1);
+    }
+
+    std::size_t hash (key_type const& key) const
+    {
+        // The shards hash their keys with the same function, so mix
+        // the bits to keep the shard from predicting the bucket.
+        std::uint64_t h = m_hash (key);
+        h ^= h >> 29;
+        h *= 0x9E3779B97F4A7C15ull;
+        return static_cast<std::size_t> (h ^ (h >> 32));
+    }
+
+    Shard& shard (key_type const& key)
+    {
+        return *m_shards[hash (key) % m_shards.size ()];
+    }
+
+    // Lock a shard whose objects may move between its window and its
+    // main cache. Sweeps don't move objects, so they don't take it.
+    static std::unique_lock <std::mutex> lockPolicy (Shard& s)
+    {
+        if (! s.window)
+            return {};
+        return std::unique_lock <std::mutex> (s.mutex);
+    }
+
+    std::shared_ptr<T> lookup (Shard& s, key_type const& key,
+        std::uint8_t frequency)
+    {
+        auto p = s.cache.fetch (key);
+        if (p || ! s.window)
+            return p;
+
+        p = s.window->fetch (key);
+        if (p && frequency >= admitFrequency)
+        {
+            s.cache.canonicalize (key, p);
+            s.window->del (key, false);
+        }
+        return p;
+    }
+
+    void sweep (Shard& s)
+    {
+        s.cache.sweep ();
+        if (s.window)
+            s.window->sweep ();
+    }
+
+    void collect_metrics ()
+    {
+        m_stats.size.set (getCacheSize ());
+        m_stats.hit_rate.set (static_cast<
+            beast::insight::Gauge::value_type> (getHitRate ()));
+    }
+
+private:
+    struct Stats
+    {
+        template <class Handler>
+        Stats (std::string const& prefix, Handler const& handler,
+            beast::insight::Collector::ptr const& collector)
+            : hook (collector->make_hook (handler))
+            , size (collector->make_gauge (prefix, "size"))
+            , hit_rate (collector->make_gauge (prefix, "hit_rate"))
+            { }
+
+        beast::insight::Hook hook;
+        beast::insight::Gauge size;
+        beast::insight::Gauge hit_rate;
+    };
+
+    beast::Journal m_journal;
+    clock_type& m_clock;
+    Stats m_stats;
+    Hash m_hash;
+
+    // Used for logging
+    std::string m_name;
+
+    CachePolicy const m_policy;
+
+    // Desired number of cache entries across all shards (0 = ignore)
+    std::atomic <int> m_target_size;
+
+    // Desired memory used by the cached objects (0 = ignore)
+    std::atomic <std::size_t> m_target_bytes;
+
+    std::vector <std::unique_ptr <Shard>> m_shards;
+};
+
+}
+
+#endif
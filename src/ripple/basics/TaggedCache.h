@@ -25,6 +25,7 @@
 #include <ripple/basics/UnorderedContainers.h>
 #include <ripple/beast/clock/abstract_clock.h>
 #include <ripple/beast/insight/Insight.h>
+#include <algorithm>
 #include <functional>
 #include <mutex>
 #include <vector>
@@ -34,6 +35,16 @@ namespace ripple {
 // VFALCO NOTE Deprecated
 struct TaggedCacheLog;
 
+/** Estimate the memory used by an object held in a cache.
+    Overload this for types whose size varies from object to object.
+*/
+template <class T>
+std::size_t
+cachedSize (T const&)
+{
+    return sizeof (T);
+}
+
 /** Map/cache combination.
     This class implements a cache and a map. The cache keeps objects alive
     in the map. The map allows multiple code paths that reference objects
@@ -82,7 +93,9 @@ public:
         , m_name (name)
         , m_target_size (size)
         , m_target_age (std::chrono::seconds (expiration_seconds))
+        , m_target_bytes (0)
         , m_cache_count (0)
+        , m_bytes (0)
         , m_hits (0)
         , m_misses (0)
     {
@@ -127,12 +140,37 @@ public:
             m_name << " target age set to " << m_target_age.count();
     }
 
+    std::size_t getTargetBytes () const
+    {
+        lock_guard lock (m_mutex);
+        return m_target_bytes;
+    }
+
+    /** Set the approximate memory the cached objects may use.
+        When the cache is over either this or the target size, it
+        expires objects faster, in proportion. 0 means no limit.
+    */
+    void setTargetBytes (std::size_t bytes)
+    {
+        lock_guard lock (m_mutex);
+        m_target_bytes = bytes;
+        JLOG(m_journal.debug()) <<
+            m_name << " target bytes set to " << bytes;
+    }
+
     int getCacheSize () const
     {
         lock_guard lock (m_mutex);
         return m_cache_count;
     }
 
+    /** Return the approximate memory used by the cached objects. */
+    std::size_t getCacheBytes () const
+    {
+        lock_guard lock (m_mutex);
+        return m_bytes;
+    }
+
     int getTrackSize () const
     {
         lock_guard lock (m_mutex);
@@ -158,6 +196,7 @@ public:
         lock_guard lock (m_mutex);
         m_cache.clear ();
         m_cache_count = 0;
+        m_bytes = 0;
     }
 
     void sweep ()
@@ -177,15 +216,28 @@ public:
 
             lock_guard lock (m_mutex);
 
-            if (m_target_size == 0 ||
-                (static_cast<int> (m_cache.size ()) <= m_target_size))
+            bool const overSize = m_target_size != 0 &&
+                (static_cast<int> (m_cache.size ()) > m_target_size);
+            bool const overBytes = m_target_bytes != 0 &&
+                (m_bytes > m_target_bytes);
+
+            if (!overSize && !overBytes)
             {
                 when_expire = now - m_target_age;
             }
             else
             {
-                when_expire = now - clock_type::duration (
-                    m_target_age.count() * m_target_size / m_cache.size ());
+                // Age in proportion to whichever limit is exceeded most
+                double ratio = 1.0;
+                if (overSize)
+                    ratio = std::min (ratio,
+                        static_cast<double> (m_target_size) / m_cache.size ());
+                if (overBytes)
+                    ratio = std::min (ratio,
+                        static_cast<double> (m_target_bytes) / m_bytes);
+
+                when_expire = now - std::chrono::duration_cast<
+                    clock_type::duration> (m_target_age * ratio);
 
                 clock_type::duration const minimumAge (
                     std::chrono::seconds (1));
@@ -194,7 +246,8 @@ public:
 
                 JLOG(m_journal.trace()) <<
                     m_name << " is growing fast " << m_cache.size () << " of " << m_target_size <<
-                        " aging at " << (now - when_expire).count() << " of " << m_target_age.count();
+                        " entries, " << m_bytes << " of " << m_target_bytes <<
+                        " bytes, aging at " << (now - when_expire).count() << " of " << m_target_age.count();
             }
 
             stuffToSweep.reserve (m_cache.size ());
@@ -220,6 +273,7 @@ public:
                 {
                     // strong, expired
                     --m_cache_count;
+                    m_bytes -= cit->second.bytes;
                     ++cacheRemovals;
                     if (cit->second.ptr.unique ())
                     {
@@ -271,6 +325,7 @@ public:
         if (entry.isCached ())
         {
             --m_cache_count;
+            m_bytes -= entry.bytes;
             entry.ptr.reset ();
             ret = true;
         }
@@ -304,10 +359,11 @@ public:
 
         if (cit == m_cache.end ())
         {
-            m_cache.emplace (std::piecewise_construct,
+            auto const result = m_cache.emplace (std::piecewise_construct,
                 std::forward_as_tuple(key),
                 std::forward_as_tuple(m_clock.now(), data));
             ++m_cache_count;
+            m_bytes += result.first->second.bytes;
             return false;
         }
 
@@ -318,8 +374,9 @@ public:
         {
             if (replace)
             {
-                entry.ptr = data;
-                entry.weak_ptr = data;
+                m_bytes -= entry.bytes;
+                entry.set (data);
+                m_bytes += entry.bytes;
             }
             else
             {
@@ -335,8 +392,7 @@ public:
         {
             if (replace)
             {
-                entry.ptr = data;
-                entry.weak_ptr = data;
+                entry.set (data);
             }
             else
             {
@@ -345,12 +401,13 @@ public:
             }
 
             ++m_cache_count;
+            m_bytes += entry.bytes;
             return true;
         }
 
-        entry.ptr = data;
-        entry.weak_ptr = data;
+        entry.set (data);
         ++m_cache_count;
+        m_bytes += entry.bytes;
 
         return false;
     }
@@ -383,6 +440,7 @@ public:
         {
             // independent of cache size, so not counted as a hit
             ++m_cache_count;
+            m_bytes += entry.bytes;
             return entry.ptr;
         }
 
@@ -446,6 +504,7 @@ public:
                 {
                     // We just put the object back in cache
                     ++m_cache_count;
+                    m_bytes += entry.bytes;
                     entry.touch (m_clock.now());
                     found = true;
                 }
@@ -530,12 +589,34 @@ private:
         weak_mapped_ptr weak_ptr;
         clock_type::time_point last_access;
 
+        // Approximate memory used by the entry while the object is cached
+        std::size_t bytes;
+
         Entry (clock_type::time_point const& last_access_,
             mapped_ptr const& ptr_)
             : ptr (ptr_)
             , weak_ptr (ptr_)
             , last_access (last_access_)
+            , bytes (weigh (ptr_))
+        {
+        }
+
+        void set (mapped_ptr const& ptr_)
         {
+            ptr = ptr_;
+            weak_ptr = ptr_;
+            bytes = weigh (ptr_);
+        }
+
+        static std::size_t weigh (mapped_ptr const& ptr_)
+        {
+            // The map node holds the key and the entry, and the
+            // object is allocated together with its control block.
+            std::size_t bytes = sizeof (std::pair <key_type const, Entry>) +
+                2 * sizeof (void*);
+            if (ptr_)
+                bytes += cachedSize (*ptr_) + 2 * sizeof (long);
+            return bytes;
         }
 
         bool isWeak () const { return ptr == nullptr; }
@@ -563,8 +644,14 @@ private:
     // Desired maximum cache age
     clock_type::duration m_target_age;
 
+    // Desired maximum memory used by the cached objects (0 = ignore)
+    std::size_t m_target_bytes;
+
     // Number of items cached
     int m_cache_count;
+
+    // Approximate memory used by the cached objects
+    std::size_t m_bytes;
     cache_type m_cache;  // Hold strong reference to recent objects
     std::uint64_t m_hits;
     std::uint64_t m_misses;
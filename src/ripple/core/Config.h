@@ -169,6 +169,17 @@ public:
     // Thread pool configuration
     std::size_t                 WORKERS = 0;
 
+    // Number of subtrees a SHAMap flush may write concurrently
+    std::size_t                 FLUSH_FANOUT = 1;
+
+    // Memory the caches may use, in bytes (0 = no limit)
+    std::uint64_t               MEMORY_LIMIT = 0;
+
+    // Relative shares of MEMORY_LIMIT given to each cache
+    std::uint32_t               NODE_CACHE_WEIGHT = 3;
+    std::uint32_t               TREE_CACHE_WEIGHT = 6;
+    std::uint32_t               FULL_BELOW_WEIGHT = 1;
+
     // These override the command line client settings
     boost::optional<boost::asio::ip::address_v4> rpc_ip;
     boost::optional<std::uint16_t> rpc_port;
@@ -29,6 +29,8 @@ struct ConfigSection
 {
     static std::string nodeDatabase ()       { return "node_db"; }
     static std::string importNodeDatabase () { return "import_db"; }
+    static std::string shardDatabase ()      { return "shard_db"; }
+    static std::string historyDatabase ()    { return "history_db"; }
 };
 
 // VFALCO TODO Rename and replace these macros with variables.
@@ -41,7 +43,9 @@ struct ConfigSection
 #define SECTION_FEE_ACCOUNT_RESERVE     "fee_account_reserve"
 #define SECTION_FEE_OWNER_RESERVE       "fee_owner_reserve"
 #define SECTION_FETCH_DEPTH             "fetch_depth"
+#define SECTION_FLUSH_FANOUT            "flush_fanout"
 #define SECTION_LEDGER_HISTORY          "ledger_history"
+#define SECTION_MEMORY                  "memory"
 #define SECTION_INSIGHT                 "insight"
 #define SECTION_IPS                     "ips"
 #define SECTION_IPS_FIXED               "ips_fixed"
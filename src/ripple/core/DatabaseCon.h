@@ -82,6 +82,12 @@ public:
         Config::StartUpType startUp = Config::NORMAL;
         bool standAlone = false;
         boost::filesystem::path dataDir;
+
+        /** Returns `true` if databases are opened in temporary files
+            instead of in `dataDir`.
+        */
+        bool
+        useTempFiles() const;
     };
 
     DatabaseCon (Setup const& setup,
@@ -39,6 +39,7 @@ enum JobType
     // earlier jobs having lower priority than later jobs. If you wish to
     // insert a job at a specific priority, simply add it at the right location.
 
+    jtSHARD,         // Store a validated ledger in the shard store
     jtPACK,          // Make a fetch pack for a peer
     jtPUBOLDLEDGER,  // An old ledger has been accepted
     jtVALIDATION_ut, // A validation from an untrusted source
@@ -58,6 +59,7 @@ enum JobType
     jtVALIDATION_t,  // A validation from a trusted source
     jtWRITE,         // Write out hashed objects
     jtACCEPT,        // Accept a consensus ledger
+    jtFLUSH,         // Flush a dirty SHAMap subtree
     jtPROPOSAL_t,    // A proposal from a trusted source
     jtSWEEP,         // Sweep for stale structures
     jtNETOP_CLUSTER, // NetworkOPs cluster peer report
@@ -117,6 +119,9 @@ public:
 
     JobType getType () const;
 
+    /** Returns the name of the job, as last set by rename. */
+    std::string const& getName () const;
+
     CancelCallback getCancelCallback () const;
 
     /** Returns the time when the job was queued. */
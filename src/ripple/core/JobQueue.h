@@ -25,12 +25,15 @@
 #include <ripple/core/JobTypes.h>
 #include <ripple/core/JobTypeData.h>
 #include <ripple/core/Stoppable.h>
+#include <ripple/core/impl/StealingJobSet.h>
 #include <ripple/core/impl/Workers.h>
 #include <ripple/json/json_value.h>
 #include <boost/coroutine/all.hpp>
+#include <deque>
 
 namespace ripple {
 
+class Config;
 class Logs;
 struct Coro_create_t {};
 
@@ -128,8 +131,29 @@ public:
 
     using JobFunction = std::function <void(Job&)>;
 
+    struct Setup
+    {
+        // Keep waiting jobs in per-thread shards which idle
+        // workers steal from, instead of a single locked set.
+        bool workStealing = false;
+
+        // Shards for each job type. Zero for one per processor.
+        std::size_t shards = 0;
+
+        // Jobs running at least this long are kept for
+        // getLatencyJson. Zero to keep none.
+        std::chrono::milliseconds slowJobThreshold {0};
+
+        // The most slow jobs kept
+        std::size_t slowJobs = 128;
+    };
+
     JobQueue (beast::insight::Collector::ptr const& collector,
         Stoppable& parent, beast::Journal journal, Logs& logs);
+
+    JobQueue (beast::insight::Collector::ptr const& collector,
+        Stoppable& parent, beast::Journal journal, Logs& logs,
+        Setup const& setup);
     ~JobQueue ();
 
     /** Adds a job to the JobQueue.
@@ -198,6 +222,18 @@ public:
     // Cannot be const because LoadMonitor has no const methods.
     Json::Value getJson (int c = 0);
 
+    /** Returns the percentiles of the time each type of job waited
+        and ran, and the most recent slow jobs.
+    */
+    Json::Value getLatencyJson ();
+
+    /** Set the ledger sequence recorded with slow jobs. */
+    void
+    setLedgerSeq (std::uint32_t seq)
+    {
+        m_ledgerSeq = seq;
+    }
+
     /** Block until no tasks running. */
     void
     rendezvous();
@@ -209,13 +245,16 @@ private:
 
     beast::Journal m_journal;
     mutable std::mutex m_mutex;
-    std::uint64_t m_lastJob;
+    std::atomic <std::uint64_t> m_lastJob;
     std::set <Job> m_jobSet;
+
+    // When set, waiting jobs are kept here instead of m_jobSet
+    std::unique_ptr <StealingJobSet> m_stealing;
     JobDataMap m_jobData;
     JobTypeData m_invalidJobData;
 
     // The number of jobs currently in processTask()
-    int m_processCount;
+    std::atomic <int> m_processCount;
 
     // The number of suspended coroutines
     int nSuspend_ = 0;
@@ -230,6 +269,22 @@ private:
 
     std::condition_variable cv_;
 
+    // A job which ran for longer than the slow job threshold
+    struct SlowJob
+    {
+        JobType type;
+        std::string name;
+        std::uint32_t ledgerSeq;
+        std::chrono::microseconds queued;
+        std::chrono::microseconds executed;
+    };
+
+    std::chrono::milliseconds const m_slowJobThreshold;
+    std::size_t const m_slowJobCapacity;
+    std::atomic <std::uint32_t> m_ledgerSeq {0};
+    std::mutex m_slowJobMutex;
+    std::deque <SlowJob> m_slowJobs;
+
     static JobTypes const& getJobTypes()
     {
         static JobTypes types;
@@ -239,8 +294,16 @@ private:
     void collect();
     JobTypeData& getJobTypeData (JobType type);
 
+    // Records a job which ran for longer than the slow job threshold
+    void addSlowJob (Job const& job, Job::clock_type::duration queued,
+        Job::clock_type::duration executed);
+
     void onStop() override;
 
+    // Returns `true` if no jobs are waiting.
+    // Without work stealing, the caller must hold m_mutex.
+    bool jobsEmpty () const;
+
     // Signals the service stopped if the stopped condition is met.
     void checkStopped (std::lock_guard <std::mutex> const& lock);
 
@@ -388,6 +451,10 @@ private:
             lock is released which only happens after the coroutine completes.
 */
 
+/** Returns the settings from the [job_queue] section. */
+JobQueue::Setup
+setup_JobQueue (Config const& config);
+
 } // ripple
 
 #include <ripple/core/Coro.ipp>
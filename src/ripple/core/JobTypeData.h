@@ -20,6 +20,7 @@
 #ifndef RIPPLE_CORE_JOBTYPEDATA_H_INCLUDED
 #define RIPPLE_CORE_JOBTYPEDATA_H_INCLUDED
 
+#include <ripple/basics/LatencyHistogram.h>
 #include <ripple/basics/Log.h>
 #include <ripple/core/JobTypeInfo.h>
 #include <ripple/beast/insight/Collector.h>
@@ -52,6 +53,40 @@ public:
     beast::insight::Event dequeue;
     beast::insight::Event execute;
 
+    /* Distributions of the time spent waiting and running */
+    LatencyHistogram dequeueTimes;
+    LatencyHistogram executeTimes;
+
+    /* Percentiles of the distributions, in microseconds, for insight */
+    struct Percentiles
+    {
+        beast::insight::Gauge p50;
+        beast::insight::Gauge p90;
+        beast::insight::Gauge p99;
+        beast::insight::Gauge p999;
+
+        void
+        make (beast::insight::Collector& collector, std::string const& prefix)
+        {
+            p50 = collector.make_gauge (prefix + "_p50");
+            p90 = collector.make_gauge (prefix + "_p90");
+            p99 = collector.make_gauge (prefix + "_p99");
+            p999 = collector.make_gauge (prefix + "_p999");
+        }
+
+        void
+        set (LatencyHistogram const& histogram)
+        {
+            auto const s = histogram.snapshot ();
+            p50 = s.percentile (0.5).count ();
+            p90 = s.percentile (0.9).count ();
+            p99 = s.percentile (0.99).count ();
+            p999 = s.percentile (0.999).count ();
+        }
+    };
+    Percentiles dequeuePercentiles;
+    Percentiles executePercentiles;
+
     JobTypeData (JobTypeInfo const& info_,
             beast::insight::Collector::ptr const& collector, Logs& logs) noexcept
         : m_load (logs.journal ("LoadMonitor"))
@@ -69,6 +104,8 @@ public:
         {
             dequeue = m_collector->make_event (info.name () + "_q");
             execute = m_collector->make_event (info.name ());
+            dequeuePercentiles.make (*m_collector, info.name () + "_q");
+            executePercentiles.make (*m_collector, info.name ());
         }
     }
 
@@ -38,6 +38,7 @@ public:
     {
         int maxLimit = std::numeric_limits <int>::max ();
 
+add(    jtSHARD,         "storeShard",              1,        false, 0,     0);
 add(    jtPACK,          "makeFetchPack",           1,        false, 0,     0);
 add(    jtPUBOLDLEDGER,  "publishAcqLedger",        2,        false, 10000, 15000);
 add(    jtVALIDATION_ut, "untrustedValidation",     maxLimit, false, 2000,  5000);
@@ -57,6 +58,7 @@ add(    jtWAL,           "writeAhead",              maxLimit, false, 1000,  2500
 add(    jtVALIDATION_t,  "trustedValidation",       maxLimit, false, 500,  1500);
 add(    jtWRITE,         "writeObjects",            maxLimit, false, 1750,  2500);
 add(    jtACCEPT,        "acceptLedger",            maxLimit, false, 0,     0);
+add(    jtFLUSH,         "flushSubtree",            maxLimit, false, 0,     0);
 add(    jtPROPOSAL_t,    "trustedProposal",         maxLimit, false, 100,   500);
 add(    jtSWEEP,         "sweep",                   maxLimit, false, 0,     0);
 add(    jtNETOP_CLUSTER, "clusterReport",           1,        false, 9999,  9999);
@@ -34,6 +34,7 @@
 #include <soci/soci.h>
 #include <string>
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 namespace sqlite_api {
@@ -117,6 +118,22 @@ void convert (soci::blob& from, std::string& to);
 void convert (std::vector<std::uint8_t> const& from, soci::blob& to);
 void convert (std::string const& from, soci::blob& to);
 
+/** Bind values to a statement and prepare it for repeated execution.
+
+    The bound values must outlive the statement. Each call to
+    `st.execute(true)` uses their current contents.
+*/
+template <class... Uses>
+void
+prepare (soci::statement& st, std::string const& sql, Uses&&... uses)
+{
+    using expand = int[];
+    (void) expand { 0, (st.exchange (std::forward<Uses>(uses)), 0)... };
+    st.alloc ();
+    st.prepare (sql);
+    st.define_and_bind ();
+}
+
 class Checkpointer
 {
   public:
@@ -416,6 +416,38 @@ void Config::loadFromString (std::string const& fileContents)
     if (getSingleSection (secConfig, SECTION_WORKERS, strTemp, j_))
         WORKERS      = beast::lexicalCastThrow <std::size_t> (strTemp);
 
+    if (getSingleSection (secConfig, SECTION_FLUSH_FANOUT, strTemp, j_))
+    {
+        FLUSH_FANOUT = beast::lexicalCastThrow <std::size_t> (strTemp);
+
+        if (FLUSH_FANOUT < 1)
+            FLUSH_FANOUT = 1;
+        else if (FLUSH_FANOUT > 16)
+            FLUSH_FANOUT = 16;
+    }
+
+    {
+        auto const& memory = section (SECTION_MEMORY);
+
+        double limit = 0;
+        if (set (limit, "limit_gb", memory))
+        {
+            if (limit <= 0)
+                Throw<std::runtime_error> (
+                    "Invalid " SECTION_MEMORY " limit_gb");
+            MEMORY_LIMIT = static_cast<std::uint64_t> (
+                limit * 1024 * 1024 * 1024);
+        }
+
+        set (NODE_CACHE_WEIGHT, "node_cache", memory);
+        set (TREE_CACHE_WEIGHT, "tree_cache", memory);
+        set (FULL_BELOW_WEIGHT, "full_below", memory);
+
+        if (NODE_CACHE_WEIGHT + TREE_CACHE_WEIGHT + FULL_BELOW_WEIGHT == 0)
+            Throw<std::runtime_error> (
+                "Invalid " SECTION_MEMORY " weights");
+    }
+
     // Do not load trusted validator configuration for standalone mode
     if (! RUN_STANDALONE)
     {
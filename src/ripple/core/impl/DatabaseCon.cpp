@@ -32,12 +32,7 @@ DatabaseCon::DatabaseCon (
     const char* initStrings[],
     int initCount)
 {
-    auto const useTempFiles  // Use temporary files or regular DB files?
-        = setup.standAlone &&
-          setup.startUp != Config::LOAD &&
-          setup.startUp != Config::LOAD_FILE &&
-          setup.startUp != Config::REPLAY;
-    boost::filesystem::path pPath = useTempFiles
+    boost::filesystem::path pPath = setup.useTempFiles()
         ? "" : (setup.dataDir / strName);
 
     open (session_, "sqlite", pPath.string());
@@ -57,6 +52,15 @@ DatabaseCon::DatabaseCon (
     }
 }
 
+bool
+DatabaseCon::Setup::useTempFiles() const
+{
+    return standAlone &&
+        startUp != Config::LOAD &&
+        startUp != Config::LOAD_FILE &&
+        startUp != Config::REPLAY;
+}
+
 DatabaseCon::Setup setup_DatabaseCon (Config const& c)
 {
     DatabaseCon::Setup setup;
@@ -57,6 +57,11 @@ JobType Job::getType () const
     return mType;
 }
 
+std::string const& Job::getName () const
+{
+    return mName;
+}
+
 Job::CancelCallback Job::getCancelCallback () const
 {
     assert (m_cancelCallback);
@@ -20,11 +20,20 @@
 #include <BeastConfig.h>
 #include <ripple/core/JobQueue.h>
 #include <ripple/basics/contract.h>
+#include <ripple/core/Config.h>
+#include <thread>
 
 namespace ripple {
 
 JobQueue::JobQueue (beast::insight::Collector::ptr const& collector,
     Stoppable& parent, beast::Journal journal, Logs& logs)
+    : JobQueue (collector, parent, journal, logs, Setup{})
+{
+}
+
+JobQueue::JobQueue (beast::insight::Collector::ptr const& collector,
+    Stoppable& parent, beast::Journal journal, Logs& logs,
+    Setup const& setup)
     : Stoppable ("JobQueue", parent)
     , m_journal (journal)
     , m_lastJob (0)
@@ -33,10 +42,21 @@ JobQueue::JobQueue (beast::insight::Collector::ptr const& collector,
     , m_workers (*this, "JobQueue", 0)
     , m_cancelCallback (std::bind (&Stoppable::isStopping, this))
     , m_collector (collector)
+    , m_slowJobThreshold (setup.slowJobThreshold)
+    , m_slowJobCapacity (setup.slowJobs)
 {
     hook = m_collector->make_hook (std::bind (&JobQueue::collect, this));
     job_count = m_collector->make_gauge ("job_count");
 
+    if (setup.workStealing)
+    {
+        auto shards = setup.shards;
+        if (shards == 0)
+            shards = std::thread::hardware_concurrency ();
+        m_stealing = std::make_unique<StealingJobSet> (
+            getJobTypes (), shards);
+    }
+
     {
         std::lock_guard <std::mutex> lock (m_mutex);
 
@@ -63,6 +83,21 @@ JobQueue::~JobQueue ()
 void
 JobQueue::collect ()
 {
+    for (auto& x : m_jobData)
+    {
+        JobTypeData& data (x.second);
+        if (data.info.special ())
+            continue;
+        data.dequeuePercentiles.set (data.dequeueTimes);
+        data.executePercentiles.set (data.executeTimes);
+    }
+
+    if (m_stealing)
+    {
+        job_count = m_stealing->size ();
+        return;
+    }
+
     std::lock_guard <std::mutex> lock (m_mutex);
     job_count = m_jobSet.size ();
 }
@@ -84,6 +119,20 @@ JobQueue::addRefCountedJob (JobType type, std::string const& name,
     // do not add jobs to a queue with no threads
     assert (type == jtCLIENT || m_workers.getNumberOfThreads () > 0);
 
+    if (m_stealing)
+    {
+        // See the comment below
+        assert (! isStopped() && (
+            m_processCount>0 ||
+            ! m_stealing->empty () ||
+            ! areChildrenStopped()));
+
+        if (m_stealing->add (Job (type, name, ++m_lastJob,
+                data.load (), func, m_cancelCallback)))
+            m_workers.addTask ();
+        return true;
+    }
+
     {
         std::lock_guard <std::mutex> lock (m_mutex);
 
@@ -114,6 +163,9 @@ JobQueue::addRefCountedJob (JobType type, std::string const& name,
 int
 JobQueue::getJobCount (JobType t) const
 {
+    if (m_stealing)
+        return m_stealing->waiting (t);
+
     std::lock_guard <std::mutex> lock (m_mutex);
 
     JobDataMap::const_iterator c = m_jobData.find (t);
@@ -126,6 +178,9 @@ JobQueue::getJobCount (JobType t) const
 int
 JobQueue::getJobCountTotal (JobType t) const
 {
+    if (m_stealing)
+        return m_stealing->waiting (t) + m_stealing->running (t);
+
     std::lock_guard <std::mutex> lock (m_mutex);
 
     JobDataMap::const_iterator c = m_jobData.find (t);
@@ -141,6 +196,16 @@ JobQueue::getJobCountGE (JobType t) const
     // return the number of jobs at this priority level or greater
     int ret = 0;
 
+    if (m_stealing)
+    {
+        for (auto const& x : m_jobData)
+        {
+            if (x.first >= t)
+                ret += m_stealing->waiting (x.first);
+        }
+        return ret;
+    }
+
     std::lock_guard <std::mutex> lock (m_mutex);
 
     for (auto const& x : m_jobData)
@@ -224,6 +289,8 @@ JobQueue::getJson (int c)
     Json::Value ret (Json::objectValue);
 
     ret["threads"] = m_workers.getNumberOfThreads ();
+    if (m_stealing)
+        ret["scheduler"] = "work_stealing";
 
     Json::Value priorities = Json::arrayValue;
 
@@ -242,6 +309,11 @@ JobQueue::getJson (int c)
 
         int waiting (data.waiting);
         int running (data.running);
+        if (m_stealing)
+        {
+            waiting = m_stealing->waiting (x.first);
+            running = m_stealing->running (x.first);
+        }
 
         if ((stats.count != 0) || (waiting != 0) ||
             (stats.latencyPeak != 0) || (running != 0))
@@ -275,14 +347,98 @@ JobQueue::getJson (int c)
     return ret;
 }
 
+static
+Json::Value
+latencyJson (LatencyHistogram const& histogram)
+{
+    auto const s = histogram.snapshot ();
+
+    Json::Value ret (Json::objectValue);
+    ret["count"] = static_cast<Json::UInt> (s.count);
+    ret["p50"] = static_cast<Json::UInt> (s.percentile (0.5).count ());
+    ret["p90"] = static_cast<Json::UInt> (s.percentile (0.9).count ());
+    ret["p99"] = static_cast<Json::UInt> (s.percentile (0.99).count ());
+    ret["p999"] = static_cast<Json::UInt> (s.percentile (0.999).count ());
+    ret["max"] = static_cast<Json::UInt> (s.max.count ());
+    return ret;
+}
+
+Json::Value
+JobQueue::getLatencyJson ()
+{
+    Json::Value ret (Json::objectValue);
+
+    Json::Value types = Json::arrayValue;
+    for (auto& x : m_jobData)
+    {
+        JobTypeData& data (x.second);
+        if (data.info.special ())
+            continue;
+
+        auto dequeued = latencyJson (data.dequeueTimes);
+        auto executed = latencyJson (data.executeTimes);
+        if (dequeued["count"].asUInt () == 0 &&
+                executed["count"].asUInt () == 0)
+            continue;
+
+        Json::Value& entry = types.append (Json::objectValue);
+        entry["job_type"] = data.name ();
+        entry["queue_us"] = std::move (dequeued);
+        entry["execute_us"] = std::move (executed);
+    }
+    ret["job_types"] = types;
+
+    if (m_slowJobThreshold > std::chrono::milliseconds::zero ())
+    {
+        ret["slow_job_ms"] = static_cast<Json::UInt> (
+            m_slowJobThreshold.count ());
+
+        Json::Value slow = Json::arrayValue;
+        std::lock_guard <std::mutex> lock (m_slowJobMutex);
+        for (auto const& job : m_slowJobs)
+        {
+            Json::Value& entry = slow.append (Json::objectValue);
+            entry["job_type"] = getJobTypes ().get (job.type).name ();
+            entry["name"] = job.name;
+            entry["ledger_seq"] = job.ledgerSeq;
+            entry["queue_us"] = static_cast<Json::UInt> (
+                job.queued.count ());
+            entry["execute_us"] = static_cast<Json::UInt> (
+                job.executed.count ());
+        }
+        ret["slow_jobs"] = slow;
+    }
+
+    return ret;
+}
+
+void
+JobQueue::addSlowJob (Job const& job, Job::clock_type::duration queued,
+    Job::clock_type::duration executed)
+{
+    using namespace std::chrono;
+
+    JLOG (m_journal.debug()) << "Slow job " << job.getName () << ": " <<
+        duration_cast<milliseconds> (executed).count () << "ms";
+
+    std::lock_guard <std::mutex> lock (m_slowJobMutex);
+    if (m_slowJobCapacity == 0)
+        return;
+    if (m_slowJobs.size () >= m_slowJobCapacity)
+        m_slowJobs.pop_front ();
+    m_slowJobs.push_back ({ job.getType (), job.getName (), m_ledgerSeq,
+        duration_cast<microseconds> (queued),
+        duration_cast<microseconds> (executed) });
+}
+
 void
 JobQueue::rendezvous()
 {
     std::unique_lock<std::mutex> lock(m_mutex);
     cv_.wait(lock, [&]
     {
-        return m_processCount == 0 &&
-            m_jobSet.empty();
+        return jobsEmpty() &&
+            m_processCount == 0;
     });
 }
 
@@ -307,6 +463,14 @@ JobQueue::onStop()
     // otherwise the base class will do the wrong thing.
 }
 
+bool
+JobQueue::jobsEmpty () const
+{
+    if (m_stealing)
+        return m_stealing->empty ();
+    return m_jobSet.empty ();
+}
+
 void
 JobQueue::checkStopped (std::lock_guard <std::mutex> const& lock)
 {
@@ -314,14 +478,18 @@ JobQueue::checkStopped (std::lock_guard <std::mutex> const& lock)
     //
     //  1. A stop notification was received
     //  2. All Stoppable children have stopped
-    //  3. There are no executing calls to processTask
-    //  4. There are no remaining Jobs in the job set
+    //  3. There are no remaining Jobs in the job set
+    //  4. There are no executing calls to processTask
     //  5. There are no suspended coroutines
     //
+    // With work stealing, jobs are taken without the lock. A job
+    // is counted in m_processCount before it leaves the job set,
+    // so the set must be checked first.
+    //
     if (isStopping() &&
         areChildrenStopped() &&
+        jobsEmpty() &&
         (m_processCount == 0) &&
-        m_jobSet.empty() &&
         nSuspend_ == 0)
     {
         stopped();
@@ -410,8 +578,10 @@ void JobQueue::on_dequeue (JobType type,
     using namespace std::chrono;
     auto const ms (ceil <std::chrono::milliseconds> (value));
 
+    JobTypeData& data (getJobTypeData (type));
+    data.dequeueTimes.insert (value);
     if (ms.count() >= 10)
-        getJobTypeData (type).dequeue.notify (ms);
+        data.dequeue.notify (ms);
 }
 
 template <class Rep, class Period>
@@ -421,8 +591,10 @@ void JobQueue::on_execute (JobType type,
     using namespace std::chrono;
     auto const ms (ceil <std::chrono::milliseconds> (value));
 
+    JobTypeData& data (getJobTypeData (type));
+    data.executeTimes.insert (value);
     if (ms.count() >= 10)
-        getJobTypeData (type).execute.notify (ms);
+        data.execute.notify (ms);
 }
 
 void
@@ -435,6 +607,12 @@ JobQueue::processTask ()
             Job::clock_type::now());
         {
             Job job;
+            if (m_stealing)
+            {
+                ++m_processCount;
+                m_stealing->next (job);
+            }
+            else
             {
                 std::lock_guard <std::mutex> lock (m_mutex);
                 getNextJob (job);
@@ -443,12 +621,37 @@ JobQueue::processTask ()
             type = job.getType();
             JobTypeData& data(getJobTypeData(type));
             JLOG(m_journal.trace()) << "Doing " << data.name () << " job";
-            on_dequeue (job.getType (), start_time - job.queue_time ());
+            auto const queued = start_time - job.queue_time ();
+            on_dequeue (job.getType (), queued);
             job.doJob ();
+
+            if (m_slowJobThreshold > std::chrono::milliseconds::zero ())
+            {
+                auto const elapsed = Job::clock_type::now() - start_time;
+                if (elapsed >= m_slowJobThreshold)
+                    addSlowJob (job, queued, elapsed);
+            }
         }
         on_execute(type, Job::clock_type::now() - start_time);
     }
 
+    if (m_stealing)
+    {
+        if (m_stealing->finish (type))
+            m_workers.addTask ();
+
+        // Only the last job running needs the lock, to
+        // wake rendezvous and to check for stopping.
+        if (--m_processCount == 0)
+        {
+            std::lock_guard <std::mutex> lock (m_mutex);
+            if (jobsEmpty() && m_processCount == 0)
+                cv_.notify_all();
+            checkStopped (lock);
+        }
+        return;
+    }
+
     {
         std::lock_guard <std::mutex> lock (m_mutex);
         // Job should be destroyed before calling checkStopped
@@ -480,4 +683,21 @@ JobQueue::onChildrenStopped ()
     checkStopped (lock);
 }
 
+//------------------------------------------------------------------------------
+
+JobQueue::Setup
+setup_JobQueue (Config const& config)
+{
+    JobQueue::Setup setup;
+    auto const& section = config.section ("job_queue");
+    set (setup.workStealing, "work_stealing", section);
+    set (setup.shards, "shards", section);
+
+    std::uint64_t ms = 0;
+    if (set (ms, "slow_job_ms", section))
+        setup.slowJobThreshold = std::chrono::milliseconds (ms);
+    set (setup.slowJobs, "slow_jobs", section);
+    return setup;
+}
+
 }
@@ -0,0 +1,210 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/core/impl/StealingJobSet.h>
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+namespace ripple {
+
+StealingJobSet::StealingJobSet (JobTypes const& types, std::size_t shards)
+{
+    shards = std::max<std::size_t> (shards, 1);
+
+    for (auto const& x : types)
+    {
+        JobTypeInfo const& jt = x.second;
+        assert (jt.type () >= 0);
+
+        auto const index = static_cast<std::size_t> (jt.type ());
+        if (queues_.size () <= index)
+            queues_.resize (index + 1);
+
+        auto q = std::make_unique<Queue> ();
+        q->limit = std::min<int> (jt.limit (), mask);
+
+        // A type which runs one job at a time keeps its jobs in order
+        auto const n = (q->limit == 1) ? 1 : shards;
+        q->shards.reserve (n);
+        for (std::size_t i = 0; i < n; ++i)
+            q->shards.push_back (std::make_unique<Shard> ());
+
+        queues_[index] = std::move (q);
+    }
+}
+
+StealingJobSet::Queue*
+StealingJobSet::queue (JobType type) const
+{
+    assert (type != jtINVALID);
+    auto const index = static_cast<std::size_t> (type);
+    if (index >= queues_.size ())
+        return nullptr;
+    return queues_[index].get ();
+}
+
+std::size_t
+StealingJobSet::home ()
+{
+    static std::atomic<std::size_t> next {0};
+    static thread_local std::size_t const index = next++;
+    return index;
+}
+
+bool
+StealingJobSet::add (Job&& job)
+{
+    auto q = queue (job.getType ());
+    assert (q);
+
+    {
+        auto& shard = *q->shards[home () % q->shards.size ()];
+        std::lock_guard<std::mutex> lock (shard.mutex);
+        shard.jobs.push_back (std::move (job));
+    }
+
+    // The job is counted only once it can be found, so a
+    // thread which reserves it will find it in a shard.
+    auto state = q->state.load ();
+    for (;;)
+    {
+        bool const start = ready (state) + deferred (state) +
+            running (state) < q->limit;
+        auto const next = state + (start ? oneReady : oneDeferred);
+        if (q->state.compare_exchange_weak (state, next))
+            return start;
+    }
+}
+
+void
+StealingJobSet::next (Job& job)
+{
+    for (;;)
+    {
+        for (auto iter = queues_.rbegin (); iter != queues_.rend (); ++iter)
+        {
+            auto q = iter->get ();
+            if (! q)
+                continue;
+
+            // Reserve one of the ready jobs, if there are any
+            auto state = q->state.load ();
+            while (ready (state) > 0)
+            {
+                if (q->state.compare_exchange_weak (
+                        state, state - oneReady + oneRunning))
+                {
+                    pop (*q, job);
+                    return;
+                }
+            }
+        }
+
+        // Every task is matched by a ready job, so one we
+        // passed over was taken by another thread and a
+        // job added since is waiting for us.
+        std::this_thread::yield ();
+    }
+}
+
+void
+StealingJobSet::pop (Queue& q, Job& job)
+{
+    auto const n = q.shards.size ();
+    auto const first = home () % n;
+    for (;;)
+    {
+        // Our own shard first, then steal from the others
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            auto& shard = *q.shards[(first + i) % n];
+            std::lock_guard<std::mutex> lock (shard.mutex);
+            if (! shard.jobs.empty ())
+            {
+                job = std::move (shard.jobs.front ());
+                shard.jobs.pop_front ();
+                return;
+            }
+        }
+
+        // Jobs were added and taken while we looked, but
+        // there is still one here for our reservation.
+        std::this_thread::yield ();
+    }
+}
+
+bool
+StealingJobSet::finish (JobType type)
+{
+    auto q = queue (type);
+    assert (q);
+
+    auto state = q->state.load ();
+    for (;;)
+    {
+        assert (running (state) > 0);
+        auto next = state - oneRunning;
+
+        // Start a deferred job in our place
+        bool const start = deferred (state) > 0;
+        if (start)
+            next = next - oneDeferred + oneReady;
+
+        if (q->state.compare_exchange_weak (state, next))
+            return start;
+    }
+}
+
+int
+StealingJobSet::waiting (JobType type) const
+{
+    auto q = queue (type);
+    if (! q)
+        return 0;
+    auto const state = q->state.load ();
+    return ready (state) + deferred (state);
+}
+
+int
+StealingJobSet::running (JobType type) const
+{
+    auto q = queue (type);
+    if (! q)
+        return 0;
+    return running (q->state.load ());
+}
+
+std::size_t
+StealingJobSet::size () const
+{
+    std::size_t n = 0;
+    for (auto const& q : queues_)
+    {
+        if (q)
+        {
+            auto const state = q->state.load ();
+            n += ready (state) + deferred (state);
+        }
+    }
+    return n;
+}
+
+} // ripple
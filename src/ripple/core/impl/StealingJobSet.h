@@ -0,0 +1,162 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_CORE_STEALINGJOBSET_H_INCLUDED
+#define RIPPLE_CORE_STEALINGJOBSET_H_INCLUDED
+
+#include <ripple/core/Job.h>
+#include <ripple/core/JobTypes.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ripple {
+
+/** The waiting jobs of a JobQueue, without a single lock.
+
+    Each JobType has its own queue, split into shards. Every thread has a
+    home shard: jobs added from a thread go to its home shard, and a
+    worker takes jobs from its home shard first, stealing from the other
+    shards when its own is empty. Jobs of types limited to one running job
+    use a single shard, so they still run in the order they were added.
+
+    The waiting, running and deferred counts of each type are packed in
+    one atomic word, so the job limits are enforced without a lock. The
+    highest priority type with a job ready to run is always taken first,
+    but jobs of the same type may run out of order.
+
+    Each job added either starts a task, or is deferred until a running
+    job of the same type finishes, exactly as in JobQueue::queueJob.
+*/
+class StealingJobSet
+{
+public:
+    StealingJobSet (JobTypes const& types, std::size_t shards);
+
+    StealingJobSet (StealingJobSet const&) = delete;
+    StealingJobSet& operator= (StealingJobSet const&) = delete;
+
+    /** Add a job.
+        @return `true` if a task should be signaled for the job, or
+                `false` if it is deferred by the limit for its type.
+    */
+    bool
+    add (Job&& job);
+
+    /** Take the highest priority job which may run.
+        @note Each call must be matched by a signaled task.
+    */
+    void
+    next (Job& job);
+
+    /** Indicate that a job taken by @ref next has finished.
+        @return `true` if a deferred job is now ready, and a task
+                should be signaled for it.
+    */
+    bool
+    finish (JobType type);
+
+    /** Jobs of this type waiting. */
+    int
+    waiting (JobType type) const;
+
+    /** Jobs of this type running. */
+    int
+    running (JobType type) const;
+
+    /** Jobs of every type waiting. */
+    std::size_t
+    size () const;
+
+    /** Returns `true` if no jobs are waiting. */
+    bool
+    empty () const
+    {
+        return size () == 0;
+    }
+
+private:
+    struct Shard
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    struct Queue
+    {
+        int limit = 0;
+
+        // ready | deferred << bits | running << (2 * bits)
+        std::atomic<std::uint64_t> state {0};
+
+        std::vector<std::unique_ptr<Shard>> shards;
+    };
+
+    static int constexpr bits = 21;
+    static std::uint64_t constexpr mask = (std::uint64_t{1} << bits) - 1;
+    static std::uint64_t constexpr oneReady = 1;
+    static std::uint64_t constexpr oneDeferred = oneReady << bits;
+    static std::uint64_t constexpr oneRunning = oneDeferred << bits;
+
+    static
+    int
+    ready (std::uint64_t state)
+    {
+        return static_cast<int>(state & mask);
+    }
+
+    static
+    int
+    deferred (std::uint64_t state)
+    {
+        return static_cast<int>((state >> bits) & mask);
+    }
+
+    static
+    int
+    running (std::uint64_t state)
+    {
+        return static_cast<int>(state >> (2 * bits));
+    }
+
+    Queue*
+    queue (JobType type) const;
+
+    // Returns the index of the calling thread's home shard
+    static
+    std::size_t
+    home ();
+
+    // Removes a job from the shards of a queue
+    // which has a job reserved by the caller
+    static
+    void
+    pop (Queue& q, Job& job);
+
+    // Queues in order of increasing priority
+    std::vector<std::unique_ptr<Queue>> queues_;
+};
+
+} // ripple
+
+#endif
@@ -1018,6 +1018,7 @@ public:
             {   "fetch_info",           &RPCParser::parseFetchInfo,             0,  1   },
             {   "gateway_balances",     &RPCParser::parseGatewayBalances  ,     1,  -1  },
             {   "get_counts",           &RPCParser::parseGetCounts,             0,  1   },
+            {   "job_latency",          &RPCParser::parseAsIs,                  0,  0   },
             {   "json",                 &RPCParser::parseJson,                  2,  2   },
             {   "json2",                &RPCParser::parseJson2,                 1,  1   },
             {   "ledger",               &RPCParser::parseLedger,                0,  2   },
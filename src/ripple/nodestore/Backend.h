@@ -70,7 +70,13 @@ public:
     bool
     canFetchBatch() = 0;
 
-    /** Fetch a batch synchronously. */
+    /** Fetch a batch synchronously.
+        The result holds the object for each key, in the same order,
+        or nullptr if the object was not found or could not be decoded.
+        @note This will be called concurrently.
+        @param n The number of keys.
+        @param keys Pointers to the key data.
+    */
     virtual
     std::vector<std::shared_ptr<NodeObject>>
     fetchBatch (std::size_t n, void const* const* keys) = 0;
@@ -100,12 +106,46 @@ public:
     /** Estimate the number of write operations pending. */
     virtual int getWriteLoad () = 0;
 
+    /** Returns `true` if objects are stored faster than they are written.
+        Backends which write synchronously are never backlogged.
+    */
+    virtual
+    bool
+    isBacklogged ()
+    {
+        return false;
+    }
+
     /** Remove contents on disk upon destruction. */
     virtual void setDeletePath() = 0;
 
     /** Perform consistency checks on database .*/
     virtual void verify() = 0;
 
+    /** Start a bulk build of an empty database.
+        Until @ref endBulk is called, objects may only be stored and
+        fetches will not find them. Objects are written without the
+        usual crash protection and indexed all at once at the end.
+        @return `false` if the backend does not support bulk builds
+                or the database is not empty.
+    */
+    virtual
+    bool
+    beginBulk()
+    {
+        return false;
+    }
+
+    /** Finish a bulk build, making every stored object visible.
+        @note This must not be called concurrently with @ref store.
+        @param threads The number of threads used to build the index.
+    */
+    virtual
+    void
+    endBulk (int threads)
+    {
+    }
+
     /** Returns the number of file handles the backend expects to need */
     virtual int fdlimit() const = 0;
 };
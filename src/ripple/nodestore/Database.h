@@ -20,10 +20,12 @@
 #ifndef RIPPLE_NODESTORE_DATABASE_H_INCLUDED
 #define RIPPLE_NODESTORE_DATABASE_H_INCLUDED
 
-#include <ripple/basics/TaggedCache.h>
+#include <ripple/basics/ShardedTaggedCache.h>
 #include <ripple/core/Stoppable.h>
 #include <ripple/nodestore/NodeObject.h>
 #include <ripple/nodestore/Backend.h>
+#include <ripple/nodestore/Trace.h>
+#include <vector>
 
 namespace ripple {
 namespace NodeStore {
@@ -95,6 +97,11 @@ public:
     */
     virtual void waitReads () = 0;
 
+    /** Wait for the pending async reads of the given objects to complete.
+        Reads that other callers are waiting on are not waited for.
+    */
+    virtual void waitReads (std::vector <uint256> const& hashes) = 0;
+
     /** Get the maximum number of async reads the node store prefers.
         @return The number of async reads preferred.
     */
@@ -125,17 +132,36 @@ public:
     */
     virtual void for_each(std::function <void(std::shared_ptr<NodeObject>)> f) = 0;
 
-    /** Import objects from another database. */
-    virtual void import (Database& source) = 0;
+    /** Import objects from another database.
+
+        The source is read on the calling thread while the objects are
+        written by a pool of threads.
+    */
+    virtual void import (Database& source,
+                         ImportOptions const& options) = 0;
+
+    void import (Database& source)
+    {
+        import (source, ImportOptions {});
+    }
 
     /** Retrieve the estimated number of pending write operations.
         This is used for diagnostics.
     */
     virtual std::int32_t getWriteLoad() const = 0;
 
+    /** Returns `true` if objects are stored faster than they are written.
+        Callers able to defer work, such as acquiring ledgers, should
+        slow down while this holds.
+    */
+    virtual bool isWriteBacklogged() const = 0;
+
     /** Get the positive cache hits to total attempts ratio. */
     virtual float getCacheHitRate () = 0;
 
+    /** Get the policy deciding which objects stay in the cache. */
+    virtual CachePolicy getCachePolicy () const = 0;
+
     /** Set the maximum number of entries and maximum cache age for both caches.
 
         @param size Number of cache entries (0 = ignore)
@@ -143,6 +169,21 @@ public:
     */
     virtual void tune (int size, int age) = 0;
 
+    /** Limit the memory used by the positive cache and the key filters.
+
+        The filters cannot shrink, so the cache gets what they leave.
+        The split is redone on each sweep as the filters grow.
+
+        @param bytes Approximate limit in bytes (0 = no limit)
+    */
+    virtual void setCacheBytes (std::size_t bytes) = 0;
+
+    /** Get the approximate memory used by the objects in the positive cache. */
+    virtual std::size_t getCacheBytes () const = 0;
+
+    /** Get the memory used by the filters over the backends' keys. */
+    virtual std::size_t getFilterBytes () const = 0;
+
     /** Remove expired entries from the positive and negative caches. */
     virtual void sweep () = 0;
 
@@ -155,6 +196,11 @@ public:
     virtual std::uint32_t getStoreSize () const = 0;
     virtual std::uint32_t getFetchSize () const = 0;
 
+    /** Record the fetches and stores requested of the database.
+        @note This must be called before the database is used.
+    */
+    virtual void setTrace (std::unique_ptr<TraceWriter> trace) = 0;
+
     /** Return the number of files needed by our backend */
     virtual int fdlimit() const = 0;
 };
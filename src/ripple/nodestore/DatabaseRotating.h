@@ -35,7 +35,7 @@ class DatabaseRotating
 public:
     virtual ~DatabaseRotating() = default;
 
-    virtual TaggedCache <uint256, NodeObject>& getPositiveCache() = 0;
+    virtual ShardedTaggedCache <uint256, NodeObject>& getPositiveCache() = 0;
 
     virtual std::mutex& peekMutex() const = 0;
 
@@ -48,6 +48,14 @@ public:
 
     /** Ensure that node is in writableBackend */
     virtual std::shared_ptr<NodeObject> fetchNode (uint256 const& hash) = 0;
+
+    /** Ensure that the nodes are in writableBackend.
+
+        The nodes only found in archiveBackend are written as one batch.
+
+        @return The number of nodes written.
+    */
+    virtual std::size_t copyNodes (std::vector <uint256> const& hashes) = 0;
 };
 
 }
@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#ifndef RIPPLE_NODESTORE_DATABASESHARD_H_INCLUDED
+#define RIPPLE_NODESTORE_DATABASESHARD_H_INCLUDED
+
+#include <ripple/nodestore/NodeObject.h>
+#include <string>
+#include <vector>
+
+namespace ripple {
+namespace NodeStore {
+
+/* This class stores ledger history in shards. Each shard holds every
+ * object of a fixed range of ledgers in a backend of its own, so shards
+ * can be built, verified and removed independently. Once all of its
+ * ledgers are stored, a shard is complete and accepts no more objects.
+ * A shard's backend is opened when the shard is first read or written.
+ * Database::fetch has no ledger to go by, so it only searches the shards
+ * which are already open.
+ */
+
+class DatabaseShard
+{
+public:
+    virtual ~DatabaseShard() = default;
+
+    /** The number of ledgers in each shard. */
+    virtual std::uint32_t ledgersPerShard() const = 0;
+
+    /** The index of the shard holding a ledger. */
+    virtual std::uint32_t seqToShardIndex (std::uint32_t seq) const = 0;
+
+    /** The first ledger in a shard. */
+    virtual std::uint32_t firstSeq (std::uint32_t shardIndex) const = 0;
+
+    /** The last ledger in a shard. */
+    virtual std::uint32_t lastSeq (std::uint32_t shardIndex) const = 0;
+
+    /** Fetch an object from the shard holding a ledger.
+        Only that shard's backend is read, the caches are not used.
+
+        @param hash The key of the object to retrieve.
+        @param seq The ledger the object belongs to.
+        @return The object, or nullptr if the shard does not have it.
+    */
+    virtual std::shared_ptr<NodeObject> fetch (
+        uint256 const& hash, std::uint32_t seq) = 0;
+
+    /** Store an object in the shard holding a ledger.
+        The shard is created if needed. Objects for complete shards
+        are ignored.
+    */
+    virtual void store (NodeObjectType type, Blob&& data,
+        uint256 const& hash, std::uint32_t seq) = 0;
+
+    /** Record that every object of a ledger has been stored.
+        The shard holding the ledger is complete once all of its
+        ledgers are.
+    */
+    virtual void setStored (std::uint32_t seq) = 0;
+
+    /** Whether every object of a ledger has been stored. */
+    virtual bool contains (std::uint32_t seq) = 0;
+
+    /** The indexes of the complete shards, for example "1-3,7". */
+    virtual std::string getCompleteShards() = 0;
+
+    /** Verify the backends of the complete shards.
+
+        @param threads The number of shards to verify at once.
+        @return The indexes of the shards that failed.
+    */
+    virtual std::vector<std::uint32_t> validate (int threads) = 0;
+
+    /** Remove a shard and its files.
+        @return `false` if there is no such shard.
+    */
+    virtual bool removeShard (std::uint32_t shardIndex) = 0;
+};
+
+}
+}
+
+#endif
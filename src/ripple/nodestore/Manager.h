@@ -22,6 +22,8 @@
 
 #include <ripple/nodestore/Factory.h>
 #include <ripple/nodestore/DatabaseRotating.h>
+#include <ripple/nodestore/DatabaseShard.h>
+#include <ostream>
 
 namespace ripple {
 namespace NodeStore {
@@ -95,7 +97,24 @@ public:
             Stoppable& parent,
                 std::shared_ptr <Backend> writableBackend,
                     std::shared_ptr <Backend> archiveBackend,
-                        beast::Journal journal) = 0;
+                        CachePolicy cachePolicy,
+                            beast::Journal journal) = 0;
+
+    /** Construct a shard database.
+
+        The 'path' key of the parameters names the directory holding the
+        shards, each in a directory of its own. The other keys are passed
+        to the backend of every shard. 'ledgers_per_shard' sets the number
+        of ledgers in a shard.
+
+        @note The returned object is also a DatabaseShard.
+    */
+    virtual
+    std::unique_ptr <Database>
+    make_DatabaseShard (std::string const& name, Scheduler& scheduler,
+        int readThreads, Stoppable& parent,
+            Section const& shardParameters,
+                beast::Journal journal) = 0;
 };
 
 //------------------------------------------------------------------------------
@@ -105,6 +124,24 @@ std::unique_ptr <Backend>
 make_Backend (Section const& config,
     Scheduler& scheduler, beast::Journal journal);
 
+/** Train compression dictionaries from the objects in a NuDB database.
+
+    A sample of the objects of each type in the database named by the
+    'path' key trains a dictionary for that type. The dictionaries are
+    added to the file named by the 'dictionary' key, keeping the ones
+    already in it so that objects written with them stay readable.
+
+    @note Throws if the database or the file can't be used.
+
+    @param config The parameters of the NuDB backend.
+    @param samples Objects to sample of each type.
+    @param size Largest dictionary size in bytes.
+    @param out Receives the savings on the samples of each type.
+*/
+void
+trainDictionaries (Section const& config, std::size_t samples,
+    std::size_t size, std::ostream& out);
+
 }
 }
 
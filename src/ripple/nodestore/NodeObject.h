@@ -105,6 +105,14 @@ private:
     Blob mData;
 };
 
+/** Estimate the memory used by a cached NodeObject. */
+inline
+std::size_t
+cachedSize (NodeObject const& object)
+{
+    return sizeof (NodeObject) + object.getData ().capacity ();
+}
+
 }
 
 #endif
@@ -40,6 +40,9 @@ struct BatchWriteReport
 {
     std::chrono::milliseconds elapsed;
     int writeCount;
+
+    // Objects still waiting to be written when the batch started
+    int queueDepth = 0;
 };
 
 /** Scheduling for asynchronous backend activity
@@ -0,0 +1,130 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#ifndef RIPPLE_NODESTORE_TRACE_H_INCLUDED
+#define RIPPLE_NODESTORE_TRACE_H_INCLUDED
+
+#include <ripple/nodestore/NodeObject.h>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+namespace ripple {
+namespace NodeStore {
+
+/** An operation made through a Database, as recorded in a trace. */
+struct TraceRecord
+{
+    enum class Op : std::uint8_t
+    {
+        fetch = 0,
+        asyncFetch = 1,
+        store = 2
+    };
+
+    Op op = Op::fetch;
+
+    /** The type of a stored object. */
+    NodeObjectType type = hotUNKNOWN;
+
+    /** The size of the object stored or found, or 0 if none was found. */
+    std::uint32_t size = 0;
+
+    /** The time since the trace started. */
+    std::chrono::microseconds time {0};
+
+    uint256 hash;
+};
+
+/** Records the fetches and stores made through a Database in a file.
+
+    The trace holds keys and sizes but not the objects, so it can be
+    replayed against any backend without holding the ledger data.
+
+    @note All functions may be called concurrently.
+*/
+class TraceWriter
+{
+public:
+    /** Create a trace, replacing any file at `path`.
+        @throws std::runtime_error if the file can not be written.
+    */
+    explicit
+    TraceWriter (std::string const& path);
+
+    ~TraceWriter ();
+
+    TraceWriter (TraceWriter const&) = delete;
+    TraceWriter& operator= (TraceWriter const&) = delete;
+
+    std::string const&
+    path () const
+    {
+        return path_;
+    }
+
+    void
+    fetch (uint256 const& hash, std::uint32_t size, bool async);
+
+    void
+    store (NodeObjectType type, uint256 const& hash, std::uint32_t size);
+
+    /** Write out the records buffered so far. */
+    void
+    flush ();
+
+private:
+    using clock_type = std::chrono::steady_clock;
+
+    std::string const path_;
+    clock_type::time_point const start_;
+    std::mutex mutex_;
+    std::ofstream ofs_;
+
+    void
+    write (TraceRecord const& record);
+};
+
+/** Reads the records of a trace in the order they were made. */
+class TraceReader
+{
+public:
+    /** Open a trace.
+        @throws std::runtime_error if the file is not a trace.
+    */
+    explicit
+    TraceReader (std::string const& path);
+
+    /** Read the next record.
+        @return `false` at the end of the trace.
+    */
+    bool
+    next (TraceRecord& record);
+
+private:
+    std::ifstream ifs_;
+};
+
+}
+}
+
+#endif
@@ -22,6 +22,8 @@
 
 #include <ripple/nodestore/NodeObject.h>
 #include <ripple/basics/BasicConfig.h>
+#include <chrono>
+#include <string>
 #include <vector>
 
 namespace ripple {
@@ -48,6 +50,27 @@ enum Status
 
 /** A batch of NodeObjects to write at once. */
 using Batch = std::vector <std::shared_ptr<NodeObject>>;
+
+/** How objects are imported from another database.
+    @see Database::import
+*/
+struct ImportOptions
+{
+    /** Threads encoding and writing the objects read from the source.
+        With more than one, Backend::store is called concurrently.
+    */
+    int writeThreads = 1;
+
+    /** File recording the objects imported so far, so that an
+        interrupted import resumes where it left off. The file is
+        removed when the import completes. Empty for none.
+    */
+    std::string checkpoint;
+
+    /** Time between progress reports. */
+    std::chrono::seconds reportInterval {10};
+};
+
 }
 }
 
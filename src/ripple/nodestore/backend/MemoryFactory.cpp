@@ -132,14 +132,26 @@ public:
     bool
     canFetchBatch() override
     {
-        return false;
+        return true;
     }
 
     std::vector<std::shared_ptr<NodeObject>>
     fetchBatch (std::size_t n, void const* const* keys) override
     {
-        Throw<std::runtime_error> ("pure virtual called");
-        return {};
+        std::vector<std::shared_ptr<NodeObject>> results;
+        results.reserve (n);
+
+        std::lock_guard<std::mutex> _(db_->mutex);
+
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            Map::iterator iter = db_->table.find (uint256::fromVoid (keys[i]));
+            if (iter == db_->table.end())
+                results.push_back (nullptr);
+            else
+                results.push_back (iter->second);
+        }
+        return results;
     }
 
     void
@@ -26,17 +26,284 @@
 #include <ripple/nodestore/impl/DecodedBlob.h>
 #include <ripple/nodestore/impl/EncodedBlob.h>
 #include <nudb/nudb.hpp>
+#include <nudb/detail/bucket.hpp>
+#include <nudb/detail/bulkio.hpp>
+#include <nudb/detail/format.hpp>
 #include <boost/filesystem.hpp>
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cmath>
 #include <cstdio>
 #include <cstdint>
+#include <cstring>
 #include <exception>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace ripple {
 namespace NodeStore {
 
+// Builds a new NuDB database without the log file. Records are
+// appended to the data file as they arrive, and the key file is
+// built in one sorted, parallel pass over an in-memory index when
+// all of the records have been written.
+//
+class NuDBBulkBuilder
+{
+private:
+    struct Entry
+    {
+        std::uint64_t hash;
+        std::uint64_t offset;
+        std::uint32_t size;
+    };
+
+    // Write buffer for the data file
+    static std::size_t constexpr bulkBytes = 64 * 1024 * 1024;
+
+    // Key file buckets buffered by each indexing thread
+    static std::size_t constexpr chunkBytes = 16 * 1024 * 1024;
+
+    std::string const dp_;
+    std::string const kp_;
+    std::size_t const keyBytes_;
+    std::uint64_t const salt_;
+    nudb::detail::dat_file_header dh_;
+    nudb::native_file df_;
+    std::unique_ptr<nudb::detail::bulk_writer<nudb::native_file>> dw_;
+    std::mutex mutex_;
+    std::vector<Entry> entries_;
+
+public:
+    NuDBBulkBuilder (std::string const& dp, std::string const& kp,
+            std::size_t keyBytes, std::uint64_t appnum)
+        : dp_ (dp)
+        , kp_ (kp)
+        , keyBytes_ (keyBytes)
+        , salt_ (nudb::make_salt())
+    {
+        using namespace nudb::detail;
+        dh_.version = currentVersion;
+        dh_.uid = make_uid();
+        dh_.appnum = appnum;
+        dh_.key_size = keyBytes;
+
+        nudb::error_code ec;
+        df_.create (nudb::file_mode::append, dp_, ec);
+        if (ec)
+            Throw<nudb::system_error>(ec);
+        dw_ = std::make_unique<bulk_writer<nudb::native_file>>(
+            df_, 0, bulkBytes);
+        auto os = dw_->prepare (dat_file_header::size, ec);
+        if (ec)
+            Throw<nudb::system_error>(ec);
+        write (os, dh_);
+    }
+
+    /** Append a record to the data file.
+        @note This may be called concurrently.
+    */
+    void
+    insert (void const* key, void const* data, std::size_t size)
+    {
+        using namespace nudb::detail;
+        auto const h = hash<nudb::xxhasher>(key, keyBytes_, salt_);
+
+        std::lock_guard<std::mutex> lock (mutex_);
+        nudb::error_code ec;
+        auto const offset = dw_->offset();
+        auto os = dw_->prepare (
+            field<uint48_t>::size + keyBytes_ + size, ec);
+        if (ec)
+            Throw<nudb::system_error>(ec);
+        write<uint48_t>(os, size);
+        std::memcpy (os.data (keyBytes_), key, keyBytes_);
+        std::memcpy (os.data (size), data, size);
+        entries_.push_back ({h, offset,
+            static_cast<std::uint32_t>(size)});
+    }
+
+    /** Write the key file for every record inserted so far. */
+    void
+    finish (int threads)
+    {
+        using namespace nudb::detail;
+        threads = std::max (threads, 1);
+
+        key_file_header kh;
+        kh.version = currentVersion;
+        kh.uid = dh_.uid;
+        kh.appnum = dh_.appnum;
+        kh.key_size = keyBytes_;
+        kh.salt = salt_;
+        kh.pepper = pepper<nudb::xxhasher>(kh.salt);
+        kh.block_size = nudb::block_size (kp_);
+        kh.load_factor = 32768;
+        kh.buckets = std::max<std::size_t>(1, std::ceil (
+            entries_.size() / (bucket_capacity (kh.block_size) * 0.5)));
+        kh.modulus = ceil_pow2 (kh.buckets);
+
+        auto const bucketOf =
+            [&kh](Entry const& e)
+            {
+                return bucket_index (e.hash, kh.buckets, kh.modulus);
+            };
+
+        // Order the index by bucket: sort slices in parallel,
+        // then merge neighbouring slices until one remains.
+        {
+            auto const less =
+                [&bucketOf](Entry const& lhs, Entry const& rhs)
+                {
+                    return bucketOf (lhs) < bucketOf (rhs);
+                };
+            std::vector<std::size_t> bounds;
+            for (int i = 0; i < threads; ++i)
+                bounds.push_back (entries_.size() * i / threads);
+            bounds.push_back (entries_.size());
+
+            auto const first = entries_.begin();
+            parallel (threads,
+                [&](int i)
+                {
+                    std::sort (first + bounds[i],
+                        first + bounds[i + 1], less);
+                });
+            while (bounds.size() > 2)
+            {
+                auto const merges = (bounds.size() - 1) / 2;
+                parallel (static_cast<int>(merges),
+                    [&](int i)
+                    {
+                        std::inplace_merge (first + bounds[2 * i],
+                            first + bounds[2 * i + 1],
+                                first + bounds[2 * i + 2], less);
+                    });
+                std::vector<std::size_t> next;
+                for (std::size_t i = 0; i < bounds.size(); i += 2)
+                    next.push_back (bounds[i]);
+                if (next.back() != bounds.back())
+                    next.push_back (bounds.back());
+                bounds = std::move (next);
+            }
+        }
+
+        nudb::native_file kf;
+        nudb::error_code ec;
+        kf.create (nudb::file_mode::write, kp_, ec);
+        if (ec)
+            Throw<nudb::system_error>(ec);
+        {
+            buffer buf (kh.block_size);
+            std::memset (buf.get(), 0, kh.block_size);
+            ostream os (buf.get(), kh.block_size);
+            write (os, kh);
+            kf.write (0, buf.get(), kh.block_size, ec);
+            if (ec)
+                Throw<nudb::system_error>(ec);
+        }
+
+        // Each thread fills a contiguous range of buckets. Full
+        // buckets spill to the end of the data file, which is
+        // shared, so spills are serialized.
+        std::size_t const chunk = std::max<std::size_t>(
+            1, chunkBytes / kh.block_size);
+        parallel (threads,
+            [&](int t)
+            {
+                auto const b0 = kh.buckets * t / threads;
+                auto const b1 = kh.buckets * (t + 1) / threads;
+                auto it = std::lower_bound (
+                    entries_.begin(), entries_.end(), b0,
+                    [&bucketOf](Entry const& e, std::size_t n)
+                    {
+                        return bucketOf (e) < n;
+                    });
+
+                buffer buf (chunk * kh.block_size);
+                nudb::error_code error;
+                for (auto c0 = b0; c0 < b1; c0 += chunk)
+                {
+                    auto const c1 = std::min (c0 + chunk, b1);
+                    for (auto n = c0; n < c1; ++n)
+                    {
+                        bucket b (kh.block_size, buf.get() +
+                            (n - c0) * kh.block_size, empty);
+                    }
+                    for (; it != entries_.end(); ++it)
+                    {
+                        auto const n = bucketOf (*it);
+                        if (n >= c1)
+                            break;
+                        bucket b (kh.block_size,
+                            buf.get() + (n - c0) * kh.block_size);
+                        if (b.full())
+                        {
+                            std::lock_guard<std::mutex> lock (mutex_);
+                            maybe_spill (b, *dw_, error);
+                            if (error)
+                                Throw<nudb::system_error>(error);
+                        }
+                        b.insert (it->offset, it->size, it->hash);
+                    }
+                    kf.write ((c0 + 1) * kh.block_size, buf.get(),
+                        (c1 - c0) * kh.block_size, error);
+                    if (error)
+                        Throw<nudb::system_error>(error);
+                }
+            });
+
+        dw_->flush (ec);
+        if (ec)
+            Throw<nudb::system_error>(ec);
+        df_.sync (ec);
+        if (ec)
+            Throw<nudb::system_error>(ec);
+        kf.sync (ec);
+        if (ec)
+            Throw<nudb::system_error>(ec);
+        df_.close();
+        kf.close();
+    }
+
+private:
+    // Run f(0) through f(n - 1) on separate threads, rethrowing
+    // the first exception once they have all finished.
+    template <class Function>
+    static
+    void
+    parallel (int n, Function&& f)
+    {
+        std::vector<std::exception_ptr> errors (n);
+        std::vector<std::thread> workers;
+        workers.reserve (n);
+        for (int i = 0; i < n; ++i)
+        {
+            workers.emplace_back (
+                [&f, &errors, i]
+                {
+                    try
+                    {
+                        f (i);
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                    }
+                });
+        }
+        for (auto& w : workers)
+            w.join();
+        for (auto const& e : errors)
+            if (e)
+                std::rethrow_exception (e);
+    }
+};
+
+//------------------------------------------------------------------------------
+
 class NuDBBackend
     : public Backend
 {
@@ -56,6 +323,8 @@ public:
     nudb::store db_;
     std::atomic <bool> deletePath_;
     Scheduler& scheduler_;
+    CodecDictionaries dictionaries_;
+    std::unique_ptr<NuDBBulkBuilder> bulk_;
 
     NuDBBackend (int keyBytes, Section const& keyValues,
         Scheduler& scheduler, beast::Journal journal)
@@ -68,6 +337,9 @@ public:
         if (name_.empty())
             Throw<std::runtime_error> (
                 "nodestore: Missing path in NuDB backend");
+        auto const dictionary = get<std::string>(keyValues, "dictionary");
+        if (! dictionary.empty())
+            dictionaries_.load (dictionary);
         auto const folder = boost::filesystem::path (name_);
         boost::filesystem::create_directories (folder);
         auto const dp = (folder / "nudb.dat").string();
@@ -75,6 +347,9 @@ public:
         auto const lp = (folder / "nudb.log").string ();
         try
         {
+            // Discard a bulk build that never finished
+            recoverBulkFiles (dp, kp, lp);
+
             nudb::error_code ec;
             nudb::create<nudb::xxhasher>(dp, kp, lp,
                 currentType, nudb::make_salt(), keyBytes,
@@ -111,6 +386,11 @@ public:
     void
     close() override
     {
+        if (bulk_)
+        {
+            bulk_.reset();
+            removeBulkFiles (db_.dat_path(), db_.key_path());
+        }
         if (db_.is_open())
         {
             nudb::error_code ec;
@@ -131,19 +411,9 @@ public:
         pno->reset();
         nudb::error_code ec;
         db_.fetch (key,
-            [key, pno, &status](void const* data, std::size_t size)
+            [this, key, pno, &status](void const* data, std::size_t size)
             {
-                nudb::detail::buffer bf;
-                auto const result =
-                    nodeobject_decompress(data, size, bf);
-                DecodedBlob decoded (key, result.first, result.second);
-                if (! decoded.wasOk ())
-                {
-                    status = dataCorrupt;
-                    return;
-                }
-                *pno = decoded.createObject();
-                status = ok;
+                status = decode (key, data, size, *pno);
             }, ec);
         if(ec == nudb::error::key_not_found)
             return notFound;
@@ -155,14 +425,60 @@ public:
     bool
     canFetchBatch() override
     {
+        // Every key is still a separate read of the key and data files
         return false;
     }
 
     std::vector<std::shared_ptr<NodeObject>>
     fetchBatch (std::size_t n, void const* const* keys) override
     {
-        Throw<std::runtime_error> ("pure virtual called");
-        return {};
+        std::vector<std::shared_ptr<NodeObject>> results;
+        results.reserve (n);
+
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            std::shared_ptr<NodeObject> no;
+            nudb::error_code ec;
+            auto const key = keys[i];
+            db_.fetch (key,
+                [this, key, &no](void const* data, std::size_t size)
+                {
+                    if (decode (key, data, size, no) != ok)
+                        no.reset ();
+                }, ec);
+            if(ec && ec != nudb::error::key_not_found)
+                Throw<nudb::system_error>(ec);
+            results.push_back (std::move (no));
+        }
+        return results;
+    }
+
+    CodecDictionaries const*
+    dictionaries() const
+    {
+        return dictionaries_.empty() ? nullptr : &dictionaries_;
+    }
+
+    // Decode a value read from the database. Compressed values are
+    // decompressed into a buffer kept by each thread, so the only
+    // allocation is the new object's.
+    Status
+    decode (void const* key, void const* data, std::size_t size,
+        std::shared_ptr<NodeObject>& no) const
+    {
+        static thread_local Blob scratch;
+        auto const result = nodeobject_decompress(data, size,
+            [](std::size_t n)
+            {
+                if (scratch.size () < n)
+                    scratch.resize (n);
+                return scratch.data ();
+            }, dictionaries());
+        DecodedBlob decoded (key, result.first, result.second);
+        if (! decoded.wasOk ())
+            return dataCorrupt;
+        no = decoded.createObject ();
+        return ok;
     }
 
     void
@@ -173,12 +489,23 @@ public:
         nudb::error_code ec;
         nudb::detail::buffer bf;
         auto const result = nodeobject_compress(
-            e.getData(), e.getSize(), bf);
+            e.getData(), e.getSize(), bf, dictionaries());
         db_.insert (e.getKey(), result.first, result.second, ec);
         if(ec && ec != nudb::error::key_exists)
             Throw<nudb::system_error>(ec);
     }
 
+    void
+    bulk_insert (std::shared_ptr <NodeObject> const& no)
+    {
+        EncodedBlob e;
+        e.prepare (no);
+        nudb::detail::buffer bf;
+        auto const result = nodeobject_compress(
+            e.getData(), e.getSize(), bf, dictionaries());
+        bulk_->insert (e.getKey(), result.first, result.second);
+    }
+
     void
     store (std::shared_ptr <NodeObject> const& no) override
     {
@@ -186,7 +513,10 @@ public:
         report.writeCount = 1;
         auto const start =
             std::chrono::steady_clock::now();
-        do_insert (no);
+        if (bulk_)
+            bulk_insert (no);
+        else
+            do_insert (no);
         report.elapsed = std::chrono::duration_cast <
             std::chrono::milliseconds>(
                 std::chrono::steady_clock::now() - start);
@@ -202,7 +532,12 @@ public:
         auto const start =
             std::chrono::steady_clock::now();
         for (auto const& e : batch)
-            do_insert (e);
+        {
+            if (bulk_)
+                bulk_insert (e);
+            else
+                do_insert (e);
+        }
         report.elapsed = std::chrono::duration_cast <
             std::chrono::milliseconds>(
                 std::chrono::steady_clock::now() - start);
@@ -220,23 +555,30 @@ public:
         db_.close(ec);
         if(ec)
             Throw<nudb::system_error>(ec);
-        nudb::visit(dp,
-            [&](
-                void const* key, std::size_t key_bytes,
-                void const* data, std::size_t size,
-                nudb::error_code&)
-            {
-                nudb::detail::buffer bf;
-                auto const result =
-                    nodeobject_decompress(data, size, bf);
-                DecodedBlob decoded (key, result.first, result.second);
-                if (! decoded.wasOk ())
+        try
+        {
+            nudb::visit(dp,
+                [&](
+                    void const* key, std::size_t key_bytes,
+                    void const* data, std::size_t size,
+                    nudb::error_code&)
                 {
-                    ec = make_error_code(nudb::error::missing_value);
-                    return;
-                }
-                f (decoded.createObject());
-            }, nudb::no_progress{}, ec);
+                    std::shared_ptr<NodeObject> no;
+                    if (decode (key, data, size, no) != ok)
+                    {
+                        ec = make_error_code(nudb::error::missing_value);
+                        return;
+                    }
+                    f (std::move (no));
+                }, nudb::no_progress{}, ec);
+        }
+        catch (...)
+        {
+            // Leave the database open for the caller
+            nudb::error_code ignored;
+            db_.open(dp, kp, lp, ignored);
+            Rethrow();
+        }
         if(ec)
             Throw<nudb::system_error>(ec);
         db_.open(dp, kp, lp, ec);
@@ -276,6 +618,76 @@ public:
             Throw<nudb::system_error>(ec);
     }
 
+    bool
+    beginBulk() override
+    {
+        if (bulk_ || ! db_.is_open())
+            return false;
+        auto const dp = db_.dat_path();
+        auto const kp = db_.key_path();
+        if (boost::filesystem::file_size (dp) >
+                nudb::detail::dat_file_header::size)
+            return false;
+        removeBulkFiles (dp, kp);
+        bulk_ = std::make_unique<NuDBBulkBuilder>(
+            dp + ".bulk", kp + ".bulk", keyBytes_, currentType);
+        return true;
+    }
+
+    void
+    endBulk (int threads) override
+    {
+        if (! bulk_)
+            return;
+        bulk_->finish (threads);
+        bulk_.reset();
+
+        // Swap the finished files in for the empty database
+        auto const dp = db_.dat_path();
+        auto const kp = db_.key_path();
+        auto const lp = db_.log_path();
+        nudb::error_code ec;
+        db_.close(ec);
+        if(ec)
+            Throw<nudb::system_error>(ec);
+        boost::filesystem::remove (lp);
+        // The key file is the commit point, so it goes last
+        boost::filesystem::rename (dp + ".bulk", dp);
+        boost::filesystem::rename (kp + ".bulk", kp);
+        db_.open (dp, kp, lp, ec);
+        if(ec)
+            Throw<nudb::system_error>(ec);
+    }
+
+    static
+    void
+    removeBulkFiles (std::string const& dp, std::string const& kp)
+    {
+        // The key file goes first, so that a key file without its
+        // data file only ever means an interrupted endBulk.
+        boost::filesystem::remove (kp + ".bulk");
+        boost::filesystem::remove (dp + ".bulk");
+    }
+
+    // Undo whatever a bulk build left behind when the server stopped.
+    // If endBulk renamed the data file but not the key file, the data
+    // file in place belongs to the uncommitted build and the database
+    // it replaced was empty, so the database is removed and recreated.
+    static
+    void
+    recoverBulkFiles (std::string const& dp,
+        std::string const& kp, std::string const& lp)
+    {
+        if (boost::filesystem::exists (kp + ".bulk") &&
+            ! boost::filesystem::exists (dp + ".bulk"))
+        {
+            boost::filesystem::remove (lp);
+            boost::filesystem::remove (kp);
+            boost::filesystem::remove (dp);
+        }
+        removeBulkFiles (dp, kp);
+    }
+
     /** Returns the number of file handles the backend expects to need */
     int
     fdlimit() const override
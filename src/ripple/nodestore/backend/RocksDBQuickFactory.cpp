@@ -258,7 +258,7 @@ public:
     bool
     canFetchBatch() override
     {
-        return false;
+        return true;
     }
 
     void
@@ -270,8 +270,33 @@ public:
     std::vector<std::shared_ptr<NodeObject>>
     fetchBatch (std::size_t n, void const* const* keys) override
     {
-        Throw<std::runtime_error> ("pure virtual called");
-        return {};
+        std::vector <rocksdb::Slice> slices;
+        slices.reserve (n);
+        for (std::size_t i = 0; i < n; ++i)
+            slices.emplace_back (static_cast <char const*> (keys[i]), m_keyBytes);
+
+        std::vector <std::string> values;
+        auto const statuses = m_db->MultiGet (
+            rocksdb::ReadOptions (), slices, &values);
+
+        std::vector<std::shared_ptr<NodeObject>> results;
+        results.reserve (n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            std::shared_ptr<NodeObject> object;
+            if (statuses[i].ok ())
+            {
+                DecodedBlob decoded (keys[i], values[i].data (), values[i].size ());
+                if (decoded.wasOk ())
+                    object = decoded.createObject ();
+            }
+            else if (! statuses[i].IsNotFound ())
+            {
+                JLOG(m_journal.error()) << statuses[i].ToString ();
+            }
+            results.push_back (std::move (object));
+        }
+        return results;
     }
 
     void
@@ -19,15 +19,21 @@
 
 #include <BeastConfig.h>
 #include <ripple/nodestore/impl/BatchWriter.h>
+#include <ripple/nodestore/impl/Tuning.h>
+#include <algorithm>
 
 namespace ripple {
 namespace NodeStore {
 
-BatchWriter::BatchWriter (Callback& callback, Scheduler& scheduler)
+BatchWriter::BatchWriter (Callback& callback, Scheduler& scheduler,
+        Stopwatch& clock)
     : m_callback (callback)
     , m_scheduler (scheduler)
+    , m_clock (clock)
     , mWriteLoad (0)
     , mWritePending (false)
+    , mBatchSize (batchWriteMaxSize)
+    , mMicrosPerObject (0)
 {
     mWriteSet.reserve (batchWritePreallocationSize);
 }
@@ -40,16 +46,31 @@ BatchWriter::~BatchWriter ()
 void
 BatchWriter::store (std::shared_ptr<NodeObject> const& object)
 {
-    std::lock_guard<decltype(mWriteMutex)> sl (mWriteMutex);
+    {
+        std::lock_guard<decltype(mWriteMutex)> sl (mWriteMutex);
 
-    mWriteSet.push_back (object);
+        if (! mWriteKeys.insert (object->getHash ()).second)
+            return;
 
-    if (! mWritePending)
-    {
-        mWritePending = true;
+        mWriteSet.push_back (object);
+
+        if (mWriteSet.size () == batchWriteMinSize)
+            mFillCondition.notify_all ();
 
-        m_scheduler.scheduleTask (*this);
+        if (mWritePending)
+            return;
+
+        mWritePending = true;
+        mSchedulingThread = std::this_thread::get_id ();
     }
+
+    // The scheduler may run the task before returning, so
+    // it is called without the lock held
+    m_scheduler.scheduleTask (*this);
+
+    std::lock_guard<decltype(mWriteMutex)> sl (mWriteMutex);
+    if (mSchedulingThread == std::this_thread::get_id ())
+        mSchedulingThread = std::thread::id ();
 }
 
 int
@@ -60,6 +81,15 @@ BatchWriter::getWriteLoad ()
     return std::max (mWriteLoad, static_cast<int> (mWriteSet.size ()));
 }
 
+bool
+BatchWriter::isBacklogged ()
+{
+    std::lock_guard<decltype(mWriteMutex)> sl (mWriteMutex);
+
+    return mWriteLoad + mWriteSet.size () >
+        batchWriteBacklogBatches * mBatchSize;
+}
+
 void
 BatchWriter::performScheduledTask ()
 {
@@ -76,9 +106,23 @@ BatchWriter::writeBatch ()
         set.reserve (batchWritePreallocationSize);
 
         {
-            std::lock_guard<decltype(mWriteMutex)> sl (mWriteMutex);
+            std::unique_lock<decltype(mWriteMutex)> sl (mWriteMutex);
+
+            // Give a small batch a moment to grow, unless the task
+            // runs on the thread that stores, which can't add to it
+            if (! mWriteSet.empty () && mWriteSet.size () < batchWriteMinSize &&
+                mSchedulingThread != std::this_thread::get_id ())
+            {
+                mFillCondition.wait_for (sl,
+                    std::chrono::milliseconds (batchWriteCoalesceMs),
+                    [this]
+                    {
+                        return mWriteSet.size () >= batchWriteMinSize;
+                    });
+            }
 
             mWriteSet.swap (set);
+            mWriteKeys.clear ();
             assert (mWriteSet.empty ());
             mWriteLoad = set.size ();
 
@@ -93,17 +137,74 @@ BatchWriter::writeBatch ()
 
         }
 
-        BatchWriteReport report;
-        report.writeCount = set.size();
-        auto const before = std::chrono::steady_clock::now();
+        for (std::size_t written = 0; written < set.size ();)
+        {
+            BatchWriteReport report;
+            std::size_t count;
+            {
+                std::lock_guard<decltype(mWriteMutex)> sl (mWriteMutex);
+
+                // Split what remains evenly, rather than
+                // leaving a small batch at the end
+                auto const remaining = set.size () - written;
+                auto const batches =
+                    (remaining + mBatchSize - 1) / mBatchSize;
+                count = (remaining + batches - 1) / batches;
+                report.queueDepth = static_cast<int> (
+                    set.size () - written + mWriteSet.size ());
+            }
+
+            report.writeCount = count;
+            auto const before = m_clock.now();
+
+            if (count == set.size ())
+            {
+                m_callback.writeBatch (set);
+            }
+            else
+            {
+                Batch const batch (set.begin () + written,
+                    set.begin () + written + count);
+                m_callback.writeBatch (batch);
+            }
+
+            auto const elapsed = m_clock.now() - before;
+            report.elapsed = std::chrono::duration_cast <
+                std::chrono::milliseconds> (elapsed);
+
+            written += count;
+            adjustBatchSize (count, std::chrono::duration_cast <
+                std::chrono::microseconds> (elapsed));
+
+            m_scheduler.onBatchWrite (report);
+        }
+    }
+}
+
+void
+BatchWriter::adjustBatchSize (std::size_t count,
+    std::chrono::microseconds elapsed)
+{
+    std::lock_guard<decltype(mWriteMutex)> sl (mWriteMutex);
 
-        m_callback.writeBatch (set);
+    mWriteLoad = std::max (0, mWriteLoad - static_cast<int> (count));
 
-        report.elapsed = std::chrono::duration_cast <std::chrono::milliseconds>
-            (std::chrono::steady_clock::now() - before);
+    // Smooth the cost so that a single slow write
+    // does not collapse the batch size
+    double const sample =
+        static_cast<double> (elapsed.count ()) / count;
+    if (mMicrosPerObject == 0)
+        mMicrosPerObject = sample;
+    else
+        mMicrosPerObject = (3 * mMicrosPerObject + sample) / 4;
 
-        m_scheduler.onBatchWrite (report);
+    std::size_t target = batchWriteMaxSize;
+    if (mMicrosPerObject > 0)
+    {
+        target = static_cast<std::size_t> (std::min<double> (
+            batchWriteMaxSize, batchWriteTargetMs * 1000 / mMicrosPerObject));
     }
+    mBatchSize = std::max<std::size_t> (target, batchWriteMinSize);
 }
 
 void
@@ -23,8 +23,12 @@
 #include <ripple/nodestore/Scheduler.h>
 #include <ripple/nodestore/Task.h>
 #include <ripple/nodestore/Types.h>
+#include <ripple/basics/base_uint.h>
+#include <ripple/basics/chrono.h>
+#include <ripple/basics/UnorderedContainers.h>
 #include <condition_variable>
 #include <mutex>
+#include <thread>
 
 namespace ripple {
 namespace NodeStore {
@@ -35,6 +39,10 @@ namespace NodeStore {
     class it not required. A backend can implement its own write batching,
     or skip write batching if doing so yields a performance benefit.
 
+    Objects already waiting to be written are not queued again. The
+    pending objects are handed to the backend in batches sized so that
+    each write takes about the same time, measured from earlier writes.
+
     @see Scheduler
 */
 class BatchWriter : private Task
@@ -46,8 +54,13 @@ public:
         virtual void writeBatch (Batch const& batch) = 0;
     };
 
-    /** Create a batch writer. */
-    BatchWriter (Callback& callback, Scheduler& scheduler);
+    /** Create a batch writer.
+
+        @param clock Times the writes, to size the batches.
+    */
+    BatchWriter (Callback& callback, Scheduler& scheduler,
+        Stopwatch& clock = beast::get_abstract_clock <
+            std::chrono::steady_clock> ());
 
     /** Destroy a batch writer.
 
@@ -65,10 +78,19 @@ public:
     /** Get an estimate of the amount of writing I/O pending. */
     int getWriteLoad ();
 
+    /** Returns `true` if objects arrive faster than they are written.
+
+        The writer is backlogged when more objects are pending than it
+        expects to write in several batches.
+    */
+    bool isBacklogged ();
+
 private:
     void performScheduledTask ();
     void writeBatch ();
     void waitForWriting ();
+    void adjustBatchSize (std::size_t count,
+        std::chrono::microseconds elapsed);
 
 private:
     using LockType = std::recursive_mutex;
@@ -76,11 +98,26 @@ private:
 
     Callback& m_callback;
     Scheduler& m_scheduler;
+    Stopwatch& m_clock;
     LockType mWriteMutex;
     CondvarType mWriteCondition;
+    std::condition_variable_any mFillCondition;
     int mWriteLoad;
     bool mWritePending;
     Batch mWriteSet;
+
+    // The thread scheduling the write task, while it does so. A
+    // scheduler may run the task on that thread before returning.
+    std::thread::id mSchedulingThread;
+
+    // The hashes of the objects in mWriteSet
+    hash_set<uint256> mWriteKeys;
+
+    // Objects handed to the backend at once
+    std::size_t mBatchSize;
+
+    // Smoothed time the backend takes to write one object
+    double mMicrosPerObject;
 };
 
 }
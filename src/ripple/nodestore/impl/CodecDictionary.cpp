@@ -0,0 +1,408 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/nodestore/impl/CodecDictionary.h>
+#include <ripple/nodestore/impl/codec.h>
+#include <ripple/nodestore/Manager.h>
+#include <ripple/basics/contract.h>
+#include <ripple/beast/xor_shift_engine.h>
+#include <ripple/protocol/digest.h>
+#include <ripple/protocol/Serializer.h>
+#include <nudb/nudb.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ripple {
+namespace NodeStore {
+
+namespace {
+
+// Marks a dictionary file, followed by its format version
+std::uint32_t const fileMagic = 0x52444354;     // "RDCT"
+std::uint32_t const fileVersion = 1;
+
+bool
+isValidType (std::uint8_t type)
+{
+    switch (type)
+    {
+    case hotUNKNOWN:
+    case hotLEDGER:
+    case hotACCOUNT_NODE:
+    case hotTRANSACTION_NODE:
+        return true;
+    default:
+        break;
+    }
+    return false;
+}
+
+}
+
+std::size_t constexpr CodecDictionaries::maxSize;
+
+std::uint32_t
+CodecDictionaries::insert (NodeObjectType type, Blob data)
+{
+    if (data.empty () || data.size () > maxSize)
+        Throw<std::runtime_error> (
+            "nodestore: invalid dictionary size " +
+                std::to_string (data.size ()));
+
+    auto const hash = sha512Half (makeSlice (data));
+    std::uint32_t id;
+    std::memcpy (&id, hash.data (), sizeof (id));
+
+    // The same dictionary added again becomes the newest
+    dictionaries_.erase (std::remove_if (
+        dictionaries_.begin (), dictionaries_.end (),
+        [id](std::unique_ptr <Dictionary> const& d)
+        {
+            return d->id == id;
+        }), dictionaries_.end ());
+
+    auto d = std::make_unique <Dictionary> ();
+    d->id = id;
+    d->type = type;
+    d->data = std::move (data);
+    d->stream = std::make_unique <LZ4_stream_t> ();
+    LZ4_resetStream (d->stream.get ());
+    LZ4_loadDict (d->stream.get (),
+        reinterpret_cast <char const*> (d->data.data ()),
+            static_cast <int> (d->data.size ()));
+
+    dictionaries_.push_back (std::move (d));
+    return id;
+}
+
+CodecDictionaries::Dictionary const*
+CodecDictionaries::newest (NodeObjectType type) const
+{
+    for (auto iter = dictionaries_.rbegin ();
+            iter != dictionaries_.rend (); ++iter)
+    {
+        if ((*iter)->type == type)
+            return iter->get ();
+    }
+    return nullptr;
+}
+
+CodecDictionaries::Dictionary const*
+CodecDictionaries::find (std::uint32_t id) const
+{
+    for (auto const& d : dictionaries_)
+    {
+        if (d->id == id)
+            return d.get ();
+    }
+    return nullptr;
+}
+
+void
+CodecDictionaries::load (std::string const& path)
+{
+    std::ifstream in (path, std::ios::binary);
+    if (! in)
+        Throw<std::runtime_error> (
+            "nodestore: can't open dictionary file " + path);
+
+    Blob const contents {std::istreambuf_iterator <char> (in),
+        std::istreambuf_iterator <char> ()};
+
+    try
+    {
+        SerialIter sit (makeSlice (contents));
+        if (sit.get32 () != fileMagic || sit.get32 () != fileVersion)
+            Throw<std::runtime_error> ("unknown format");
+
+        auto count = sit.get32 ();
+        while (count--)
+        {
+            auto const type = sit.get8 ();
+            if (! isValidType (type))
+                Throw<std::runtime_error> ("bad object type");
+            auto const size = sit.get32 ();
+            insert (static_cast <NodeObjectType> (type),
+                sit.getRaw (size));
+        }
+
+        if (! sit.empty ())
+            Throw<std::runtime_error> ("extra data");
+    }
+    catch (std::exception const& e)
+    {
+        Throw<std::runtime_error> (
+            "nodestore: invalid dictionary file " + path + ": " + e.what ());
+    }
+}
+
+void
+CodecDictionaries::save (std::string const& path) const
+{
+    Serializer s;
+    s.add32 (fileMagic);
+    s.add32 (fileVersion);
+    s.add32 (static_cast <std::uint32_t> (dictionaries_.size ()));
+    for (auto const& d : dictionaries_)
+    {
+        s.add8 (static_cast <unsigned char> (d->type));
+        s.add32 (static_cast <std::uint32_t> (d->data.size ()));
+        s.addRaw (d->data);
+    }
+
+    std::ofstream out (path, std::ios::binary | std::ios::trunc);
+    out.write (reinterpret_cast <char const*> (s.data ()), s.size ());
+    if (! out)
+        Throw<std::runtime_error> (
+            "nodestore: can't write dictionary file " + path);
+}
+
+Blob
+CodecDictionaries::train (std::vector <Blob> const& samples, std::size_t size)
+{
+    // Substrings of this length are counted
+    std::size_t const k = sizeof (std::uint64_t);
+
+    // The dictionary is made of pieces of samples of this length,
+    // starting every step bytes
+    std::size_t const segment = 64;
+    std::size_t const step = segment / 2;
+
+    size = std::min (size, maxSize);
+
+    auto const substring = [](std::uint8_t const* p)
+    {
+        std::uint64_t v;
+        std::memcpy (&v, p, sizeof (v));
+        return v;
+    };
+
+    // Count the samples each substring appears in
+    std::unordered_map <std::uint64_t, std::uint32_t> counts;
+    {
+        std::unordered_set <std::uint64_t> seen;
+        for (auto const& sample : samples)
+        {
+            seen.clear ();
+            for (std::size_t i = 0; i + k <= sample.size (); ++i)
+            {
+                auto const s = substring (sample.data () + i);
+                if (seen.insert (s).second)
+                    ++counts[s];
+            }
+        }
+    }
+
+    struct Candidate
+    {
+        std::uint64_t score;
+        std::size_t sample;
+        std::size_t offset;
+        std::size_t length;
+
+        bool operator< (Candidate const& other) const
+        {
+            return score < other.score;
+        }
+    };
+
+    // A segment is worth the number of samples sharing each of its
+    // substrings that are not yet in the dictionary. Substrings only
+    // found in one sample are worthless.
+    std::unordered_set <std::uint64_t> seen;
+    auto const score = [&](Candidate const& c)
+    {
+        std::uint64_t total = 0;
+        seen.clear ();
+        auto const p = samples[c.sample].data () + c.offset;
+        for (std::size_t i = 0; i + k <= c.length; ++i)
+        {
+            auto const s = substring (p + i);
+            if (! seen.insert (s).second)
+                continue;
+            auto const iter = counts.find (s);
+            if (iter != counts.end () && iter->second > 1)
+                total += iter->second;
+        }
+        return total;
+    };
+
+    std::priority_queue <Candidate> queue;
+    for (std::size_t i = 0; i < samples.size (); ++i)
+    {
+        auto const n = samples[i].size ();
+        for (std::size_t offset = 0; offset + k <= n; offset += step)
+        {
+            Candidate c {0, i, offset, std::min (segment, n - offset)};
+            c.score = score (c);
+            if (c.score != 0)
+                queue.push (c);
+        }
+    }
+
+    // Greedily take the best segment. Scores only fall as segments
+    // are taken, so a segment whose score still beats the next best
+    // is the best overall.
+    std::vector <Candidate> chosen;
+    std::size_t used = 0;
+    while (! queue.empty () && used < size)
+    {
+        auto c = queue.top ();
+        queue.pop ();
+
+        c.score = score (c);
+        if (c.score == 0)
+            continue;
+        if (! queue.empty () && c.score < queue.top ().score)
+        {
+            queue.push (c);
+            continue;
+        }
+
+        c.length = std::min (c.length, size - used);
+        used += c.length;
+        chosen.push_back (c);
+
+        auto const p = samples[c.sample].data () + c.offset;
+        for (std::size_t i = 0; i + k <= c.length; ++i)
+            counts.erase (substring (p + i));
+    }
+
+    // The best segments go last, so they take precedence when the
+    // dictionary is loaded.
+    Blob dictionary;
+    dictionary.reserve (used);
+    for (auto iter = chosen.rbegin (); iter != chosen.rend (); ++iter)
+    {
+        auto const p = samples[iter->sample].data () + iter->offset;
+        dictionary.insert (dictionary.end (), p, p + iter->length);
+    }
+    return dictionary;
+}
+
+//------------------------------------------------------------------------------
+
+void
+trainDictionaries (Section const& config, std::size_t samples,
+    std::size_t size, std::ostream& out)
+{
+    auto const from = get<std::string> (config, "path");
+    auto const to = get<std::string> (config, "dictionary");
+    if (! boost::iequals (get<std::string> (config, "type"), "nudb"))
+        Throw<std::runtime_error> (
+            "nodestore: dictionaries need a nudb backend");
+    if (from.empty () || to.empty ())
+        Throw<std::runtime_error> (
+            "nodestore: missing 'path' or 'dictionary' key");
+
+    CodecDictionaries dictionaries;
+    if (boost::filesystem::exists (to))
+        dictionaries.load (to);
+
+    // Sample the objects of each type uniformly
+    beast::xor_shift_engine gen;
+    std::map <NodeObjectType, std::vector <Blob>> sampled;
+    std::map <NodeObjectType, std::size_t> seen;
+    nudb::error_code ec;
+    nudb::visit ((boost::filesystem::path (from) / "nudb.dat").string (),
+        [&](void const*, std::size_t,
+            void const* data, std::size_t bytes, nudb::error_code&)
+        {
+            nudb::detail::buffer bf;
+            auto const result = nodeobject_decompress (
+                data, bytes, bf, dictionaries.empty () ?
+                    nullptr : &dictionaries);
+            // Inner nodes have their own encoding
+            if (result.second == 525 || result.second <= 9)
+                return;
+            auto const p = static_cast <std::uint8_t const*> (
+                result.first);
+            auto const type = static_cast <NodeObjectType> (p[8]);
+            auto& v = sampled[type];
+            auto const n = seen[type]++;
+            if (v.size () < samples)
+            {
+                v.emplace_back (p, p + result.second);
+            }
+            else
+            {
+                auto const i = gen () % (n + 1);
+                if (i < samples)
+                    v[i].assign (p, p + result.second);
+            }
+        }, nudb::no_progress {}, ec);
+    if (ec)
+        Throw<nudb::system_error> (ec);
+
+    for (auto const& entry : sampled)
+    {
+        auto dictionary = CodecDictionaries::train (entry.second, size);
+        if (dictionary.empty ())
+        {
+            out << "type " << entry.first <<
+                ": nothing in common between the objects" << std::endl;
+            continue;
+        }
+
+        // Measure the dictionary on its own samples
+        CodecDictionaries candidate;
+        auto const id = candidate.insert (entry.first, dictionary);
+        std::size_t plain = 0;
+        std::size_t trained = 0;
+        nudb::detail::buffer bf;
+        for (auto const& value : entry.second)
+        {
+            plain += nodeobject_compress (
+                value.data (), value.size (), bf).second;
+            trained += nodeobject_compress (
+                value.data (), value.size (), bf, &candidate).second;
+        }
+        out << "type " << entry.first <<
+            ": dictionary " << id <<
+            ", " << seen[entry.first] << " objects, " <<
+            entry.second.size () << " sampled, " <<
+            std::fixed << std::setprecision (1) <<
+            (100.0 * trained / std::max <std::size_t> (plain, 1)) <<
+            "% of the lz4 size";
+
+        // A dictionary that doesn't help would only slow reads
+        if (trained < plain)
+            dictionaries.insert (entry.first, std::move (dictionary));
+        else
+            out << ", not kept";
+        out << std::endl;
+    }
+
+    dictionaries.save (to);
+    out << "Wrote " << dictionaries.list ().size () <<
+        " dictionaries to " << to << std::endl;
+}
+
+}
+}
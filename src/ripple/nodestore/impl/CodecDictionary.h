@@ -0,0 +1,118 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_NODESTORE_CODECDICTIONARY_H_INCLUDED
+#define RIPPLE_NODESTORE_CODECDICTIONARY_H_INCLUDED
+
+#include <ripple/nodestore/NodeObject.h>
+#include <lz4/lib/lz4.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ripple {
+namespace NodeStore {
+
+/** Compression dictionaries for the node store codec.
+
+    A dictionary holds byte sequences that are common in objects of one
+    NodeObjectType, such as the field codes and layout of serialized
+    ledger entries. Objects are compressed against the newest dictionary
+    for their type. Every dictionary is identified by a hash of its
+    contents, which is stored with each object compressed against it, so
+    older objects stay readable as long as their dictionary is kept.
+
+    Expect smaller savings than zstd reports for trained dictionaries.
+    Most of a ledger entry is hashes and account IDs, which no dictionary
+    can predict, and LZ4 has no entropy coder to shrink the bytes it
+    can't match. The dictionary only helps with the field codes,
+    currencies and issuers that repeat between objects.
+
+    @note The dictionaries must not be changed while they are in use.
+*/
+class CodecDictionaries
+{
+public:
+    /** Largest dictionary LZ4 can make use of. */
+    static std::size_t constexpr maxSize = 64 * 1024;
+
+    struct Dictionary
+    {
+        std::uint32_t id;
+        NodeObjectType type;
+        Blob data;
+
+        // Compression state with the dictionary already loaded
+        std::unique_ptr <LZ4_stream_t> stream;
+    };
+
+    CodecDictionaries () = default;
+    CodecDictionaries (CodecDictionaries const&) = delete;
+    CodecDictionaries& operator= (CodecDictionaries const&) = delete;
+
+    bool empty () const
+    {
+        return dictionaries_.empty ();
+    }
+
+    std::vector <std::unique_ptr <Dictionary>> const& list () const
+    {
+        return dictionaries_;
+    }
+
+    /** Add a dictionary, making it the newest for its type.
+        @return The dictionary's identifier.
+    */
+    std::uint32_t insert (NodeObjectType type, Blob data);
+
+    /** Return the newest dictionary for a type, or nullptr. */
+    Dictionary const* newest (NodeObjectType type) const;
+
+    /** Return the dictionary with an identifier, or nullptr. */
+    Dictionary const* find (std::uint32_t id) const;
+
+    /** Read the dictionaries from a file written by save.
+        Throws if the file can't be read or isn't valid.
+    */
+    void load (std::string const& path);
+
+    /** Write the dictionaries to a file. */
+    void save (std::string const& path) const;
+
+    /** Build a dictionary from sample objects of one type.
+
+        Chooses the segments of the samples whose substrings occur
+        most often across all of them, until the dictionary is full.
+
+        @param samples Encoded objects, as passed to the codec.
+        @param size The largest dictionary to build.
+    */
+    static
+    Blob
+    train (std::vector <Blob> const& samples, std::size_t size);
+
+private:
+    std::vector <std::unique_ptr <Dictionary>> dictionaries_;
+};
+
+}
+}
+
+#endif
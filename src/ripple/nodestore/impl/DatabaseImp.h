@@ -26,6 +26,11 @@
 #include <ripple/basics/KeyCache.h>
 #include <ripple/basics/chrono.h>
 #include <ripple/beast/core/CurrentThreadName.h>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <map>
 
 namespace ripple {
 namespace NodeStore {
@@ -40,7 +45,7 @@ private:
     std::unique_ptr <Backend> m_backend;
 protected:
     // Positive cache
-    TaggedCache <uint256, NodeObject> m_cache;
+    ShardedTaggedCache <uint256, NodeObject> m_cache;
 
     // Negative cache
     KeyCache <uint256> m_negCache;
@@ -49,8 +54,11 @@ private:
     std::condition_variable   m_readCondVar;
     std::condition_variable   m_readGenCondVar;
     std::set <uint256>        m_readSet;        // set of reads to do
+    std::multiset <uint256>   m_reading;        // reads being done
     uint256                   m_readLast;       // last hash read
     std::vector <std::thread> m_readThreads;
+    std::size_t const         m_readThreadCount;
+    int                       m_readBusy;       // threads reading
     bool                      m_readShut;
     uint64_t                  m_readGen;        // current read generation
     int                       fdlimit_;
@@ -59,6 +67,8 @@ private:
     std::atomic <std::uint32_t> m_fetchHitCount;
     std::atomic <std::uint32_t> m_storeSize;
     std::atomic <std::uint32_t> m_fetchSize;
+    std::atomic <std::size_t> m_cacheBytes;     // cache and filter limit
+    std::unique_ptr <TraceWriter> m_trace;
 
 public:
     DatabaseImp (std::string const& name,
@@ -66,15 +76,19 @@ public:
                  int readThreads,
                  Stoppable& parent,
                  std::unique_ptr <Backend> backend,
+                 CachePolicy cachePolicy,
                  beast::Journal journal)
         : Database (name, parent)
         , m_journal (journal)
         , m_scheduler (scheduler)
         , m_backend (std::move (backend))
         , m_cache ("NodeStore", cacheTargetSize, cacheTargetSeconds,
-            stopwatch(), journal)
+            stopwatch(), journal, beast::insight::NullCollector::New (),
+                cachePolicy)
         , m_negCache ("NodeStore", stopwatch(),
             cacheTargetSize, cacheTargetSeconds)
+        , m_readThreadCount (readThreads)
+        , m_readBusy (0)
         , m_readShut (false)
         , m_readGen (0)
         , fdlimit_ (0)
@@ -83,6 +97,7 @@ public:
         , m_fetchHitCount (0)
         , m_storeSize (0)
         , m_fetchSize (0)
+        , m_cacheBytes (0)
     {
         for (int i = 0; i < readThreads; ++i)
             m_readThreads.emplace_back (&DatabaseImp::threadEntry, this);
@@ -112,11 +127,12 @@ public:
 
     bool asyncFetch (uint256 const& hash, std::shared_ptr<NodeObject>& object) override
     {
-        // See if the object is in cache
-        object = m_cache.fetch (hash);
-        if (object || m_negCache.touch_if_exists (hash))
-            return true;
+        // See if the object is in cache. This isn't the request
+        // for the object, so it doesn't count as one.
+        object = m_cache.peek (hash);
+        bool const done = object || m_negCache.touch_if_exists (hash);
 
+        if (! done)
         {
             // No. Post a read
             std::lock_guard <std::mutex> lock (m_readLock);
@@ -124,7 +140,12 @@ public:
                 m_readCondVar.notify_one ();
         }
 
-        return false;
+        if (m_trace)
+            m_trace->fetch (hash, object ?
+                static_cast <std::uint32_t> (object->getData().size()) : 0,
+                    true);
+
+        return done;
     }
 
     void waitReads() override
@@ -135,12 +156,31 @@ public:
             // Wake in two generations
             std::uint64_t const wakeGeneration = m_readGen + 2;
 
-            while (!m_readShut && !m_readSet.empty () && (m_readGen < wakeGeneration))
+            while (!m_readShut && (!m_readSet.empty () || m_readBusy != 0) &&
+                    (m_readGen < wakeGeneration))
                 m_readGenCondVar.wait (lock);
         }
 
     }
 
+    void waitReads (std::vector <uint256> const& hashes) override
+    {
+        std::unique_lock <std::mutex> lock (m_readLock);
+
+        auto const pending = [this, &hashes]
+        {
+            for (auto const& hash : hashes)
+            {
+                if (m_readSet.count (hash) || m_reading.count (hash))
+                    return true;
+            }
+            return false;
+        };
+
+        while (!m_readShut && pending ())
+            m_readGenCondVar.wait (lock);
+    }
+
     int getDesiredAsyncReadCount () override
     {
         // We prefer a client not fill our cache
@@ -151,7 +191,12 @@ public:
 
     std::shared_ptr<NodeObject> fetch (uint256 const& hash) override
     {
-        return doTimedFetch (hash, false);
+        auto object = doTimedFetch (hash, false);
+        if (m_trace)
+            m_trace->fetch (hash, object ?
+                static_cast <std::uint32_t> (object->getData().size()) : 0,
+                    false);
+        return object;
     }
 
     /** Perform a fetch and report the time it took */
@@ -174,9 +219,11 @@ public:
 
     std::shared_ptr<NodeObject> doFetch (uint256 const& hash, FetchReport &report)
     {
-        // See if the object already exists in the cache
+        // See if the object already exists in the cache. Reads made
+        // ahead of a request aren't counted as requests themselves.
         //
-        std::shared_ptr<NodeObject> obj = m_cache.fetch (hash);
+        std::shared_ptr<NodeObject> obj = report.isAsync ?
+            m_cache.peek (hash) : m_cache.fetch (hash);
 
         if (obj != nullptr)
             return obj;
@@ -198,6 +245,51 @@ public:
             ++m_fetchTotalCount;
         }
 
+        return canonicalizeFetched (hash, std::move (obj));
+    }
+
+    /** Fetch a batch of objects read ahead of a request.
+        Objects that are already cached, or known to be missing, are
+        not read again. The backend is asked for the rest at once.
+    */
+    void doBatchFetch (std::vector <uint256> const& hashes)
+    {
+        std::vector <uint256> wanted;
+        wanted.reserve (hashes.size ());
+        for (auto const& hash : hashes)
+        {
+            if (! m_cache.peek (hash) && ! m_negCache.touch_if_exists (hash))
+                wanted.push_back (hash);
+        }
+
+        if (wanted.empty ())
+            return;
+
+        auto const before = std::chrono::steady_clock::now();
+        auto objects = fetchBatchFrom (wanted);
+        auto const elapsed = std::chrono::duration_cast <
+            std::chrono::milliseconds> (std::chrono::steady_clock::now() - before);
+        m_fetchTotalCount += wanted.size ();
+
+        for (std::size_t i = 0; i < wanted.size (); ++i)
+        {
+            FetchReport report;
+            report.isAsync = true;
+            report.wentToDisk = true;
+            report.elapsed = elapsed / wanted.size ();
+
+            auto const obj = canonicalizeFetched (
+                wanted[i], std::move (objects[i]));
+
+            report.wasFound = (obj != nullptr);
+            m_scheduler.onFetch (report);
+        }
+    }
+
+    /** Share an object read from the database with other threads. */
+    std::shared_ptr<NodeObject> canonicalizeFetched (uint256 const& hash,
+        std::shared_ptr<NodeObject> obj)
+    {
         if (obj == nullptr)
         {
 
@@ -230,6 +322,43 @@ public:
         return fetchInternal (*m_backend, hash);
     }
 
+    virtual std::vector <std::shared_ptr<NodeObject>> fetchBatchFrom (
+        std::vector <uint256> const& hashes)
+    {
+        return fetchBatchInternal (*m_backend, hashes);
+    }
+
+    std::vector <std::shared_ptr<NodeObject>> fetchBatchInternal (
+        Backend& backend, std::vector <uint256> const& hashes)
+    {
+        std::vector <std::shared_ptr<NodeObject>> objects;
+
+        if (! backend.canFetchBatch ())
+        {
+            objects.reserve (hashes.size ());
+            for (auto const& hash : hashes)
+                objects.push_back (fetchInternal (backend, hash));
+            return objects;
+        }
+
+        std::vector <void const*> keys;
+        keys.reserve (hashes.size ());
+        for (auto const& hash : hashes)
+            keys.push_back (hash.begin ());
+
+        objects = backend.fetchBatch (keys.size (), keys.data ());
+        for (auto const& object : objects)
+        {
+            if (object)
+            {
+                ++m_fetchHitCount;
+                m_fetchSize += object->getData().size();
+            }
+        }
+
+        return objects;
+    }
+
     std::shared_ptr<NodeObject> fetchInternal (Backend& backend,
         uint256 const& hash)
     {
@@ -280,6 +409,10 @@ public:
         assert (hash == sha512Hash(makeSlice(data)));
         #endif
 
+        if (m_trace)
+            m_trace->store (type, hash,
+                static_cast <std::uint32_t> (data.size()));
+
         std::shared_ptr<NodeObject> object = NodeObject::createObject(
             type, std::move(data), hash);
 
@@ -300,6 +433,11 @@ public:
         return m_cache.getHitRate ();
     }
 
+    CachePolicy getCachePolicy () const override
+    {
+        return m_cache.policy ();
+    }
+
     void tune (int size, int age) override
     {
         m_cache.setTargetSize (size);
@@ -308,8 +446,25 @@ public:
         m_negCache.setTargetAge (age);
     }
 
+    void setCacheBytes (std::size_t bytes) override
+    {
+        m_cacheBytes = bytes;
+        applyCacheBytes ();
+    }
+
+    std::size_t getCacheBytes () const override
+    {
+        return m_cache.getCacheBytes ();
+    }
+
+    std::size_t getFilterBytes () const override
+    {
+        return 0;
+    }
+
     void sweep () override
     {
+        applyCacheBytes ();
         m_cache.sweep ();
         m_negCache.sweep ();
     }
@@ -319,19 +474,36 @@ public:
         return m_backend->getWriteLoad();
     }
 
+    bool isWriteBacklogged() const override
+    {
+        return m_backend->isBacklogged();
+    }
+
     //------------------------------------------------------------------------------
 
     // Entry point for async read threads
     void threadEntry ()
     {
         beast::setCurrentThreadName ("prefetch");
+
+        std::vector <uint256> hashes;
+        hashes.reserve (asyncReadBatchSize);
+
         while (1)
         {
-            uint256 hash;
-
             {
                 std::unique_lock <std::mutex> lock (m_readLock);
 
+                if (! hashes.empty ())
+                {
+                    // The previous reads are done
+                    --m_readBusy;
+                    for (auto const& hash : hashes)
+                        m_reading.erase (m_reading.find (hash));
+                    hashes.clear ();
+                    m_readGenCondVar.notify_all ();
+                }
+
                 while (!m_readShut && m_readSet.empty ())
                 {
                     // all work is done
@@ -342,24 +514,42 @@ public:
                 if (m_readShut)
                     break;
 
+                // Share the pending reads between the threads, so a
+                // short queue isn't drained by a single one
+                std::size_t const batch = std::min <std::size_t> (
+                    asyncReadBatchSize, std::max <std::size_t> (1,
+                        m_readSet.size () / m_readThreadCount));
+
                 // Read in key order to make the back end more efficient
                 std::set <uint256>::iterator it = m_readSet.lower_bound (m_readLast);
-                if (it == m_readSet.end ())
+                while (hashes.size () < batch)
                 {
-                    it = m_readSet.begin ();
+                    if (it == m_readSet.end ())
+                    {
+                        // Finish this pass before starting the next
+                        if (! hashes.empty ())
+                            break;
 
-                    // A generation has completed
-                    ++m_readGen;
-                    m_readGenCondVar.notify_all ();
-                }
+                        it = m_readSet.begin ();
+
+                        // A generation has completed
+                        ++m_readGen;
+                        m_readGenCondVar.notify_all ();
+                    }
 
-                hash = *it;
-                m_readSet.erase (it);
-                m_readLast = hash;
+                    hashes.push_back (*it);
+                    it = m_readSet.erase (it);
+                }
+                m_readLast = hashes.back ();
+                m_reading.insert (hashes.begin (), hashes.end ());
+                ++m_readBusy;
             }
 
-            // Perform the read
-            doTimedFetch (hash, true);
+            // Perform the reads
+            if (hashes.size () == 1)
+                doTimedFetch (hashes.front (), true);
+            else
+                doBatchFetch (hashes);
          }
      }
 
@@ -370,33 +560,316 @@ public:
         m_backend->for_each (f);
     }
 
-    void import (Database& source) override
+    using Database::import;
+
+    void import (Database& source, ImportOptions const& options) override
     {
-        importInternal (source, *m_backend.get());
+        importInternal (source, *m_backend.get(), options);
     }
 
-    void importInternal (Database& source, Backend& dest)
+    /** Copy every object of a database into a backend.
+
+        The source is read on this thread, in batches handed to the
+        writer threads through a bounded queue. Batches may complete out
+        of order, so the checkpoint records the objects up to the first
+        batch still being written, and the key of the last of them.
+        Reading the source again from the start then skips as many
+        objects as the checkpoint records.
+
+        Skipping by count relies on the source visiting its objects in
+        the same order each time. The last object skipped must have the
+        recorded key; if it does not, the source is read again from the
+        start and every object is imported.
+
+        A fresh import into an empty backend that supports bulk builds
+        writes no checkpoints: nothing is kept if it is interrupted, so
+        the next run starts again from the beginning.
+    */
+    void importInternal (Database& source, Backend& dest,
+        ImportOptions const& options)
     {
+        using clock_type = std::chrono::steady_clock;
+
+        auto const sourceName = source.getName ();
+        auto const checkpoint =
+            readCheckpoint (options.checkpoint, sourceName);
+        std::uint64_t resume = checkpoint.count;
+        if (resume != 0)
+        {
+            JLOG(m_journal.warn()) << "Import resuming after " <<
+                resume << " objects";
+        }
+
+        bool const bulk = resume == 0 && dest.beginBulk ();
+        if (bulk)
+        {
+            JLOG(m_journal.warn()) << "Import using a bulk build of " <<
+                dest.getName ();
+        }
+
+        std::size_t const threads = std::max (options.writeThreads, 1);
+        std::size_t const maxQueued = 4 * threads;
+
+        std::mutex m;
+        std::condition_variable cond;
+        std::deque <std::pair <std::uint64_t, Batch>> queue;
+        bool done = false;
+        std::exception_ptr error;
+
+        // The completed batches past the first one still being written,
+        // with the number of objects and the key of the last object
+        // imported once each is done.
+        std::map <std::uint64_t, Checkpoint> completed;
+        std::uint64_t imported = resume;
+        uint256 importedKey = checkpoint.key;
+        std::uint64_t bytes = 0;
+
+        auto writer = [&]
+        {
+            for (;;)
+            {
+                std::pair <std::uint64_t, Batch> work;
+                {
+                    std::unique_lock <std::mutex> lock (m);
+                    cond.wait (lock,
+                        [&]{ return done || ! queue.empty (); });
+                    if (queue.empty ())
+                        return;
+                    work = std::move (queue.front ());
+                    queue.pop_front ();
+                }
+                cond.notify_all ();
+
+                std::uint64_t size = 0;
+                try
+                {
+                    if (threads == 1)
+                    {
+                        dest.storeBatch (work.second);
+                    }
+                    else
+                    {
+                        for (auto const& object : work.second)
+                            dest.store (object);
+                    }
+                    for (auto const& object : work.second)
+                        size += object->getData ().size ();
+                }
+                catch (...)
+                {
+                    std::lock_guard <std::mutex> lock (m);
+                    if (! error)
+                        error = std::current_exception ();
+                    done = true;
+                    queue.clear ();
+                    cond.notify_all ();
+                    return;
+                }
+
+                m_storeCount += work.second.size ();
+                m_storeSize += size;
+
+                std::lock_guard <std::mutex> lock (m);
+                bytes += size;
+                completed[work.first] = { work.first + work.second.size (),
+                    work.second.back ()->getHash () };
+                for (auto it = completed.begin (); it != completed.end () &&
+                    it->first == imported; it = completed.erase (it))
+                {
+                    imported = it->second.count;
+                    importedKey = it->second.key;
+                }
+            }
+        };
+
+        std::vector <std::thread> workers;
+        for (std::size_t i = 0; i < threads; ++i)
+            workers.emplace_back (writer);
+
+        auto const start = clock_type::now ();
+        auto nextReport = start + options.reportInterval;
+        std::uint64_t reportedCheckpoint = resume;
+        Checkpoint lastCheckpoint = checkpoint;
+
+        // Called with the lock held
+        auto const report = [&]
+        {
+            auto const elapsed = std::max (0.001,
+                std::chrono::duration_cast <std::chrono::duration <double>> (
+                    clock_type::now () - start).count ());
+            JLOG(m_journal.warn()) << "Import progress: " <<
+                imported << " objects, " <<
+                static_cast <std::uint64_t> (
+                    (imported - resume) / elapsed) << " objects/sec, " <<
+                static_cast <std::uint64_t> (bytes / elapsed) <<
+                " bytes/sec";
+
+            // Record the previous count, so that objects the backend
+            // has yet to flush are written again after a crash
+            if (! bulk && ! options.checkpoint.empty () &&
+                lastCheckpoint.count != reportedCheckpoint)
+            {
+                writeCheckpoint (options.checkpoint, sourceName,
+                    lastCheckpoint);
+                reportedCheckpoint = lastCheckpoint.count;
+            }
+            lastCheckpoint = { imported, importedKey };
+        };
+
+        std::uint64_t read = 0;
         Batch b;
         b.reserve (batchWritePreallocationSize);
 
-        source.for_each ([&](std::shared_ptr<NodeObject> object)
+        auto const push = [&]
         {
-            if (b.size() >= batchWritePreallocationSize)
+            std::unique_lock <std::mutex> lock (m);
+            cond.wait (lock,
+                [&]{ return done || queue.size () < maxQueued; });
+            if (done)
+                Throw<std::runtime_error> ("import writer failed");
+            queue.emplace_back (read - b.size (), std::move (b));
+            cond.notify_all ();
+
+            if (clock_type::now () >= nextReport)
             {
-                dest.storeBatch (b);
-                b.clear();
-                b.reserve (batchWritePreallocationSize);
+                report ();
+                nextReport += options.reportInterval;
             }
 
-            b.push_back (object);
-            ++m_storeCount;
-            if (object)
-                m_storeSize += object->getData().size();
-        });
+            b.clear ();
+            b.reserve (batchWritePreallocationSize);
+        };
+
+        // Thrown when the source's order differs from the checkpoint's
+        struct OrderChanged { };
+
+        try
+        {
+            auto const visit = [&](std::shared_ptr<NodeObject> object)
+            {
+                // Objects imported by an interrupted run are skipped
+                if (++read <= resume)
+                {
+                    if (read == resume && object->getHash () != checkpoint.key)
+                        throw OrderChanged ();
+                    return;
+                }
+
+                b.push_back (std::move (object));
+                if (b.size () >= batchWritePreallocationSize)
+                    push ();
+            };
+
+            try
+            {
+                source.for_each (visit);
+            }
+            catch (OrderChanged const&)
+            {
+                JLOG(m_journal.warn()) << "Import source order differs "
+                    "from the checkpoint, importing every object";
+                {
+                    // Nothing was queued while skipping
+                    std::lock_guard <std::mutex> lock (m);
+                    resume = 0;
+                    imported = 0;
+                    importedKey.zero ();
+                    reportedCheckpoint = 0;
+                    lastCheckpoint = {};
+                }
+                read = 0;
+                source.for_each (visit);
+            }
+
+            if (! b.empty ())
+                push ();
+        }
+        catch (...)
+        {
+            std::lock_guard <std::mutex> lock (m);
+            if (! error)
+                error = std::current_exception ();
+        }
+
+        {
+            std::lock_guard <std::mutex> lock (m);
+            done = true;
+        }
+        cond.notify_all ();
+        for (auto& w : workers)
+            w.join ();
+
+        if (error)
+            std::rethrow_exception (error);
+
+        if (bulk)
+        {
+            JLOG(m_journal.warn()) << "Import indexing " << imported <<
+                " objects";
+            dest.endBulk (static_cast<int>(threads));
+        }
+
+        report ();
+        if (! options.checkpoint.empty ())
+        {
+            boost::system::error_code ec;
+            boost::filesystem::remove (options.checkpoint, ec);
+        }
+    }
+
+    // The objects imported from a source by an earlier run
+    struct Checkpoint
+    {
+        std::uint64_t count = 0;
+
+        // The key of the last object imported
+        uint256 key;
+    };
+
+    Checkpoint readCheckpoint (std::string const& path,
+        std::string const& sourceName)
+    {
+        if (path.empty () || ! boost::filesystem::exists (path))
+            return {};
+
+        std::ifstream ifs (path);
+        std::string name;
+        std::string key;
+        Checkpoint checkpoint;
+        if (! std::getline (ifs, name) || ! (ifs >> checkpoint.count) ||
+            ! (ifs >> key) || ! checkpoint.key.SetHexExact (key))
+        {
+            JLOG(m_journal.warn()) << "Ignoring unreadable import "
+                "checkpoint " << path;
+            return {};
+        }
 
-        if (! b.empty())
-            dest.storeBatch (b);
+        if (name != sourceName)
+        {
+            JLOG(m_journal.warn()) << "Ignoring import checkpoint " <<
+                path << " of '" << name << "'";
+            return {};
+        }
+        return checkpoint;
+    }
+
+    void writeCheckpoint (std::string const& path,
+        std::string const& sourceName, Checkpoint const& checkpoint)
+    {
+        auto const temp = path + ".tmp";
+        {
+            std::ofstream ofs (temp, std::ios::trunc);
+            ofs << sourceName << '\n' << checkpoint.count << '\n' <<
+                to_string (checkpoint.key) << '\n';
+            if (! ofs)
+            {
+                JLOG(m_journal.warn()) << "Unable to write import "
+                    "checkpoint " << temp;
+                return;
+            }
+        }
+        boost::system::error_code ec;
+        boost::filesystem::rename (temp, path, ec);
     }
 
     std::uint32_t getStoreCount () const override
@@ -429,6 +902,16 @@ public:
         return fdlimit_;
     }
 
+    void setTrace (std::unique_ptr <TraceWriter> trace) override
+    {
+        if (trace)
+        {
+            JLOG(m_journal.warn()) << "Tracing " << getName () <<
+                " to " << trace->path ();
+        }
+        m_trace = std::move (trace);
+    }
+
     //--------------------------------------------------------------------------
     //
     // Stoppable.
@@ -457,6 +940,19 @@ protected:
         for (auto& e : m_readThreads)
             e.join();
     }
+
+private:
+    // Give the cache what the filters leave of the limit, but never
+    // zero, which would lift the limit.
+    void applyCacheBytes ()
+    {
+        auto const bytes = m_cacheBytes.load ();
+        if (bytes == 0)
+            return;
+
+        auto const filters = getFilterBytes ();
+        m_cache.setTargetBytes (bytes > filters ? bytes - filters : 1);
+    }
 };
 
 }
@@ -31,25 +31,206 @@ std::shared_ptr <Backend> DatabaseRotatingImp::rotateBackends (
     archiveBackend_ = writableBackend_;
     writableBackend_ = newBackend;
 
+    // The new backend starts out empty, so every key written to it
+    // is known
+    archiveFilter_ = std::move (writableFilter_);
+    writableFilter_ = std::make_shared <KeyFilter> (keyFilterInitialKeys);
+
     return oldBackend;
 }
 
-std::shared_ptr<NodeObject> DatabaseRotatingImp::fetchFrom (uint256 const& hash)
+void
+DatabaseRotatingImp::writeBatch (Batch const& batch)
+{
+    Backends b = getBackends();
+    if (b.writableFilter)
+    {
+        for (auto const& object : batch)
+            b.writableFilter->insert (object->getHash ());
+    }
+    b.writableBackend->storeBatch (batch);
+}
+
+void
+DatabaseRotatingImp::store (NodeObjectType type,
+    Blob&& data, uint256 const& hash)
+{
+    Backends b = getBackends();
+    if (b.writableFilter)
+        b.writableFilter->insert (hash);
+    storeInternal (type, std::move (data), hash, *b.writableBackend);
+}
+
+void
+DatabaseRotatingImp::import (Database& source,
+    ImportOptions const& options)
+{
+    Backends b = getBackends();
+    importInternal (source, *b.writableBackend, options);
+
+    // The imported keys are unknown to the filter
+    std::lock_guard <std::mutex> lock (rotateMutex_);
+    if (writableFilter_ == b.writableFilter)
+        writableFilter_.reset ();
+}
+
+std::shared_ptr<NodeObject>
+DatabaseRotatingImp::fetchFrom (uint256 const& hash)
+{
+    return fetchRotating (hash, false);
+}
+
+std::shared_ptr<NodeObject>
+DatabaseRotatingImp::fetchRotating (uint256 const& hash, bool promoteNow)
 {
     Backends b = getBackends();
-    std::shared_ptr<NodeObject> object = fetchInternal (*b.writableBackend, hash);
-    if (!object)
+    std::shared_ptr<NodeObject> object;
+    if (! b.writableFilter || b.writableFilter->mayContain (hash))
+        object = fetchInternal (*b.writableBackend, hash);
+
+    if (!object && (! b.archiveFilter || b.archiveFilter->mayContain (hash)))
     {
         object = fetchInternal (*b.archiveBackend, hash);
         if (object)
         {
-            getWritableBackend()->store (object);
+            if (promoteNow)
+                writeBatch (Batch {object});
+            else
+                promoted_.store (object);
             m_negCache.erase (hash);
         }
     }
 
     return object;
 }
+
+std::size_t
+DatabaseRotatingImp::copyNodes (std::vector <uint256> const& hashes)
+{
+    Backends b = getBackends();
+
+    // Only the keys the writable backend may have need to be read
+    std::vector <uint256> missing;
+    std::vector <uint256> wanted;
+    for (auto const& hash : hashes)
+    {
+        if (! b.writableFilter || b.writableFilter->mayContain (hash))
+            wanted.push_back (hash);
+        else
+            missing.push_back (hash);
+    }
+
+    auto const objects = fetchBatchInternal (*b.writableBackend, wanted);
+    for (std::size_t i = 0; i < objects.size (); ++i)
+    {
+        if (! objects[i])
+            missing.push_back (wanted[i]);
+    }
+
+    if (missing.empty ())
+        return 0;
+
+    Batch batch;
+    batch.reserve (missing.size ());
+    for (auto& object : fetchBatchInternal (*b.archiveBackend, missing))
+    {
+        if (object)
+        {
+            m_negCache.erase (object->getHash ());
+            batch.push_back (std::move (object));
+        }
+    }
+
+    if (! batch.empty ())
+    {
+        if (b.writableFilter)
+        {
+            for (auto const& object : batch)
+                b.writableFilter->insert (object->getHash ());
+        }
+        b.writableBackend->storeBatch (batch);
+    }
+
+    return batch.size ();
+}
+
+std::vector <std::shared_ptr<NodeObject>>
+DatabaseRotatingImp::fetchBatchFrom (std::vector <uint256> const& hashes)
+{
+    Backends b = getBackends();
+
+    std::vector <std::shared_ptr<NodeObject>> objects (hashes.size ());
+    std::vector <uint256> missing;
+    std::vector <std::size_t> index;
+
+    // Read the writable backend for the keys it may have
+    {
+        std::vector <uint256> wanted;
+        std::vector <std::size_t> wantedIndex;
+        for (std::size_t i = 0; i < hashes.size (); ++i)
+        {
+            if (! b.writableFilter || b.writableFilter->mayContain (hashes[i]))
+            {
+                wanted.push_back (hashes[i]);
+                wantedIndex.push_back (i);
+            }
+            else
+            {
+                missing.push_back (hashes[i]);
+                index.push_back (i);
+            }
+        }
+
+        if (! wanted.empty ())
+        {
+            auto found = fetchBatchInternal (*b.writableBackend, wanted);
+            for (std::size_t i = 0; i < found.size (); ++i)
+            {
+                if (found[i])
+                {
+                    objects[wantedIndex[i]] = std::move (found[i]);
+                }
+                else
+                {
+                    missing.push_back (wanted[i]);
+                    index.push_back (wantedIndex[i]);
+                }
+            }
+        }
+    }
+
+    // Look for the rest in the archive
+    if (b.archiveFilter)
+    {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < missing.size (); ++i)
+        {
+            if (b.archiveFilter->mayContain (missing[i]))
+            {
+                missing[n] = missing[i];
+                index[n++] = index[i];
+            }
+        }
+        missing.resize (n);
+        index.resize (n);
+    }
+
+    if (missing.empty ())
+        return objects;
+
+    auto archived = fetchBatchInternal (*b.archiveBackend, missing);
+    for (std::size_t i = 0; i < archived.size (); ++i)
+    {
+        if (archived[i])
+        {
+            promoted_.store (archived[i]);
+            m_negCache.erase (missing[i]);
+            objects[index[i]] = std::move (archived[i]);
+        }
+    }
+
+    return objects;
 }
 
 }
+}
@@ -20,7 +20,9 @@
 #ifndef RIPPLE_NODESTORE_DATABASEROTATINGIMP_H_INCLUDED
 #define RIPPLE_NODESTORE_DATABASEROTATINGIMP_H_INCLUDED
 
+#include <ripple/nodestore/impl/BatchWriter.h>
 #include <ripple/nodestore/impl/DatabaseImp.h>
+#include <ripple/nodestore/impl/KeyFilter.h>
 #include <ripple/nodestore/DatabaseRotating.h>
 
 namespace ripple {
@@ -29,23 +31,41 @@ namespace NodeStore {
 class DatabaseRotatingImp
     : public DatabaseImp
     , public DatabaseRotating
+    , private BatchWriter::Callback
 {
 private:
     std::shared_ptr <Backend> writableBackend_;
     std::shared_ptr <Backend> archiveBackend_;
+
+    // The keys written to each backend, if it was created empty by a
+    // rotation. Backends without a filter are always read.
+    std::shared_ptr <KeyFilter> writableFilter_;
+    std::shared_ptr <KeyFilter> archiveFilter_;
     mutable std::mutex rotateMutex_;
 
     struct Backends {
-        std::shared_ptr <Backend> const& writableBackend;
-        std::shared_ptr <Backend> const& archiveBackend;
+        std::shared_ptr <Backend> writableBackend;
+        std::shared_ptr <Backend> archiveBackend;
+        std::shared_ptr <KeyFilter> writableFilter;
+        std::shared_ptr <KeyFilter> archiveFilter;
     };
 
     Backends getBackends() const
     {
         std::lock_guard <std::mutex> lock (rotateMutex_);
-        return Backends {writableBackend_, archiveBackend_};
+        return Backends {writableBackend_, archiveBackend_,
+            writableFilter_, archiveFilter_};
     }
 
+    // Objects found in the archive, written back in the background.
+    // Declared last so pending writes finish before the rest goes.
+    BatchWriter mutable promoted_;
+
+    void writeBatch (Batch const& batch) override;
+
+    std::shared_ptr<NodeObject> fetchRotating (
+        uint256 const& hash, bool promoteNow);
+
 public:
     DatabaseRotatingImp (std::string const& name,
                  Scheduler& scheduler,
@@ -53,6 +73,7 @@ public:
                  Stoppable& parent,
                  std::shared_ptr <Backend> writableBackend,
                  std::shared_ptr <Backend> archiveBackend,
+                 CachePolicy cachePolicy,
                  beast::Journal journal)
             : DatabaseImp (
                 name,
@@ -60,9 +81,11 @@ public:
                 readThreads,
                 parent,
                 std::unique_ptr <Backend>(),
+                cachePolicy,
                 journal)
             , writableBackend_ (writableBackend)
             , archiveBackend_ (archiveBackend)
+            , promoted_ (*this, scheduler)
     {}
 
     ~DatabaseRotatingImp () override
@@ -97,7 +120,14 @@ public:
 
     std::int32_t getWriteLoad() const override
     {
-        return getWritableBackend()->getWriteLoad();
+        return getWritableBackend()->getWriteLoad() +
+            promoted_.getWriteLoad();
+    }
+
+    bool isWriteBacklogged() const override
+    {
+        return getWritableBackend()->isBacklogged() ||
+            promoted_.isBacklogged();
     }
 
     void for_each (std::function <void(std::shared_ptr<NodeObject>)> f) override
@@ -107,29 +137,36 @@ public:
         b.writableBackend->for_each (f);
     }
 
-    void import (Database& source) override
-    {
-        importInternal (source, *getWritableBackend());
-    }
+    using Database::import;
+
+    void import (Database& source,
+                 ImportOptions const& options) override;
 
     void store (NodeObjectType type,
                 Blob&& data,
-                uint256 const& hash) override
-    {
-        storeInternal (type, std::move(data), hash,
-                *getWritableBackend());
-    }
+                uint256 const& hash) override;
 
     std::shared_ptr<NodeObject> fetchNode (uint256 const& hash) override
     {
-        return fetchFrom (hash);
+        return fetchRotating (hash, true);
     }
 
+    std::size_t copyNodes (std::vector <uint256> const& hashes) override;
+
     std::shared_ptr<NodeObject> fetchFrom (uint256 const& hash) override;
-    TaggedCache <uint256, NodeObject>& getPositiveCache() override
+    std::vector <std::shared_ptr<NodeObject>> fetchBatchFrom (
+        std::vector <uint256> const& hashes) override;
+    ShardedTaggedCache <uint256, NodeObject>& getPositiveCache() override
     {
         return m_cache;
     }
+
+    std::size_t getFilterBytes () const override
+    {
+        Backends b = getBackends();
+        return (b.writableFilter ? b.writableFilter->size () : 0) +
+            (b.archiveFilter ? b.archiveFilter->size () : 0);
+    }
 };
 
 }
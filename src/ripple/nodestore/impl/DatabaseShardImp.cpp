@@ -0,0 +1,330 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <ripple/nodestore/impl/DatabaseShardImp.h>
+#include <ripple/basics/contract.h>
+#include <ripple/basics/Log.h>
+#include <ripple/beast/core/LexicalCast.h>
+#include <thread>
+
+namespace ripple {
+namespace NodeStore {
+
+DatabaseShardImp::DatabaseShardImp (std::string const& name,
+        Scheduler& scheduler, int readThreads, Stoppable& parent,
+            Section const& config, beast::Journal journal)
+    : DatabaseImp (
+        name,
+        scheduler,
+        readThreads,
+        parent,
+        std::unique_ptr <Backend>(),
+        ripple::getCachePolicy (config),
+        journal)
+    , config_ (config)
+    , scheduler_ (scheduler)
+    , j_ (journal)
+    , dir_ (get<std::string> (config, "path"))
+    , ledgersPerShard_ (get<std::uint32_t> (
+        config, "ledgers_per_shard", 16384))
+{
+    using namespace boost::filesystem;
+
+    if (dir_.empty ())
+        Throw<std::runtime_error> ("shard database requires a path");
+    if (ledgersPerShard_ == 0)
+        Throw<std::runtime_error> ("ledgers_per_shard must be positive");
+
+    create_directories (dir_);
+
+    // Open the shards left by a previous run
+    for (auto const& entry : directory_iterator (dir_))
+    {
+        std::uint32_t shardIndex;
+        if (! is_directory (entry.status ()) ||
+            ! beast::lexicalCastChecked (
+                shardIndex, entry.path ().filename ().string ()))
+        {
+            continue;
+        }
+
+        shards_.emplace (shardIndex, std::make_shared <Shard> (
+            shardIndex, firstSeq (shardIndex), lastSeq (shardIndex),
+                entry.path (), config_, scheduler_, j_));
+    }
+
+    JLOG(j_.info()) <<
+        "opened " << shards_.size () << " shards in " << dir_.string () <<
+            ", complete: " << getCompleteShards ();
+}
+
+std::shared_ptr <Shard>
+DatabaseShardImp::findShard (std::uint32_t shardIndex) const
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    auto const it = shards_.find (shardIndex);
+    if (it == shards_.end ())
+        return {};
+    return it->second;
+}
+
+std::shared_ptr <Shard>
+DatabaseShardImp::getShard (std::uint32_t shardIndex)
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    auto& shard = shards_[shardIndex];
+    if (! shard)
+    {
+        JLOG(j_.debug()) << "creating shard " << shardIndex;
+        shard = std::make_shared <Shard> (
+            shardIndex, firstSeq (shardIndex), lastSeq (shardIndex),
+                dir_ / std::to_string (shardIndex), config_, scheduler_, j_);
+    }
+    return shard;
+}
+
+std::vector <std::shared_ptr <Shard>>
+DatabaseShardImp::getShards () const
+{
+    std::vector <std::shared_ptr <Shard>> shards;
+    std::lock_guard <std::mutex> lock (mutex_);
+    shards.reserve (shards_.size ());
+    for (auto it = shards_.rbegin (); it != shards_.rend (); ++it)
+        shards.push_back (it->second);
+    return shards;
+}
+
+std::shared_ptr<NodeObject>
+DatabaseShardImp::fetch (uint256 const& hash, std::uint32_t seq)
+{
+    auto const shard = findShard (seqToShardIndex (seq));
+    if (! shard)
+        return {};
+
+    return shard->withBackend (
+        [&](Backend& backend)
+        {
+            return fetchInternal (backend, hash);
+        });
+}
+
+void
+DatabaseShardImp::store (NodeObjectType type, Blob&& data,
+    uint256 const& hash, std::uint32_t seq)
+{
+    auto const shard = getShard (seqToShardIndex (seq));
+
+    // Complete shards are read only
+    if (shard->complete ())
+        return;
+
+    shard->withBackend (
+        [&](Backend& backend)
+        {
+            storeInternal (type, std::move (data), hash, backend);
+        });
+}
+
+void
+DatabaseShardImp::setStored (std::uint32_t seq)
+{
+    auto const shardIndex = seqToShardIndex (seq);
+    if (getShard (shardIndex)->setStored (seq))
+    {
+        JLOG(j_.info()) <<
+            "shard " << shardIndex << " is complete, ledgers " <<
+                firstSeq (shardIndex) << "-" << lastSeq (shardIndex);
+    }
+}
+
+bool
+DatabaseShardImp::contains (std::uint32_t seq)
+{
+    auto const shard = findShard (seqToShardIndex (seq));
+    return shard && shard->contains (seq);
+}
+
+std::string
+DatabaseShardImp::getCompleteShards ()
+{
+    RangeSet <std::uint32_t> complete;
+    for (auto const& shard : getShards ())
+    {
+        if (shard->complete ())
+            complete.insert (shard->index ());
+    }
+    return to_string (complete);
+}
+
+std::vector <std::uint32_t>
+DatabaseShardImp::validate (int threads)
+{
+    std::vector <std::shared_ptr <Shard>> shards;
+    for (auto& shard : getShards ())
+    {
+        if (shard->complete ())
+            shards.push_back (std::move (shard));
+    }
+
+    std::mutex m;
+    std::vector <std::uint32_t> failed;
+    std::atomic <std::size_t> next (0);
+
+    auto verify = [&]
+    {
+        for (std::size_t i = next++; i < shards.size (); i = next++)
+        {
+            if (! shards[i]->verify ())
+            {
+                std::lock_guard <std::mutex> lock (m);
+                failed.push_back (shards[i]->index ());
+            }
+        }
+    };
+
+    // Shards are independent so they are verified at the same time
+    std::vector <std::thread> workers;
+    auto const count = std::min <std::size_t> (
+        std::max (threads, 1), shards.size ());
+    for (std::size_t i = 1; i < count; ++i)
+        workers.emplace_back (verify);
+    verify ();
+    for (auto& w : workers)
+        w.join ();
+
+    std::sort (failed.begin (), failed.end ());
+    JLOG(j_.info()) <<
+        "verified " << shards.size () << " shards, " <<
+            failed.size () << " failed";
+    return failed;
+}
+
+bool
+DatabaseShardImp::removeShard (std::uint32_t shardIndex)
+{
+    std::shared_ptr <Shard> shard;
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        auto const it = shards_.find (shardIndex);
+        if (it == shards_.end ())
+            return false;
+        shard = std::move (it->second);
+        shards_.erase (it);
+    }
+
+    // The files go when the last user lets go of the shard
+    shard->setDeletePath ();
+    JLOG(j_.info()) << "removed shard " << shardIndex;
+    return true;
+}
+
+std::int32_t
+DatabaseShardImp::getWriteLoad () const
+{
+    std::int32_t load = 0;
+    for (auto const& shard : getShards ())
+    {
+        // A shard that was never opened has nothing to write
+        if (! shard->isOpen ())
+            continue;
+        load += shard->withBackend (
+            [](Backend& backend)
+            {
+                return backend.getWriteLoad ();
+            });
+    }
+    return load;
+}
+
+bool
+DatabaseShardImp::isWriteBacklogged () const
+{
+    for (auto const& shard : getShards ())
+    {
+        if (! shard->isOpen ())
+            continue;
+        bool const backlogged = shard->withBackend (
+            [](Backend& backend)
+            {
+                return backend.isBacklogged ();
+            });
+        if (backlogged)
+            return true;
+    }
+    return false;
+}
+
+int
+DatabaseShardImp::fdlimit () const
+{
+    int limit = 0;
+    for (auto const& shard : getShards ())
+        limit += shard->fdlimit ();
+    return limit;
+}
+
+void
+DatabaseShardImp::for_each (
+    std::function <void(std::shared_ptr<NodeObject>)> f)
+{
+    for (auto const& shard : getShards ())
+    {
+        shard->withBackend (
+            [&](Backend& backend)
+            {
+                backend.for_each (f);
+            });
+    }
+}
+
+std::shared_ptr<NodeObject>
+DatabaseShardImp::fetchFrom (uint256 const& hash)
+{
+    // Recent ledgers are the most likely to be asked for. Without
+    // the ledger, opening every shard to look would hold their files
+    // open for good, so only the open shards are searched.
+    for (auto const& shard : getShards ())
+    {
+        if (! shard->isOpen ())
+            continue;
+        auto object = shard->withBackend (
+            [&](Backend& backend)
+            {
+                return fetchInternal (backend, hash);
+            });
+        if (object)
+            return object;
+    }
+    return {};
+}
+
+std::vector <std::shared_ptr<NodeObject>>
+DatabaseShardImp::fetchBatchFrom (std::vector <uint256> const& hashes)
+{
+    std::vector <std::shared_ptr<NodeObject>> objects;
+    objects.reserve (hashes.size ());
+    for (auto const& hash : hashes)
+        objects.push_back (fetchFrom (hash));
+    return objects;
+}
+
+}
+}
@@ -0,0 +1,154 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#ifndef RIPPLE_NODESTORE_DATABASESHARDIMP_H_INCLUDED
+#define RIPPLE_NODESTORE_DATABASESHARDIMP_H_INCLUDED
+
+#include <ripple/nodestore/impl/DatabaseImp.h>
+#include <ripple/nodestore/impl/Shard.h>
+#include <ripple/nodestore/DatabaseShard.h>
+#include <map>
+
+namespace ripple {
+namespace NodeStore {
+
+class DatabaseShardImp
+    : public DatabaseImp
+    , public DatabaseShard
+{
+private:
+    Section const config_;
+    Scheduler& scheduler_;
+    beast::Journal j_;
+    boost::filesystem::path const dir_;
+    std::uint32_t const ledgersPerShard_;
+
+    std::mutex mutable mutex_;
+    std::map <std::uint32_t, std::shared_ptr <Shard>> shards_;
+
+    std::shared_ptr <Shard> findShard (std::uint32_t shardIndex) const;
+    std::shared_ptr <Shard> getShard (std::uint32_t shardIndex);
+
+    // The shards, newest first
+    std::vector <std::shared_ptr <Shard>> getShards () const;
+
+public:
+    DatabaseShardImp (std::string const& name,
+                      Scheduler& scheduler,
+                      int readThreads,
+                      Stoppable& parent,
+                      Section const& config,
+                      beast::Journal journal);
+
+    ~DatabaseShardImp () override
+    {
+        // Stop threads before data members are destroyed.
+        DatabaseImp::stopThreads ();
+    }
+
+    using DatabaseImp::fetch;
+
+    //--------------------------------------------------------------------------
+    //
+    // DatabaseShard
+
+    std::uint32_t ledgersPerShard () const override
+    {
+        return ledgersPerShard_;
+    }
+
+    std::uint32_t seqToShardIndex (std::uint32_t seq) const override
+    {
+        assert (seq != 0);
+        return (seq - 1) / ledgersPerShard_;
+    }
+
+    std::uint32_t firstSeq (std::uint32_t shardIndex) const override
+    {
+        return 1 + shardIndex * ledgersPerShard_;
+    }
+
+    std::uint32_t lastSeq (std::uint32_t shardIndex) const override
+    {
+        return (shardIndex + 1) * ledgersPerShard_;
+    }
+
+    std::shared_ptr<NodeObject> fetch (
+        uint256 const& hash, std::uint32_t seq) override;
+
+    void store (NodeObjectType type, Blob&& data,
+        uint256 const& hash, std::uint32_t seq) override;
+
+    void setStored (std::uint32_t seq) override;
+
+    bool contains (std::uint32_t seq) override;
+
+    std::string getCompleteShards () override;
+
+    std::vector <std::uint32_t> validate (int threads) override;
+
+    bool removeShard (std::uint32_t shardIndex) override;
+
+    //--------------------------------------------------------------------------
+    //
+    // Database
+
+    std::string getName () const override
+    {
+        return dir_.string ();
+    }
+
+    std::int32_t getWriteLoad () const override;
+
+    bool isWriteBacklogged () const override;
+
+    int fdlimit () const override;
+
+    void for_each (
+        std::function <void(std::shared_ptr<NodeObject>)> f) override;
+
+    using Database::import;
+
+    void import (Database& source,
+                 ImportOptions const& options) override
+    {
+        Throw<std::runtime_error> (
+            "a shard database can not import objects");
+    }
+
+    void store (NodeObjectType type,
+                Blob&& data,
+                uint256 const& hash) override
+    {
+        // Objects are routed to shards by ledger sequence
+        Throw<std::runtime_error> (
+            "a shard database requires the ledger sequence to store");
+    }
+
+    std::shared_ptr<NodeObject> fetchFrom (uint256 const& hash) override;
+
+    std::vector <std::shared_ptr<NodeObject>> fetchBatchFrom (
+        std::vector <uint256> const& hashes) override;
+};
+
+}
+}
+
+#endif
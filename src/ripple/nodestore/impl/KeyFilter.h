@@ -0,0 +1,185 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#ifndef RIPPLE_NODESTORE_KEYFILTER_H_INCLUDED
+#define RIPPLE_NODESTORE_KEYFILTER_H_INCLUDED
+
+#include <ripple/basics/base_uint.h>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+namespace ripple {
+namespace NodeStore {
+
+/** A bloom filter over the keys written to a backend.
+
+    A key the filter does not contain was never inserted, so a read
+    for it can be skipped. Keys are hashes already, their bits pick
+    the filter bits directly.
+
+    The filter grows as keys are inserted by adding segments, each
+    holding twice the keys of the last. A query checks every segment,
+    so each new segment uses one more hash and proportionally more
+    bits per key, halving its false positive rate. The first segment
+    gives about 0.3% and the rates sum to under 0.7% however many
+    segments there are, without knowing the number of keys ahead of
+    time. Once the last segment is added it takes every further key
+    and its rate rises as it overfills.
+
+    Insertions and queries may be made concurrently.
+*/
+class KeyFilter
+{
+private:
+    // Hashes used by the first segment, one more for each after it.
+    // With one and a half bits per key for each hash a segment's
+    // false positive rate is about 0.487 to the power of its hashes.
+    static std::size_t constexpr firstHashes = 8;
+    static std::size_t constexpr maxSegments = 24;
+
+    struct Segment
+    {
+        std::size_t const capacity;
+        std::size_t const hashes;
+        std::uint64_t const bits;
+        std::unique_ptr <std::atomic <std::uint64_t>[]> words;
+        std::atomic <std::size_t> count;
+
+        Segment (std::size_t capacity_, std::size_t index)
+            : capacity (capacity_)
+            , hashes (firstHashes + index)
+            , bits (capacity_ * hashes * 3 / 2)
+            , words (new std::atomic <std::uint64_t>[(bits + 63) / 64])
+            , count (0)
+        {
+            for (std::size_t i = 0; i < (bits + 63) / 64; ++i)
+                words[i].store (0, std::memory_order_relaxed);
+        }
+    };
+
+    std::array <std::unique_ptr <Segment>, maxSegments> segments_;
+    std::atomic <std::size_t> size_;
+    std::mutex mutex_;
+
+    // Derive the bits of a key from two independent words of it
+    template <class Function>
+    static
+    bool
+    forEachBit (Segment const& segment, uint256 const& key, Function f)
+    {
+        std::uint64_t h1;
+        std::uint64_t h2;
+        std::memcpy (&h1, key.begin (), sizeof (h1));
+        std::memcpy (&h2, key.begin () + sizeof (h1), sizeof (h2));
+        h2 |= 1;
+
+        for (std::size_t i = 0; i < segment.hashes; ++i)
+        {
+            auto const bit = (h1 + i * h2) % segment.bits;
+            if (! f (segment.words[bit / 64], std::uint64_t (1) << (bit % 64)))
+                return false;
+        }
+        return true;
+    }
+
+    Segment&
+    writableSegment ()
+    {
+        auto n = size_.load (std::memory_order_acquire);
+        auto* segment = segments_[n - 1].get ();
+        if (segment->count++ < segment->capacity || n == maxSegments)
+            return *segment;
+
+        std::lock_guard <std::mutex> lock (mutex_);
+        n = size_.load (std::memory_order_relaxed);
+        if (n < maxSegments && segments_[n - 1].get () == segment)
+        {
+            segments_[n] = std::make_unique <Segment> (
+                2 * segment->capacity, n);
+            size_.store (++n, std::memory_order_release);
+        }
+        segment = segments_[n - 1].get ();
+        ++segment->count;
+        return *segment;
+    }
+
+public:
+    explicit
+    KeyFilter (std::size_t initialKeys)
+        : size_ (1)
+    {
+        segments_[0] = std::make_unique <Segment> (
+            std::max <std::size_t> (initialKeys, 64), 0);
+    }
+
+    KeyFilter (KeyFilter const&) = delete;
+    KeyFilter& operator= (KeyFilter const&) = delete;
+
+    void
+    insert (uint256 const& key)
+    {
+        forEachBit (writableSegment (), key,
+            [](std::atomic <std::uint64_t>& word, std::uint64_t mask)
+            {
+                word.fetch_or (mask, std::memory_order_relaxed);
+                return true;
+            });
+    }
+
+    /** Returns `false` if the key was never inserted. */
+    bool
+    mayContain (uint256 const& key) const
+    {
+        auto const n = size_.load (std::memory_order_acquire);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (forEachBit (*segments_[i], key,
+                [](std::atomic <std::uint64_t> const& word,
+                    std::uint64_t mask)
+                {
+                    return (word.load (std::memory_order_relaxed) &
+                        mask) != 0;
+                }))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** The number of bytes used by the filter. */
+    std::size_t
+    size () const
+    {
+        std::size_t bytes = 0;
+        auto const n = size_.load (std::memory_order_acquire);
+        for (std::size_t i = 0; i < n; ++i)
+            bytes += (segments_[i]->bits + 63) / 64 * 8;
+        return bytes;
+    }
+};
+
+}
+}
+
+#endif
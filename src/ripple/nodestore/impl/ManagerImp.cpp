@@ -20,6 +20,7 @@
 #include <BeastConfig.h>
 #include <ripple/nodestore/impl/ManagerImp.h>
 #include <ripple/nodestore/impl/DatabaseRotatingImp.h>
+#include <ripple/nodestore/impl/DatabaseShardImp.h>
 
 namespace ripple {
 namespace NodeStore {
@@ -98,6 +99,7 @@ ManagerImp::make_Database (
             backendParameters,
             scheduler,
             journal),
+        getCachePolicy (backendParameters),
         journal);
 }
 
@@ -109,6 +111,7 @@ ManagerImp::make_DatabaseRotating (
         Stoppable& parent,
         std::shared_ptr <Backend> writableBackend,
         std::shared_ptr <Backend> archiveBackend,
+        CachePolicy cachePolicy,
         beast::Journal journal)
 {
     return std::make_unique <DatabaseRotatingImp> (
@@ -118,6 +121,25 @@ ManagerImp::make_DatabaseRotating (
         parent,
         writableBackend,
         archiveBackend,
+        cachePolicy,
+        journal);
+}
+
+std::unique_ptr <Database>
+ManagerImp::make_DatabaseShard (
+    std::string const& name,
+    Scheduler& scheduler,
+    int readThreads,
+    Stoppable& parent,
+    Section const& shardParameters,
+    beast::Journal journal)
+{
+    return std::make_unique <DatabaseShardImp> (
+        name,
+        scheduler,
+        readThreads,
+        parent,
+        shardParameters,
         journal);
 }
 
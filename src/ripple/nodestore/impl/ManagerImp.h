@@ -76,6 +76,16 @@ public:
         Stoppable& parent,
         std::shared_ptr <Backend> writableBackend,
         std::shared_ptr <Backend> archiveBackend,
+        CachePolicy cachePolicy,
+        beast::Journal journal) override;
+
+    std::unique_ptr <Database>
+    make_DatabaseShard (
+        std::string const& name,
+        Scheduler& scheduler,
+        int readThreads,
+        Stoppable& parent,
+        Section const& shardParameters,
         beast::Journal journal) override;
 };
 
@@ -0,0 +1,236 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <ripple/nodestore/impl/Shard.h>
+#include <ripple/nodestore/Manager.h>
+#include <ripple/basics/contract.h>
+#include <ripple/basics/Log.h>
+#include <ripple/beast/core/LexicalCast.h>
+#include <boost/algorithm/string.hpp>
+#include <fstream>
+
+namespace ripple {
+namespace NodeStore {
+
+static char const* const controlFileName = "control.txt";
+
+// Parse the styled string written by to_string(RangeSet)
+static
+RangeSet <std::uint32_t>
+parseRangeSet (std::string const& s)
+{
+    RangeSet <std::uint32_t> result;
+    if (s.empty () || s == "empty")
+        return result;
+
+    std::vector <std::string> intervals;
+    boost::split (intervals, s, boost::algorithm::is_any_of (","));
+    for (auto const& interval : intervals)
+    {
+        std::vector <std::string> bounds;
+        boost::split (bounds, interval, boost::algorithm::is_any_of ("-"));
+
+        std::uint32_t first;
+        std::uint32_t last;
+        if (bounds.size () == 1 &&
+            beast::lexicalCastChecked (first, bounds[0]))
+        {
+            last = first;
+        }
+        else if (bounds.size () != 2 ||
+            ! beast::lexicalCastChecked (first, bounds[0]) ||
+            ! beast::lexicalCastChecked (last, bounds[1]) ||
+            last < first)
+        {
+            Throw<std::runtime_error> (
+                "invalid shard control file: '" + s + "'");
+        }
+        result.insert (range (first, last));
+    }
+    return result;
+}
+
+Shard::Shard (std::uint32_t index, std::uint32_t firstSeq,
+    std::uint32_t lastSeq, boost::filesystem::path const& dir,
+        Section const& config, Scheduler& scheduler,
+            beast::Journal journal)
+    : index_ (index)
+    , firstSeq_ (firstSeq)
+    , lastSeq_ (lastSeq)
+    , dir_ (dir)
+    , config_ (config)
+    , scheduler_ (scheduler)
+    , j_ (journal)
+    , complete_ (false)
+    , deletePath_ (false)
+{
+    using namespace boost::filesystem;
+
+    create_directories (dir_);
+
+    auto const control = dir_ / controlFileName;
+    if (exists (control))
+    {
+        std::ifstream ifs (control.string ());
+        std::string s;
+        std::getline (ifs, s);
+        stored_ = parseRangeSet (boost::trim_copy (s));
+
+        if (! stored_.empty () && (boost::icl::first (stored_) < firstSeq_ ||
+            boost::icl::last (stored_) > lastSeq_))
+        {
+            Throw<std::runtime_error> (
+                "shard " + std::to_string (index_) +
+                    " stores ledgers out of its range");
+        }
+        complete_ = boost::icl::contains (
+            stored_, range (firstSeq_, lastSeq_));
+    }
+}
+
+Shard::~Shard ()
+{
+    backend_.reset ();
+
+    if (deletePath_)
+    {
+        boost::system::error_code ec;
+        boost::filesystem::remove_all (dir_, ec);
+        if (ec)
+        {
+            JLOG(j_.error()) <<
+                "shard " << index_ << ": unable to remove " <<
+                    dir_.string () << ": " << ec.message ();
+        }
+    }
+}
+
+void
+Shard::openBackend () const
+{
+    {
+        boost::shared_lock <boost::shared_mutex> lock (backendMutex_);
+        if (backend_)
+            return;
+    }
+
+    boost::unique_lock <boost::shared_mutex> lock (backendMutex_);
+    if (backend_)
+        return;
+
+    JLOG(j_.debug()) << "shard " << index_ << ": opening backend";
+    Section section (config_);
+    section.set ("path", dir_.string ());
+    backend_ = Manager::instance ().make_Backend (
+        section, scheduler_, j_);
+}
+
+bool
+Shard::isOpen () const
+{
+    boost::shared_lock <boost::shared_mutex> lock (backendMutex_);
+    return backend_ != nullptr;
+}
+
+int
+Shard::fdlimit () const
+{
+    boost::shared_lock <boost::shared_mutex> lock (backendMutex_);
+    return backend_ ? backend_->fdlimit () : 0;
+}
+
+bool
+Shard::complete () const
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    return complete_;
+}
+
+bool
+Shard::contains (std::uint32_t seq) const
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    return boost::icl::contains (stored_, seq);
+}
+
+bool
+Shard::setStored (std::uint32_t seq)
+{
+    assert (seq >= firstSeq_ && seq <= lastSeq_);
+
+    std::lock_guard <std::mutex> lock (mutex_);
+    if (complete_ || boost::icl::contains (stored_, seq))
+        return false;
+
+    stored_.insert (seq);
+    complete_ = boost::icl::contains (stored_, range (firstSeq_, lastSeq_));
+    saveControl ();
+    return complete_;
+}
+
+void
+Shard::saveControl ()
+{
+    // Write a new file then rename it, so the ledgers recorded
+    // survive a crash part way through
+    auto const control = dir_ / controlFileName;
+    auto const temp = dir_ / (std::string (controlFileName) + ".tmp");
+    {
+        std::ofstream ofs (temp.string (), std::ios::trunc);
+        ofs << to_string (stored_) << '\n';
+        if (! ofs)
+        {
+            Throw<std::runtime_error> (
+                "unable to write " + temp.string ());
+        }
+    }
+    boost::filesystem::rename (temp, control);
+}
+
+bool
+Shard::verify ()
+{
+    openBackend ();
+    boost::unique_lock <boost::shared_mutex> lock (backendMutex_);
+    try
+    {
+        backend_->verify ();
+    }
+    catch (std::exception const& e)
+    {
+        JLOG(j_.error()) <<
+            "shard " << index_ << " failed verification: " << e.what ();
+        return false;
+    }
+    return true;
+}
+
+void
+Shard::setDeletePath ()
+{
+    deletePath_ = true;
+    boost::unique_lock <boost::shared_mutex> lock (backendMutex_);
+    if (backend_)
+        backend_->setDeletePath ();
+}
+
+}
+}
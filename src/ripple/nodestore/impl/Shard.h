@@ -0,0 +1,131 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#ifndef RIPPLE_NODESTORE_SHARD_H_INCLUDED
+#define RIPPLE_NODESTORE_SHARD_H_INCLUDED
+
+#include <ripple/nodestore/Backend.h>
+#include <ripple/nodestore/Scheduler.h>
+#include <ripple/basics/BasicConfig.h>
+#include <ripple/basics/RangeSet.h>
+#include <ripple/beast/utility/Journal.h>
+#include <boost/filesystem.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <mutex>
+
+namespace ripple {
+namespace NodeStore {
+
+/* One shard of a DatabaseShard.
+
+   A shard owns the backend holding the objects of a fixed range of
+   ledgers, and a control file listing the ledgers stored so far. The
+   backend is kept in a directory of its own named after the shard index,
+   and is only opened once it is used.
+*/
+class Shard
+{
+private:
+    std::uint32_t const index_;
+    std::uint32_t const firstSeq_;
+    std::uint32_t const lastSeq_;
+    boost::filesystem::path const dir_;
+    Section const config_;
+    Scheduler& scheduler_;
+    beast::Journal j_;
+
+    // Held shared to use the backend, unique to open or verify it
+    boost::shared_mutex mutable backendMutex_;
+    std::unique_ptr <Backend> mutable backend_;
+
+    std::mutex mutable mutex_;
+    RangeSet <std::uint32_t> stored_;
+    bool complete_;
+    bool deletePath_;
+
+    void saveControl ();
+
+    // Opens the backend if it is not open yet
+    void openBackend () const;
+
+public:
+    Shard (std::uint32_t index, std::uint32_t firstSeq,
+        std::uint32_t lastSeq, boost::filesystem::path const& dir,
+            Section const& config, Scheduler& scheduler,
+                beast::Journal journal);
+
+    ~Shard ();
+
+    std::uint32_t
+    index () const
+    {
+        return index_;
+    }
+
+    /** Whether every ledger of the shard has been stored. */
+    bool
+    complete () const;
+
+    /** Whether a ledger of the shard has been stored. */
+    bool
+    contains (std::uint32_t seq) const;
+
+    /** Record that a ledger of the shard has been stored.
+        @return `true` if this completed the shard.
+    */
+    bool
+    setStored (std::uint32_t seq);
+
+    /** Call a function with the backend, opening it first if needed.
+        Waits while the backend is being verified.
+    */
+    template <class Function>
+    auto
+    withBackend (Function&& f) const -> decltype (f (*backend_))
+    {
+        openBackend ();
+        boost::shared_lock <boost::shared_mutex> lock (backendMutex_);
+        return f (*backend_);
+    }
+
+    /** Whether the backend has been opened. */
+    bool
+    isOpen () const;
+
+    /** Verify the backend.
+        @return `false` if the backend is damaged.
+    */
+    bool
+    verify ();
+
+    /** Remove the shard's files when it is destroyed. */
+    void
+    setDeletePath ();
+
+    /** The file descriptors the backend needs, or 0 if it is not open. */
+    int
+    fdlimit () const;
+};
+
+}
+}
+
+#endif
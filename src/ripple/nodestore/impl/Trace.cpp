@@ -0,0 +1,158 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <ripple/nodestore/Trace.h>
+#include <ripple/basics/contract.h>
+#include <array>
+#include <cstring>
+
+namespace ripple {
+namespace NodeStore {
+
+// A trace is this header followed by fixed size records
+static char const traceMagic[8] = { 'N', 'S', 'T', 'R', 'A', 'C', 'E', '1' };
+
+// op, type, size, time and hash
+static std::size_t const traceRecordSize = 1 + 1 + 4 + 8 + 32;
+
+template <class Int>
+static
+std::uint8_t*
+putInt (std::uint8_t* p, Int v)
+{
+    for (std::size_t i = 0; i < sizeof(Int); ++i)
+        *p++ = static_cast<std::uint8_t> (v >> (8 * i));
+    return p;
+}
+
+template <class Int>
+static
+std::uint8_t const*
+getInt (std::uint8_t const* p, Int& v)
+{
+    v = 0;
+    for (std::size_t i = 0; i < sizeof(Int); ++i)
+        v |= static_cast<Int> (*p++) << (8 * i);
+    return p;
+}
+
+//------------------------------------------------------------------------------
+
+TraceWriter::TraceWriter (std::string const& path)
+    : path_ (path)
+    , start_ (clock_type::now ())
+    , ofs_ (path, std::ios::binary | std::ios::trunc)
+{
+    ofs_.write (traceMagic, sizeof(traceMagic));
+    if (! ofs_)
+        Throw<std::runtime_error> (
+            "Unable to write the node store trace " + path);
+}
+
+TraceWriter::~TraceWriter ()
+{
+    flush ();
+}
+
+void
+TraceWriter::fetch (uint256 const& hash, std::uint32_t size, bool async)
+{
+    TraceRecord record;
+    record.op = async ? TraceRecord::Op::asyncFetch : TraceRecord::Op::fetch;
+    record.size = size;
+    record.hash = hash;
+    write (record);
+}
+
+void
+TraceWriter::store (NodeObjectType type, uint256 const& hash,
+    std::uint32_t size)
+{
+    TraceRecord record;
+    record.op = TraceRecord::Op::store;
+    record.type = type;
+    record.size = size;
+    record.hash = hash;
+    write (record);
+}
+
+void
+TraceWriter::flush ()
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    ofs_.flush ();
+}
+
+void
+TraceWriter::write (TraceRecord const& record)
+{
+    std::array<std::uint8_t, traceRecordSize> buf;
+    auto p = buf.data ();
+    *p++ = static_cast<std::uint8_t> (record.op);
+    *p++ = static_cast<std::uint8_t> (record.type);
+    p = putInt (p, record.size);
+
+    std::lock_guard<std::mutex> lock (mutex_);
+
+    // Taken under the lock, so the times never go backwards
+    auto const time = std::chrono::duration_cast<std::chrono::microseconds> (
+        clock_type::now () - start_);
+    p = putInt (p, static_cast<std::uint64_t> (time.count ()));
+    std::memcpy (p, record.hash.data (), record.hash.size ());
+
+    ofs_.write (reinterpret_cast<char const*> (buf.data ()), buf.size ());
+}
+
+//------------------------------------------------------------------------------
+
+TraceReader::TraceReader (std::string const& path)
+    : ifs_ (path, std::ios::binary)
+{
+    char magic[sizeof(traceMagic)];
+    if (! ifs_.read (magic, sizeof(magic)) ||
+        std::memcmp (magic, traceMagic, sizeof(magic)) != 0)
+        Throw<std::runtime_error> (
+            "Not a node store trace: " + path);
+}
+
+bool
+TraceReader::next (TraceRecord& record)
+{
+    std::array<std::uint8_t, traceRecordSize> buf;
+    if (! ifs_.read (reinterpret_cast<char*> (buf.data ()), buf.size ()))
+        return false;
+
+    std::uint8_t const* p = buf.data ();
+    auto const op = *p++;
+    if (op > static_cast<std::uint8_t> (TraceRecord::Op::store))
+        Throw<std::runtime_error> ("Corrupt node store trace");
+    record.op = static_cast<TraceRecord::Op> (op);
+    record.type = static_cast<NodeObjectType> (*p++);
+    p = getInt (p, record.size);
+    std::uint64_t time;
+    p = getInt (p, time);
+    record.time = std::chrono::microseconds (time);
+    std::memcpy (record.hash.data (), p, record.hash.size ());
+    return true;
+}
+
+}
+}
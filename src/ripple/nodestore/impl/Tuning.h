@@ -33,6 +33,25 @@ enum
 
     // Fraction of the cache one query source can take
     ,asyncDivider = 8
+
+    // Most keys a read thread takes from the queue at once
+    ,asyncReadBatchSize = 64
+
+    // Keys the first segment of a rotated backend's key filter holds
+    ,keyFilterInitialKeys = 1 << 20
+
+    // Fewest and most objects a batch writer hands the backend at once
+    ,batchWriteMinSize = 128
+    ,batchWriteMaxSize = 16384
+
+    // Milliseconds a batch write should take, used to size batches
+    ,batchWriteTargetMs = 100
+
+    // Batches of pending objects beyond which the writer is backlogged
+    ,batchWriteBacklogBatches = 8
+
+    // Milliseconds a small batch waits for more objects to arrive
+    ,batchWriteCoalesceMs = 2
 };
 
 }
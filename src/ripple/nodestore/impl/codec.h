@@ -22,6 +22,7 @@
 
 #include <ripple/basics/contract.h>
 #include <nudb/detail/field.hpp>
+#include <ripple/nodestore/impl/CodecDictionary.h>
 #include <ripple/nodestore/impl/varint.h>
 #include <ripple/nodestore/NodeObject.h>
 #include <ripple/protocol/HashPrefix.h>
@@ -128,6 +129,68 @@ lz4_compress (void const* in,
     return result;
 }
 
+template <class BufferFactory>
+std::pair<void const*, std::size_t>
+lz4_dict_decompress (void const* in, std::size_t in_size,
+    CodecDictionaries::Dictionary const& dictionary, BufferFactory&& bf)
+{
+    using namespace nudb::detail;
+    std::pair<void const*, std::size_t> result;
+    std::uint8_t const* p = reinterpret_cast<
+        std::uint8_t const*>(in);
+    auto const n = read_varint(
+        p, in_size, result.second);
+    if (n == 0)
+        Throw<std::runtime_error> (
+            "lz4 dict decompress: n == 0");
+    void* const out = bf(result.second);
+    result.first = out;
+    if (LZ4_decompress_safe_usingDict(
+        reinterpret_cast<char const*>(in) + n,
+            reinterpret_cast<char*>(out),
+                static_cast<int>(in_size - n),
+                    static_cast<int>(result.second),
+        reinterpret_cast<char const*>(dictionary.data.data()),
+            static_cast<int>(dictionary.data.size())) !=
+                static_cast<int>(result.second))
+        Throw<std::runtime_error> (
+            "lz4 dict decompress: LZ4_decompress_safe_usingDict");
+    return result;
+}
+
+template <class BufferFactory>
+std::pair<void const*, std::size_t>
+lz4_dict_compress (void const* in, std::size_t in_size,
+    CodecDictionaries::Dictionary const& dictionary, BufferFactory&& bf)
+{
+    using namespace nudb::detail;
+    std::pair<void const*, std::size_t> result;
+    std::array<std::uint8_t, varint_traits<
+        std::size_t>::max> vi;
+    auto const n = write_varint(
+        vi.data(), in_size);
+    auto const out_max =
+        LZ4_compressBound(in_size);
+    std::uint8_t* out = reinterpret_cast<
+        std::uint8_t*>(bf(n + out_max));
+    result.first = out;
+    std::memcpy(out, vi.data(), n);
+    // Each thread keeps a stream, reset to the state with the
+    // dictionary loaded. Compressing changes the stream, and this
+    // LZ4 can't attach a dictionary to a stream without copying it.
+    static thread_local LZ4_stream_t stream;
+    std::memcpy(&stream, dictionary.stream.get(), sizeof(stream));
+    auto const out_size = LZ4_compress_fast_continue(
+        &stream, reinterpret_cast<char const*>(in),
+            reinterpret_cast<char*>(out + n),
+                static_cast<int>(in_size), out_max, 1);
+    if (out_size == 0)
+        Throw<std::runtime_error> (
+            "lz4 dict compress");
+    result.second = n + out_size;
+    return result;
+}
+
 //------------------------------------------------------------------------------
 
 /*
@@ -137,12 +200,16 @@ lz4_compress (void const* in,
     1 = lz4 compressed
     2 = inner node compressed
     3 = full inner node
+    5 = v2 inner node compressed
+    6 = full v2 inner node
+    7 = lz4 compressed with a dictionary, followed by the dictionary id
 */
 
 template <class BufferFactory>
 std::pair<void const*, std::size_t>
 nodeobject_decompress (void const* in,
-    std::size_t in_size, BufferFactory&& bf)
+    std::size_t in_size, BufferFactory&& bf,
+        CodecDictionaries const* dictionaries = nullptr)
 {
     using namespace nudb::detail;
 
@@ -325,6 +392,26 @@ nodeobject_decompress (void const* in,
         write(os, is((depth+1)/2), (depth+1)/2);
         break;
     }
+    case 7: // lz4 with a dictionary
+    {
+        auto const hs =
+            field<std::uint32_t>::size; // Dictionary id
+        if (in_size < hs)
+            Throw<std::runtime_error> (
+                "nodeobject codec: short dictionary id");
+        istream is(p, in_size);
+        std::uint32_t id;
+        read<std::uint32_t>(is, id);
+        auto const dictionary = dictionaries ?
+            dictionaries->find(id) : nullptr;
+        if (! dictionary)
+            Throw<std::runtime_error> (
+                "nodeobject codec: unknown dictionary=" +
+                    std::to_string(id));
+        result = lz4_dict_decompress(
+            p + hs, in_size - hs, *dictionary, bf);
+        break;
+    }
     default:
         Throw<std::runtime_error> (
             "nodeobject codec: bad type=" +
@@ -350,7 +437,8 @@ zero32()
 template <class BufferFactory>
 std::pair<void const*, std::size_t>
 nodeobject_compress (void const* in,
-    std::size_t in_size, BufferFactory&& bf)
+    std::size_t in_size, BufferFactory&& bf,
+        CodecDictionaries const* dictionaries = nullptr)
 {
     using std::runtime_error;
     using namespace nudb::detail;
@@ -503,6 +591,17 @@ nodeobject_compress (void const* in,
         }
     }
 
+    // Use the newest dictionary for the type of object, if any
+    CodecDictionaries::Dictionary const* dictionary = nullptr;
+    if (dictionaries && in_size > 9)
+    {
+        dictionary = dictionaries->newest(
+            static_cast<NodeObjectType>(
+                static_cast<std::uint8_t const*>(in)[8]));
+        if (dictionary)
+            type = 7;
+    }
+
     std::array<std::uint8_t, varint_traits<
         std::size_t>::max> vi;
     auto const vn = write_varint(
@@ -528,6 +627,27 @@ nodeobject_compress (void const* in,
         result.second = vn + lzr.second;
         break;
     }
+    case 7: // lz4 with a dictionary
+    {
+        auto const hs =
+            field<std::uint32_t>::size; // Dictionary id
+        std::uint8_t* p;
+        auto const lzr = lz4_dict_compress(
+                in, in_size, *dictionary, [&p, &vn, &hs, &bf]
+            (std::size_t n)
+            {
+                p = reinterpret_cast<
+                    std::uint8_t*>(
+                        bf(vn + hs + n));
+                return p + vn + hs;
+            });
+        std::memcpy(p, vi.data(), vn);
+        ostream os(p + vn, hs);
+        write<std::uint32_t>(os, dictionary->id);
+        result.first = p;
+        result.second = vn + hs + lzr.second;
+        break;
+    }
     default:
         Throw<std::logic_error> (
             "nodeobject codec: unknown=" +
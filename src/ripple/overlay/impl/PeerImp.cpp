@@ -20,6 +20,7 @@
 #include <BeastConfig.h>
 #include <ripple/overlay/impl/PeerImp.h>
 #include <ripple/overlay/impl/Tuning.h>
+#include <ripple/app/consensus/ConsensusVerifier.h>
 #include <ripple/app/consensus/RCLValidations.h>
 #include <ripple/app/ledger/InboundLedgers.h>
 #include <ripple/app/ledger/LedgerMaster.h>
@@ -30,6 +31,7 @@
 #include <ripple/app/misc/Transaction.h>
 #include <ripple/app/misc/ValidatorList.h>
 #include <ripple/app/tx/apply.h>
+#include <ripple/app/tx/BatchVerifier.h>
 #include <ripple/basics/random.h>
 #include <ripple/basics/UptimeTimer.h>
 #include <ripple/beast/core/SemanticVersion.h>
@@ -1088,7 +1090,10 @@ PeerImp::onMessage (std::shared_ptr <protocol::TMTransaction> const& m)
             }
         }
 
-        if (app_.getJobQueue().getJobCount(jtTRANSACTION) > 100)
+        // Transactions waiting for their signature to be
+        // checked count toward the limit
+        if (app_.getJobQueue().getJobCount(jtTRANSACTION) +
+            app_.getBatchVerifier().pending() > 100)
         {
             JLOG(p_journal_.info()) << "Transaction queue is full";
         }
@@ -1098,14 +1103,25 @@ PeerImp::onMessage (std::shared_ptr <protocol::TMTransaction> const& m)
         }
         else
         {
-            app_.getJobQueue ().addJob (
-                jtTRANSACTION, "recvTransaction->checkTransaction",
-                [weak = std::weak_ptr<PeerImp>(shared_from_this()),
-                flags, checkSignature, stx] (Job&) {
-                    if (auto peer = weak.lock())
-                        peer->checkTransaction(flags,
-                            checkSignature, stx);
-                });
+            auto& jobQueue = app_.getJobQueue ();
+            auto queue =
+                [&jobQueue, weak = std::weak_ptr<PeerImp>(shared_from_this()),
+                flags, checkSignature, stx] () {
+                    jobQueue.addJob (
+                        jtTRANSACTION, "recvTransaction->checkTransaction",
+                        [weak, flags, checkSignature, stx] (Job&) {
+                            if (auto peer = weak.lock())
+                                peer->checkTransaction(flags,
+                                    checkSignature, stx);
+                        });
+                };
+
+            // Check the signature on the verifier's threads
+            // before scheduling the remaining checks
+            if (checkSignature)
+                app_.getBatchVerifier ().check (stx, std::move (queue));
+            else
+                queue ();
         }
     }
     catch (std::exception const&)
@@ -1275,12 +1291,46 @@ PeerImp::onMessage (std::shared_ptr <protocol::TMProposeSet> const& m)
             app_.timeKeeper().closeTime(),calcNodeID(publicKey)});
 
     std::weak_ptr<PeerImp> weak = shared_from_this();
-    app_.getJobQueue ().addJob (
-        isTrusted ? jtPROPOSAL_t : jtPROPOSAL_ut, "recvPropose->checkPropose",
-        [weak, m, proposal] (Job& job) {
-            if (auto peer = weak.lock())
-                peer->checkPropose(job, m, proposal);
-        });
+    auto process = [weak, m, proposal, isTrusted] (bool checkSignature)
+    {
+        if (auto peer = weak.lock())
+        {
+            peer->app_.getJobQueue ().addJob (
+                isTrusted ? jtPROPOSAL_t : jtPROPOSAL_ut,
+                "recvPropose->checkPropose",
+                [weak, m, proposal, checkSignature] (Job& job) {
+                    if (auto peer = weak.lock())
+                        peer->checkPropose(job, m, proposal, checkSignature);
+                });
+        }
+    };
+
+    auto& verifier = app_.getConsensusVerifier ();
+    if (! verifier.enabled () || cluster ())
+    {
+        process (true);
+        return;
+    }
+
+    // Check the signature before the proposal reaches the job queue
+    if (! verifier.check (isTrusted,
+        [proposal] { return proposal.checkSign (); },
+        [weak, process] (bool valid)
+        {
+            if (valid)
+            {
+                process (false);
+            }
+            else if (auto peer = weak.lock())
+            {
+                JLOG(peer->p_journal_.warn()) <<
+                    "Proposal fails sig check";
+                peer->charge (Resource::feeInvalidSignature);
+            }
+        }))
+    {
+        JLOG(p_journal_.debug()) << "Proposal: Dropping UNTRUSTED (verify)";
+    }
 }
 
 void
@@ -1590,17 +1640,49 @@ PeerImp::onMessage (std::shared_ptr <protocol::TMValidation> const& m)
         if (isTrusted || !app_.getFeeTrack ().isLoadedLocal ())
         {
             std::weak_ptr<PeerImp> weak = shared_from_this();
-            app_.getJobQueue ().addJob (
-                isTrusted ? jtVALIDATION_t : jtVALIDATION_ut,
-                "recvValidation->checkValidation",
-                [weak, val, isTrusted, m] (Job&)
+            auto process = [weak, val, isTrusted, m] (bool checkSignature)
+            {
+                if (auto peer = weak.lock())
                 {
-                    if (auto peer = weak.lock())
-                        peer->checkValidation(
-                            val,
-                            isTrusted,
-                            m);
-                });
+                    peer->app_.getJobQueue ().addJob (
+                        isTrusted ? jtVALIDATION_t : jtVALIDATION_ut,
+                        "recvValidation->checkValidation",
+                        [weak, val, isTrusted, checkSignature, m] (Job&)
+                        {
+                            if (auto peer = weak.lock())
+                                peer->checkValidation(
+                                    val,
+                                    isTrusted,
+                                    checkSignature,
+                                    m);
+                        });
+                }
+            };
+
+            auto& verifier = app_.getConsensusVerifier ();
+            if (! verifier.enabled () || cluster ())
+            {
+                process (true);
+            }
+            else if (! verifier.check (isTrusted,
+                [val] { return val->isValid (); },
+                [weak, process] (bool valid)
+                {
+                    if (valid)
+                    {
+                        process (false);
+                    }
+                    else if (auto peer = weak.lock())
+                    {
+                        JLOG(peer->p_journal_.warn()) <<
+                            "Validation is invalid";
+                        peer->charge (Resource::feeInvalidRequest);
+                    }
+                }))
+            {
+                JLOG(p_journal_.debug()) <<
+                    "Validation: Dropping UNTRUSTED (verify)";
+            }
         }
         else
         {
@@ -1875,7 +1957,7 @@ PeerImp::checkTransaction (int flags,
 void
 PeerImp::checkPropose (Job& job,
     std::shared_ptr <protocol::TMProposeSet> const& packet,
-        RCLCxPeerPos peerPos)
+        RCLCxPeerPos peerPos, bool checkSignature)
 {
     bool isTrusted = (job.getType () == jtPROPOSAL_t);
 
@@ -1885,7 +1967,7 @@ PeerImp::checkPropose (Job& job,
     assert (packet);
     protocol::TMProposeSet& set = *packet;
 
-    if (! cluster() && !peerPos.checkSign ())
+    if (checkSignature && ! cluster() && !peerPos.checkSign ())
     {
         JLOG(p_journal_.warn()) <<
             "Proposal fails sig check";
@@ -1917,13 +1999,14 @@ PeerImp::checkPropose (Job& job,
 
 void
 PeerImp::checkValidation (STValidation::pointer val,
-    bool isTrusted, std::shared_ptr<protocol::TMValidation> const& packet)
+    bool isTrusted, bool checkSignature,
+        std::shared_ptr<protocol::TMValidation> const& packet)
 {
     try
     {
         // VFALCO Which functions throw?
         uint256 signingHash = val->getSigningHash();
-        if (! cluster() && !val->isValid (signingHash))
+        if (checkSignature && ! cluster() && !val->isValid (signingHash))
         {
             JLOG(p_journal_.warn()) <<
                 "Validation is invalid";
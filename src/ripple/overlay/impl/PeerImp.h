@@ -442,11 +442,12 @@ private:
     void
     checkPropose (Job& job,
         std::shared_ptr<protocol::TMProposeSet> const& packet,
-            RCLCxPeerPos peerPos);
+            RCLCxPeerPos peerPos, bool checkSignature);
 
     void
     checkValidation (STValidation::pointer val,
-        bool isTrusted, std::shared_ptr<protocol::TMValidation> const& packet);
+        bool isTrusted, bool checkSignature,
+            std::shared_ptr<protocol::TMValidation> const& packet);
 
     void
     getLedger (std::shared_ptr<protocol::TMGetLedger> const&packet);
@@ -98,6 +98,7 @@ JSS ( binary );                     // in: AccountTX, LedgerEntry,
 JSS ( books );                      // in: Subscribe, Unsubscribe
 JSS ( both );                       // in: Subscribe, Unsubscribe
 JSS ( both_sides );                 // in: Subscribe, Unsubscribe
+JSS ( branches_done );              // out: NetworkOPs
 JSS ( build_path );                 // in: TransactionSign
 JSS ( build_version );              // out: NetworkOPs
 JSS ( cancel_after );               // out: AccountChannels
@@ -121,6 +122,7 @@ JSS ( code );                       // out: errors
 JSS ( command );                    // in: RPCHandler
 JSS ( complete );                   // out: NetworkOPs, InboundLedger
 JSS ( complete_ledgers );           // out: NetworkOPs, PeerImp
+JSS ( complete_shards );            // out: NetworkOPs
 JSS ( consensus );                  // out: NetworkOPs, LedgerConsensus
 JSS ( converge_time );              // out: NetworkOPs
 JSS ( converge_time_s );            // out: NetworkOPs
@@ -184,6 +186,7 @@ JSS ( freeze_peer );                // out: AccountLines
 JSS ( frozen_balances );            // out: GatewayBalances
 JSS ( full );                       // in: LedgerClearer, handlers/Ledger
 JSS ( full_reply );                 // out: PathFind
+JSS ( fullbelow_bytes );            // out: GetCounts
 JSS ( fullbelow_size );             // in: GetCounts
 JSS ( generator );                  // in: LedgerEntry
 JSS ( good );                       // out: RPCVersion
@@ -218,6 +221,7 @@ JSS ( key_type );                   // in/out: WalletPropose, TransactionSign
 JSS ( latency );                    // out: PeerImp
 JSS ( last );                       // out: RPCVersion
 JSS ( last_close );                 // out: NetworkOPs
+JSS ( last_rotated );               // out: NetworkOPs
 JSS ( ledger );                     // in: NetworkOPs, LedgerCleaner,
                                     //     RPCHelpers
                                     // out: NetworkOPs, PeerImp
@@ -289,6 +293,9 @@ JSS ( no_ripple );                  // out: AccountLines
 JSS ( no_ripple_peer );             // out: AccountLines
 JSS ( node );                       // out: LedgerEntry
 JSS ( node_binary );                // out: LedgerEntry
+JSS ( node_cache_bytes );           // out: GetCounts
+JSS ( node_cache_policy );          // out: GetCounts
+JSS ( node_filter_bytes );          // out: GetCounts
 JSS ( node_hit_rate );              // out: GetCounts
 JSS ( node_read_bytes );            // out: GetCounts
 JSS ( node_reads_hit );             // out: GetCounts
@@ -296,11 +303,15 @@ JSS ( node_reads_total );           // out: GetCounts
 JSS ( node_writes );                // out: GetCounts
 JSS ( node_written_bytes );         // out: GetCounts
 JSS ( nodes );                      // out: PathState
+JSS ( nodes_copied );               // out: NetworkOPs
+JSS ( nodes_per_second );           // out: NetworkOPs
+JSS ( nodes_visited );              // out: NetworkOPs
 JSS ( obligations );                // out: GatewayBalances
 JSS ( offer );                      // in: LedgerEntry
 JSS ( offers );                     // out: NetworkOPs, AccountOffers, Subscribe
 JSS ( offline );                    // in: TransactionSign
 JSS ( offset );                     // in/out: AccountTxOld
+JSS ( online_delete );              // out: NetworkOPs
 JSS ( open );                       // out: handlers/Ledger
 JSS ( open_ledger_fee );            // out: TxQ
 JSS ( open_ledger_level );          // out: TxQ
@@ -323,6 +334,7 @@ JSS ( peers );                      // out: InboundLedger, handlers/Peers, Overl
 JSS ( port );                       // in: Connect
 JSS ( previous_ledger );            // out: LedgerPropose
 JSS ( proof );                      // in: BookOffers
+JSS ( proposal_jobs );              // out: GetCounts
 JSS ( propose_seq );                // out: LedgerPropose
 JSS ( proposers );                  // out: NetworkOPs, LedgerConsensus
 JSS ( protocol );                   // out: PeerImp
@@ -385,6 +397,7 @@ JSS ( stand_alone );                // out: NetworkOPs
 JSS ( start );                      // in: TxHistory
 JSS ( state );                      // out: Logic.h, ServerState, LedgerData
 JSS ( state_accounting );           // out: NetworkOPs
+JSS ( state_copy );                 // out: NetworkOPs
 JSS ( state_now );                  // in: Subscribe
 JSS ( status );                     // error
 JSS ( stop );                       // in: LedgerCleaner
@@ -392,6 +405,7 @@ JSS ( streams );                    // in: Subscribe, Unsubscribe
 JSS ( strict );                     // in: AccountCurrencies, AccountInfo
 JSS ( sub_index );                  // in: LedgerEntry
 JSS ( subcommand );                 // in: PathFind
+JSS ( subtrees_skipped );           // out: NetworkOPs
 JSS ( success );                    // rpc
 JSS ( supported );                  // out: AmendmentTableImpl
 JSS ( system_time_offset );         // out: NetworkOPs
@@ -414,7 +428,9 @@ JSS ( transaction_hash );           // out: RCLCxPeerPos, LedgerToJson
 JSS ( transactions );               // out: LedgerToJson,
                                     // in: AccountTx*, Unsubscribe
 JSS ( transitions );                // out: NetworkOPs
+JSS ( treenode_cache_bytes );       // out: GetCounts
 JSS ( treenode_cache_size );        // out: GetCounts
+JSS ( treenode_hit_rate );          // out: GetCounts
 JSS ( treenode_track_size );        // out: GetCounts
 JSS ( trusted );                    // out: UnlList
 JSS ( tx );                         // out: STTx, AccountTx*
@@ -443,6 +459,7 @@ JSS ( validated );                  // out: NetworkOPs, RPCHelpers, AccountTx*
                                     //      Tx
 JSS ( validated_ledger );           // out: NetworkOPs
 JSS ( validated_ledgers );          // out: NetworkOPs
+JSS ( validation_jobs );            // out: GetCounts
 JSS ( validation_key );             // out: ValidationCreate, ValidationSeed
 JSS ( validation_private_key );     // out: ValidationCreate
 JSS ( validation_public_key );      // out: ValidationCreate, ValidationSeed
@@ -450,6 +467,10 @@ JSS ( validation_quorum );          // out: NetworkOPs
 JSS ( validation_seed );            // out: ValidationCreate, ValidationSeed
 JSS ( validations );                // out: AmendmentTableImpl
 JSS ( value );                      // out: STAmount
+JSS ( verify_dropped );             // out: GetCounts
+JSS ( verify_trusted );             // out: GetCounts
+JSS ( verify_tx );                  // out: GetCounts
+JSS ( verify_untrusted );           // out: GetCounts
 JSS ( version );                    // out: RPCVersion
 JSS ( vetoed );                     // out: AmendmentTableImpl
 JSS ( vote );                       // in: Feature
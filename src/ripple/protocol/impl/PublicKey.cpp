@@ -22,10 +22,13 @@
 #include <ripple/protocol/digest.h>
 #include <ripple/protocol/impl/secp256k1.h>
 #include <ripple/basics/contract.h>
+#include <ripple/basics/hardened_hash.h>
 #include <ripple/basics/strHex.h>
 #include <ripple/beast/core/ByteOrder.h>
 #include <boost/multiprecision/cpp_int.hpp>
 #include <ed25519-donna/ed25519.h>
+#include <array>
+#include <mutex>
 #include <type_traits>
 
 namespace ripple {
@@ -179,6 +182,69 @@ ed25519Canonical (Slice const& sig)
         S, S + 32, Order, Order + 32);
 }
 
+// Parsed secp256k1 public keys, so that a key which signs often is
+// only decompressed once. Each key maps to a single slot, which holds
+// the most recently parsed key to land there.
+class ParsedKeyCache
+{
+private:
+    static std::size_t constexpr shardCount = 16;
+    static std::size_t constexpr slotsPerShard = 512;
+
+    struct Slot
+    {
+        PublicKey key;
+        secp256k1_pubkey parsed;
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::array<Slot, slotsPerShard> slots;
+    };
+
+    hardened_hash<> hash_;
+    std::array<Shard, shardCount> shards_;
+
+public:
+    bool
+    parse (PublicKey const& publicKey, secp256k1_pubkey& parsed)
+    {
+        auto const h = hash_(publicKey);
+        auto& shard = shards_[h % shardCount];
+        auto& slot = shard.slots[(h / shardCount) % slotsPerShard];
+        {
+            std::lock_guard<std::mutex> lock (shard.mutex);
+            if (slot.key == publicKey)
+            {
+                parsed = slot.parsed;
+                return true;
+            }
+        }
+
+        if(secp256k1_ec_pubkey_parse(
+                secp256k1Context(),
+                &parsed,
+                reinterpret_cast<unsigned char const*>(
+                    publicKey.data()),
+                publicKey.size()) != 1)
+            return false;
+
+        std::lock_guard<std::mutex> lock (shard.mutex);
+        slot.key = publicKey;
+        slot.parsed = parsed;
+        return true;
+    }
+};
+
+static
+ParsedKeyCache&
+parsedKeyCache()
+{
+    static ParsedKeyCache cache;
+    return cache;
+}
+
 //------------------------------------------------------------------------------
 
 PublicKey::PublicKey (Slice const& slice)
@@ -235,12 +301,7 @@ verifyDigest (PublicKey const& publicKey,
         return false;
 
     secp256k1_pubkey pubkey_imp;
-    if(secp256k1_ec_pubkey_parse(
-            secp256k1Context(),
-            &pubkey_imp,
-            reinterpret_cast<unsigned char const*>(
-                publicKey.data()),
-            publicKey.size()) != 1)
+    if (! parsedKeyCache().parse (publicKey, pubkey_imp))
         return false;
 
     secp256k1_ecdsa_signature sig_imp;
@@ -18,13 +18,16 @@
 //==============================================================================
 
 #include <BeastConfig.h>
+#include <ripple/app/consensus/ConsensusVerifier.h>
 #include <ripple/app/ledger/AcceptedLedger.h>
 #include <ripple/app/ledger/InboundLedgers.h>
 #include <ripple/app/ledger/LedgerMaster.h>
 #include <ripple/app/main/Application.h>
 #include <ripple/app/misc/NetworkOPs.h>
+#include <ripple/app/tx/BatchVerifier.h>
 #include <ripple/basics/UptimeTimer.h>
 #include <ripple/core/DatabaseCon.h>
+#include <ripple/core/JobQueue.h>
 #include <ripple/json/json_value.h>
 #include <ripple/ledger/CachedSLEs.h>
 #include <ripple/net/RPCErr.h>
@@ -99,16 +102,42 @@ Json::Value doGetCounts (RPC::Context& context)
 
     ret[jss::write_load] = context.app.getNodeStore ().getWriteLoad ();
 
+    {
+        // Messages waiting at each stage of signature checking
+        auto const verify = context.app.getConsensusVerifier ().counts ();
+        ret[jss::verify_trusted] = static_cast<Json::UInt> (verify.trusted);
+        ret[jss::verify_untrusted] = static_cast<Json::UInt> (
+            verify.untrusted);
+        ret[jss::verify_dropped] = static_cast<Json::UInt> (verify.dropped);
+        ret[jss::verify_tx] = static_cast<Json::UInt> (
+            context.app.getBatchVerifier ().pending ());
+
+        auto& jobQueue = context.app.getJobQueue ();
+        ret[jss::proposal_jobs] = jobQueue.getJobCount (jtPROPOSAL_t) +
+            jobQueue.getJobCount (jtPROPOSAL_ut);
+        ret[jss::validation_jobs] = jobQueue.getJobCount (jtVALIDATION_t) +
+            jobQueue.getJobCount (jtVALIDATION_ut);
+    }
+
     ret[jss::historical_perminute] = static_cast<int>(
         context.app.getInboundLedgers().fetchRate());
     ret[jss::SLE_hit_rate] = context.app.cachedSLEs().rate();
     ret[jss::node_hit_rate] = context.app.getNodeStore ().getCacheHitRate ();
+    ret[jss::node_cache_bytes] = static_cast<Json::UInt> (
+        context.app.getNodeStore ().getCacheBytes ());
+    ret[jss::node_filter_bytes] = static_cast<Json::UInt> (
+        context.app.getNodeStore ().getFilterBytes ());
+    ret[jss::node_cache_policy] = to_string (
+        context.app.getNodeStore ().getCachePolicy ());
     ret[jss::ledger_hit_rate] = context.app.getLedgerMaster ().getCacheHitRate ();
     ret[jss::AL_hit_rate] = context.app.getAcceptedLedgerCache ().getHitRate ();
 
     ret[jss::fullbelow_size] = static_cast<int>(context.app.family().fullbelow().size());
+    ret[jss::fullbelow_bytes] = static_cast<Json::UInt>(context.app.family().fullbelow().bytes());
     ret[jss::treenode_cache_size] = context.app.family().treecache().getCacheSize();
+    ret[jss::treenode_cache_bytes] = static_cast<Json::UInt>(context.app.family().treecache().getCacheBytes());
     ret[jss::treenode_track_size] = context.app.family().treecache().getTrackSize();
+    ret[jss::treenode_hit_rate] = context.app.family().treecache().getHitRate();
 
     std::string uptime;
     int s = UptimeTimer::getInstance ().getElapsedSeconds ();
@@ -45,6 +45,7 @@ Json::Value doFee                   (RPC::Context&);
 Json::Value doFetchInfo             (RPC::Context&);
 Json::Value doGatewayBalances       (RPC::Context&);
 Json::Value doGetCounts             (RPC::Context&);
+Json::Value doJobLatency            (RPC::Context&);
 Json::Value doLedgerAccept          (RPC::Context&);
 Json::Value doLedgerCleaner         (RPC::Context&);
 Json::Value doLedgerClosed          (RPC::Context&);
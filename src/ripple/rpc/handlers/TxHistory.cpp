@@ -19,16 +19,14 @@
 
 #include <BeastConfig.h>
 #include <ripple/app/main/Application.h>
+#include <ripple/app/misc/HistoryStore.h>
 #include <ripple/app/misc/Transaction.h>
-#include <ripple/core/DatabaseCon.h>
-#include <ripple/core/SociDB.h>
 #include <ripple/net/RPCErr.h>
 #include <ripple/protocol/JsonFields.h>
 #include <ripple/protocol/ErrorCodes.h>
 #include <ripple/resource/Fees.h>
 #include <ripple/rpc/Context.h>
 #include <ripple/rpc/Role.h>
-#include <boost/format.hpp>
 
 namespace ripple {
 
@@ -52,38 +50,13 @@ Json::Value doTxHistory (RPC::Context& context)
 
     obj[jss::index] = startIndex;
 
-    std::string sql =
-        boost::str (boost::format (
-            "SELECT LedgerSeq, Status, RawTxn "
-            "FROM Transactions ORDER BY LedgerSeq desc LIMIT %u,20;")
-                    % startIndex);
-
+    for (auto const& tx :
+        context.app.getHistoryStore ().getTxHistory (startIndex, 20))
     {
-        auto db = context.app.getTxnDB ().checkoutDb ();
-
-        boost::optional<std::uint64_t> ledgerSeq;
-        boost::optional<std::string> status;
-        soci::blob sociRawTxnBlob (*db);
-        soci::indicator rti;
-        Blob rawTxn;
-
-        soci::statement st = (db->prepare << sql,
-                              soci::into (ledgerSeq),
-                              soci::into (status),
-                              soci::into (sociRawTxnBlob, rti));
-
-        st.execute ();
-        while (st.fetch ())
-        {
-            if (soci::i_ok == rti)
-                convert(sociRawTxnBlob, rawTxn);
-            else
-                rawTxn.clear ();
-
-            if (auto trans = Transaction::transactionFromSQL (
-                    ledgerSeq, status, rawTxn, context.app))
-                txs.append (trans->getJson (0));
-        }
+        if (auto trans = Transaction::transactionFromSQL (
+                boost::optional<std::uint64_t> (tx.ledgerSeq), tx.status,
+                    tx.raw, context.app))
+            txs.append (trans->getJson (0));
     }
 
     obj[jss::txs] = txs;
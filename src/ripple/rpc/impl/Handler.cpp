@@ -119,6 +119,7 @@ Handler handlerArray[] {
     {   "feature",              byRef (&doFeature),             Role::ADMIN,   NO_CONDITION     },
     {   "fee",                  byRef (&doFee),                 Role::USER,    NO_CONDITION     },
     {   "fetch_info",           byRef (&doFetchInfo),           Role::ADMIN,   NO_CONDITION     },
+    {   "job_latency",          byRef (&doJobLatency),          Role::ADMIN,   NO_CONDITION     },
     {   "ledger_accept",        byRef (&doLedgerAccept),        Role::ADMIN,   NEEDS_CURRENT_LEDGER  },
     {   "ledger_cleaner",       byRef (&doLedgerCleaner),       Role::ADMIN,   NEEDS_NETWORK_CONNECTION  },
     {   "ledger_closed",        byRef (&doLedgerClosed),        Role::USER,  NO_CONDITION   },
@@ -24,8 +24,10 @@
 #include <ripple/shamap/FullBelowCache.h>
 #include <ripple/shamap/TreeNodeCache.h>
 #include <ripple/nodestore/Database.h>
+#include <ripple/nodestore/DatabaseShard.h>
 #include <ripple/beast/utility/Journal.h>
 #include <cstdint>
+#include <functional>
 
 namespace ripple {
 
@@ -62,6 +64,15 @@ public:
     NodeStore::Database const&
     db() const = 0;
 
+    /** Returns the shard store, or `nullptr` if there is none.
+
+        Complete maps of old ledgers are read from the shard
+        holding their ledger when the node store lacks a node.
+    */
+    virtual
+    NodeStore::DatabaseShard*
+    shardDb() = 0;
+
     virtual
     void
     missing_node (std::uint32_t refNum) = 0;
@@ -69,6 +80,24 @@ public:
     virtual
     void
     missing_node (uint256 const& refHash) = 0;
+
+    /** Returns the number of subtrees flushDirty may write concurrently.
+
+        A value of 1 flushes every dirty node on the calling thread.
+    */
+    virtual
+    std::size_t
+    flushFanout() const = 0;
+
+    /** Run a task asynchronously.
+
+        The task may run at any later time, or not at all if the
+        implementation is shutting down. Callers must not depend
+        on the task running in order to make progress.
+    */
+    virtual
+    void
+    dispatch (std::function<void()> task) = 0;
 };
 
 } // ripple
@@ -83,6 +83,26 @@ public:
         return m_cache.size ();
     }
 
+    /** Return the approximate memory used by the cache.
+        Thread safety:
+            Safe to call from any thread.
+    */
+    std::size_t bytes () const
+    {
+        return m_cache.bytes ();
+    }
+
+    /** Limit the memory used by the cache.
+        The target size still applies when it is lower.
+        Thread safety:
+            Safe to call from any thread.
+        @param bytes The approximate limit, or 0 for none.
+    */
+    void setTargetBytes (std::size_t bytes)
+    {
+        m_cache.setTargetBytes (bytes);
+    }
+
     /** Remove expired cache items.
         Thread safety:
             Safe to call from any thread.
@@ -178,6 +178,20 @@ public:
     const_iterator upper_bound(uint256 const& id) const;
 
     void visitNodes (std::function<bool (SHAMapAbstractNode&)> const&) const;
+
+    /** Visit the nodes below one branch of the root, depth first.
+
+        Subtrees below different branches may be visited concurrently.
+
+        @param branch The branch of the root to visit below.
+        @param function Called with each node before its children.
+                        Returns `true` if the children are to be skipped.
+        @param done Called with each inner node whose children were
+                    visited, after the last of them.
+    */
+    void visitSubtree (int branch,
+        std::function<bool (SHAMapAbstractNode&)> const& function,
+        std::function<void (SHAMapInnerNode&)> const& done) const;
     void
         visitLeaves(
             std::function<void(std::shared_ptr<SHAMapItem const> const&)> const&) const;
@@ -254,6 +268,7 @@ private:
     void canonicalize (SHAMapHash const& hash, std::shared_ptr<SHAMapAbstractNode>&) const;
 
     // database operations
+    std::shared_ptr<NodeObject> fetchFromShard (SHAMapHash const& hash) const;
     std::shared_ptr<SHAMapAbstractNode> fetchNodeFromDB (SHAMapHash const& hash) const;
     std::shared_ptr<SHAMapAbstractNode> fetchNodeNT (SHAMapHash const& hash) const;
     std::shared_ptr<SHAMapAbstractNode> fetchNodeNT (
@@ -300,6 +315,16 @@ private:
     std::shared_ptr<SHAMapAbstractNode> descend (std::shared_ptr<SHAMapInnerNode> const&, int branch) const;
     std::shared_ptr<SHAMapAbstractNode> descendThrow (std::shared_ptr<SHAMapInnerNode> const&, int branch) const;
 
+    /** Read the missing children of an inner node in one batch.
+        Every child that is neither hooked up nor in the tree node
+        cache is handed to the node store's async read threads, and
+        this waits for those reads to finish, so that descending into
+        the children afterwards does not go to disk once per child.
+        Only this node's reads are waited for, not the rest of the
+        async read queue.
+    */
+    void prefetchChildren (SHAMapInnerNode& node) const;
+
     // Descend with filter
     SHAMapAbstractNode* descendAsync (SHAMapInnerNode* parent, int branch,
         SHAMapSyncFilter* filter, bool& pending) const;
@@ -325,6 +350,17 @@ private:
                      std::shared_ptr<SHAMapItem const> const& otherMapItem,
                      bool isFirstMap, Delta & differences, int & maxCount) const;
     int walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq);
+
+    /** Flush the modified nodes below (and including) an inner node.
+        Returns the now shareable inner node.
+    */
+    std::shared_ptr<SHAMapInnerNode>
+        flushSubTree (std::shared_ptr<SHAMapInnerNode> node, bool doWrite,
+            NodeObjectType t, std::uint32_t seq, int& flushed) const;
+
+    /** Flush the modified children of the root, several at a time. */
+    void flushChildren (std::shared_ptr<SHAMapInnerNode> const& node,
+        NodeObjectType t, std::uint32_t seq, int& flushed) const;
     bool isInconsistentNode(std::shared_ptr<SHAMapAbstractNode> const& node) const;
 
     // Structure to track information about call to
@@ -25,6 +25,7 @@
 #include <ripple/basics/TaggedCache.h>
 #include <ripple/beast/utility/Journal.h>
 
+#include <array>
 #include <cstdint>
 #include <memory>
 #include <mutex>
@@ -147,12 +148,30 @@ class SHAMapInnerNodeV2;
 class SHAMapInnerNode
     : public SHAMapAbstractNode
 {
-    std::array<SHAMapHash, 16>          mHashes;
-    std::shared_ptr<SHAMapAbstractNode> mChildren[16];
-    int                             mIsBranch = 0;
+    // Most inner nodes have only a few branches, so the hashes and
+    // children are stored only for the non-empty branches, packed in
+    // branch order. mIsBranch records which branches are present.
+    std::unique_ptr<SHAMapHash[]>   mHashes;
+    std::unique_ptr<std::shared_ptr<SHAMapAbstractNode>[]> mChildren;
+    std::uint16_t                   mIsBranch = 0;
+    std::uint8_t                    mCapacity = 0;
     std::uint32_t                   mFullBelowGen = 0;
 
-    static std::mutex               childLock;
+    // Guards the child pointers. Nodes share a fixed set of
+    // mutexes, chosen by address, so that traversals of
+    // unrelated nodes rarely contend.
+    static std::array<std::mutex, 256> childLocks;
+    static SHAMapHash const         zeroHash;
+
+    std::mutex& childLock () const;
+
+    int getChildIndex (int branch) const;
+    void resizeChildren (int capacity);
+    void addBranch (int branch);
+    void removeBranch (int branch);
+    void setHashes (std::array<SHAMapHash, 16> const& hashes);
+    void copyChildren (SHAMapInnerNode& to) const;
+
 public:
     SHAMapInnerNode(std::uint32_t seq);
     std::shared_ptr<SHAMapAbstractNode> clone(std::uint32_t seq) const override;
@@ -258,6 +277,9 @@ public:  // public only to SHAMap
     bool updateHash () override;
 };
 
+/** Estimate the memory used by a cached node. */
+std::size_t cachedSize (SHAMapAbstractNode const& node);
+
 // SHAMapAbstractNode
 
 inline
@@ -349,12 +371,38 @@ SHAMapInnerNode::isEmptyBranch (int m) const
     return (mIsBranch & (1 << m)) == 0;
 }
 
+inline
+std::mutex&
+SHAMapInnerNode::childLock () const
+{
+    // Fibonacci hashing spreads nearby allocations across stripes
+    auto const addr = reinterpret_cast<std::uintptr_t>(this);
+    return childLocks[static_cast<std::uint64_t>(addr >> 4) *
+        0x9E3779B97F4A7C15ull >> 56];
+}
+
+// Returns the position of a branch in the packed arrays,
+// which is the number of non-empty branches before it.
+inline
+int
+SHAMapInnerNode::getChildIndex (int branch) const
+{
+    static std::uint8_t const bits[16] =
+        { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+    unsigned const below = mIsBranch & ((1u << branch) - 1);
+    return bits[below & 0xF] + bits[(below >> 4) & 0xF] +
+        bits[(below >> 8) & 0xF] + bits[(below >> 12) & 0xF];
+}
+
 inline
 SHAMapHash const&
 SHAMapInnerNode::getChildHash (int m) const
 {
     assert ((m >= 0) && (m < 16) && (getType() == tnINNER));
-    return mHashes[m];
+    if (isEmptyBranch (m))
+        return zeroHash;
+    return mHashes[getChildIndex (m)];
 }
 
 inline
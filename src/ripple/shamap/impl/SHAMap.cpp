@@ -20,6 +20,10 @@
 #include <BeastConfig.h>
 #include <ripple/basics/contract.h>
 #include <ripple/shamap/SHAMap.h>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 
 namespace ripple {
 
@@ -240,6 +244,18 @@ SHAMap::findKey(uint256 const& id) const
     return leaf;
 }
 
+// A complete map of an old ledger may be held by the shard store
+std::shared_ptr<NodeObject>
+SHAMap::fetchFromShard (SHAMapHash const& hash) const
+{
+    if (ledgerSeq_ == 0)
+        return {};
+    auto const shards = f_.shardDb ();
+    if (! shards || ! shards->contains (ledgerSeq_))
+        return {};
+    return shards->fetch (hash.as_uint256(), ledgerSeq_);
+}
+
 std::shared_ptr<SHAMapAbstractNode>
 SHAMap::fetchNodeFromDB (SHAMapHash const& hash) const
 {
@@ -248,6 +264,8 @@ SHAMap::fetchNodeFromDB (SHAMapHash const& hash) const
     if (backed_)
     {
         std::shared_ptr<NodeObject> obj = f_.db().fetch (hash.as_uint256());
+        if (!obj)
+            obj = fetchFromShard (hash);
         if (obj)
         {
             try
@@ -461,6 +479,32 @@ SHAMap::descend (SHAMapInnerNode * parent, SHAMapNodeID const& parentID,
     return std::make_pair (child, parentID.getChildNodeID (branch));
 }
 
+void
+SHAMap::prefetchChildren (SHAMapInnerNode& node) const
+{
+    if (!backed_)
+        return;
+
+    std::vector<uint256> pending;
+    for (int branch = 0; branch < 16; ++branch)
+    {
+        if (node.isEmptyBranch (branch) || node.getChildPointer (branch))
+            continue;
+
+        // Don't count the check as a request for the node
+        auto const& hash = node.getChildHash (branch);
+        if (f_.treecache().peek (hash.as_uint256()))
+            continue;
+
+        std::shared_ptr<NodeObject> obj;
+        if (! f_.db().asyncFetch (hash.as_uint256(), obj))
+            pending.push_back (hash.as_uint256());
+    }
+
+    if (! pending.empty ())
+        f_.db().waitReads (pending);
+}
+
 SHAMapAbstractNode*
 SHAMap::descendAsync (SHAMapInnerNode* parent, int branch,
     SHAMapSyncFilter * filter, bool & pending) const
@@ -487,6 +531,8 @@ SHAMap::descendAsync (SHAMapInnerNode* parent, int branch,
                 pending = true;
                 return nullptr;
             }
+            if (!obj)
+                obj = fetchFromShard (hash);
             if (!obj)
                 return nullptr;
 
@@ -551,6 +597,7 @@ SHAMap::firstBelow(std::shared_ptr<SHAMapAbstractNode> node,
             stack.push({inner, stack.top().second.getChildNodeID(branch)});
         }
     }
+    prefetchChildren (*inner);
     for (int i = 0; i < 16;)
     {
         if (!inner->isEmptyBranch(i))
@@ -573,6 +620,7 @@ SHAMap::firstBelow(std::shared_ptr<SHAMapAbstractNode> node,
             {
                 stack.push({inner, stack.top().second.getChildNodeID(branch)});
             }
+            prefetchChildren (*inner);
             i = 0;  // scan all 16 branches of this new node
         }
         else
@@ -1159,7 +1207,6 @@ int
 SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
 {
     int flushed = 0;
-    Serializer s;
 
     if (!root_ || (root_->getSeq() == 0))
         return flushed;
@@ -1186,6 +1233,25 @@ SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
         return 1;
     }
 
+    if (doWrite && backed_ && (f_.flushFanout() > 1))
+    {
+        // Flush the root's subtrees concurrently, then the root itself
+        node = preFlushNode(std::move(node));
+        flushChildren (node, t, seq, flushed);
+
+        node->updateHashDeep();
+        root_ = writeNode(t, seq, std::move(node));
+        return flushed + 1;
+    }
+
+    root_ = flushSubTree (std::move(node), doWrite, t, seq, flushed);
+    return flushed;
+}
+
+std::shared_ptr<SHAMapInnerNode>
+SHAMap::flushSubTree (std::shared_ptr<SHAMapInnerNode> node, bool doWrite,
+    NodeObjectType t, std::uint32_t seq, int& flushed) const
+{
     // Stack of {parent,index,child} pointers representing
     // inner nodes we are in the process of flushing
     using StackEntry = std::pair <std::shared_ptr<SHAMapInnerNode>, int>;
@@ -1273,10 +1339,108 @@ SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
         ++pos;
     }
 
-    // Last inner node is the new root_
-    root_ = std::move (node);
+    return node;
+}
 
-    return flushed;
+void
+SHAMap::flushChildren (std::shared_ptr<SHAMapInnerNode> const& node,
+    NodeObjectType t, std::uint32_t seq, int& flushed) const
+{
+    assert (node->getSeq() == seq_);
+
+    // Shared with the dispatched tasks, which may
+    // not start running until after we return.
+    struct Work
+    {
+        std::vector<std::pair<int, std::shared_ptr<SHAMapInnerNode>>> subtrees;
+        std::atomic<std::size_t> next {0};
+        std::atomic<int> flushed {0};
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::size_t finished = 0;
+        std::exception_ptr error;
+    };
+
+    auto work = std::make_shared<Work>();
+
+    for (int branch = 0; branch < 16; ++branch)
+    {
+        if (node->isEmptyBranch (branch))
+            continue;
+
+        auto child = node->getChild (branch);
+
+        if (!child || (child->getSeq() == 0))
+            continue;
+
+        if (child->isInner ())
+        {
+            work->subtrees.emplace_back (branch,
+                std::static_pointer_cast<SHAMapInnerNode>(std::move(child)));
+        }
+        else
+        {
+            ++flushed;
+            child = preFlushNode(std::move(child));
+            child->updateHash();
+            node->shareChild (branch, writeNode(t, seq, std::move(child)));
+        }
+    }
+
+    if (work->subtrees.empty ())
+        return;
+
+    // Every runner claims subtrees until none are left. The calling
+    // thread is also a runner, so we finish even if no dispatched
+    // task ever gets to run.
+    auto runner = [this, work, t, seq]()
+    {
+        for (;;)
+        {
+            auto const i = work->next++;
+            if (i >= work->subtrees.size())
+                return;
+
+            try
+            {
+                int n = 0;
+                auto& subtree = work->subtrees[i].second;
+                subtree = flushSubTree (std::move(subtree), true, t, seq, n);
+                work->flushed += n;
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock (work->mutex);
+                if (!work->error)
+                    work->error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock (work->mutex);
+            if (++work->finished == work->subtrees.size())
+                work->cv.notify_all();
+        }
+    };
+
+    auto const tasks = std::min (f_.flushFanout(), work->subtrees.size());
+    for (std::size_t i = 1; i < tasks; ++i)
+        f_.dispatch (runner);
+
+    runner();
+
+    {
+        std::unique_lock<std::mutex> lock (work->mutex);
+        work->cv.wait (lock, [&work]
+            { return work->finished == work->subtrees.size(); });
+    }
+
+    if (work->error)
+        std::rethrow_exception (work->error);
+
+    // Hook the flushed subtrees to the root
+    for (auto const& subtree : work->subtrees)
+        node->shareChild (subtree.first, subtree.second);
+
+    flushed += work->flushed;
 }
 
 void SHAMap::dump (bool hash) const
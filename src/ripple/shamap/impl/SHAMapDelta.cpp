@@ -242,6 +242,7 @@ void SHAMap::walkMap (std::vector<SHAMapMissingNode>& missingNodes, int maxMissi
         std::shared_ptr<SHAMapInnerNode> node = std::move (nodeStack.top());
         nodeStack.pop ();
 
+        prefetchChildren (*node);
         for (int i = 0; i < 16; ++i)
         {
             if (!node->isEmptyBranch (i))
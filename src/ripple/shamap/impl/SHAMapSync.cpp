@@ -55,6 +55,7 @@ void SHAMap::visitNodes(std::function<bool (SHAMapAbstractNode&)> const& functio
 
     auto node = std::static_pointer_cast<SHAMapInnerNode>(root_);
     int pos = 0;
+    prefetchChildren (*node);
 
     while (1)
     {
@@ -84,6 +85,7 @@ void SHAMap::visitNodes(std::function<bool (SHAMapAbstractNode&)> const& functio
                     // descend to the child's first position
                     node = std::static_pointer_cast<SHAMapInnerNode>(child);
                     pos = 0;
+                    prefetchChildren (*node);
                 }
             }
             else
@@ -100,6 +102,62 @@ void SHAMap::visitNodes(std::function<bool (SHAMapAbstractNode&)> const& functio
     }
 }
 
+void
+SHAMap::visitSubtree (int branch,
+    std::function<bool (SHAMapAbstractNode&)> const& function,
+    std::function<void (SHAMapInnerNode&)> const& done) const
+{
+    assert ((branch >= 0) && (branch < 16));
+
+    if (!root_ || !root_->isInner ())
+        return;
+
+    auto const root = std::static_pointer_cast<SHAMapInnerNode>(root_);
+    if (root->isEmptyBranch (branch))
+        return;
+
+    auto const top = descendNoStore (root, branch);
+    if (function (*top) || top->isLeaf ())
+        return;
+
+    using StackEntry = std::pair <int, std::shared_ptr<SHAMapInnerNode>>;
+    std::stack <StackEntry, std::vector <StackEntry>> stack;
+
+    auto node = std::static_pointer_cast<SHAMapInnerNode>(top);
+    int pos = 0;
+    prefetchChildren (*node);
+
+    while (1)
+    {
+        while (pos < 16)
+        {
+            if (node->isEmptyBranch (pos))
+            {
+                ++pos;
+                continue;
+            }
+
+            auto child = descendNoStore (node, pos++);
+            if (function (*child) || child->isLeaf ())
+                continue;
+
+            // save the position to resume at, and descend
+            stack.push (std::make_pair (pos, std::move (node)));
+            node = std::static_pointer_cast<SHAMapInnerNode>(child);
+            pos = 0;
+            prefetchChildren (*node);
+        }
+
+        done (*node);
+
+        if (stack.empty ())
+            break;
+
+        std::tie (pos, node) = stack.top ();
+        stack.pop ();
+    }
+}
+
 // Starting at the position referred to by the specfied
 // StackEntry, process that node and its first resident
 // children, descending the SHAMap until we complete the
@@ -32,7 +32,8 @@
 
 namespace ripple {
 
-std::mutex SHAMapInnerNode::childLock;
+std::array<std::mutex, 256> SHAMapInnerNode::childLocks;
+SHAMapHash const SHAMapInnerNode::zeroHash;
 
 SHAMapAbstractNode::~SHAMapAbstractNode() = default;
 
@@ -41,15 +42,13 @@ SHAMapInnerNode::clone(std::uint32_t seq) const
 {
     auto p = std::make_shared<SHAMapInnerNode>(seq);
     p->mHash = mHash;
-    p->mIsBranch = mIsBranch;
     p->mFullBelowGen = mFullBelowGen;
-    p->mHashes = mHashes;
-    std::lock_guard <std::mutex> lock(childLock);
-    for (int i = 0; i < 16; ++i)
-    {
-        p->mChildren[i] = mChildren[i];
+    std::lock_guard <std::mutex> lock(childLock());
+    copyChildren (*p);
+#ifndef NDEBUG
+    for (int i = 0; i < p->mCapacity; ++i)
         assert(std::dynamic_pointer_cast<SHAMapInnerNodeV2>(p->mChildren[i]) == nullptr);
-    }
+#endif
     return std::move(p);
 }
 
@@ -58,19 +57,19 @@ SHAMapInnerNodeV2::clone(std::uint32_t seq) const
 {
     auto p = std::make_shared<SHAMapInnerNodeV2>(seq);
     p->mHash = mHash;
-    p->mIsBranch = mIsBranch;
     p->mFullBelowGen = mFullBelowGen;
-    p->mHashes = mHashes;
     p->common_ = common_;
     p->depth_ = depth_;
-    std::lock_guard <std::mutex> lock(childLock);
-    for (int i = 0; i < 16; ++i)
+    std::lock_guard <std::mutex> lock(childLock());
+    copyChildren (*p);
+#ifndef NDEBUG
+    for (int i = 0; i < p->mCapacity; ++i)
     {
-        p->mChildren[i] = mChildren[i];
         if (p->mChildren[i] != nullptr)
             assert(std::dynamic_pointer_cast<SHAMapInnerNodeV2>(p->mChildren[i]) != nullptr ||
                    std::dynamic_pointer_cast<SHAMapTreeNode>(p->mChildren[i]) != nullptr);
     }
+#endif
     return std::move(p);
 }
 
@@ -148,13 +147,10 @@ SHAMapAbstractNode::make(Slice const& rawNode, std::uint32_t seq, SHANodeFormat
                 Throw<std::runtime_error> ("invalid FI node");
 
             auto ret = std::make_shared<SHAMapInnerNode>(seq);
+            std::array<SHAMapHash, 16> hashes;
             for (int i = 0; i < 16; ++i)
-            {
-                s.get256 (ret->mHashes[i].as_uint256(), i * 32);
-
-                if (ret->mHashes[i].isNonZero ())
-                    ret->mIsBranch |= (1 << i);
-            }
+                s.get256 (hashes[i].as_uint256(), i * 32);
+            ret->setHashes (hashes);
             if (hashValid)
                 ret->mHash = hash;
             else
@@ -165,6 +161,7 @@ SHAMapAbstractNode::make(Slice const& rawNode, std::uint32_t seq, SHANodeFormat
         {
             auto ret = std::make_shared<SHAMapInnerNode>(seq);
             // compressed inner
+            std::array<SHAMapHash, 16> hashes;
             for (int i = 0; i < (len / 33); ++i)
             {
                 int pos;
@@ -172,10 +169,9 @@ SHAMapAbstractNode::make(Slice const& rawNode, std::uint32_t seq, SHANodeFormat
                     Throw<std::runtime_error> ("short CI node");
                 if ((pos < 0) || (pos >= 16))
                     Throw<std::runtime_error> ("invalid CI node");
-                s.get256 (ret->mHashes[pos].as_uint256(), i * 33);
-                if (ret->mHashes[pos].isNonZero ())
-                    ret->mIsBranch |= (1 << pos);
+                s.get256 (hashes[pos].as_uint256(), i * 33);
             }
+            ret->setHashes (hashes);
             if (hashValid)
                 ret->mHash = hash;
             else
@@ -207,13 +203,10 @@ SHAMapAbstractNode::make(Slice const& rawNode, std::uint32_t seq, SHANodeFormat
                 Throw<std::runtime_error> ("invalid FI node");
 
             auto ret = std::make_shared<SHAMapInnerNodeV2>(seq);
+            std::array<SHAMapHash, 16> hashes;
             for (int i = 0; i < 16; ++i)
-            {
-                s.get256 (ret->mHashes[i].as_uint256(), i * 32);
-
-                if (ret->mHashes[i].isNonZero ())
-                    ret->mIsBranch |= (1 << i);
-            }
+                s.get256 (hashes[i].as_uint256(), i * 32);
+            ret->setHashes (hashes);
             ret->set_common(id.getDepth(), id.getNodeID());
             if (hashValid)
                 ret->mHash = hash;
@@ -225,6 +218,7 @@ SHAMapAbstractNode::make(Slice const& rawNode, std::uint32_t seq, SHANodeFormat
         {
             auto ret = std::make_shared<SHAMapInnerNodeV2>(seq);
             // compressed v2 inner
+            std::array<SHAMapHash, 16> hashes;
             for (int i = 0; i < (len / 33); ++i)
             {
                 int pos;
@@ -232,10 +226,9 @@ SHAMapAbstractNode::make(Slice const& rawNode, std::uint32_t seq, SHANodeFormat
                     Throw<std::runtime_error> ("short CI node");
                 if ((pos < 0) || (pos >= 16))
                     Throw<std::runtime_error> ("invalid CI node");
-                s.get256 (ret->mHashes[pos].as_uint256(), i * 33);
-                if (ret->mHashes[pos].isNonZero ())
-                    ret->mIsBranch |= (1 << pos);
+                s.get256 (hashes[pos].as_uint256(), i * 33);
             }
+            ret->setHashes (hashes);
             ret->set_common(id.getDepth(), id.getNodeID());
             if (hashValid)
                 ret->mHash = hash;
@@ -305,13 +298,10 @@ SHAMapAbstractNode::make(Slice const& rawNode, std::uint32_t seq, SHANodeFormat
             else
                 ret = std::make_shared<SHAMapInnerNode>(seq);
 
+            std::array<SHAMapHash, 16> hashes;
             for (int i = 0; i < 16; ++i)
-            {
-                s.get256 (ret->mHashes[i].as_uint256(), i * 32);
-
-                if (ret->mHashes[i].isNonZero ())
-                    ret->mIsBranch |= (1 << i);
-            }
+                s.get256 (hashes[i].as_uint256(), i * 32);
+            ret->setHashes (hashes);
 
             if (isV2)
             {
@@ -368,8 +358,8 @@ SHAMapInnerNode::updateHash()
         sha512_half_hasher h;
         using beast::hash_append;
         hash_append(h, HashPrefix::innerNode);
-        for(auto const& hh : mHashes)
-            hash_append(h, hh);
+        for (int i = 0; i < 16; ++i)
+            hash_append(h, getChildHash(i));
         nh = static_cast<typename
             sha512_half_hasher::result_type>(h);
     }
@@ -382,10 +372,11 @@ SHAMapInnerNode::updateHash()
 void
 SHAMapInnerNode::updateHashDeep()
 {
-    for (auto pos = 0; pos < 16; ++pos)
+    auto const count = getBranchCount();
+    for (auto i = 0; i < count; ++i)
     {
-        if (mChildren[pos] != nullptr)
-            mHashes[pos] = mChildren[pos]->getNodeHash();
+        if (mChildren[i] != nullptr)
+            mHashes[i] = mChildren[i]->getNodeHash();
     }
     updateHash();
 }
@@ -441,18 +432,18 @@ SHAMapInnerNode::addRaw(Serializer& s, SHANodeFormat format) const
         {
             s.add32 (HashPrefix::innerNode);
 
-            for (auto const& hh : mHashes)
-                s.add256 (hh.as_uint256());
+            for (int i = 0; i < 16; ++i)
+                s.add256 (getChildHash(i).as_uint256());
         }
         else  // format == snfWIRE
         {
             if (getBranchCount () < 12)
             {
                 // compressed node
-                for (int i = 0; i < mHashes.size(); ++i)
+                for (int i = 0; i < 16; ++i)
                     if (!isEmptyBranch (i))
                     {
-                        s.add256 (mHashes[i].as_uint256());
+                        s.add256 (getChildHash(i).as_uint256());
                         s.add8 (i);
                     }
 
@@ -460,8 +451,8 @@ SHAMapInnerNode::addRaw(Serializer& s, SHANodeFormat format) const
             }
             else
             {
-                for (auto const& hh : mHashes)
-                    s.add256 (hh.as_uint256());
+                for (int i = 0; i < 16; ++i)
+                    s.add256 (getChildHash(i).as_uint256());
 
                 s.add8 (2);
             }
@@ -479,7 +470,7 @@ SHAMapInnerNodeV2::addRaw(Serializer& s, SHANodeFormat format) const
         s.add32 (HashPrefix::innerNodeV2);
 
         for (int i = 0 ; i < 16; ++i)
-            s.add256 (mHashes[i].as_uint256());
+            s.add256 (getChildHash(i).as_uint256());
 
         s.add8(depth_);
 
@@ -592,13 +583,117 @@ bool SHAMapInnerNode::isEmpty () const
 int SHAMapInnerNode::getBranchCount () const
 {
     assert (isInner ());
+    return getChildIndex (16);
+}
+
+// Reallocate the packed arrays, preserving their contents
+void
+SHAMapInnerNode::resizeChildren (int capacity)
+{
+    auto const count = getBranchCount ();
+    assert ((capacity >= count) && (capacity <= 16));
+
+    std::unique_ptr<SHAMapHash[]> hashes;
+    std::unique_ptr<std::shared_ptr<SHAMapAbstractNode>[]> children;
+
+    if (capacity != 0)
+    {
+        hashes = std::make_unique<SHAMapHash[]> (capacity);
+        children = std::make_unique<
+            std::shared_ptr<SHAMapAbstractNode>[]> (capacity);
+
+        for (int i = 0; i < count; ++i)
+        {
+            hashes[i] = mHashes[i];
+            children[i] = std::move (mChildren[i]);
+        }
+    }
+
+    mHashes = std::move (hashes);
+    mChildren = std::move (children);
+    mCapacity = static_cast<std::uint8_t> (capacity);
+}
+
+// Make room for a new, empty branch
+void
+SHAMapInnerNode::addBranch (int branch)
+{
+    assert (isEmptyBranch (branch));
+
+    auto const count = getBranchCount ();
+    if (count == mCapacity)
+        resizeChildren ((count < 2) ? 2 : (count < 4) ? 4 : (count < 8) ? 8 : 16);
+
+    auto const index = getChildIndex (branch);
+    for (int i = count; i > index; --i)
+    {
+        mHashes[i] = mHashes[i - 1];
+        mChildren[i] = std::move (mChildren[i - 1]);
+    }
+
+    mHashes[index].zero ();
+    mChildren[index].reset ();
+    mIsBranch |= (1 << branch);
+}
+
+void
+SHAMapInnerNode::removeBranch (int branch)
+{
+    assert (!isEmptyBranch (branch));
+
+    auto const count = getBranchCount ();
+    for (int i = getChildIndex (branch); i < count - 1; ++i)
+    {
+        mHashes[i] = mHashes[i + 1];
+        mChildren[i] = std::move (mChildren[i + 1]);
+    }
+
+    mHashes[count - 1].zero ();
+    mChildren[count - 1].reset ();
+    mIsBranch &= ~(1 << branch);
+}
+
+// Initialize an empty node from a full set of branch hashes
+void
+SHAMapInnerNode::setHashes (std::array<SHAMapHash, 16> const& hashes)
+{
+    assert (mIsBranch == 0);
+
     int count = 0;
+    for (auto const& hash : hashes)
+    {
+        if (hash.isNonZero ())
+            ++count;
+    }
+
+    resizeChildren (count);
 
+    int index = 0;
     for (int i = 0; i < 16; ++i)
-        if (!isEmptyBranch (i))
-            ++count;
+    {
+        if (hashes[i].isNonZero ())
+        {
+            mHashes[index++] = hashes[i];
+            mIsBranch |= (1 << i);
+        }
+    }
+}
+
+// Caller must hold this node's childLock
+void
+SHAMapInnerNode::copyChildren (SHAMapInnerNode& to) const
+{
+    assert (to.mIsBranch == 0);
+
+    to.resizeChildren (mCapacity);
+    to.mIsBranch = mIsBranch;
 
-    return count;
+    auto const count = getBranchCount ();
+    for (int i = 0; i < count; ++i)
+    {
+        to.mHashes[i] = mHashes[i];
+        to.mChildren[i] = mChildren[i];
+    }
 }
 
 #ifdef BEAST_DEBUG
@@ -627,14 +722,14 @@ std::string
 SHAMapInnerNode::getString(const SHAMapNodeID & id) const
 {
     std::string ret = SHAMapAbstractNode::getString(id);
-    for (int i = 0; i < mHashes.size(); ++i)
+    for (int i = 0; i < 16; ++i)
     {
         if (!isEmptyBranch (i))
         {
             ret += "\nb";
             ret += beast::lexicalCastThrow <std::string> (i);
             ret += " = ";
-            ret += to_string (mHashes[i]);
+            ret += to_string (getChildHash (i));
         }
     }
     return ret;
@@ -670,13 +765,19 @@ SHAMapInnerNode::setChild(int m, std::shared_ptr<SHAMapAbstractNode> const& chil
     assert (mType == tnINNER);
     assert (mSeq != 0);
     assert (child.get() != this);
-    mHashes[m].zero();
     mHash.zero();
     if (child)
-        mIsBranch |= (1 << m);
-    else
-        mIsBranch &= ~ (1 << m);
-    mChildren[m] = child;
+    {
+        if (isEmptyBranch (m))
+            addBranch (m);
+        auto const i = getChildIndex (m);
+        mHashes[i].zero();
+        mChildren[i] = child;
+    }
+    else if (!isEmptyBranch (m))
+    {
+        removeBranch (m);
+    }
 }
 
 // finished modifying, now make shareable
@@ -687,8 +788,9 @@ void SHAMapInnerNode::shareChild (int m, std::shared_ptr<SHAMapAbstractNode> con
     assert (mSeq != 0);
     assert (child);
     assert (child.get() != this);
+    assert (!isEmptyBranch (m));
 
-    mChildren[m] = child;
+    mChildren[getChildIndex (m)] = child;
 }
 
 SHAMapAbstractNode*
@@ -697,8 +799,11 @@ SHAMapInnerNode::getChildPointer (int branch)
     assert (branch >= 0 && branch < 16);
     assert (isInner());
 
-    std::lock_guard <std::mutex> lock (childLock);
-    return mChildren[branch].get ();
+    if (isEmptyBranch (branch))
+        return nullptr;
+
+    std::lock_guard <std::mutex> lock (childLock());
+    return mChildren[getChildIndex (branch)].get ();
 }
 
 std::shared_ptr<SHAMapAbstractNode>
@@ -707,8 +812,11 @@ SHAMapInnerNode::getChild (int branch)
     assert (branch >= 0 && branch < 16);
     assert (isInner());
 
-    std::lock_guard <std::mutex> lock (childLock);
-    return mChildren[branch];
+    if (isEmptyBranch (branch))
+        return {};
+
+    std::lock_guard <std::mutex> lock (childLock());
+    return mChildren[getChildIndex (branch)];
 }
 
 std::shared_ptr<SHAMapAbstractNode>
@@ -717,20 +825,21 @@ SHAMapInnerNode::canonicalizeChild(int branch, std::shared_ptr<SHAMapAbstractNod
     assert (branch >= 0 && branch < 16);
     assert (isInner());
     assert (node);
-    assert (node->getNodeHash() == mHashes[branch]);
+    assert (node->getNodeHash() == getChildHash (branch));
 
-    std::lock_guard <std::mutex> lock (childLock);
-    if (mChildren[branch])
+    std::lock_guard <std::mutex> lock (childLock());
+    auto& child = mChildren[getChildIndex (branch)];
+    if (child)
     {
         // There is already a node hooked up, return it
-        node = mChildren[branch];
+        node = child;
     }
     else
     {
         // Hook this node up
         // node must not be a v2 inner node
         assert(std::dynamic_pointer_cast<SHAMapInnerNodeV2>(node) == nullptr);
-        mChildren[branch] = node;
+        child = node;
     }
     return node;
 }
@@ -741,13 +850,14 @@ SHAMapInnerNodeV2::canonicalizeChild(int branch, std::shared_ptr<SHAMapAbstractN
     assert (branch >= 0 && branch < 16);
     assert (isInner());
     assert (node);
-    assert (node->getNodeHash() == mHashes[branch]);
+    assert (node->getNodeHash() == getChildHash (branch));
 
-    std::lock_guard <std::mutex> lock (childLock);
-    if (mChildren[branch])
+    std::lock_guard <std::mutex> lock (childLock());
+    auto& child = mChildren[getChildIndex (branch)];
+    if (child)
     {
         // There is already a node hooked up, return it
-        node = mChildren[branch];
+        node = child;
     }
     else
     {
@@ -755,7 +865,7 @@ SHAMapInnerNodeV2::canonicalizeChild(int branch, std::shared_ptr<SHAMapAbstractN
         // node must not be a v1 inner node
         assert(std::dynamic_pointer_cast<SHAMapInnerNodeV2>(node) != nullptr ||
                std::dynamic_pointer_cast<SHAMapTreeNode>(node)    != nullptr);
-        mChildren[branch] = node;
+        child = node;
     }
     return node;
 }
@@ -827,10 +937,10 @@ SHAMapInnerNodeV2::setChildren(std::shared_ptr<SHAMapTreeNode> const& child1,
         b2 = *k2 >> 4;
         depth_ = 2*depth_;
     }
-    mChildren[b1] = child1;
-    mIsBranch |= 1 << b1;
-    mChildren[b2] = child2;
-    mIsBranch |= 1 << b2;
+    addBranch (b1);
+    mChildren[getChildIndex (b1)] = child1;
+    addBranch (b2);
+    mChildren[getChildIndex (b2)] = child2;
 }
 
 void
@@ -868,16 +978,17 @@ SHAMapInnerNode::invariants(bool is_v2, bool is_root) const
     unsigned count = 0;
     for (int i = 0; i < 16; ++i)
     {
-        if (mHashes[i].isNonZero())
+        if (getChildHash(i).isNonZero())
         {
-            assert((mIsBranch & (1 << i)) != 0);
-            if (mChildren[i] != nullptr)
-                mChildren[i]->invariants(is_v2);
+            assert(!isEmptyBranch(i));
+            auto const& child = mChildren[getChildIndex(i)];
+            if (child != nullptr)
+                child->invariants(is_v2);
             ++count;
         }
         else
         {
-            assert((mIsBranch & (1 << i)) == 0);
+            assert(isEmptyBranch(i));
         }
     }
     if (!is_root)
@@ -896,27 +1007,28 @@ SHAMapInnerNodeV2::invariants(bool is_v2, bool is_root) const
     unsigned count = 0;
     for (int i = 0; i < 16; ++i)
     {
-        if (mHashes[i].isNonZero())
+        if (getChildHash(i).isNonZero())
         {
-            assert((mIsBranch & (1 << i)) != 0);
-            if (mChildren[i] != nullptr)
+            assert(!isEmptyBranch(i));
+            auto const& child = mChildren[getChildIndex(i)];
+            if (child != nullptr)
             {
-                assert(mHashes[i] == mChildren[i]->getNodeHash());
+                assert(getChildHash(i) == child->getNodeHash());
 #ifndef NDEBUG
-                auto const& childID = mChildren[i]->key();
+                auto const& childID = child->key();
 
                 // Make sure this child it attached to the correct branch
                 SHAMapNodeID nodeID {depth(), common()};
                 assert (i == nodeID.selectBranch(childID));
 #endif
                 assert(has_common_prefix(childID));
-                mChildren[i]->invariants(is_v2);
+                child->invariants(is_v2);
             }
             ++count;
         }
         else
         {
-            assert((mIsBranch & (1 << i)) == 0);
+            assert(isEmptyBranch(i));
         }
     }
     if (!is_root)
@@ -943,4 +1055,22 @@ SHAMapTreeNode::invariants(bool, bool) const
     assert(mItem != nullptr);
 }
 
+std::size_t
+cachedSize (SHAMapAbstractNode const& node)
+{
+    if (node.isInner ())
+    {
+        // Each non-empty branch holds a hash and a child pointer
+        auto const& inner = static_cast<SHAMapInnerNode const&>(node);
+        return sizeof (SHAMapInnerNode) + inner.getBranchCount () *
+            (sizeof (SHAMapHash) + sizeof (std::shared_ptr<SHAMapAbstractNode>));
+    }
+
+    auto const& leaf = static_cast<SHAMapTreeNode const&>(node);
+    std::size_t bytes = sizeof (SHAMapTreeNode);
+    if (auto const& item = leaf.peekItem ())
+        bytes += sizeof (SHAMapItem) + item->size ();
+    return bytes;
+}
+
 } // ripple
@@ -18,6 +18,7 @@
 //==============================================================================
 #include <BeastConfig.h>
 
+#include <ripple/app/consensus/ConsensusVerifier.cpp>
 #include <ripple/app/consensus/RCLConsensus.cpp>
 #include <ripple/app/consensus/RCLCxPeerPos.cpp>
 #include <ripple/app/consensus/RCLValidations.cpp>
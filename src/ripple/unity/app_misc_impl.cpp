@@ -21,8 +21,12 @@
 
 #include <ripple/app/misc/impl/AccountTxPaging.cpp>
 #include <ripple/app/misc/impl/AmendmentTable.cpp>
+#include <ripple/app/misc/impl/HistoryStore.cpp>
 #include <ripple/app/misc/impl/LoadFeeTrack.cpp>
 #include <ripple/app/misc/impl/Manifest.cpp>
+#include <ripple/app/misc/impl/PartitionedHistoryStore.cpp>
+#include <ripple/app/misc/impl/RocksDBHistoryStore.cpp>
+#include <ripple/app/misc/impl/SQLiteHistoryStore.cpp>
 #include <ripple/app/misc/impl/Transaction.cpp>
 #include <ripple/app/misc/impl/TxQ.cpp>
 #include <ripple/app/misc/impl/ValidatorList.cpp>
@@ -26,6 +26,7 @@
 #include <ripple/core/impl/Job.cpp>
 #include <ripple/core/impl/JobQueue.cpp>
 #include <ripple/core/impl/SNTPClock.cpp>
+#include <ripple/core/impl/StealingJobSet.cpp>
 #include <ripple/core/impl/Stoppable.cpp>
 #include <ripple/core/impl/TerminateHandler.cpp>
 #include <ripple/core/impl/TimeKeeper.cpp>
@@ -45,6 +45,7 @@
 #include <ripple/rpc/handlers/FetchInfo.cpp>
 #include <ripple/rpc/handlers/GatewayBalances.cpp>
 #include <ripple/rpc/handlers/GetCounts.cpp>
+#include <ripple/rpc/handlers/JobLatency.cpp>
 #include <ripple/rpc/handlers/LedgerHandler.cpp>
 #include <ripple/rpc/handlers/LedgerAccept.cpp>
 #include <ripple/rpc/handlers/LedgerCleanerHandler.cpp>
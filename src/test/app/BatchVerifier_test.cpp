@@ -0,0 +1,546 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <ripple/app/misc/HashRouter.h>
+#include <ripple/app/tx/apply.h>
+#include <ripple/app/tx/BatchVerifier.h>
+#include <ripple/basics/chrono.h>
+#include <ripple/core/Stoppable.h>
+#include <ripple/protocol/Feature.h>
+#include <ripple/protocol/PublicKey.h>
+#include <ripple/protocol/SecretKey.h>
+#include <ripple/protocol/impl/secp256k1.h>
+#include <ripple/basics/StringUtilities.h>
+#include <ripple/beast/unit_test.h>
+#include <ripple/beast/xor_shift_engine.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace ripple {
+namespace test {
+
+// The flags checkValidity uses to cache signature results
+int constexpr sigBad = SF_PRIVATE1;
+int constexpr sigGood = SF_PRIVATE2;
+int constexpr sigKnown = sigBad | sigGood;
+
+// Builds signed transactions, some of them with bad signatures
+class SignedTxs
+{
+public:
+    // Every `badEvery` transaction has a bad signature
+    static
+    std::vector<std::shared_ptr<STTx const>>
+    make (std::size_t count, KeyType type, std::size_t badEvery = 0)
+    {
+        std::vector<std::shared_ptr<STTx const>> result;
+        result.reserve (count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            auto const keys = randomKeyPair (type);
+            auto tx = std::make_shared<STTx> (ttACCOUNT_SET,
+                [&keys, i](auto& obj)
+                {
+                    obj.setAccountID (sfAccount, calcAccountID (keys.first));
+                    obj.setFieldVL (sfSigningPubKey, keys.first.slice());
+                    obj.setFieldU32 (sfSequence, i + 1);
+                });
+            if (badEvery && (i % badEvery == 0))
+                tx->sign (keys.first, randomKeyPair (type).second);
+            else
+                tx->sign (keys.first, keys.second);
+            result.push_back (std::move (tx));
+        }
+        return result;
+    }
+
+    static
+    bool
+    isBad (std::size_t i, std::size_t badEvery)
+    {
+        return badEvery && (i % badEvery == 0);
+    }
+};
+
+class BatchVerifier_test : public beast::unit_test::suite
+{
+public:
+    static
+    BatchVerifier::Setup
+    enabled (std::size_t threads, std::size_t batchSize)
+    {
+        BatchVerifier::Setup setup;
+        setup.threads = threads;
+        setup.batchSize = batchSize;
+        return setup;
+    }
+
+    void
+    testCheckSignatures ()
+    {
+        testcase ("check signatures");
+
+        using namespace std::chrono_literals;
+        TestStopwatch clock;
+        HashRouter router (clock, 300s, 2);
+
+        auto txs = SignedTxs::make (100, KeyType::ed25519, 7);
+        auto const secp = SignedTxs::make (10, KeyType::secp256k1, 3);
+        txs.insert (txs.end(), secp.begin(), secp.end());
+
+        // A known result is kept
+        router.setFlags (txs[1]->getTransactionID(), sigBad);
+
+        checkSignatures (router, txs);
+
+        auto const isBad = [](std::size_t i)
+        {
+            if (i >= 100)
+                return SignedTxs::isBad (i - 100, 3);
+            return i == 1 || SignedTxs::isBad (i, 7);
+        };
+
+        for (std::size_t i = 0; i < txs.size(); ++i)
+        {
+            auto const flags = router.getFlags (txs[i]->getTransactionID());
+            if (isBad (i))
+                BEAST_EXPECT((flags & sigKnown) == sigBad);
+            else
+                BEAST_EXPECT((flags & sigKnown) == sigGood);
+        }
+
+        // checkValidity agrees with the cached results
+        std::unordered_set<uint256, beast::uhash<>> const presets {
+            featureMultiSign };
+        Rules const rules (presets);
+        Config const config;
+        for (std::size_t i = 0; i < txs.size(); ++i)
+        {
+            auto const validity = checkValidity (
+                router, *txs[i], rules, config).first;
+            if (isBad (i))
+                BEAST_EXPECT(validity == Validity::SigBad);
+            else
+                BEAST_EXPECT(validity == Validity::Valid);
+        }
+
+        // Multi-signed transactions are left for checkValidity
+        auto const keys = randomKeyPair (KeyType::ed25519);
+        auto const multi = std::make_shared<STTx const> (ttACCOUNT_SET,
+            [&keys](auto& obj)
+            {
+                obj.setAccountID (sfAccount, calcAccountID (keys.first));
+                obj.setFieldVL (sfSigningPubKey, Slice{});
+            });
+        checkSignatures (router, { multi });
+        BEAST_EXPECT(router.getFlags (multi->getTransactionID()) == 0);
+    }
+
+    void
+    testDisabled ()
+    {
+        testcase ("disabled");
+
+        using namespace std::chrono_literals;
+        TestStopwatch clock;
+        HashRouter router (clock, 300s, 2);
+        RootStoppable parent ("TestRootStoppable");
+        BatchVerifier verifier (parent, BatchVerifier::Setup{},
+            router, beast::Journal());
+        parent.prepare ();
+        parent.start ();
+
+        auto const txs = SignedTxs::make (3, KeyType::ed25519);
+        int called = 0;
+        for (auto const& tx : txs)
+            verifier.check (tx, [&called]{ ++called; });
+        verifier.check (txs[0]);
+        BEAST_EXPECT(called == 3);
+        for (auto const& tx : txs)
+            BEAST_EXPECT(router.getFlags (tx->getTransactionID()) == 0);
+
+        parent.stop (beast::Journal());
+    }
+
+    void
+    testThreads (std::size_t threads)
+    {
+        testcase ("threads: " + std::to_string (threads));
+
+        using namespace std::chrono_literals;
+        TestStopwatch clock;
+        HashRouter router (clock, 300s, 2);
+        RootStoppable parent ("TestRootStoppable");
+        BatchVerifier verifier (parent,
+            enabled (threads, 16),
+            router, beast::Journal());
+        parent.prepare ();
+        parent.start ();
+
+        auto txs = SignedTxs::make (200, KeyType::ed25519, 9);
+        auto const secp = SignedTxs::make (40, KeyType::secp256k1, 9);
+        txs.insert (txs.end(), secp.begin(), secp.end());
+        std::atomic<std::size_t> called (0);
+
+        // Several peers delivering transactions at once
+        std::vector<std::thread> peers;
+        for (std::size_t t = 0; t < 4; ++t)
+        {
+            peers.emplace_back (
+                [&, t]
+                {
+                    for (std::size_t i = t; i < txs.size(); i += 4)
+                        verifier.check (txs[i], [&called]{ ++called; });
+                });
+        }
+        for (auto& peer : peers)
+            peer.join ();
+
+        // A client waiting for its result
+        auto const client = SignedTxs::make (1, KeyType::ed25519);
+        verifier.check (client[0]);
+        BEAST_EXPECT(router.getFlags (
+            client[0]->getTransactionID()) & sigGood);
+
+        parent.stop (beast::Journal());
+        BEAST_EXPECT(called == txs.size());
+        BEAST_EXPECT(verifier.pending () == 0);
+
+        for (std::size_t i = 0; i < txs.size(); ++i)
+        {
+            auto const flags = router.getFlags (txs[i]->getTransactionID());
+            BEAST_EXPECT((flags & sigKnown) ==
+                (SignedTxs::isBad (i % 200, 9) ? sigBad : sigGood));
+        }
+
+        // Once stopped, signatures are left for checkValidity
+        auto const late = SignedTxs::make (1, KeyType::ed25519);
+        bool lateCalled = false;
+        verifier.check (late[0], [&lateCalled]{ lateCalled = true; });
+        BEAST_EXPECT(lateCalled);
+        BEAST_EXPECT(router.getFlags (late[0]->getTransactionID()) == 0);
+    }
+
+    void
+    testStopDrains ()
+    {
+        testcase ("stop checks queued transactions");
+
+        using namespace std::chrono_literals;
+        TestStopwatch clock;
+        HashRouter router (clock, 300s, 2);
+        RootStoppable parent ("TestRootStoppable");
+
+        BatchVerifier verifier (parent, enabled (2, 64),
+            router, beast::Journal());
+        parent.prepare ();
+        parent.start ();
+
+        auto const txs = SignedTxs::make (10, KeyType::ed25519, 4);
+        std::atomic<std::size_t> called (0);
+        for (auto const& tx : txs)
+            verifier.check (tx, [&called]{ ++called; });
+
+        parent.stop (beast::Journal());
+        BEAST_EXPECT(called == txs.size());
+        for (std::size_t i = 0; i < txs.size(); ++i)
+        {
+            auto const flags = router.getFlags (txs[i]->getTransactionID());
+            BEAST_EXPECT((flags & sigKnown) ==
+                (SignedTxs::isBad (i, 4) ? sigBad : sigGood));
+        }
+    }
+
+    void
+    testSetup ()
+    {
+        testcase ("setup");
+
+        {
+            Config c;
+            auto const setup = setup_BatchVerifier (c);
+            BEAST_EXPECT(setup.threads == std::thread::hardware_concurrency());
+            BEAST_EXPECT(setup.batchSize == 64);
+        }
+        {
+            Config c;
+            c.section ("signature_batch").set ("threads", "3");
+            c.section ("signature_batch").set ("batch_size", "0");
+            auto const setup = setup_BatchVerifier (c);
+            BEAST_EXPECT(setup.threads == 3);
+            BEAST_EXPECT(setup.batchSize == 1);
+        }
+        {
+            Config c;
+            c.section ("signature_batch").set ("threads", "0");
+            BEAST_EXPECT(setup_BatchVerifier (c).threads == 0);
+        }
+    }
+
+    void
+    run() override
+    {
+        testCheckSignatures ();
+        testDisabled ();
+        testThreads (1);
+        testThreads (4);
+        testStopDrains ();
+        testSetup ();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// Reports secp256k1 verifications per second, parsing the public key
+// for each signature as verify used to, and with the parsed key cache.
+// Then reports the throughput of verifiers with more threads.
+//
+// The transactions are read from the file named by the argument, which
+// holds one hex-encoded signed transaction per line. Without one, a
+// synthetic set is signed where a few hot accounts sign most of the
+// transactions.
+class SignatureCheckTiming_test : public beast::unit_test::suite
+{
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    static
+    std::vector<std::shared_ptr<STTx const>>
+    load (std::string const& path)
+    {
+        std::vector<std::shared_ptr<STTx const>> result;
+        std::ifstream in (path);
+        std::string line;
+        while (std::getline (in, line))
+        {
+            auto const blob = strUnHex (line);
+            if (! blob.second || blob.first.empty())
+                continue;
+            try
+            {
+                SerialIter sit (makeSlice (blob.first));
+                result.push_back (std::make_shared<STTx const> (sit));
+            }
+            catch (std::exception const&)
+            {
+            }
+        }
+        return result;
+    }
+
+    static
+    std::vector<std::shared_ptr<STTx const>>
+    synthetic (std::size_t count, std::size_t accounts)
+    {
+        std::vector<std::pair<PublicKey, SecretKey>> keys;
+        for (std::size_t i = 0; i < accounts; ++i)
+            keys.push_back (randomKeyPair (KeyType::secp256k1));
+
+        // Account i signs in proportion to 1 / (i + 1)
+        std::vector<double> weights;
+        for (std::size_t i = 0; i < accounts; ++i)
+            weights.push_back (1.0 / (i + 1));
+        std::discrete_distribution<std::size_t> pick (
+            weights.begin(), weights.end());
+        beast::xor_shift_engine gen (accounts);
+
+        std::vector<std::shared_ptr<STTx const>> result;
+        result.reserve (count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            auto const& kp = keys[pick (gen)];
+            auto tx = std::make_shared<STTx> (ttACCOUNT_SET,
+                [&kp, i](auto& obj)
+                {
+                    obj.setAccountID (sfAccount, calcAccountID (kp.first));
+                    obj.setFieldVL (sfSigningPubKey, kp.first.slice());
+                    obj.setFieldU32 (sfSequence, i + 1);
+                });
+            tx->sign (kp.first, kp.second);
+            result.push_back (std::move (tx));
+        }
+        return result;
+    }
+
+    // Verify as verifyDigest did before keys were cached
+    static
+    bool
+    verifyUncached (PublicKey const& publicKey,
+        uint256 const& digest, Slice const& sig)
+    {
+        auto const canonicality = ecdsaCanonicality (sig);
+        if (! canonicality)
+            return false;
+
+        secp256k1_pubkey pubkey_imp;
+        if(secp256k1_ec_pubkey_parse(
+                secp256k1Context(),
+                &pubkey_imp,
+                reinterpret_cast<unsigned char const*>(
+                    publicKey.data()),
+                publicKey.size()) != 1)
+            return false;
+
+        secp256k1_ecdsa_signature sig_imp;
+        if(secp256k1_ecdsa_signature_parse_der(
+                secp256k1Context(),
+                &sig_imp,
+                reinterpret_cast<unsigned char const*>(
+                    sig.data()),
+                sig.size()) != 1)
+            return false;
+        if (*canonicality != ECDSACanonicality::fullyCanonical)
+            secp256k1_ecdsa_signature_normalize(
+                secp256k1Context(), &sig_imp, &sig_imp);
+        return secp256k1_ecdsa_verify(
+            secp256k1Context(),
+            &sig_imp,
+            reinterpret_cast<unsigned char const*>(
+                digest.data()),
+            &pubkey_imp) == 1;
+    }
+
+    void
+    run() override
+    {
+        using namespace std::chrono_literals;
+
+#ifndef NDEBUG
+        std::size_t const count = 4000;
+#else
+        std::size_t const count = 40000;
+#endif
+
+        auto const txs = arg().empty() ?
+            synthetic (count, 500) : load (arg());
+        if (! BEAST_EXPECT(! txs.empty()))
+            return;
+
+        // The single-signed secp256k1 transactions
+        struct Signed
+        {
+            PublicKey publicKey;
+            uint256 digest;
+            Blob sig;
+        };
+        std::vector<Signed> secp;
+        for (auto const& tx : txs)
+        {
+            auto const spk = tx->getSigningPubKey();
+            if (publicKeyType (makeSlice (spk)) != KeyType::secp256k1)
+                continue;
+            secp.push_back ({ PublicKey (makeSlice (spk)),
+                tx->getSigningHash(), tx->getSignature() });
+        }
+
+        auto const perSecond = [](std::size_t n, clock_type::duration d)
+        {
+            std::stringstream ss;
+            ss << std::fixed << std::setprecision(0) <<
+                n / std::chrono::duration_cast<
+                    std::chrono::duration<double>>(d).count();
+            return ss.str();
+        };
+
+        log << txs.size() << " transactions, " <<
+            secp.size() << " single-signed with secp256k1" << std::endl;
+        log << std::setw(16) << "secp256k1" <<
+            std::setw(16) << "verify/sec" << std::endl;
+
+        for (bool const cached : { false, true })
+        {
+            std::size_t valid = 0;
+            auto const start = clock_type::now();
+            for (auto const& s : secp)
+            {
+                bool const ok = cached ?
+                    verifyDigest (s.publicKey, s.digest,
+                        makeSlice (s.sig), false) :
+                    verifyUncached (s.publicKey, s.digest,
+                        makeSlice (s.sig));
+                if (ok)
+                    ++valid;
+            }
+            log << std::setw(16) << (cached ? "cached keys" : "parse keys") <<
+                std::setw(16) << perSecond (secp.size(),
+                    clock_type::now() - start) << std::endl;
+            BEAST_EXPECT(valid == secp.size());
+        }
+
+        log << std::setw(16) << "threads" <<
+            std::setw(16) << "checks/sec" <<
+            std::setw(16) << "per thread" << std::endl;
+
+        std::size_t const cores = std::max (1u,
+            std::thread::hardware_concurrency());
+        for (std::size_t threads = 1; threads <= cores; threads *= 2)
+        {
+            TestStopwatch clock;
+            HashRouter router (clock, 300s, 2);
+            RootStoppable parent ("TestRootStoppable");
+            BatchVerifier verifier (parent,
+                BatchVerifier_test::enabled (threads, 64),
+                router, beast::Journal());
+            parent.prepare ();
+            parent.start ();
+
+            // Peers delivering the transactions
+            std::atomic<std::size_t> called (0);
+            auto const start = clock_type::now();
+            std::vector<std::thread> peers;
+            for (std::size_t t = 0; t < 4; ++t)
+            {
+                peers.emplace_back (
+                    [&, t]
+                    {
+                        for (std::size_t i = t; i < txs.size(); i += 4)
+                            verifier.check (txs[i], [&called]{ ++called; });
+                    });
+            }
+            for (auto& peer : peers)
+                peer.join ();
+            while (called < txs.size())
+                std::this_thread::sleep_for (100us);
+            auto const elapsed = clock_type::now() - start;
+
+            log << std::setw(16) << threads <<
+                std::setw(16) << perSecond (txs.size(), elapsed) <<
+                std::setw(16) << perSecond (txs.size(), elapsed * threads) <<
+                std::endl;
+
+            parent.stop (beast::Journal());
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(BatchVerifier,app,ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(SignatureCheckTiming,app,ripple);
+
+} // test
+} // ripple
@@ -0,0 +1,470 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <ripple/unity/rocksdb.h>
+#include <ripple/app/main/DBInit.h>
+#include <ripple/app/misc/HistoryStore.h>
+#include <ripple/beast/unit_test.h>
+#include <ripple/beast/utility/temp_dir.h>
+#include <test/app/SyntheticLedgers.h>
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <iomanip>
+#include <map>
+
+namespace ripple {
+namespace test {
+
+class HistoryStore_test : public beast::unit_test::suite
+{
+public:
+    using Position = std::pair<std::uint32_t, std::uint32_t>;
+
+    // What a store should hold after a sequence of changes
+    class Model
+    {
+    private:
+        struct Entry
+        {
+            std::uint32_t ledgerSeq;
+            std::uint32_t txnSeq;
+            std::vector<AccountID> affected;
+        };
+
+        std::map<uint256, Entry> txs_;
+
+    public:
+        void
+        save (LedgerSQLRows const& rows)
+        {
+            deleteIf ([&rows](std::uint32_t seq)
+                { return seq == rows.info.seq; });
+            for (auto const& txn : rows.transactions)
+                txs_[txn.id] = { rows.info.seq, txn.txnSeq, txn.affected };
+        }
+
+        template <class Predicate>
+        void
+        deleteIf (Predicate p)
+        {
+            for (auto iter = txs_.begin (); iter != txs_.end ();)
+            {
+                if (p (iter->second.ledgerSeq))
+                    iter = txs_.erase (iter);
+                else
+                    ++iter;
+            }
+        }
+
+        std::vector<Position>
+        history (AccountID const& account, std::uint32_t minLedger,
+            std::uint32_t maxLedger, bool forward) const
+        {
+            std::vector<Position> ret;
+            for (auto const& tx : txs_)
+            {
+                auto const& e = tx.second;
+                if (e.ledgerSeq >= minLedger && e.ledgerSeq <= maxLedger &&
+                    std::find (e.affected.begin (), e.affected.end (),
+                        account) != e.affected.end ())
+                    ret.emplace_back (e.ledgerSeq, e.txnSeq);
+            }
+            std::sort (ret.begin (), ret.end ());
+            if (! forward)
+                std::reverse (ret.begin (), ret.end ());
+            return ret;
+        }
+
+        bool
+        contains (uint256 const& id) const
+        {
+            return txs_.count (id) != 0;
+        }
+    };
+
+    // Read an account's history a page at a time, the way account_tx
+    // does, by asking for one more transaction than the page holds
+    static
+    std::vector<Position>
+    page (HistoryStore& store, AccountID const& account,
+        std::uint32_t minLedger, std::uint32_t maxLedger, bool forward,
+        std::uint32_t pageSize)
+    {
+        std::vector<Position> ret;
+        boost::optional<HistoryStore::Position> start;
+        for (;;)
+        {
+            std::vector<Position> got;
+            store.forEachAccountTx (account, minLedger, maxLedger, forward,
+                start, pageSize + 1,
+                [&got](HistoryStore::Tx&& tx)
+                {
+                    got.emplace_back (tx.ledgerSeq, tx.txnSeq);
+                });
+
+            if (got.size () <= pageSize)
+            {
+                ret.insert (ret.end (), got.begin (), got.end ());
+                return ret;
+            }
+
+            ret.insert (ret.end (), got.begin (), got.end () - 1);
+            start.emplace ();
+            start->ledgerSeq = got.back ().first;
+            start->txnSeq = got.back ().second;
+        }
+    }
+
+    void
+    expectHistory (HistoryStore& store, Model const& model,
+        std::vector<AccountID> const& accounts)
+    {
+        for (auto const& account : accounts)
+        {
+            for (bool const forward : { true, false })
+            {
+                BEAST_EXPECT(page (store, account, 0, 1000, forward, 7) ==
+                    model.history (account, 0, 1000, forward));
+                BEAST_EXPECT(page (store, account, 5, 12, forward, 3) ==
+                    model.history (account, 5, 12, forward));
+            }
+
+            auto const expected = model.history (account, 4, 1000, false);
+            auto const txs = store.getAccountTxs (
+                account, 4, 1000, true, 5, 10);
+            std::vector<Position> got;
+            for (auto const& tx : txs)
+                got.emplace_back (tx.ledgerSeq, tx.txnSeq);
+            if (expected.size () <= 5)
+                BEAST_EXPECT(got.empty ());
+            else
+                BEAST_EXPECT(got == std::vector<Position> (
+                    expected.begin () + 5, expected.begin () +
+                        std::min<std::size_t> (expected.size (), 15)));
+
+            // Pages counted by offset, as the old account_tx reads them
+            for (bool const descending : { false, true })
+            {
+                got.clear ();
+                for (std::uint32_t offset = 0;; offset += 4)
+                {
+                    auto const txs = store.getAccountTxs (
+                        account, 3, 1000, descending, offset, 4);
+                    for (auto const& tx : txs)
+                        got.emplace_back (tx.ledgerSeq, tx.txnSeq);
+                    if (txs.size () < 4)
+                        break;
+                }
+                BEAST_EXPECT(got ==
+                    model.history (account, 3, 1000, ! descending));
+            }
+        }
+    }
+
+    void
+    testStore (Section const& section)
+    {
+        beast::temp_dir dir;
+        DatabaseCon::Setup setup;
+        setup.dataDir = dir.path ();
+        DatabaseCon txnDB (setup, "transaction.db", TxnDBInit, TxnDBCount);
+        AccountIDCache idCache (1000);
+
+        auto store = make_HistoryStore (
+            section, setup, txnDB, idCache, beast::Journal());
+
+        // Few accounts, so each has a long history
+        SyntheticLedgers gen (7, 12);
+        Model model;
+
+        std::vector<std::shared_ptr<LedgerSQLRows>> ledgers;
+        for (LedgerIndex seq = 2; seq < 22; ++seq)
+        {
+            ledgers.push_back (gen.make (seq, 10, 3));
+            store->saveTransactions (*ledgers.back ());
+            model.save (*ledgers.back ());
+        }
+        expectHistory (*store, model, gen.accounts ());
+
+        // Transactions are found by ID
+        {
+            auto const& txn = ledgers[3]->transactions[2];
+            auto const tx = store->getTransaction (txn.id);
+            if (BEAST_EXPECT(tx))
+            {
+                BEAST_EXPECT(tx->ledgerSeq == 5);
+                BEAST_EXPECT(tx->status &&
+                    *tx->status == std::string (1, TXN_SQL_VALIDATED));
+                BEAST_EXPECT(tx->raw == txn.raw);
+            }
+            BEAST_EXPECT(! store->getTransaction (uint256 (1)));
+        }
+
+        // Recent transactions come first
+        {
+            auto const txs = store->getTxHistory (5, 10);
+            BEAST_EXPECT(txs.size () == 10);
+            for (auto const& tx : txs)
+                BEAST_EXPECT(tx.ledgerSeq == 20 || tx.ledgerSeq == 21);
+            BEAST_EXPECT(store->getTxHistory (200, 10).empty ());
+        }
+
+        // Saving a ledger again replaces its transactions
+        {
+            auto const replaced = ledgers[8];
+            ledgers[8] = gen.make (replaced->info.seq, 4, 5);
+            store->saveTransactions (*ledgers[8]);
+            model.save (*ledgers[8]);
+            BEAST_EXPECT(! store->getTransaction (
+                replaced->transactions[0].id));
+            expectHistory (*store, model, gen.accounts ());
+        }
+
+        // A new ledger comes first in newest-first pages
+        {
+            ledgers.push_back (gen.make (22, 10, 3));
+            store->saveTransactions (*ledgers.back ());
+            model.save (*ledgers.back ());
+            expectHistory (*store, model, gen.accounts ());
+        }
+
+        // A transaction saved in another ledger is moved, even to
+        // a ledger in another partition
+        {
+            auto rows = gen.make (23, 2, 2);
+            rows->transactions[1] = ledgers[17]->transactions[4];
+            rows->transactions[1].txnSeq = 1;
+            store->saveTransactions (*rows);
+            model.save (*rows);
+            auto const tx = store->getTransaction (
+                rows->transactions[1].id);
+            BEAST_EXPECT(tx && tx->ledgerSeq == 23);
+            expectHistory (*store, model, gen.accounts ());
+        }
+
+        // Old ledgers are deleted
+        {
+            BEAST_EXPECT(store->getMinLedgerSeq () == LedgerIndex (2));
+            store->deleteBeforeLedgerSeq (8);
+            model.deleteIf ([](std::uint32_t seq) { return seq < 8; });
+            BEAST_EXPECT(store->getMinLedgerSeq () == LedgerIndex (8));
+            BEAST_EXPECT(! store->getTransaction (
+                ledgers[0]->transactions[0].id));
+            expectHistory (*store, model, gen.accounts ());
+        }
+    }
+
+    void
+    testPartitions ()
+    {
+        testcase ("partitions");
+
+        using namespace boost::filesystem;
+
+        beast::temp_dir dir;
+        DatabaseCon::Setup setup;
+        setup.dataDir = dir.path ();
+        DatabaseCon txnDB (setup, "transaction.db", TxnDBInit, TxnDBCount);
+        AccountIDCache idCache (1000);
+
+        Section section;
+        section.set ("type", "sqlite");
+        section.set ("ledgers_per_partition", "10");
+
+        auto const partition = [&setup](int index)
+        {
+            return setup.dataDir /
+                ("transaction." + std::to_string (index) + ".db");
+        };
+
+        SyntheticLedgers gen (3, 8);
+        Model model;
+        {
+            auto store = make_HistoryStore (
+                section, setup, txnDB, idCache, beast::Journal());
+            for (LedgerIndex seq = 5; seq < 35; ++seq)
+            {
+                auto const rows = gen.make (seq, 4, 2);
+                store->saveTransactions (*rows);
+                model.save (*rows);
+            }
+            BEAST_EXPECT(exists (partition (0)));
+            BEAST_EXPECT(exists (partition (3)));
+            BEAST_EXPECT(! exists (partition (4)));
+        }
+
+        // The partitions are found again when the store is reopened
+        auto store = make_HistoryStore (
+            section, setup, txnDB, idCache, beast::Journal());
+        BEAST_EXPECT(store->getMinLedgerSeq () == LedgerIndex (5));
+        expectHistory (*store, model, gen.accounts ());
+
+        // Whole partitions are removed with their files
+        store->deleteBeforeLedgerSeq (20);
+        model.deleteIf ([](std::uint32_t seq) { return seq < 20; });
+        BEAST_EXPECT(! exists (partition (0)));
+        BEAST_EXPECT(! exists (partition (1)));
+        BEAST_EXPECT(exists (partition (2)));
+        BEAST_EXPECT(store->getMinLedgerSeq () == LedgerIndex (20));
+        expectHistory (*store, model, gen.accounts ());
+
+        // Part of a partition is deleted from its tables
+        store->deleteBeforeLedgerSeq (25);
+        model.deleteIf ([](std::uint32_t seq) { return seq < 25; });
+        BEAST_EXPECT(exists (partition (2)));
+        BEAST_EXPECT(store->getMinLedgerSeq () == LedgerIndex (25));
+        expectHistory (*store, model, gen.accounts ());
+    }
+
+    void
+    run () override
+    {
+        {
+            testcase ("sqlite");
+            Section section;
+            section.set ("type", "sqlite");
+            testStore (section);
+        }
+        {
+            // Small partitions, so account histories span several
+            testcase ("sqlite partitions");
+            Section section;
+            section.set ("type", "sqlite");
+            section.set ("ledgers_per_partition", "4");
+            section.set ("open_partitions", "2");
+            testStore (section);
+        }
+    #if RIPPLE_ROCKSDB_AVAILABLE
+        {
+            testcase ("rocksdb");
+            Section section;
+            section.set ("type", "rocksdb");
+            testStore (section);
+        }
+    #endif
+        testPartitions ();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// Reports how long it takes to read a page of an account's history
+// as the number of stored transactions grows, both from a position
+// and counted by offset from the newest transaction.
+class HistoryStoreTiming_test : public beast::unit_test::suite
+{
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    void
+    run () override
+    {
+        std::vector<std::pair<std::string, std::string>> types {
+            { "sqlite", "0" }, { "sqlite", "2000" } };
+    #if RIPPLE_ROCKSDB_AVAILABLE
+        types.emplace_back ("rocksdb", "0");
+    #endif
+
+        std::size_t const txnsPerLedger = 50;
+        std::size_t const pages = 200;
+
+        log << std::setw(10) << "type" <<
+            std::setw(12) << "partition" <<
+            std::setw(12) << "txns" <<
+            std::setw(14) << "save us/lgr" <<
+            std::setw(14) << "page us" <<
+            std::setw(14) << "offset us" << std::endl;
+
+        for (auto const& type : types)
+        {
+            beast::temp_dir dir;
+            DatabaseCon::Setup setup;
+            setup.dataDir = dir.path ();
+            DatabaseCon txnDB (setup, "transaction.db",
+                TxnDBInit, TxnDBCount);
+            AccountIDCache idCache (1000);
+
+            Section section;
+            section.set ("type", type.first);
+            section.set ("ledgers_per_partition", type.second);
+            auto store = make_HistoryStore (
+                section, setup, txnDB, idCache, beast::Journal());
+
+            SyntheticLedgers gen (1, 500);
+            beast::xor_shift_engine rng (2);
+            LedgerIndex seq = 2;
+
+            for (std::size_t ledgers : { 500, 2000, 8000, 32000 })
+            {
+                auto start = clock_type::now ();
+                std::size_t saved = 0;
+                for (; seq < ledgers + 2; ++seq, ++saved)
+                    store->saveTransactions (
+                        *gen.make (seq, txnsPerLedger, 4));
+                auto const save = std::chrono::duration_cast<
+                    std::chrono::microseconds>(clock_type::now () - start);
+
+                // Pages of 20 starting in a random ledger
+                start = clock_type::now ();
+                std::size_t found = 0;
+                for (std::size_t i = 0; i < pages; ++i)
+                {
+                    auto const& account =
+                        gen.accounts ()[rng () % gen.accounts ().size ()];
+                    store->forEachAccountTx (account,
+                        2 + rng () % (seq - 2), seq, rng () % 2 == 0,
+                        boost::none, 21,
+                        [&found](HistoryStore::Tx&&) { ++found; });
+                }
+                auto const read = std::chrono::duration_cast<
+                    std::chrono::microseconds>(clock_type::now () - start);
+                BEAST_EXPECT(found != 0);
+
+                // Up to 100 consecutive pages of 20 by offset
+                start = clock_type::now ();
+                std::size_t offsetPages = 0;
+                for (std::uint32_t offset = 0; offsetPages < 100;
+                    offset += 20, ++offsetPages)
+                {
+                    if (store->getAccountTxs (gen.accounts ()[0],
+                            0, seq, true, offset, 20).size () < 20)
+                        break;
+                }
+                auto const offsetRead = std::chrono::duration_cast<
+                    std::chrono::microseconds>(clock_type::now () - start);
+
+                log << std::setw(10) << type.first <<
+                    std::setw(12) << type.second <<
+                    std::setw(12) << (seq - 2) * txnsPerLedger <<
+                    std::setw(14) << save.count () / saved <<
+                    std::setw(14) << read.count () / pages <<
+                    std::setw(14) << offsetRead.count () /
+                        std::max<std::size_t> (offsetPages, 1) << std::endl;
+            }
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(HistoryStore,app,ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(HistoryStoreTiming,app,ripple);
+
+} // test
+} // ripple
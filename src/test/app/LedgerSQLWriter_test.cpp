@@ -0,0 +1,473 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <ripple/app/ledger/LedgerSQLWriter.h>
+#include <ripple/app/main/DBInit.h>
+#include <ripple/app/misc/HistoryStore.h>
+#include <ripple/basics/StringUtilities.h>
+#include <ripple/beast/unit_test.h>
+#include <ripple/beast/utility/temp_dir.h>
+#include <ripple/core/Stoppable.h>
+#include <ripple/protocol/STTx.h>
+#include <test/app/RecordedLedgers.h>
+#include <test/app/SyntheticLedgers.h>
+#include <boost/algorithm/string.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
+
+namespace ripple {
+namespace test {
+
+class LedgerSQLWriter_test : public beast::unit_test::suite
+{
+public:
+    static
+    DatabaseCon::Setup
+    setup (beast::temp_dir const* dir = nullptr)
+    {
+        DatabaseCon::Setup setup;
+        if (dir)
+            setup.dataDir = dir->path();
+        else
+            setup.standAlone = true;
+        return setup;
+    }
+
+    static
+    int
+    count (DatabaseCon& con, std::string const& sql)
+    {
+        int n = 0;
+        auto db = con.checkoutDb ();
+        *db << sql, soci::into (n);
+        return n;
+    }
+
+    void
+    expectStored (DatabaseCon& ledgerDB, DatabaseCon& txnDB,
+        LedgerSQLRows const& rows)
+    {
+        auto const seq = std::to_string (rows.info.seq);
+
+        std::size_t affected = 0;
+        for (auto const& txn : rows.transactions)
+            affected += txn.affected.size ();
+
+        BEAST_EXPECT(count (ledgerDB,
+            "SELECT COUNT(*) FROM Ledgers WHERE LedgerSeq = " + seq +
+            " AND LedgerHash = '" + to_string (rows.info.hash) + "';") == 1);
+        BEAST_EXPECT(count (txnDB,
+            "SELECT COUNT(*) FROM Transactions WHERE LedgerSeq = " +
+            seq + ";") == rows.transactions.size ());
+        BEAST_EXPECT(count (txnDB,
+            "SELECT COUNT(*) FROM AccountTransactions WHERE LedgerSeq = " +
+            seq + ";") == affected);
+
+        for (auto const& txn : rows.transactions)
+        {
+            auto db = txnDB.checkoutDb ();
+            auto const id = to_string (txn.id);
+            std::string type;
+            std::string account;
+            std::uint32_t accountSeq = 0;
+            std::string status;
+            soci::blob raw (*db);
+            soci::blob meta (*db);
+            *db << "SELECT TransType, FromAcct, FromSeq, Status, RawTxn, "
+                "TxnMeta FROM Transactions WHERE TransID = :id;",
+                soci::use (id),
+                soci::into (type), soci::into (account),
+                soci::into (accountSeq), soci::into (status),
+                soci::into (raw), soci::into (meta);
+            BEAST_EXPECT(type == txn.type);
+            BEAST_EXPECT(account == toBase58 (txn.account));
+            BEAST_EXPECT(accountSeq == txn.accountSeq);
+            BEAST_EXPECT(status == std::string (1, TXN_SQL_VALIDATED));
+            Blob b;
+            convert (raw, b);
+            BEAST_EXPECT(b == txn.raw);
+            convert (meta, b);
+            BEAST_EXPECT(b == txn.meta);
+        }
+    }
+
+    void
+    testWriteNow ()
+    {
+        testcase ("write now");
+
+        DatabaseCon ledgerDB (setup(), "ledger.db",
+            LedgerDBInit, LedgerDBCount);
+        DatabaseCon txnDB (setup(), "transaction.db",
+            TxnDBInit, TxnDBCount);
+        RootStoppable parent ("TestRootStoppable");
+        AccountIDCache idCache (1000);
+        auto history = make_HistoryStore (Section (), setup(), txnDB,
+            idCache, beast::Journal());
+        LedgerSQLWriter writer (
+            parent, ledgerDB, *history, beast::Journal());
+        parent.start ();
+
+        SyntheticLedgers gen (1);
+
+        // No rows, a partial statement, exactly one multi-row
+        // statement, and several with a remainder.
+        auto const n = LedgerSQLWriter::accountRowsPerInsert;
+        std::vector<std::shared_ptr<LedgerSQLRows>> ledgers {
+            gen.make (2, 0, 0),
+            gen.make (3, 3, 5),
+            gen.make (4, 1, n),
+            gen.make (5, 20, n / 2 + 3),
+        };
+        for (auto const& rows : ledgers)
+        {
+            BEAST_EXPECT(writer.writeNow (*rows));
+            expectStored (ledgerDB, txnDB, *rows);
+        }
+
+        // Saving a ledger again replaces its rows
+        auto const again = gen.make (5, 7, 2);
+        BEAST_EXPECT(writer.writeNow (*again));
+        expectStored (ledgerDB, txnDB, *again);
+        BEAST_EXPECT(count (ledgerDB,
+            "SELECT COUNT(*) FROM Ledgers WHERE LedgerSeq = 5;") == 1);
+        BEAST_EXPECT(count (txnDB,
+            "SELECT COUNT(*) FROM Transactions;") == 3 + 1 + 7);
+
+        parent.stop (beast::Journal());
+    }
+
+    void
+    testQueued ()
+    {
+        testcase ("queued writes");
+
+        DatabaseCon ledgerDB (setup(), "ledger.db",
+            LedgerDBInit, LedgerDBCount);
+        DatabaseCon txnDB (setup(), "transaction.db",
+            TxnDBInit, TxnDBCount);
+        RootStoppable parent ("TestRootStoppable");
+        AccountIDCache idCache (1000);
+        auto history = make_HistoryStore (Section (), setup(), txnDB,
+            idCache, beast::Journal());
+        LedgerSQLWriter writer (
+            parent, ledgerDB, *history, beast::Journal());
+        parent.start ();
+
+        SyntheticLedgers gen (2);
+        std::vector<std::shared_ptr<LedgerSQLRows>> ledgers;
+        for (LedgerIndex seq = 2; seq < 12; ++seq)
+            ledgers.push_back (gen.make (seq, 10, 4));
+
+        std::mutex m;
+        std::condition_variable cv;
+        std::vector<LedgerIndex> written;
+        for (auto const& rows : ledgers)
+        {
+            auto const seq = rows->info.seq;
+            writer.write (rows,
+                [&, seq](bool ok)
+                {
+                    BEAST_EXPECT(ok);
+                    std::lock_guard<std::mutex> lock (m);
+                    written.push_back (seq);
+                    cv.notify_all ();
+                });
+        }
+        {
+            std::unique_lock<std::mutex> lock (m);
+            BEAST_EXPECT(cv.wait_for (lock, std::chrono::seconds (30),
+                [&]{ return written.size () == ledgers.size (); }));
+        }
+
+        // Ledgers are written in the order they were queued
+        BEAST_EXPECT(std::is_sorted (written.begin (), written.end ()));
+        BEAST_EXPECT(writer.pending () == 0);
+        for (auto const& rows : ledgers)
+            expectStored (ledgerDB, txnDB, *rows);
+
+        parent.stop (beast::Journal());
+
+        // Once stopped, writes complete before returning
+        bool done = false;
+        auto const late = gen.make (12, 2, 2);
+        writer.write (late, [&done](bool ok){ done = ok; });
+        BEAST_EXPECT(done);
+        expectStored (ledgerDB, txnDB, *late);
+    }
+
+    void
+    testRecorded ()
+    {
+        testcase ("recorded ledgers");
+
+        DatabaseCon ledgerDB (setup(), "ledger.db",
+            LedgerDBInit, LedgerDBCount);
+        DatabaseCon txnDB (setup(), "transaction.db",
+            TxnDBInit, TxnDBCount);
+        RootStoppable parent ("TestRootStoppable");
+        AccountIDCache idCache (1000);
+        auto history = make_HistoryStore (Section (), setup(), txnDB,
+            idCache, beast::Journal());
+        LedgerSQLWriter writer (
+            parent, ledgerDB, *history, beast::Journal());
+        parent.start ();
+
+        SyntheticLedgers gen (3);
+        std::vector<std::shared_ptr<LedgerSQLRows>> ledgers;
+        for (LedgerIndex seq = 2; seq < 7; ++seq)
+        {
+            ledgers.push_back (gen.make (seq, seq, 3));
+            BEAST_EXPECT(writer.writeNow (*ledgers.back ()));
+        }
+
+        // The newest ledgers read back as they were written
+        auto const loaded = loadRecordedLedgers (ledgerDB, txnDB, 3);
+        if (! BEAST_EXPECT(loaded.size () == 3))
+            return;
+        for (std::size_t i = 0; i < loaded.size (); ++i)
+        {
+            auto const& expected = *ledgers[i + 2];
+            auto const& rows = *loaded[i];
+            BEAST_EXPECT(rows.info.seq == expected.info.seq);
+            BEAST_EXPECT(rows.info.hash == expected.info.hash);
+            BEAST_EXPECT(rows.info.parentHash == expected.info.parentHash);
+            BEAST_EXPECT(rows.info.txHash == expected.info.txHash);
+            BEAST_EXPECT(rows.info.drops == expected.info.drops);
+            if (! BEAST_EXPECT(rows.transactions.size () ==
+                    expected.transactions.size ()))
+                continue;
+            for (std::size_t j = 0; j < rows.transactions.size (); ++j)
+            {
+                auto const& a = rows.transactions[j];
+                auto const& b = expected.transactions[j];
+                BEAST_EXPECT(a.id == b.id && a.type == b.type &&
+                    a.account == b.account &&
+                    a.accountSeq == b.accountSeq &&
+                    a.txnSeq == b.txnSeq &&
+                    a.raw == b.raw && a.meta == b.meta);
+                BEAST_EXPECT(std::is_permutation (
+                    a.affected.begin (), a.affected.end (),
+                    b.affected.begin (), b.affected.end ()));
+            }
+        }
+
+        parent.stop (beast::Journal());
+    }
+
+    void
+    run () override
+    {
+        testWriteNow ();
+        testQueued ();
+        testRecorded ();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// Reports the rate at which ledgers are saved, by the writer and by
+// building SQL strings for each transaction. The ledgers are replayed
+// from a server's databases, or are synthetic if none are given.
+class LedgerSQLWriterTiming_test : public beast::unit_test::suite
+{
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    // Save the rows the way each transaction was saved before
+    static
+    void
+    writeStrings (DatabaseCon& ledgerDB, DatabaseCon& txnDB,
+        LedgerSQLRows const& rows)
+    {
+        auto const seq = std::to_string (rows.info.seq);
+        {
+            auto db = ledgerDB.checkoutDb ();
+            *db << "DELETE FROM Ledgers WHERE LedgerSeq = " + seq + ";";
+        }
+        {
+            auto db = txnDB.checkoutDb ();
+            soci::transaction tr (*db);
+            *db << "DELETE FROM Transactions WHERE LedgerSeq = " + seq + ";";
+            *db << "DELETE FROM AccountTransactions WHERE LedgerSeq = " +
+                seq + ";";
+            for (auto const& txn : rows.transactions)
+            {
+                auto const id = to_string (txn.id);
+                *db << "DELETE FROM AccountTransactions WHERE TransID = '" +
+                    id + "';";
+                std::string sql (
+                    "INSERT INTO AccountTransactions "
+                    "(TransID, Account, LedgerSeq, TxnSeq) VALUES ");
+                bool first = true;
+                for (auto const& account : txn.affected)
+                {
+                    if (! first)
+                        sql += ", ";
+                    first = false;
+                    sql += "('" + id + "','" + toBase58 (account) + "'," +
+                        seq + "," + std::to_string (txn.txnSeq) + ")";
+                }
+                *db << sql + ";";
+                *db << STTx::getMetaSQLInsertReplaceHeader () +
+                    "('" + id + "', '" + txn.type + "', '" +
+                    toBase58 (txn.account) + "', '" +
+                    std::to_string (txn.accountSeq) +
+                    "', '" + seq + "', '" + TXN_SQL_VALIDATED + "', " +
+                    sqlEscape (txn.raw) + ", " + sqlEscape (txn.meta) + ");";
+            }
+            tr.commit ();
+        }
+        {
+            auto db = ledgerDB.checkoutDb ();
+            soci::transaction tr (*db);
+            *db << "INSERT OR REPLACE INTO Ledgers (LedgerHash,LedgerSeq) "
+                "VALUES ('" + to_string (rows.info.hash) + "'," + seq + ");";
+            *db << "UPDATE Validations SET LedgerSeq = " + seq +
+                ", InitialSeq = " + seq + " WHERE LedgerHash = '" +
+                to_string (rows.info.hash) + "';";
+            tr.commit ();
+        }
+    }
+
+    // Save the same ledgers with each method and report the rates
+    void
+    replay (std::string const& name,
+        std::vector<std::shared_ptr<LedgerSQLRows>> const& recorded)
+    {
+        std::size_t rowCount = 0;
+        for (auto const& rows : recorded)
+        {
+            rowCount += 1 + rows->transactions.size ();
+            for (auto const& txn : rows->transactions)
+                rowCount += txn.affected.size ();
+        }
+        auto const ledgers = recorded.size ();
+
+        for (bool const prepared : { false, true })
+        {
+            beast::temp_dir dir;
+            DatabaseCon ledgerDB (setup (dir), "ledger.db",
+                LedgerDBInit, LedgerDBCount);
+            DatabaseCon txnDB (setup (dir), "transaction.db",
+                TxnDBInit, TxnDBCount);
+            RootStoppable parent ("TestRootStoppable");
+            AccountIDCache idCache (1000);
+            auto history = make_HistoryStore (Section (), setup (dir),
+                txnDB, idCache, beast::Journal());
+            LedgerSQLWriter writer (
+                parent, ledgerDB, *history, beast::Journal());
+            parent.start ();
+
+            auto const start = clock_type::now();
+            for (auto const& rows : recorded)
+            {
+                if (prepared)
+                    BEAST_EXPECT(writer.writeNow (*rows));
+                else
+                    writeStrings (ledgerDB, txnDB, *rows);
+            }
+            auto const elapsed = std::chrono::duration_cast<
+                std::chrono::duration<double>>(
+                    clock_type::now() - start).count();
+
+            log << std::setw(20) << name <<
+                std::setw(10) << (prepared ? "writer" : "strings") <<
+                std::setw(14) << std::fixed << std::setprecision(0) <<
+                (ledgers / elapsed) <<
+                std::setw(14) << (rowCount / elapsed) << std::endl;
+
+            parent.stop (beast::Journal());
+        }
+    }
+
+    void
+    run () override
+    {
+        Section args;
+        {
+            std::vector<std::string> v;
+            boost::split (v, arg(), boost::algorithm::is_any_of (","));
+            args.append (v);
+        }
+        auto const from = get<std::string> (args, "from");
+        auto const ledgers = get<std::size_t> (args, "ledgers", 200);
+
+        log << std::setw(20) << "ledgers" <<
+            std::setw(10) << "method" <<
+            std::setw(14) << "ledgers/sec" <<
+            std::setw(14) << "rows/sec" << std::endl;
+
+        if (! from.empty())
+        {
+            // The newest ledgers saved by a server. Use a copy of the
+            // database directory of a stopped server.
+            DatabaseCon::Setup recorded;
+            recorded.dataDir = from;
+            DatabaseCon ledgerDB (recorded, "ledger.db",
+                LedgerDBInit, LedgerDBCount);
+            DatabaseCon txnDB (recorded, "transaction.db",
+                TxnDBInit, TxnDBCount);
+            auto const rows = loadRecordedLedgers (
+                ledgerDB, txnDB, ledgers);
+            if (! BEAST_EXPECT(! rows.empty()))
+                return;
+            replay ("recorded", rows);
+            return;
+        }
+
+        log << "No recorded ledgers, using synthetic ones. Usage:\n" <<
+            "--unittest-arg=from=<dir>[,ledgers=<n>]\n" <<
+            "from:    Directory of a server's ledger.db and transaction.db\n" <<
+            "ledgers: The newest ledgers to replay (default 200)" << std::endl;
+
+        for (auto const shape : { std::make_pair (20, 2),
+            std::make_pair (100, 3), std::make_pair (200, 8) })
+        {
+            SyntheticLedgers gen (shape.first);
+            std::vector<std::shared_ptr<LedgerSQLRows>> synthetic;
+            for (std::size_t i = 0; i < ledgers; ++i)
+            {
+                synthetic.push_back (gen.make (
+                    static_cast<LedgerIndex>(i + 2),
+                    shape.first, shape.second));
+            }
+            replay (std::to_string (shape.first) + " txns x " +
+                std::to_string (shape.second), synthetic);
+        }
+    }
+
+private:
+    static
+    DatabaseCon::Setup
+    setup (beast::temp_dir const& dir)
+    {
+        return LedgerSQLWriter_test::setup (&dir);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(LedgerSQLWriter,app,ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(LedgerSQLWriterTiming,app,ripple);
+
+} // test
+} // ripple
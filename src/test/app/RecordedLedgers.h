@@ -0,0 +1,172 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_TEST_APP_RECORDEDLEDGERS_H_INCLUDED
+#define RIPPLE_TEST_APP_RECORDEDLEDGERS_H_INCLUDED
+
+#include <ripple/app/ledger/LedgerSQLWriter.h>
+#include <ripple/core/DatabaseCon.h>
+#include <ripple/core/SociDB.h>
+#include <boost/optional.hpp>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace ripple {
+namespace test {
+
+// Reads back the rows of the newest ledgers saved in a server's ledger
+// and transaction databases, oldest first.
+inline
+std::vector<std::shared_ptr<LedgerSQLRows>>
+loadRecordedLedgers (DatabaseCon& ledgerDB, DatabaseCon& txnDB,
+    std::size_t count)
+{
+    using time_point = NetClock::time_point;
+    using duration = NetClock::duration;
+
+    std::vector<std::shared_ptr<LedgerSQLRows>> ledgers;
+    {
+        auto db = ledgerDB.checkoutDb ();
+
+        std::uint64_t seq;
+        std::string hash;
+        boost::optional<std::string> prevHash, accountHash, transHash;
+        boost::optional<std::uint64_t> drops, closeTime, prevCloseTime,
+            closeRes, closeFlags;
+
+        soci::statement st = (db->prepare <<
+            "SELECT LedgerSeq, LedgerHash, PrevHash, AccountSetHash, "
+            "TransSetHash, TotalCoins, ClosingTime, PrevClosingTime, "
+            "CloseTimeRes, CloseFlags FROM Ledgers "
+            "ORDER BY LedgerSeq DESC LIMIT " + std::to_string (count) + ";",
+            soci::into (seq), soci::into (hash), soci::into (prevHash),
+            soci::into (accountHash), soci::into (transHash),
+            soci::into (drops), soci::into (closeTime),
+            soci::into (prevCloseTime), soci::into (closeRes),
+            soci::into (closeFlags));
+
+        st.execute ();
+        while (st.fetch ())
+        {
+            auto rows = std::make_shared<LedgerSQLRows>();
+            auto& info = rows->info;
+            info.seq = rangeCheckedCast<std::uint32_t>(seq);
+            info.hash.SetHexExact (hash);
+            if (prevHash)
+                info.parentHash.SetHexExact (*prevHash);
+            if (accountHash)
+                info.accountHash.SetHexExact (*accountHash);
+            if (transHash)
+                info.txHash.SetHexExact (*transHash);
+            info.drops = drops.value_or (0);
+            info.closeTime = time_point{duration{closeTime.value_or (0)}};
+            info.parentCloseTime =
+                time_point{duration{prevCloseTime.value_or (0)}};
+            info.closeTimeResolution = duration{closeRes.value_or (0)};
+            info.closeFlags = static_cast<int>(closeFlags.value_or (0));
+            ledgers.push_back (std::move (rows));
+        }
+    }
+    std::reverse (ledgers.begin (), ledgers.end ());
+
+    auto db = txnDB.checkoutDb ();
+    for (auto& rows : ledgers)
+    {
+        auto const seq = std::to_string (rows->info.seq);
+
+        // Transactions in the order they were applied
+        std::map<uint256, std::size_t> index;
+        {
+            std::string id;
+            boost::optional<std::string> type, account;
+            boost::optional<std::uint64_t> accountSeq;
+            soci::blob raw (*db);
+            soci::blob meta (*db);
+            soci::indicator rawPresent, metaPresent;
+
+            soci::statement st = (db->prepare <<
+                "SELECT TransID, TransType, FromAcct, FromSeq, RawTxn, "
+                "TxnMeta FROM Transactions WHERE LedgerSeq = " + seq + ";",
+                soci::into (id), soci::into (type), soci::into (account),
+                soci::into (accountSeq), soci::into (raw, rawPresent),
+                soci::into (meta, metaPresent));
+
+            st.execute ();
+            while (st.fetch ())
+            {
+                LedgerSQLRows::Transaction txn;
+                txn.id.SetHexExact (id);
+                txn.type = type.value_or ("");
+                if (account)
+                {
+                    if (auto const parsed = parseBase58<AccountID> (*account))
+                        txn.account = *parsed;
+                }
+                txn.accountSeq =
+                    static_cast<std::uint32_t>(accountSeq.value_or (0));
+                if (rawPresent == soci::i_ok)
+                    convert (raw, txn.raw);
+                if (metaPresent == soci::i_ok)
+                    convert (meta, txn.meta);
+                index[txn.id] = rows->transactions.size ();
+                rows->transactions.push_back (std::move (txn));
+            }
+        }
+
+        {
+            std::string id;
+            std::string account;
+            boost::optional<std::uint64_t> txnSeq;
+
+            soci::statement st = (db->prepare <<
+                "SELECT TransID, Account, TxnSeq FROM AccountTransactions "
+                "WHERE LedgerSeq = " + seq + ";",
+                soci::into (id), soci::into (account), soci::into (txnSeq));
+
+            st.execute ();
+            while (st.fetch ())
+            {
+                uint256 txID;
+                txID.SetHexExact (id);
+                auto const iter = index.find (txID);
+                auto const parsed = parseBase58<AccountID> (account);
+                if (iter == index.end () || ! parsed)
+                    continue;
+                auto& txn = rows->transactions[iter->second];
+                txn.txnSeq = static_cast<std::uint32_t>(txnSeq.value_or (0));
+                txn.affected.push_back (*parsed);
+            }
+        }
+
+        std::sort (rows->transactions.begin (), rows->transactions.end (),
+            [](LedgerSQLRows::Transaction const& a,
+                LedgerSQLRows::Transaction const& b)
+            {
+                return a.txnSeq < b.txnSeq;
+            });
+    }
+    return ledgers;
+}
+
+} // test
+} // ripple
+
+#endif
@@ -52,6 +52,8 @@ class SHAMapStore_test : public beast::unit_test::suite
         cfg = onlineDelete(std::move(cfg));
         cfg->section(ConfigSection::nodeDatabase())
             .set("advisory_delete", "1");
+        cfg->section(ConfigSection::nodeDatabase())
+            .set("copy_threads", "1");
         return cfg;
     }
 
@@ -442,6 +444,21 @@ public:
 
         lastRotated = store.getLastRotated();
 
+        {
+            // The copy of the state made by the rotation is reported
+            auto const info = env.rpc("server_info")[jss::result][jss::info];
+            auto const& onlineDelete = info[jss::online_delete];
+            BEAST_EXPECT(onlineDelete[jss::last_rotated] == lastRotated);
+
+            auto const& copy = onlineDelete[jss::state_copy];
+            BEAST_EXPECT(copy[jss::state] == "complete");
+            BEAST_EXPECT(copy[jss::ledger_index] == lastRotated);
+            BEAST_EXPECT(copy[jss::branches_done] == 16);
+            BEAST_EXPECT(copy[jss::nodes_visited].asUInt() > 0);
+            BEAST_EXPECT(copy[jss::nodes_copied].asUInt() <=
+                copy[jss::nodes_visited].asUInt());
+        }
+
         // Close enough ledgers to trigger another rotate
         for (; ledgerSeq < lastRotated + deleteInterval + 1; ++ledgerSeq)
         {
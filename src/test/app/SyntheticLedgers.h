@@ -0,0 +1,104 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#ifndef RIPPLE_TEST_APP_SYNTHETICLEDGERS_H_INCLUDED
+#define RIPPLE_TEST_APP_SYNTHETICLEDGERS_H_INCLUDED
+
+#include <ripple/app/ledger/LedgerSQLWriter.h>
+#include <ripple/beast/xor_shift_engine.h>
+#include <ripple/protocol/digest.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace ripple {
+namespace test {
+
+// Produces the rows of deterministic synthetic ledgers
+class SyntheticLedgers
+{
+private:
+    beast::xor_shift_engine gen_;
+    std::vector<AccountID> accounts_;
+
+public:
+    explicit
+    SyntheticLedgers (std::uint64_t seed, std::size_t accounts = 1000)
+        : gen_ (seed)
+    {
+        accounts_.reserve (accounts);
+        for (std::size_t i = 0; i < accounts; ++i)
+            accounts_.emplace_back (gen_());
+    }
+
+    std::vector<AccountID> const&
+    accounts () const
+    {
+        return accounts_;
+    }
+
+    // A ledger whose transactions each affect `affected` accounts
+    std::shared_ptr<LedgerSQLRows>
+    make (LedgerIndex seq, std::size_t txns, std::size_t affected)
+    {
+        auto rows = std::make_shared<LedgerSQLRows>();
+        rows->info.seq = seq;
+        rows->info.hash = sha512Half (std::uint64_t (seq), gen_());
+        rows->info.parentHash = sha512Half (std::uint64_t (seq - 1));
+        rows->info.drops = 100000000000000000;
+        rows->info.accountHash = sha512Half (gen_());
+        rows->info.txHash = sha512Half (gen_());
+
+        affected = std::min (affected, accounts_.size ());
+
+        for (std::size_t i = 0; i < txns; ++i)
+        {
+            LedgerSQLRows::Transaction txn;
+            txn.id = sha512Half (rows->info.hash, i);
+            txn.type = "Payment";
+            txn.account = accounts_[gen_() % accounts_.size()];
+            txn.accountSeq = static_cast<std::uint32_t>(gen_());
+            txn.txnSeq = static_cast<std::uint32_t>(i);
+            txn.raw.resize (180 + gen_() % 60);
+            for (auto& b : txn.raw)
+                b = static_cast<std::uint8_t>(gen_());
+            txn.meta.resize (300 + gen_() % 500);
+            for (auto& b : txn.meta)
+                b = static_cast<std::uint8_t>(gen_());
+
+            // Each affected account is listed once, as in a ledger
+            txn.affected.push_back (txn.account);
+            while (txn.affected.size () < affected)
+            {
+                auto const& account = accounts_[gen_() % accounts_.size()];
+                if (std::find (txn.affected.begin (), txn.affected.end (),
+                        account) == txn.affected.end ())
+                    txn.affected.push_back (account);
+            }
+            rows->transactions.push_back (std::move (txn));
+        }
+        return rows;
+    }
+};
+
+} // test
+} // ripple
+
+#endif
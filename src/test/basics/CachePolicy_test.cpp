@@ -0,0 +1,358 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/basics/chrono.h>
+#include <ripple/basics/FrequencySketch.h>
+#include <ripple/basics/ShardedTaggedCache.h>
+#include <ripple/beast/unit_test.h>
+#include <ripple/beast/clock/manual_clock.h>
+#include <ripple/beast/xor_shift_engine.h>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+
+namespace ripple {
+
+/** A recorded sequence of cache requests.
+
+    The text form is one key per line, as a decimal number. Requests for
+    the same object must use the same key.
+*/
+class CacheTrace
+{
+public:
+    std::vector<std::uint64_t> keys;
+
+    static
+    CacheTrace
+    load (std::istream& in)
+    {
+        CacheTrace trace;
+        std::uint64_t key;
+        while (in >> key)
+            trace.keys.push_back (key);
+        return trace;
+    }
+
+    /** A working set requested at random, interrupted by scans.
+
+        Each round requests `hot` random keys from a working set of
+        `working` keys, then `scan` keys that are never seen again.
+    */
+    static
+    CacheTrace
+    scanning (std::size_t rounds, std::size_t working, std::size_t hot,
+        std::size_t scan)
+    {
+        CacheTrace trace;
+        beast::xor_shift_engine gen (rounds);
+        std::uint64_t next = working;
+        for (std::size_t r = 0; r < rounds; ++r)
+        {
+            for (std::size_t i = 0; i < hot; ++i)
+                trace.keys.push_back (gen() % working);
+            for (std::size_t i = 0; i < scan; ++i)
+                trace.keys.push_back (next++);
+        }
+        return trace;
+    }
+};
+
+/** Replays a trace against a cache and returns the hit rate.
+
+    A miss stores the object, as the node store does after reading it
+    from the backend. The cache is swept, and the clock advanced by a
+    second, every `sweepInterval` requests.
+*/
+inline
+float
+replay (CacheTrace const& trace, CachePolicy policy, int size,
+    std::size_t sweepInterval)
+{
+    beast::Journal const j;
+    TestStopwatch clock;
+    ShardedTaggedCache<std::uint64_t, std::uint64_t> cache ("replay",
+        size, 60, clock, j, beast::insight::NullCollector::New(), policy);
+
+    std::size_t n = 0;
+    for (auto const key : trace.keys)
+    {
+        if (! cache.fetch (key))
+        {
+            auto p = std::make_shared<std::uint64_t> (key);
+            cache.canonicalize (key, p);
+        }
+
+        if (++n % sweepInterval == 0)
+        {
+            ++clock;
+            cache.sweep();
+        }
+    }
+    return cache.getHitRate();
+}
+
+class CachePolicy_test : public beast::unit_test::suite
+{
+public:
+    void
+    testSketch()
+    {
+        testcase ("frequency sketch");
+
+        FrequencySketch sketch (1000);
+        BEAST_EXPECT(sketch.estimate (1) == 0);
+
+        for (int i = 0; i < 5; ++i)
+            sketch.increment (1);
+        sketch.increment (2);
+
+        BEAST_EXPECT(sketch.estimate (1) >= 5);
+        BEAST_EXPECT(sketch.estimate (2) >= 1);
+        BEAST_EXPECT(sketch.estimate (1) > sketch.estimate (2));
+
+        for (int i = 0; i < 100; ++i)
+            sketch.increment (3);
+        BEAST_EXPECT(sketch.estimate (3) ==
+            FrequencySketch::maxFrequency);
+
+        // Old counts decay as new keys arrive
+        for (std::size_t i = 0; i < 20000; ++i)
+            sketch.increment (1000 + i);
+        BEAST_EXPECT(sketch.estimate (3) < FrequencySketch::maxFrequency);
+    }
+
+    void
+    testAdmission()
+    {
+        testcase ("admission");
+
+        beast::Journal const j;
+        TestStopwatch clock;
+        ShardedTaggedCache<int, int> c ("test", 1600, 60, clock, j,
+            beast::insight::NullCollector::New(), CachePolicy::tinylfu);
+        BEAST_EXPECT(c.policy() == CachePolicy::tinylfu);
+
+        // Objects stored without being requested are still cached
+        for (int i = 0; i < 100; ++i)
+            BEAST_EXPECT(! c.insert (i, i));
+        BEAST_EXPECT(c.getCacheSize() == 100);
+        BEAST_EXPECT(c.getTrackSize() == 100);
+
+        // and shared
+        for (int i = 0; i < 100; ++i)
+        {
+            auto const p1 = c.fetch (i);
+            auto p2 = std::make_shared<int> (i);
+            BEAST_EXPECT(c.canonicalize (i, p2));
+            BEAST_EXPECT(p1 && p1 == p2);
+        }
+
+        // Peeking neither counts nor admits
+        c.clearStats();
+        BEAST_EXPECT(c.peek (0));
+        BEAST_EXPECT(! c.peek (1000));
+        BEAST_EXPECT(c.getHitRate() == 0);
+
+        // A long scan with a working set requested repeatedly
+        int workingMisses = 0;
+        for (int round = 0; round < 10; ++round)
+        {
+            for (int i = 0; i < 100; ++i)
+            {
+                if (! c.fetch (i))
+                {
+                    ++workingMisses;
+                    c.insert (i, i);
+                }
+            }
+            for (int i = 0; i < 5000; ++i)
+            {
+                int const key = 1000 + round * 5000 + i;
+                if (! c.fetch (key))
+                    c.insert (key, key);
+            }
+            ++clock;
+            c.sweep();
+        }
+        BEAST_EXPECT(workingMisses == 0);
+
+        c.clear();
+        BEAST_EXPECT(c.getTrackSize() == 0);
+    }
+
+    void
+    testConcurrentAdmission()
+    {
+        testcase ("concurrent admission");
+
+        // Threads racing to look up, store and promote the same keys
+        // must all end up sharing one object per key
+        beast::Journal const j;
+        TestStopwatch clock;
+        ShardedTaggedCache<int, int> c ("test", 1600, 60, clock, j,
+            beast::insight::NullCollector::New(), CachePolicy::tinylfu, 2);
+
+        int const keys = 2000;
+        std::size_t const threads = 4;
+        std::vector<std::vector<std::shared_ptr<int>>> got (threads,
+            std::vector<std::shared_ptr<int>> (keys));
+        std::atomic<int> changed (0);
+
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back (
+                [&c, &got, &changed, keys, t]
+                {
+                    for (int round = 0; round < 4; ++round)
+                    {
+                        for (int i = 0; i < keys; ++i)
+                        {
+                            auto p = c.fetch (i);
+                            if (! p)
+                            {
+                                p = std::make_shared<int> (i);
+                                c.canonicalize (i, p);
+                            }
+                            if (! got[t][i])
+                                got[t][i] = p;
+                            else if (got[t][i] != p)
+                                ++changed;
+                        }
+                    }
+                });
+        }
+        for (auto& w : workers)
+            w.join();
+
+        BEAST_EXPECT(changed == 0);
+        std::size_t shared = 0;
+        for (int i = 0; i < keys; ++i)
+        {
+            bool same = true;
+            for (std::size_t t = 1; t < threads; ++t)
+                same = same && got[t][i] == got[0][i];
+            shared += same ? 1 : 0;
+        }
+        BEAST_EXPECT(shared == keys);
+    }
+
+    void
+    testReplay()
+    {
+        testcase ("replay");
+
+        // A working set that a time-based cache loses to each scan
+        auto const trace = CacheTrace::scanning (5, 1000, 20000, 20000);
+
+        auto const lru = replay (trace, CachePolicy::lru, 2000, 1000);
+        auto const tinylfu = replay (trace, CachePolicy::tinylfu, 2000, 1000);
+
+        log << "lru " << lru << "% tinylfu " << tinylfu << "%" << std::endl;
+        BEAST_EXPECT(tinylfu > lru);
+
+        // Without scans the policies are about as good
+        auto const hot = CacheTrace::scanning (5, 1000, 20000, 0);
+        BEAST_EXPECT(replay (hot, CachePolicy::tinylfu, 2000, 1000) >
+            replay (hot, CachePolicy::lru, 2000, 1000) - 1);
+    }
+
+    void
+    testConfig()
+    {
+        testcase ("config");
+
+        Section section;
+        BEAST_EXPECT(getCachePolicy (section) == CachePolicy::lru);
+        section.set ("cache_policy", "tinylfu");
+        BEAST_EXPECT(getCachePolicy (section) == CachePolicy::tinylfu);
+        BEAST_EXPECT(to_string (CachePolicy::tinylfu) == "tinylfu");
+        section.set ("cache_policy", "arc");
+        try
+        {
+            getCachePolicy (section);
+            fail();
+        }
+        catch (std::runtime_error const&)
+        {
+            pass();
+        }
+    }
+
+    void
+    run() override
+    {
+        testSketch();
+        testAdmission();
+        testConcurrentAdmission();
+        testReplay();
+        testConfig();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// Reports the hit rate of each cache policy on a trace. The trace is
+// read from the file named by the suite argument, if there is one.
+class CachePolicyReplay_test : public beast::unit_test::suite
+{
+public:
+    void
+    run() override
+    {
+        CacheTrace trace;
+        if (! arg().empty())
+        {
+            std::ifstream in (arg());
+            if (! in)
+            {
+                fail ("Can't open " + arg());
+                return;
+            }
+            trace = CacheTrace::load (in);
+        }
+        else
+        {
+            trace = CacheTrace::scanning (10, 20000, 100000, 100000);
+        }
+
+        log << trace.keys.size() << " requests" << std::endl;
+        log << std::setw(10) << "size" <<
+            std::setw(10) << "lru" <<
+            std::setw(10) << "tinylfu" << std::endl;
+
+        for (int size : { 10000, 40000, 100000 })
+        {
+            log << std::setw(10) << size << std::fixed <<
+                std::setprecision(1) <<
+                std::setw(10) << replay (trace, CachePolicy::lru, size, 10000) <<
+                std::setw(10) << replay (trace, CachePolicy::tinylfu, size, 10000) <<
+                std::endl;
+        }
+        pass();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(CachePolicy,common,ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(CachePolicyReplay,common,ripple);
+
+}
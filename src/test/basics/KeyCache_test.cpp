@@ -89,6 +89,39 @@ public:
             c.sweep ();
             BEAST_EXPECT(c.size () < 3);
         }
+
+        // Insert three items, limit the memory to two of them, sweep
+        {
+            Cache c ("test", clock, 0, 3);
+
+            BEAST_EXPECT(c.bytes () == 0);
+            BEAST_EXPECT(c.insert ("one"));
+            ++clock;
+            BEAST_EXPECT(c.insert ("two"));
+            ++clock;
+            BEAST_EXPECT(c.insert ("three"));
+            ++clock;
+            BEAST_EXPECT(c.size () == 3);
+            BEAST_EXPECT(c.bytes () > 0);
+            c.setTargetBytes (c.bytes () * 2 / 3);
+            c.sweep ();
+            BEAST_EXPECT(c.size () < 3);
+        }
+
+        // A memory limit above the target size does not raise it
+        {
+            Cache c ("test", clock, 1, 6);
+
+            BEAST_EXPECT(c.insert ("one"));
+            ++clock;
+            BEAST_EXPECT(c.insert ("two"));
+            ++clock;
+            BEAST_EXPECT(c.insert ("three"));
+            ++clock;
+            c.setTargetBytes (c.bytes () * 100);
+            c.sweep ();
+            BEAST_EXPECT(c.size () < 3);
+        }
     }
 };
 
@@ -0,0 +1,148 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/basics/LatencyHistogram.h>
+#include <ripple/beast/unit_test.h>
+#include <ripple/beast/xor_shift_engine.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace ripple {
+namespace test {
+
+class LatencyHistogram_test : public beast::unit_test::suite
+{
+public:
+    using us = std::chrono::microseconds;
+
+    void
+    testBuckets ()
+    {
+        testcase ("buckets");
+
+        using H = LatencyHistogram;
+
+        // Small values are exact
+        for (std::uint64_t v = 0; v < 2 * H::subBuckets; ++v)
+        {
+            BEAST_EXPECT(H::bucket (v) == v);
+            BEAST_EXPECT(H::upper (H::bucket (v)) == v);
+        }
+
+        // Every value falls within its bucket, and buckets are in order
+        std::size_t last = 0;
+        for (std::uint64_t v = 1; v < (std::uint64_t{1} << 24); v += v / 7 + 1)
+        {
+            auto const b = H::bucket (v);
+            BEAST_EXPECT(b >= last);
+            BEAST_EXPECT(b < H::buckets);
+            BEAST_EXPECT(v <= H::upper (b));
+            BEAST_EXPECT(b == 0 || v > H::upper (b - 1));
+            BEAST_EXPECT(H::upper (b) - v <= v / H::subBuckets);
+            last = b;
+        }
+
+        // Large values are clamped
+        BEAST_EXPECT(H::bucket (~std::uint64_t{0}) == H::buckets - 1);
+        BEAST_EXPECT(H::upper (H::buckets - 1) ==
+            (std::uint64_t{1} << H::maxBits) - 1);
+    }
+
+    void
+    testPercentiles ()
+    {
+        testcase ("percentiles");
+
+        LatencyHistogram h;
+        BEAST_EXPECT(h.snapshot ().count == 0);
+        BEAST_EXPECT(h.snapshot ().percentile (0.5) == us (0));
+
+        beast::xor_shift_engine gen (42);
+        std::vector<std::uint64_t> values;
+        for (int i = 0; i < 100000; ++i)
+        {
+            // Mostly fast, with a long tail
+            auto v = gen () % 1000;
+            if (i % 100 == 0)
+                v = 10000 + gen () % 1000000;
+            values.push_back (v);
+            h.insert (us (v));
+        }
+        std::sort (values.begin (), values.end ());
+
+        auto const s = h.snapshot ();
+        BEAST_EXPECT(s.count == values.size ());
+        BEAST_EXPECT(s.max == us (values.back ()));
+
+        for (double p : { 0.5, 0.9, 0.99, 0.999, 1.0 })
+        {
+            auto const exact = values[std::max<std::size_t> (
+                std::ceil (p * values.size ()), 1) - 1];
+            auto const estimate = s.percentile (p).count ();
+            BEAST_EXPECT(estimate >= exact);
+            BEAST_EXPECT(estimate - exact <= exact / LatencyHistogram::subBuckets);
+        }
+
+        // Durations are counted in whole microseconds
+        LatencyHistogram ms;
+        ms.insert (std::chrono::milliseconds (3));
+        ms.insert (std::chrono::nanoseconds (-5));
+        BEAST_EXPECT(ms.snapshot ().max == us (3000));
+        BEAST_EXPECT(ms.snapshot ().percentile (0.5) == us (0));
+    }
+
+    void
+    testThreads ()
+    {
+        testcase ("threads");
+
+        LatencyHistogram h;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; ++t)
+        {
+            threads.emplace_back ([&h, t]
+            {
+                for (int i = 0; i < 10000; ++i)
+                    h.insert (us (t * 100 + i % 100));
+            });
+        }
+        for (auto& thread : threads)
+            thread.join ();
+
+        auto const s = h.snapshot ();
+        BEAST_EXPECT(s.count == 80000);
+        BEAST_EXPECT(s.max == us (799));
+    }
+
+    void
+    run() override
+    {
+        testBuckets ();
+        testPercentiles ();
+        testThreads ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(LatencyHistogram,basics,ripple);
+
+} // test
+} // ripple
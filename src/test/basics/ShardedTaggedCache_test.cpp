@@ -0,0 +1,214 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/basics/chrono.h>
+#include <ripple/basics/ShardedTaggedCache.h>
+#include <ripple/beast/unit_test.h>
+#include <ripple/beast/clock/manual_clock.h>
+#include <ripple/beast/xor_shift_engine.h>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+namespace ripple {
+
+class ShardedTaggedCache_test : public beast::unit_test::suite
+{
+public:
+    using Cache = ShardedTaggedCache <int, std::string>;
+
+    void
+    testBasics()
+    {
+        testcase ("basics");
+
+        beast::Journal const j;
+        TestStopwatch clock;
+        clock.set (0);
+
+        Cache c ("test", 64, 1, clock, j);
+
+        for (int i = 0; i < 1000; ++i)
+            BEAST_EXPECT(! c.insert (i, std::to_string (i)));
+        BEAST_EXPECT(c.getCacheSize() == 1000);
+        BEAST_EXPECT(c.getTrackSize() == 1000);
+        BEAST_EXPECT(c.getKeys().size() == 1000);
+
+        {
+            std::string s;
+            BEAST_EXPECT(c.retrieve (500, s));
+            BEAST_EXPECT(s == "500");
+            BEAST_EXPECT(! c.retrieve (1000, s));
+        }
+
+        // Canonicalizing a duplicate returns the original
+        {
+            Cache::mapped_ptr const p1 (c.fetch (7));
+            Cache::mapped_ptr p2 (std::make_shared <std::string> ("7"));
+            BEAST_EXPECT(c.canonicalize (7, p2));
+            BEAST_EXPECT(p1.get() == p2.get());
+        }
+
+        BEAST_EXPECT(c.del (8, false));
+        BEAST_EXPECT(! c.fetch (8));
+        BEAST_EXPECT(c.getTrackSize() == 999);
+
+        // An entry with a strong reference outside the cache is
+        // only weakly tracked after a sweep
+        Cache::mapped_ptr p (c.fetch (9));
+        ++clock;
+        c.sweep ();
+        BEAST_EXPECT(c.getCacheSize() == 0);
+        BEAST_EXPECT(c.getTrackSize() == 1);
+        BEAST_EXPECT(c.fetch (9) == p);
+        BEAST_EXPECT(c.getCacheSize() == 1);
+
+        p.reset ();
+        c.clear ();
+        BEAST_EXPECT(c.getCacheSize() == 0);
+        BEAST_EXPECT(c.getTrackSize() == 0);
+    }
+
+    void
+    testHitRate()
+    {
+        testcase ("hit rate");
+
+        beast::Journal const j;
+        TestStopwatch clock;
+        Cache c ("test", 0, 60, clock, j);
+
+        for (int i = 0; i < 100; ++i)
+            c.insert (i, std::to_string (i));
+        for (int i = 0; i < 200; ++i)
+            c.fetch (i);
+        BEAST_EXPECT(c.getHitRate() == 50.0f);
+
+        c.clearStats ();
+        BEAST_EXPECT(c.getHitRate() == 0.0f);
+    }
+
+    void
+    run() override
+    {
+        testBasics();
+        testHitRate();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// Compares the throughput of TaggedCache and ShardedTaggedCache as the
+// number of threads fetching and canonicalizing concurrently increases,
+// while another thread sweeps continuously.
+class TaggedCacheContention_test : public beast::unit_test::suite
+{
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    template <class Cache>
+    double
+    measure (Cache& c, std::size_t threads, std::size_t ops, int keys)
+    {
+        for (int i = 0; i < keys; ++i)
+            c.insert (i, i);
+
+        std::atomic<bool> done (false);
+        std::thread sweeper (
+            [&c, &done]
+            {
+                while (! done)
+                    c.sweep ();
+            });
+
+        std::vector<std::thread> workers;
+        workers.reserve (threads);
+
+        auto const start = clock_type::now();
+        for (std::size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back (
+                [&c, t, ops, keys]
+                {
+                    beast::xor_shift_engine gen (t + 1);
+                    for (std::size_t i = 0; i < ops; ++i)
+                    {
+                        int const key = gen() % keys;
+                        if (i % 8)
+                        {
+                            c.fetch (key);
+                        }
+                        else
+                        {
+                            auto p = std::make_shared<int> (key);
+                            c.canonicalize (key, p);
+                        }
+                    }
+                });
+        }
+        for (auto& w : workers)
+            w.join();
+        auto const elapsed = std::chrono::duration_cast<
+            std::chrono::duration<double>>(clock_type::now() - start);
+
+        done = true;
+        sweeper.join();
+
+        return threads * ops / elapsed.count();
+    }
+
+    void
+    run() override
+    {
+        beast::Journal const j;
+
+#ifndef NDEBUG
+        std::size_t const ops = 100000;
+#else
+        std::size_t const ops = 1000000;
+#endif
+        int const keys = 100000;
+
+        log << std::setw(8) << "threads" <<
+            std::setw(16) << "single ops/s" <<
+            std::setw(16) << "sharded ops/s" << std::endl;
+
+        for (std::size_t threads : { 1, 2, 4, 8, 16 })
+        {
+            TaggedCache <int, int> single (
+                "single", keys, 60, stopwatch(), j);
+            ShardedTaggedCache <int, int> sharded (
+                "sharded", keys, 60, stopwatch(), j);
+
+            auto const a = measure (single, threads, ops, keys);
+            auto const b = measure (sharded, threads, ops, keys);
+
+            log << std::setw(8) << threads <<
+                std::setw(16) << std::fixed << std::setprecision(0) << a <<
+                std::setw(16) << b << std::endl;
+        }
+        pass();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ShardedTaggedCache,common,ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(TaggedCacheContention,common,ripple);
+
+}
@@ -144,6 +144,41 @@ public:
             BEAST_EXPECT(c.getCacheSize() == 0);
             BEAST_EXPECT(c.getTrackSize() == 0);
         }
+
+        // Put two objects in a cache with no size limit, then limit the
+        // memory it may use and make sure the older object expires early.
+        {
+            Cache b ("bytes", 0, 10, clock, j);
+            BEAST_EXPECT(b.getCacheBytes() == 0);
+
+            BEAST_EXPECT(! b.insert (1, "one"));
+            auto const one = b.getCacheBytes();
+            BEAST_EXPECT(one > sizeof(Value));
+            clock.advance (std::chrono::seconds (4));
+            BEAST_EXPECT(! b.insert (2, "two"));
+            BEAST_EXPECT(b.getCacheBytes() == 2 * one);
+
+            // Within the target age, nothing expires
+            clock.advance (std::chrono::seconds (2));
+            b.sweep ();
+            BEAST_EXPECT(b.getCacheSize() == 2);
+
+            // At twice the limit, objects expire at half the target age
+            b.setTargetBytes (one);
+            BEAST_EXPECT(b.getTargetBytes() == one);
+            b.sweep ();
+            BEAST_EXPECT(b.getCacheSize() == 1);
+            BEAST_EXPECT(b.getCacheBytes() == one);
+            BEAST_EXPECT(b.fetch (2) != nullptr);
+
+            // Within the limit, the target age applies again
+            clock.advance (std::chrono::seconds (5));
+            b.sweep ();
+            BEAST_EXPECT(b.getCacheSize() == 1);
+
+            b.clear ();
+            BEAST_EXPECT(b.getCacheBytes() == 0);
+        }
     }
 };
 
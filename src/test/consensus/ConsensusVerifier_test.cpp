@@ -0,0 +1,311 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/app/consensus/ConsensusVerifier.h>
+#include <ripple/basics/contract.h>
+#include <ripple/core/Stoppable.h>
+#include <ripple/beast/unit_test.h>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ripple {
+namespace test {
+
+class ConsensusVerifier_test : public beast::unit_test::suite
+{
+    // Holds the verifier's threads inside a check until opened
+    class Gate
+    {
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        bool entered_ = false;
+        bool open_ = false;
+
+    public:
+        ConsensusVerifier::Check
+        check ()
+        {
+            return [this]
+            {
+                std::unique_lock<std::mutex> lock (mutex_);
+                entered_ = true;
+                cond_.notify_all ();
+                cond_.wait (lock, [this]{ return open_; });
+                return true;
+            };
+        }
+
+        void
+        waitEntered ()
+        {
+            std::unique_lock<std::mutex> lock (mutex_);
+            cond_.wait (lock, [this]{ return entered_; });
+        }
+
+        void
+        open ()
+        {
+            std::lock_guard<std::mutex> lock (mutex_);
+            open_ = true;
+            cond_.notify_all ();
+        }
+    };
+
+    // Records the order and results of callbacks
+    class Results
+    {
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        std::vector<std::pair<std::string, bool>> results_;
+
+    public:
+        ConsensusVerifier::Callback
+        callback (std::string const& name)
+        {
+            return [this, name] (bool valid)
+            {
+                std::lock_guard<std::mutex> lock (mutex_);
+                results_.emplace_back (name, valid);
+                cond_.notify_all ();
+            };
+        }
+
+        std::vector<std::pair<std::string, bool>>
+        wait (std::size_t count)
+        {
+            std::unique_lock<std::mutex> lock (mutex_);
+            cond_.wait (lock, [&]{ return results_.size () >= count; });
+            return results_;
+        }
+    };
+
+    static
+    ConsensusVerifier::Setup
+    makeSetup (std::size_t threads, std::size_t maxUntrusted = 1024)
+    {
+        ConsensusVerifier::Setup setup;
+        setup.threads = threads;
+        setup.maxUntrusted = maxUntrusted;
+        return setup;
+    }
+
+public:
+    void
+    testDisabled ()
+    {
+        testcase ("disabled");
+
+        RootStoppable parent ("TestRootStoppable");
+        ConsensusVerifier verifier (parent, makeSetup (0), beast::Journal());
+        parent.prepare ();
+        parent.start ();
+        BEAST_EXPECT(! verifier.enabled ());
+
+        int called = 0;
+        BEAST_EXPECT(verifier.check (false, []{ return true; },
+            [&called] (bool valid) { if (valid) ++called; }));
+        BEAST_EXPECT(verifier.check (true, []{ return false; },
+            [&called] (bool valid) { if (! valid) ++called; }));
+
+        // A check that throws fails, as it does on the threads
+        BEAST_EXPECT(verifier.check (true,
+            []() -> bool { Throw<std::runtime_error> ("bad signature"); },
+            [&called] (bool valid) { if (! valid) ++called; }));
+        BEAST_EXPECT(called == 3);
+
+        parent.stop (beast::Journal());
+    }
+
+    void
+    testResults ()
+    {
+        testcase ("results");
+
+        RootStoppable parent ("TestRootStoppable");
+        ConsensusVerifier verifier (parent, makeSetup (3), beast::Journal());
+        parent.prepare ();
+        parent.start ();
+        BEAST_EXPECT(verifier.enabled ());
+
+        Results results;
+        std::size_t const count = 200;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            ConsensusVerifier::Check check = [i]
+            {
+                if (i % 7 == 0)
+                    Throw<std::runtime_error> ("bad signature");
+                return i % 3 != 0;
+            };
+            BEAST_EXPECT(verifier.check (i % 2 == 0, std::move (check),
+                results.callback (std::to_string (i))));
+        }
+
+        auto const checked = results.wait (count);
+        BEAST_EXPECT(checked.size () == count);
+        for (auto const& r : checked)
+        {
+            auto const i = std::stoul (r.first);
+            BEAST_EXPECT(r.second == (i % 7 != 0 && i % 3 != 0));
+        }
+
+        parent.stop (beast::Journal());
+    }
+
+    void
+    testPriority ()
+    {
+        testcase ("trusted first");
+
+        RootStoppable parent ("TestRootStoppable");
+        ConsensusVerifier verifier (parent, makeSetup (1), beast::Journal());
+        parent.prepare ();
+        parent.start ();
+
+        Gate gate;
+        Results results;
+        verifier.check (true, gate.check (), results.callback ("gate"));
+        gate.waitEntered ();
+
+        auto const valid = []{ return true; };
+        verifier.check (false, valid, results.callback ("untrusted 1"));
+        verifier.check (false, valid, results.callback ("untrusted 2"));
+        verifier.check (true, valid, results.callback ("trusted"));
+
+        auto const counts = verifier.counts ();
+        BEAST_EXPECT(counts.trusted == 1);
+        BEAST_EXPECT(counts.untrusted == 2);
+
+        gate.open ();
+        auto const checked = results.wait (4);
+        BEAST_EXPECT(checked.size () == 4);
+        BEAST_EXPECT(checked[0].first == "gate");
+        BEAST_EXPECT(checked[1].first == "trusted");
+        BEAST_EXPECT(checked[2].first == "untrusted 1");
+        BEAST_EXPECT(checked[3].first == "untrusted 2");
+
+        parent.stop (beast::Journal());
+    }
+
+    void
+    testUntrustedLimit ()
+    {
+        testcase ("untrusted limit");
+
+        RootStoppable parent ("TestRootStoppable");
+        ConsensusVerifier verifier (parent,
+            makeSetup (1, 2), beast::Journal());
+        parent.prepare ();
+        parent.start ();
+
+        Gate gate;
+        Results results;
+        verifier.check (true, gate.check (), results.callback ("gate"));
+        gate.waitEntered ();
+
+        auto const valid = []{ return true; };
+        BEAST_EXPECT(verifier.check (false, valid, results.callback ("1")));
+        BEAST_EXPECT(verifier.check (false, valid, results.callback ("2")));
+        BEAST_EXPECT(! verifier.check (false, valid, results.callback ("3")));
+
+        // Trusted checks are never dropped
+        for (int i = 0; i < 5; ++i)
+            BEAST_EXPECT(verifier.check (true, valid, results.callback ("t")));
+
+        auto const counts = verifier.counts ();
+        BEAST_EXPECT(counts.trusted == 5);
+        BEAST_EXPECT(counts.untrusted == 2);
+        BEAST_EXPECT(counts.dropped == 1);
+
+        gate.open ();
+        BEAST_EXPECT(results.wait (8).size () == 8);
+
+        parent.stop (beast::Journal());
+        BEAST_EXPECT(verifier.counts ().dropped == 1);
+    }
+
+    void
+    testStopDrains ()
+    {
+        testcase ("stop drains");
+
+        RootStoppable parent ("TestRootStoppable");
+        ConsensusVerifier verifier (parent, makeSetup (2), beast::Journal());
+        parent.prepare ();
+        parent.start ();
+
+        Results results;
+        for (int i = 0; i < 100; ++i)
+            verifier.check (i % 2 == 0, []{ return true; },
+                results.callback (std::to_string (i)));
+        parent.stop (beast::Journal());
+
+        BEAST_EXPECT(results.wait (100).size () == 100);
+
+        // Once stopped, checks are run before returning
+        bool called = false;
+        BEAST_EXPECT(verifier.check (false, []{ return true; },
+            [&called] (bool valid) { called = valid; }));
+        BEAST_EXPECT(called);
+    }
+
+    void
+    testSetup ()
+    {
+        testcase ("setup");
+
+        {
+            Config c;
+            auto const setup = setup_ConsensusVerifier (c);
+            BEAST_EXPECT(setup.threads == 2);
+            BEAST_EXPECT(setup.maxUntrusted == 1024);
+            BEAST_EXPECT(setup.batchSize == 8);
+        }
+        {
+            Config c;
+            c.section ("consensus_verify").set ("threads", "0");
+            c.section ("consensus_verify").set ("untrusted_limit", "10");
+            c.section ("consensus_verify").set ("batch_size", "0");
+            auto const setup = setup_ConsensusVerifier (c);
+            BEAST_EXPECT(setup.threads == 0);
+            BEAST_EXPECT(setup.maxUntrusted == 10);
+            BEAST_EXPECT(setup.batchSize == 1);
+        }
+    }
+
+    void
+    run() override
+    {
+        testDisabled ();
+        testResults ();
+        testPriority ();
+        testUntrustedLimit ();
+        testStopDrains ();
+        testSetup ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ConsensusVerifier,consensus,ripple);
+
+} // test
+} // ripple
@@ -853,6 +853,45 @@ trustthesevalidators.gov
         }
     }
 
+    void testMemory ()
+    {
+        testcase ("memory");
+
+        {
+            Config c;
+            c.loadFromString ("");
+            BEAST_EXPECT(c.MEMORY_LIMIT == 0);
+            BEAST_EXPECT(c.NODE_CACHE_WEIGHT == 3);
+            BEAST_EXPECT(c.TREE_CACHE_WEIGHT == 6);
+            BEAST_EXPECT(c.FULL_BELOW_WEIGHT == 1);
+        }
+        {
+            Config c;
+            c.loadFromString (R"rippleConfig(
+[memory]
+limit_gb=1.5
+node_cache=1
+tree_cache=2
+full_below=0
+)rippleConfig");
+            BEAST_EXPECT(c.MEMORY_LIMIT == 3ull * 512 * 1024 * 1024);
+            BEAST_EXPECT(c.NODE_CACHE_WEIGHT == 1);
+            BEAST_EXPECT(c.TREE_CACHE_WEIGHT == 2);
+            BEAST_EXPECT(c.FULL_BELOW_WEIGHT == 0);
+        }
+        expectException ([]
+            {
+                Config c;
+                c.loadFromString ("[memory]\nlimit_gb=0\n");
+            });
+        expectException ([]
+            {
+                Config c;
+                c.loadFromString ("[memory]\nlimit_gb=1\n"
+                    "node_cache=0\ntree_cache=0\nfull_below=0\n");
+            });
+    }
+
     void run ()
     {
         testLegacy ();
@@ -861,6 +900,7 @@ trustthesevalidators.gov
         testValidatorsFile ();
         testSetup (false);
         testSetup (true);
+        testMemory ();
     }
 };
 
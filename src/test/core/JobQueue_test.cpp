@@ -19,8 +19,20 @@
 
 #include <BeastConfig.h>
 #include <ripple/core/JobQueue.h>
+#include <ripple/basics/Log.h>
+#include <ripple/core/Config.h>
+#include <ripple/core/impl/StealingJobSet.h>
+#include <ripple/beast/insight/NullCollector.h>
 #include <ripple/beast/unit_test.h>
 #include <test/jtx/Env.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace ripple {
 namespace test {
@@ -140,15 +152,394 @@ class JobQueue_test : public beast::unit_test::suite
         }
     }
 
+    void testStealingJobSet()
+    {
+        testcase ("StealingJobSet");
+
+        JobTypes const types;
+        StealingJobSet set (types, 4);
+        LoadMonitor load {beast::Journal()};
+
+        std::vector<int> ran;
+        auto add = [&] (JobType type, int id)
+        {
+            return set.add (Job (type, "test", id, load,
+                [&ran, id] (Job&) { ran.push_back (id); }, nullptr));
+        };
+        auto next = [&]
+        {
+            Job job;
+            set.next (job);
+            job.doJob ();
+            return job.getType ();
+        };
+
+        // Unlimited types always start a task
+        BEAST_EXPECT(add (jtCLIENT, 1));
+        BEAST_EXPECT(add (jtCLIENT, 2));
+
+        // Others are deferred at the limit
+        BEAST_EXPECT(add (jtSHARD, 3));
+        BEAST_EXPECT(! add (jtSHARD, 4));
+        BEAST_EXPECT(! add (jtSHARD, 5));
+        BEAST_EXPECT(add (jtPROPOSAL_t, 6));
+
+        BEAST_EXPECT(set.size () == 6);
+        BEAST_EXPECT(set.waiting (jtSHARD) == 3);
+        BEAST_EXPECT(set.waiting (jtCLIENT) == 2);
+
+        // Highest priority first
+        BEAST_EXPECT(next () == jtPROPOSAL_t);
+        BEAST_EXPECT(next () == jtCLIENT);
+        BEAST_EXPECT(next () == jtCLIENT);
+        BEAST_EXPECT(next () == jtSHARD);
+        BEAST_EXPECT(set.running (jtSHARD) == 1);
+        BEAST_EXPECT(set.waiting (jtSHARD) == 2);
+        BEAST_EXPECT(! set.finish (jtPROPOSAL_t));
+        BEAST_EXPECT(! set.finish (jtCLIENT));
+        BEAST_EXPECT(! set.finish (jtCLIENT));
+
+        // Finishing starts a deferred job, in order
+        BEAST_EXPECT(set.finish (jtSHARD));
+        BEAST_EXPECT(next () == jtSHARD);
+        BEAST_EXPECT(set.finish (jtSHARD));
+        BEAST_EXPECT(next () == jtSHARD);
+        BEAST_EXPECT(! set.finish (jtSHARD));
+
+        BEAST_EXPECT(set.empty ());
+        BEAST_EXPECT(set.running (jtSHARD) == 0);
+        BEAST_EXPECT(ran.size () == 6);
+        BEAST_EXPECT(ran[0] == 6);
+        BEAST_EXPECT(ran[3] == 3);
+        BEAST_EXPECT(ran[4] == 4);
+        BEAST_EXPECT(ran[5] == 5);
+    }
+
+    void testScheduler (bool workStealing)
+    {
+        testcase (workStealing ? "work stealing" : "job set");
+
+        Logs logs (beast::severities::kError);
+        RootStoppable parent ("TestRootStoppable");
+        JobQueue::Setup setup;
+        setup.workStealing = workStealing;
+        setup.shards = 3;
+        JobQueue jq (beast::insight::NullCollector::New(), parent,
+            beast::Journal(), logs, setup);
+        parent.prepare ();
+        parent.start ();
+
+        {
+            // Higher priority jobs run first
+            jq.setThreadCount (1, false);
+
+            std::mutex mutex;
+            std::condition_variable cv;
+            bool entered = false;
+            bool open = false;
+            std::vector<JobType> order;
+
+            jq.addJob (jtCLIENT, "gate", [&] (Job&)
+            {
+                std::unique_lock<std::mutex> lock (mutex);
+                entered = true;
+                cv.notify_all ();
+                cv.wait (lock, [&]{ return open; });
+            });
+            {
+                std::unique_lock<std::mutex> lock (mutex);
+                cv.wait (lock, [&]{ return entered; });
+            }
+
+            for (auto type : { jtLEDGER_REQ, jtPROPOSAL_t, jtCLIENT })
+            {
+                jq.addJob (type, "order", [&order, type] (Job&)
+                    { order.push_back (type); });
+            }
+            BEAST_EXPECT(jq.getJobCount (jtPROPOSAL_t) == 1);
+            BEAST_EXPECT(jq.getJobCountGE (jtLEDGER_REQ) == 3);
+            BEAST_EXPECT(jq.getJobCountTotal (jtCLIENT) == 2);
+
+            {
+                std::lock_guard<std::mutex> lock (mutex);
+                open = true;
+                cv.notify_all ();
+            }
+            jq.rendezvous ();
+            BEAST_EXPECT(order.size () == 3);
+            BEAST_EXPECT(order ==
+                std::vector<JobType>({ jtPROPOSAL_t, jtCLIENT, jtLEDGER_REQ }));
+        }
+
+        {
+            // Jobs added from many threads all run, within their limits
+            jq.setThreadCount (4, false);
+
+            int const producers = 4;
+            int const jobs = 2000;
+            std::atomic<int> ran {0};
+            std::atomic<int> limited {0};
+            std::atomic<int> peak {0};
+
+            auto limitedJob = [&] (Job&)
+            {
+                auto const n = ++limited;
+                int p = peak.load ();
+                while (n > p && ! peak.compare_exchange_weak (p, n))
+                    ;
+                std::this_thread::yield ();
+                --limited;
+                ++ran;
+            };
+
+            std::vector<std::thread> threads;
+            for (int t = 0; t < producers; ++t)
+            {
+                threads.emplace_back ([&, t]
+                {
+                    for (int i = 0; i < jobs; ++i)
+                    {
+                        if (i % 10 == 0)
+                        {
+                            jq.addJob (jtLEDGER_REQ, "limited", limitedJob);
+                        }
+                        else if (i % 10 == 1)
+                        {
+                            // A job which adds another
+                            jq.addJob (jtCLIENT, "parent", [&] (Job&)
+                            {
+                                jq.addJob (jtTRANSACTION, "child",
+                                    [&] (Job&) { ++ran; });
+                                ++ran;
+                            });
+                        }
+                        else
+                        {
+                            jq.addJob (t % 2 ? jtVALIDATION_t : jtWRITE,
+                                "job", [&] (Job&) { ++ran; });
+                        }
+                    }
+                });
+            }
+            for (auto& thread : threads)
+                thread.join ();
+
+            jq.rendezvous ();
+            BEAST_EXPECT(ran == producers * (jobs + jobs / 10));
+            BEAST_EXPECT(peak > 0 && peak <= 2);
+            BEAST_EXPECT(jq.getJobCountGE (jtSHARD) == 0);
+            BEAST_EXPECT(jq.getJobCountTotal (jtLEDGER_REQ) == 0);
+        }
+
+        parent.stop (beast::Journal());
+    }
+
+    void testLatency()
+    {
+        testcase ("latency");
+
+        using namespace std::chrono_literals;
+
+        Logs logs (beast::severities::kError);
+        RootStoppable parent ("TestRootStoppable");
+        JobQueue::Setup setup;
+        setup.slowJobThreshold = 20ms;
+        setup.slowJobs = 2;
+        JobQueue jq (beast::insight::NullCollector::New(), parent,
+            beast::Journal(), logs, setup);
+        jq.setThreadCount (2, false);
+        parent.prepare ();
+        parent.start ();
+
+        for (int i = 0; i < 50; ++i)
+            jq.addJob (jtCLIENT, "fast", [] (Job&) {});
+        jq.rendezvous ();
+
+        jq.setLedgerSeq (7);
+        for (int i = 0; i < 3; ++i)
+        {
+            jq.addJob (jtTRANSACTION, "slow", [i] (Job& job)
+            {
+                job.rename ("slow " + std::to_string (i));
+                std::this_thread::sleep_for (25ms);
+            });
+            jq.rendezvous ();
+        }
+
+        auto const json = jq.getLatencyJson ();
+        BEAST_EXPECT(json["job_types"].size () == 2);
+        for (auto const& entry : json["job_types"])
+        {
+            auto const client = entry["job_type"] == "clientCommand";
+            BEAST_EXPECT(client ||
+                entry["job_type"] == "transaction");
+            BEAST_EXPECT(entry["queue_us"]["count"] == (client ? 50 : 3));
+            BEAST_EXPECT(entry["execute_us"]["count"] == (client ? 50 : 3));
+            if (! client)
+            {
+                BEAST_EXPECT(entry["execute_us"]["p50"].asUInt () >= 25000);
+                BEAST_EXPECT(entry["execute_us"]["max"].asUInt () >=
+                    entry["execute_us"]["p999"].asUInt ());
+            }
+        }
+
+        // Only the most recent slow jobs are kept
+        BEAST_EXPECT(json["slow_job_ms"] == 20);
+        auto const& slow = json["slow_jobs"];
+        BEAST_EXPECT(slow.size () == 2);
+        if (slow.size () == 2)
+        {
+            BEAST_EXPECT(slow[0u]["name"] == "slow 1");
+            BEAST_EXPECT(slow[1u]["name"] == "slow 2");
+            BEAST_EXPECT(slow[1u]["job_type"] == "transaction");
+            BEAST_EXPECT(slow[1u]["ledger_seq"] == 7);
+            BEAST_EXPECT(slow[1u]["execute_us"].asUInt () >= 25000);
+        }
+
+        parent.stop (beast::Journal());
+    }
+
+    void testSetup()
+    {
+        testcase ("setup");
+
+        {
+            Config c;
+            auto const setup = setup_JobQueue (c);
+            BEAST_EXPECT(! setup.workStealing);
+            BEAST_EXPECT(setup.shards == 0);
+            BEAST_EXPECT(setup.slowJobThreshold.count () == 0);
+            BEAST_EXPECT(setup.slowJobs == 128);
+        }
+        {
+            Config c;
+            c.section ("job_queue").set ("work_stealing", "1");
+            c.section ("job_queue").set ("shards", "8");
+            c.section ("job_queue").set ("slow_job_ms", "250");
+            c.section ("job_queue").set ("slow_jobs", "16");
+            auto const setup = setup_JobQueue (c);
+            BEAST_EXPECT(setup.workStealing);
+            BEAST_EXPECT(setup.shards == 8);
+            BEAST_EXPECT(setup.slowJobThreshold.count () == 250);
+            BEAST_EXPECT(setup.slowJobs == 16);
+        }
+    }
+
 public:
     void run()
     {
         testAddJob();
         testPostCoro();
+        testStealingJobSet();
+        testScheduler(false);
+        testScheduler(true);
+        testLatency();
+        testSetup();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// Reports job throughput and queueing latency for each scheduler
+// as the number of worker threads increases. Every job is tiny, so
+// the cost of the scheduler itself dominates.
+//
+// The argument, if any, is the number of jobs to run per test.
+class JobQueueTiming_test : public beast::unit_test::suite
+{
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    struct Result
+    {
+        double perSecond;
+        std::chrono::microseconds p50;
+        std::chrono::microseconds p99;
+    };
+
+    static
+    Result
+    measure (bool workStealing, int threads, int jobs)
+    {
+        Logs logs (beast::severities::kError);
+        RootStoppable parent ("TestRootStoppable");
+        JobQueue::Setup setup;
+        setup.workStealing = workStealing;
+        JobQueue jq (beast::insight::NullCollector::New(), parent,
+            beast::Journal(), logs, setup);
+        jq.setThreadCount (threads, false);
+        parent.prepare ();
+        parent.start ();
+
+        int const producers = 4;
+        std::vector<clock_type::duration> waits (jobs);
+        std::atomic<int> next {0};
+
+        auto const start = clock_type::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < producers; ++t)
+        {
+            workers.emplace_back ([&, t]
+            {
+                static JobType const types[] =
+                    { jtCLIENT, jtTRANSACTION, jtVALIDATION_t, jtPROPOSAL_t };
+                for (int i = t; i < jobs; i += producers)
+                {
+                    auto const queued = clock_type::now();
+                    jq.addJob (types[i % 4], "timing",
+                        [&waits, &next, queued] (Job&)
+                        {
+                            waits[next++] = clock_type::now() - queued;
+                        });
+                }
+            });
+        }
+        for (auto& thread : workers)
+            thread.join ();
+        jq.rendezvous ();
+        auto const elapsed = clock_type::now() - start;
+        parent.stop (beast::Journal());
+
+        std::sort (waits.begin (), waits.end ());
+        using namespace std::chrono;
+        return {
+            jobs / duration_cast<duration<double>>(elapsed).count(),
+            duration_cast<microseconds>(waits[waits.size () / 2]),
+            duration_cast<microseconds>(waits[waits.size () * 99 / 100]) };
+    }
+
+    void
+    run() override
+    {
+        int jobs = 200000;
+        if (! arg().empty())
+            jobs = std::max (std::stoi (arg()), 100);
+
+        log << std::setw(8) << "threads" <<
+            std::setw(16) << "scheduler" <<
+            std::setw(14) << "jobs/sec" <<
+            std::setw(12) << "p50 us" <<
+            std::setw(12) << "p99 us" << std::endl;
+
+        for (int threads : { 1, 2, 4, 8, 16, 32, 64 })
+        {
+            for (bool workStealing : { false, true })
+            {
+                auto const r = measure (workStealing, threads, jobs);
+                log << std::setw(8) << threads <<
+                    std::setw(16) << (workStealing ? "work_stealing" : "job_set") <<
+                    std::setw(14) << std::fixed << std::setprecision(0) <<
+                        r.perSecond <<
+                    std::setw(12) << r.p50.count() <<
+                    std::setw(12) << r.p99.count() << std::endl;
+            }
+        }
+        pass();
     }
 };
 
 BEAST_DEFINE_TESTSUITE(JobQueue, core, ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(JobQueueTiming, core, ripple);
 
 } // test
 } // ripple
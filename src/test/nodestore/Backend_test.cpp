@@ -22,8 +22,13 @@
 #include <test/nodestore/TestBase.h>
 #include <ripple/nodestore/DummyScheduler.h>
 #include <ripple/nodestore/Manager.h>
+#include <ripple/protocol/digest.h>
+#include <ripple/protocol/HashPrefix.h>
+#include <ripple/protocol/Serializer.h>
 #include <ripple/beast/utility/temp_dir.h>
+#include <boost/filesystem.hpp>
 #include <algorithm>
+#include <thread>
 
 namespace ripple {
 namespace NodeStore {
@@ -33,6 +38,36 @@ namespace NodeStore {
 class Backend_test : public TestBase
 {
 public:
+    // Create inner nodes, which some backends store compressed.
+    // They are read back with an unknown type.
+    static
+    Batch
+    createInnerNodes (int numObjects, std::uint64_t seed)
+    {
+        Batch batch;
+        batch.reserve (numObjects);
+
+        beast::xor_shift_engine rng (seed);
+
+        for (int i = 0; i < numObjects; ++i)
+        {
+            Serializer s;
+            s.add32 (HashPrefix::innerNode);
+            for (int branch = 0; branch < 16; ++branch)
+            {
+                uint256 hash;
+                if (branch == 0 || rng() % (i % 4 + 1) == 0)
+                    beast::rngfill (hash.begin(), hash.size(), rng);
+                s.add256 (hash);
+            }
+            auto const hash = sha512Half (makeSlice (s.peekData()));
+            batch.push_back (NodeObject::createObject (
+                hotUNKNOWN, std::move (s.modData()), hash));
+        }
+
+        return batch;
+    }
+
     void testBackend (
         std::string const& type,
         std::uint64_t const seedValue,
@@ -52,6 +87,9 @@ public:
         // Create a batch
         auto batch = createPredictableBatch (
             numObjectsToTest, rng());
+        auto const inner = createInnerNodes (
+            numObjectsToTest / 10, rng());
+        batch.insert (batch.end(), inner.begin(), inner.end());
 
         beast::Journal j;
 
@@ -80,6 +118,36 @@ public:
                 fetchCopyOfBatch (*backend, &copy, batch);
                 BEAST_EXPECT(areBatchesEqual (batch, copy));
             }
+
+            {
+                // Read it back in one batch, along with missing keys
+                auto const missing = createPredictableBatch (
+                    numObjectsToTest / 10, rng());
+
+                std::vector <void const*> keys;
+                for (auto const& object : batch)
+                    keys.push_back (object->getHash().begin());
+                for (auto const& object : missing)
+                    keys.push_back (object->getHash().begin());
+
+                auto const objects = backend->fetchBatch (
+                    keys.size(), keys.data());
+                BEAST_EXPECT(objects.size() == keys.size());
+
+                Batch copy (objects.begin(), objects.begin() + batch.size());
+                BEAST_EXPECT(std::all_of (copy.begin(), copy.end(),
+                    [](std::shared_ptr<NodeObject> const& object)
+                    {
+                        return object != nullptr;
+                    }));
+                BEAST_EXPECT(std::all_of (
+                    objects.begin() + batch.size(), objects.end(),
+                    [](std::shared_ptr<NodeObject> const& object)
+                    {
+                        return object == nullptr;
+                    }));
+                BEAST_EXPECT(areBatchesEqual (batch, copy));
+            }
         }
 
         {
@@ -97,13 +165,154 @@ public:
         }
     }
 
+    void testBulkBuild (std::uint64_t const seedValue)
+    {
+        DummyScheduler scheduler;
+        beast::Journal j;
+
+        testcase ("NuDB bulk build");
+
+        Section params;
+        beast::temp_dir tempDir;
+        params.set ("type", "nudb");
+        params.set ("path", tempDir.path());
+
+        auto batch = createPredictableBatch (8000, seedValue);
+        auto const inner = createInnerNodes (800, seedValue + 1);
+        batch.insert (batch.end(), inner.begin(), inner.end());
+        std::sort (batch.begin (), batch.end (), LessThan{});
+
+        {
+            auto backend = Manager::instance().make_Backend (
+                params, scheduler, j);
+            BEAST_EXPECT(backend->beginBulk());
+
+            // Store from several threads, as a parallel import does
+            std::vector<std::thread> writers;
+            for (std::size_t t = 0; t < 4; ++t)
+            {
+                writers.emplace_back (
+                    [&backend, &batch, t]
+                    {
+                        for (std::size_t i = t; i < batch.size(); i += 4)
+                            backend->store (batch[i]);
+                    });
+            }
+            for (auto& w : writers)
+                w.join();
+
+            // Nothing is visible until the build finishes
+            std::shared_ptr<NodeObject> object;
+            BEAST_EXPECT(backend->fetch (
+                batch.front()->getHash().begin(), &object) == notFound);
+
+            backend->endBulk (3);
+            BEAST_EXPECT(! backend->beginBulk());
+
+            Batch copy;
+            fetchCopyOfBatch (*backend, &copy, batch);
+            BEAST_EXPECT(areBatchesEqual (batch, copy));
+
+            backend->verify();
+
+            // The finished database takes ordinary writes
+            auto const more = createPredictableBatch (100, seedValue + 2);
+            storeBatch (*backend, more);
+            fetchCopyOfBatch (*backend, &copy, more);
+            BEAST_EXPECT(areBatchesEqual (more, copy));
+        }
+
+        {
+            // Re-open the backend
+            auto backend = Manager::instance().make_Backend (
+                params, scheduler, j);
+            Batch copy;
+            fetchCopyOfBatch (*backend, &copy, batch);
+            BEAST_EXPECT(areBatchesEqual (batch, copy));
+        }
+
+        {
+            // An unfinished build is discarded
+            beast::temp_dir abandonDir;
+            Section abandonParams;
+            abandonParams.set ("type", "nudb");
+            abandonParams.set ("path", abandonDir.path());
+            {
+                auto backend = Manager::instance().make_Backend (
+                    abandonParams, scheduler, j);
+                BEAST_EXPECT(backend->beginBulk());
+                storeBatch (*backend, batch);
+            }
+            auto backend = Manager::instance().make_Backend (
+                abandonParams, scheduler, j);
+            std::shared_ptr<NodeObject> object;
+            BEAST_EXPECT(backend->fetch (
+                batch.front()->getHash().begin(), &object) == notFound);
+            BEAST_EXPECT(backend->beginBulk());
+            backend->endBulk (1);
+            backend->verify();
+        }
+
+        {
+            // A build interrupted while its files were being swapped in,
+            // or before its key file was written, is discarded
+            namespace fs = boost::filesystem;
+            auto const built = fs::path (tempDir.path());
+            beast::temp_dir swapDir;
+            Section swapParams;
+            swapParams.set ("type", "nudb");
+            swapParams.set ("path", swapDir.path());
+            auto const dir = fs::path (swapDir.path());
+
+            auto check = [&]
+                {
+                    auto backend = Manager::instance().make_Backend (
+                        swapParams, scheduler, j);
+                    std::shared_ptr<NodeObject> object;
+                    BEAST_EXPECT(backend->fetch (batch.front()->
+                        getHash().begin(), &object) == notFound);
+                    BEAST_EXPECT(! fs::exists (dir / "nudb.dat.bulk"));
+                    BEAST_EXPECT(! fs::exists (dir / "nudb.key.bulk"));
+                    storeBatch (*backend, batch);
+                    backend->verify();
+                };
+
+            // Only the data file was renamed
+            Manager::instance().make_Backend (swapParams, scheduler, j);
+            fs::remove (dir / "nudb.dat");
+            fs::copy_file (built / "nudb.dat", dir / "nudb.dat");
+            fs::copy_file (built / "nudb.key", dir / "nudb.key.bulk");
+            check ();
+
+            // Only the data file was written
+            for (auto const& name : { "nudb.dat", "nudb.key", "nudb.log" })
+                fs::remove (dir / name);
+            fs::copy_file (built / "nudb.dat", dir / "nudb.dat.bulk");
+            check ();
+        }
+
+        {
+            // Backends without bulk builds decline
+            beast::temp_dir memoryDir;
+            Section memoryParams;
+            memoryParams.set ("type", "memory");
+            memoryParams.set ("path", memoryDir.path());
+            auto backend = Manager::instance().make_Backend (
+                memoryParams, scheduler, j);
+            BEAST_EXPECT(! backend->beginBulk());
+        }
+    }
+
     //--------------------------------------------------------------------------
 
     void run ()
     {
         std::uint64_t const seedValue = 50;
 
+        testBackend ("memory", seedValue);
+
         testBackend ("nudb", seedValue);
+        testBulkBuild (seedValue);
 
     #if RIPPLE_ROCKSDB_AVAILABLE
         testBackend ("rocksdb", seedValue);
@@ -0,0 +1,209 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <test/nodestore/TestBase.h>
+#include <ripple/nodestore/DummyScheduler.h>
+#include <ripple/nodestore/impl/BatchWriter.h>
+#include <ripple/nodestore/impl/Tuning.h>
+#include <ripple/basics/chrono.h>
+#include <chrono>
+#include <deque>
+
+namespace ripple {
+namespace NodeStore {
+
+class BatchWriter_test : public TestBase
+{
+public:
+    // Runs scheduled tasks only when asked to
+    class ManualScheduler : public Scheduler
+    {
+    public:
+        std::deque <Task*> tasks;
+        std::vector <BatchWriteReport> reports;
+
+        void run ()
+        {
+            while (! tasks.empty())
+            {
+                auto const task = tasks.front();
+                tasks.pop_front();
+                task->performScheduledTask();
+            }
+        }
+
+        void scheduleTask (Task& task) override
+        {
+            tasks.push_back (&task);
+        }
+
+        void onFetch (FetchReport const&) override
+        {
+        }
+
+        void onBatchWrite (BatchWriteReport const& report) override
+        {
+            reports.push_back (report);
+        }
+    };
+
+    // Records each batch, advancing the clock by a fixed time per object
+    class Recorder : public BatchWriter::Callback
+    {
+    public:
+        TestStopwatch clock;
+        std::chrono::microseconds perObject {0};
+        std::vector <std::size_t> sizes;
+        std::size_t written = 0;
+
+        void writeBatch (Batch const& batch) override
+        {
+            clock.advance (perObject * batch.size());
+            sizes.push_back (batch.size());
+            written += batch.size();
+        }
+    };
+
+    void
+    testDuplicates ()
+    {
+        testcase ("duplicates");
+
+        ManualScheduler scheduler;
+        Recorder recorder;
+        BatchWriter writer (recorder, scheduler, recorder.clock);
+
+        auto const batch = createPredictableBatch (500, 1);
+        for (int i = 0; i < 3; ++i)
+            for (auto const& object : batch)
+                writer.store (object);
+
+        BEAST_EXPECT(scheduler.tasks.size() == 1);
+        BEAST_EXPECT(writer.getWriteLoad() == static_cast<int>(batch.size()));
+        scheduler.run();
+        BEAST_EXPECT(recorder.written == batch.size());
+        BEAST_EXPECT(writer.getWriteLoad() == 0);
+
+        // Once written, an object may be stored again
+        writer.store (batch.front());
+        scheduler.run();
+        BEAST_EXPECT(recorder.written == batch.size() + 1);
+    }
+
+    void
+    testAdaptiveBatches ()
+    {
+        testcase ("adaptive batches");
+
+        ManualScheduler scheduler;
+        Recorder recorder;
+        recorder.perObject = std::chrono::microseconds (50);
+        BatchWriter writer (recorder, scheduler, recorder.clock);
+
+        // The first write measures the backend
+        auto const first = createPredictableBatch (4000, 2);
+        for (auto const& object : first)
+            writer.store (object);
+        scheduler.run();
+        BEAST_EXPECT(recorder.sizes.size() == 1);
+        BEAST_EXPECT(scheduler.reports.front().queueDepth ==
+            static_cast<int>(first.size()));
+
+        // Later writes are sized to take about the target time
+        auto const limit = batchWriteTargetMs * 1000 /
+            recorder.perObject.count();
+        auto const second = createPredictableBatch (4000, 3);
+        for (auto const& object : second)
+            writer.store (object);
+        recorder.sizes.clear();
+        scheduler.run();
+        BEAST_EXPECT(recorder.sizes.size() > 1);
+        for (auto const size : recorder.sizes)
+        {
+            BEAST_EXPECT(size >= batchWriteMinSize);
+            BEAST_EXPECT(size <= limit);
+        }
+        BEAST_EXPECT(recorder.written == first.size() + second.size());
+    }
+
+    void
+    testBacklog ()
+    {
+        testcase ("backlog");
+
+        ManualScheduler scheduler;
+        Recorder recorder;
+        recorder.perObject = std::chrono::microseconds (100);
+        BatchWriter writer (recorder, scheduler, recorder.clock);
+
+        auto const first = createPredictableBatch (1000, 4);
+        for (auto const& object : first)
+            writer.store (object);
+        BEAST_EXPECT(! writer.isBacklogged());
+        scheduler.run();
+
+        // Each batch now holds at most 1000 objects
+        auto const backlog = createPredictableBatch (
+            batchWriteBacklogBatches * 1000 + 1, 5);
+        for (auto const& object : backlog)
+            writer.store (object);
+        BEAST_EXPECT(writer.isBacklogged());
+
+        recorder.perObject = std::chrono::microseconds (0);
+        scheduler.run();
+        BEAST_EXPECT(! writer.isBacklogged());
+        BEAST_EXPECT(recorder.written == first.size() + backlog.size());
+    }
+
+    void
+    testSynchronous ()
+    {
+        testcase ("synchronous scheduler");
+
+        // The task runs inside store, so each object is written at once
+        DummyScheduler scheduler;
+        Recorder recorder;
+        BatchWriter writer (recorder, scheduler, recorder.clock);
+
+        auto const batch = createPredictableBatch (100, 6);
+        for (auto const& object : batch)
+        {
+            writer.store (object);
+            BEAST_EXPECT(writer.getWriteLoad() == 0);
+        }
+        BEAST_EXPECT(recorder.sizes.size() == batch.size());
+        BEAST_EXPECT(recorder.written == batch.size());
+    }
+
+    void
+    run () override
+    {
+        testDuplicates ();
+        testAdaptiveBatches ();
+        testBacklog ();
+        testSynchronous ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(BatchWriter,NodeStore,ripple);
+
+}
+}
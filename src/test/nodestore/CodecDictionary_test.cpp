@@ -0,0 +1,461 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <test/nodestore/TestBase.h>
+#include <ripple/nodestore/DummyScheduler.h>
+#include <ripple/nodestore/Manager.h>
+#include <ripple/nodestore/impl/codec.h>
+#include <ripple/nodestore/impl/CodecDictionary.h>
+#include <ripple/nodestore/impl/DecodedBlob.h>
+#include <ripple/nodestore/impl/EncodedBlob.h>
+#include <ripple/protocol/digest.h>
+#include <ripple/protocol/HashPrefix.h>
+#include <ripple/protocol/Indexes.h>
+#include <ripple/protocol/STLedgerEntry.h>
+#include <ripple/beast/utility/temp_dir.h>
+#include <nudb/nudb.hpp>
+#include <fstream>
+#include <sstream>
+
+namespace ripple {
+namespace NodeStore {
+
+// Produces encoded state leaves, as the NuDB backend sees them: account
+// roots, and trust lines to a few popular issuers.
+class StateLeaves
+{
+private:
+    beast::xor_shift_engine gen_;
+    std::vector<Issue> issues_;
+    std::size_t n_ = 0;
+
+    AccountID
+    randomAccount()
+    {
+        AccountID id;
+        beast::rngfill (id.begin(), id.size(), gen_);
+        return id;
+    }
+
+    void
+    setPrevious (STLedgerEntry& sle)
+    {
+        uint256 txID;
+        beast::rngfill (txID.begin(), txID.size(), gen_);
+        sle.setFieldH256 (sfPreviousTxnID, txID);
+        sle.setFieldU32 (sfPreviousTxnLgrSeq, gen_() % 30000000);
+    }
+
+    STLedgerEntry
+    accountRoot()
+    {
+        auto const id = randomAccount();
+        STLedgerEntry sle (keylet::account (id));
+        sle.setAccountID (sfAccount, id);
+        sle.setFieldAmount (sfBalance, STAmount (gen_() % 100000000000));
+        sle.setFieldU32 (sfSequence, gen_() % 100000);
+        sle.setFieldU32 (sfOwnerCount, gen_() % 10);
+        sle.setFieldU32 (sfFlags, 0);
+        setPrevious (sle);
+        return sle;
+    }
+
+    STLedgerEntry
+    trustLine()
+    {
+        auto const& issue = issues_[gen_() % issues_.size()];
+        auto const holder = randomAccount();
+        STLedgerEntry sle (keylet::line (
+            holder, issue.account, issue.currency));
+        sle.setFieldU32 (sfFlags, lsfLowReserve);
+        sle.setFieldAmount (sfBalance, STAmount (
+            Issue (issue.currency, noAccount()), gen_() % 1000000000, -6));
+        sle.setFieldAmount (sfLowLimit, STAmount (
+            Issue (issue.currency, holder), 1000000000, -6));
+        sle.setFieldAmount (sfHighLimit, STAmount (
+            Issue (issue.currency, issue.account), 0, 0));
+        sle.setFieldU64 (sfLowNode, 0);
+        sle.setFieldU64 (sfHighNode, gen_() % 1000);
+        setPrevious (sle);
+        return sle;
+    }
+
+public:
+    explicit
+    StateLeaves (std::uint64_t seed)
+        : gen_ (seed)
+    {
+        // The issuers are the same for every seed
+        beast::xor_shift_engine gen;
+        for (auto const currency : { "USD", "EUR", "BTC", "CNY" })
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                AccountID issuer;
+                beast::rngfill (issuer.begin(), issuer.size(), gen);
+                issues_.emplace_back (to_currency (currency), issuer);
+            }
+        }
+    }
+
+    Blob
+    next()
+    {
+        auto const sle = (n_++ % 2) ? trustLine() : accountRoot();
+
+        Serializer s;
+        s.add32 (0);
+        s.add32 (0);
+        s.add8 (hotACCOUNT_NODE);
+        s.add32 (HashPrefix::leafNode);
+        sle.add (s);
+        s.add256 (sle.key());
+        return std::move (s.modData());
+    }
+};
+
+class CodecDictionary_test : public TestBase
+{
+public:
+    static
+    std::vector<Blob>
+    makeLeaves (std::size_t n, std::uint64_t seed)
+    {
+        StateLeaves gen (seed);
+        std::vector<Blob> leaves;
+        leaves.reserve (n);
+        while (n--)
+            leaves.push_back (gen.next());
+        return leaves;
+    }
+
+    // Compress a value and make sure it comes back the same.
+    // Returns the compressed size, including the codec type.
+    std::size_t
+    roundTrip (Blob const& value,
+        CodecDictionaries const* dictionaries, std::size_t expectedType)
+    {
+        nudb::detail::buffer bf;
+        auto const out = nodeobject_compress (
+            value.data(), value.size(), bf, dictionaries);
+
+        std::size_t type;
+        read_varint (static_cast<std::uint8_t const*> (out.first),
+            out.second, type);
+        BEAST_EXPECT(type == expectedType);
+
+        nudb::detail::buffer bf2;
+        auto const check = nodeobject_decompress (
+            out.first, out.second, bf2, dictionaries);
+        BEAST_EXPECT(check.second == value.size());
+        BEAST_EXPECT(std::memcmp (
+            check.first, value.data(), value.size()) == 0);
+        return out.second;
+    }
+
+    void
+    testCodec()
+    {
+        testcase ("codec");
+
+        CodecDictionaries dictionaries;
+        dictionaries.insert (hotACCOUNT_NODE,
+            CodecDictionaries::train (makeLeaves (2000, 1), 16 * 1024));
+        BEAST_EXPECT(dictionaries.newest (hotACCOUNT_NODE) != nullptr);
+        BEAST_EXPECT(dictionaries.newest (hotTRANSACTION_NODE) == nullptr);
+
+        std::size_t plain = 0;
+        std::size_t trained = 0;
+        for (auto const& leaf : makeLeaves (1000, 2))
+        {
+            plain += roundTrip (leaf, nullptr, 1);
+            trained += roundTrip (leaf, &dictionaries, 7);
+        }
+        log << "state leaves: " << plain << " bytes with lz4, " <<
+            trained << " with a dictionary" << std::endl;
+        // Hashes and account IDs are incompressible, so the gain comes
+        // from the field codes, issuers and currencies that repeat.
+        BEAST_EXPECT(trained < plain * 9 / 10);
+
+        // Types without a dictionary use lz4
+        auto leaf = makeLeaves (1, 3).front();
+        leaf[8] = hotTRANSACTION_NODE;
+        roundTrip (leaf, &dictionaries, 1);
+
+        // Inner nodes are still encoded by branch
+        Serializer s;
+        s.add32 (0);
+        s.add32 (0);
+        s.add8 (hotUNKNOWN);
+        s.add32 (HashPrefix::innerNode);
+        for (int i = 0; i < 16; ++i)
+            s.add256 (i % 3 ? uint256{} : sha512Half (i));
+        roundTrip (s.peekData(), &dictionaries, 2);
+    }
+
+    void
+    testVersions()
+    {
+        testcase ("versions");
+
+        auto const leaf = makeLeaves (1, 4).front();
+        auto const samples = makeLeaves (500, 5);
+
+        // Objects written before there were dictionaries
+        nudb::detail::buffer bf;
+        auto const old = nodeobject_compress (
+            leaf.data(), leaf.size(), bf);
+        Blob const oldValue (
+            static_cast<std::uint8_t const*> (old.first),
+            static_cast<std::uint8_t const*> (old.first) + old.second);
+
+        CodecDictionaries first;
+        first.insert (hotACCOUNT_NODE,
+            CodecDictionaries::train (samples, 4096));
+
+        // Objects written with the first dictionary
+        auto const out = nodeobject_compress (
+            leaf.data(), leaf.size(), bf, &first);
+        Blob const firstValue (
+            static_cast<std::uint8_t const*> (out.first),
+            static_cast<std::uint8_t const*> (out.first) + out.second);
+
+        // A newer dictionary replaces the first for writing, but the
+        // first is kept so its objects can still be read.
+        CodecDictionaries both;
+        both.insert (hotACCOUNT_NODE, first.list().front()->data);
+        auto const id = both.insert (hotACCOUNT_NODE,
+            CodecDictionaries::train (samples, 8192));
+        BEAST_EXPECT(both.newest (hotACCOUNT_NODE)->id == id);
+        BEAST_EXPECT(id != first.list().front()->id);
+
+        for (auto const& value : { oldValue, firstValue })
+        {
+            nudb::detail::buffer bf2;
+            auto const check = nodeobject_decompress (
+                value.data(), value.size(), bf2, &both);
+            BEAST_EXPECT(check.second == leaf.size());
+            BEAST_EXPECT(std::memcmp (
+                check.first, leaf.data(), leaf.size()) == 0);
+        }
+
+        // Without its dictionary, an object can't be read
+        CodecDictionaries other;
+        other.insert (hotACCOUNT_NODE,
+            CodecDictionaries::train (makeLeaves (500, 6), 4096));
+        for (auto const dictionaries : { (CodecDictionaries const*) nullptr,
+            (CodecDictionaries const*) &other })
+        {
+            try
+            {
+                nudb::detail::buffer bf2;
+                nodeobject_decompress (firstValue.data(),
+                    firstValue.size(), bf2, dictionaries);
+                fail();
+            }
+            catch (std::runtime_error const&)
+            {
+                pass();
+            }
+        }
+    }
+
+    void
+    testFile()
+    {
+        testcase ("file");
+
+        beast::temp_dir dir;
+        auto const path = dir.file ("dictionaries");
+
+        CodecDictionaries saved;
+        saved.insert (hotACCOUNT_NODE,
+            CodecDictionaries::train (makeLeaves (500, 7), 4096));
+        saved.insert (hotLEDGER, Blob (100, 7));
+        saved.save (path);
+
+        CodecDictionaries loaded;
+        loaded.load (path);
+        BEAST_EXPECT(loaded.list().size() == 2);
+        for (auto const& d : saved.list())
+        {
+            auto const found = loaded.find (d->id);
+            BEAST_EXPECT(found && found->type == d->type &&
+                found->data == d->data);
+        }
+
+        // A file that isn't a dictionary file is rejected
+        {
+            std::ofstream out (path, std::ios::trunc);
+            out << "[node_db]\ntype=nudb\n";
+        }
+        for (auto const& name : { path, path + ".missing" })
+        {
+            try
+            {
+                CodecDictionaries bad;
+                bad.load (name);
+                fail();
+            }
+            catch (std::runtime_error const&)
+            {
+                pass();
+            }
+        }
+    }
+
+    void
+    testBackend()
+    {
+        testcase ("backend");
+
+        DummyScheduler scheduler;
+        beast::temp_dir node_db;
+        beast::temp_dir dictionary_dir;
+        auto const path = dictionary_dir.file ("dictionaries");
+
+        auto leaves = makeLeaves (500, 8);
+        {
+            CodecDictionaries dictionaries;
+            dictionaries.insert (hotACCOUNT_NODE,
+                CodecDictionaries::train (leaves, 4096));
+            dictionaries.save (path);
+        }
+
+        Section params;
+        params.set ("type", "nudb");
+        params.set ("path", node_db.path());
+        params.set ("dictionary", path);
+
+        // Objects as the database would store them
+        Batch batch;
+        for (auto& leaf : leaves)
+        {
+            auto const hash = sha512Half (makeSlice (leaf));
+            batch.push_back (NodeObject::createObject (hotACCOUNT_NODE,
+                Blob (leaf.begin() + 9, leaf.end()), hash));
+        }
+        auto const other = createPredictableBatch (100, 9);
+        batch.insert (batch.end(), other.begin(), other.end());
+
+        beast::Journal j;
+        {
+            auto backend = Manager::instance().make_Backend (
+                params, scheduler, j);
+            storeBatch (*backend, batch);
+        }
+        {
+            auto backend = Manager::instance().make_Backend (
+                params, scheduler, j);
+            Batch copy;
+            fetchCopyOfBatch (*backend, &copy, batch);
+            BEAST_EXPECT(areBatchesEqual (batch, copy));
+        }
+    }
+
+    void
+    testTraining()
+    {
+        testcase ("training");
+
+        DummyScheduler scheduler;
+        beast::temp_dir node_db;
+        beast::temp_dir dictionary_dir;
+        auto const path = dictionary_dir.file ("dictionaries");
+
+        Section params;
+        params.set ("type", "nudb");
+        params.set ("path", node_db.path());
+
+        // Objects written before there were dictionaries, including
+        // random ones that have nothing in common
+        Batch batch;
+        for (auto& leaf : makeLeaves (500, 10))
+        {
+            auto const hash = sha512Half (makeSlice (leaf));
+            batch.push_back (NodeObject::createObject (hotACCOUNT_NODE,
+                Blob (leaf.begin() + 9, leaf.end()), hash));
+        }
+        auto const other = createPredictableBatch (100, 11);
+        batch.insert (batch.end(), other.begin(), other.end());
+
+        beast::Journal j;
+        {
+            auto backend = Manager::instance().make_Backend (
+                params, scheduler, j);
+            storeBatch (*backend, batch);
+        }
+
+        // The backend must be nudb and name a dictionary file
+        try
+        {
+            std::ostringstream out;
+            trainDictionaries (params, 200, 4096, out);
+            fail();
+        }
+        catch (std::runtime_error const&)
+        {
+            pass();
+        }
+
+        params.set ("dictionary", path);
+        std::ostringstream out;
+        trainDictionaries (params, 200, 4096, out);
+        log << out.str();
+
+        CodecDictionaries trained;
+        trained.load (path);
+        auto const first = trained.newest (hotACCOUNT_NODE);
+        if (! BEAST_EXPECT(first))
+            return;
+        BEAST_EXPECT(first->data.size() <= 4096);
+        // A dictionary that makes objects bigger is dropped
+        BEAST_EXPECT(trained.newest (hotLEDGER) == nullptr);
+
+        // Training again keeps the dictionaries already in the file
+        auto const id = first->id;
+        trainDictionaries (params, 400, 8192, out);
+        trained.load (path);
+        BEAST_EXPECT(trained.find (id) != nullptr);
+        BEAST_EXPECT(trained.newest (hotACCOUNT_NODE)->id != id);
+
+        // Every object is still readable with the dictionaries
+        auto backend = Manager::instance().make_Backend (
+            params, scheduler, j);
+        Batch copy;
+        fetchCopyOfBatch (*backend, &copy, batch);
+        BEAST_EXPECT(areBatchesEqual (batch, copy));
+    }
+
+    void
+    run() override
+    {
+        testCodec();
+        testVersions();
+        testFile();
+        testBackend();
+        testTraining();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(CodecDictionary,NodeStore,ripple);
+
+}
+}
@@ -0,0 +1,419 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <test/nodestore/TestBase.h>
+#include <ripple/nodestore/DummyScheduler.h>
+#include <ripple/nodestore/DatabaseRotating.h>
+#include <ripple/nodestore/Manager.h>
+#include <ripple/nodestore/impl/KeyFilter.h>
+#include <ripple/beast/utility/temp_dir.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+namespace ripple {
+namespace NodeStore {
+
+// A backend that counts the reads made of another
+class CountingBackend : public Backend
+{
+private:
+    std::unique_ptr <Backend> backend_;
+
+public:
+    std::atomic <std::size_t> reads;
+
+    explicit
+    CountingBackend (std::unique_ptr <Backend> backend)
+        : backend_ (std::move (backend))
+        , reads (0)
+    {
+    }
+
+    std::string getName() override
+    {
+        return backend_->getName();
+    }
+
+    void close() override
+    {
+        backend_->close();
+    }
+
+    Status fetch (void const* key,
+        std::shared_ptr<NodeObject>* pObject) override
+    {
+        ++reads;
+        return backend_->fetch (key, pObject);
+    }
+
+    bool canFetchBatch() override
+    {
+        return backend_->canFetchBatch();
+    }
+
+    std::vector<std::shared_ptr<NodeObject>>
+    fetchBatch (std::size_t n, void const* const* keys) override
+    {
+        reads += n;
+        return backend_->fetchBatch (n, keys);
+    }
+
+    void store (std::shared_ptr<NodeObject> const& object) override
+    {
+        backend_->store (object);
+    }
+
+    void storeBatch (Batch const& batch) override
+    {
+        backend_->storeBatch (batch);
+    }
+
+    void for_each (
+        std::function <void (std::shared_ptr<NodeObject>)> f) override
+    {
+        backend_->for_each (f);
+    }
+
+    int getWriteLoad () override
+    {
+        return backend_->getWriteLoad();
+    }
+
+    void setDeletePath() override
+    {
+        backend_->setDeletePath();
+    }
+
+    void verify() override
+    {
+        backend_->verify();
+    }
+
+    int fdlimit() const override
+    {
+        return backend_->fdlimit();
+    }
+};
+
+class DatabaseRotating_test : public TestBase
+{
+public:
+    void
+    testKeyFilter (std::int64_t const seedValue)
+    {
+        testcase ("key filter");
+
+        // Start small so the filter has to grow many segments
+        KeyFilter filter (64);
+        auto const batch = createPredictableBatch (50000, seedValue);
+        for (auto const& e : batch)
+            filter.insert (e->getHash());
+
+        bool all = true;
+        for (auto const& e : batch)
+            all = all && filter.mayContain (e->getHash());
+        BEAST_EXPECT(all);
+
+        std::size_t falsePositives = 0;
+        auto const others = createPredictableBatch (50000, seedValue + 1);
+        for (auto const& e : others)
+        {
+            if (filter.mayContain (e->getHash()))
+                ++falsePositives;
+        }
+        BEAST_EXPECT(falsePositives < others.size() / 100);
+    }
+
+    void
+    testRotation (std::int64_t const seedValue)
+    {
+        testcase ("reads skipped after rotation");
+
+        DummyScheduler scheduler;
+        RootStoppable parent ("TestRootStoppable");
+        beast::Journal j;
+
+        auto const makeBackend = [&](std::string const& path)
+        {
+            Section params;
+            params.set ("type", "memory");
+            params.set ("path", path);
+            return std::make_shared <CountingBackend> (
+                Manager::instance().make_Backend (params, scheduler, j));
+        };
+
+        auto const first = makeBackend ("rotation_first");
+        auto const second = makeBackend ("rotation_second");
+        auto const db = Manager::instance().make_DatabaseRotating (
+            "test", scheduler, 2, parent, first,
+                makeBackend ("rotation_archive"), CachePolicy::lru, j);
+        auto& database = dynamic_cast <Database&> (*db);
+
+        auto const batch = createPredictableBatch (
+            numObjectsToTest, seedValue);
+        storeBatch (database, batch);
+
+        {
+            std::lock_guard <std::mutex> lock (db->peekMutex());
+            db->rotateBackends (second);
+            db->getPositiveCache().clear();
+        }
+
+        // Everything is found in the archive, without reading the
+        // new writable backend, and is written back to it
+        Batch copy;
+        fetchCopyOfBatch (database, &copy, batch);
+        BEAST_EXPECT(areBatchesEqual (batch, copy));
+        BEAST_EXPECT(second->reads == 0);
+        BEAST_EXPECT(first->reads >= batch.size());
+
+        bool promoted = true;
+        for (auto const& e : batch)
+        {
+            std::shared_ptr <NodeObject> object;
+            if (second->fetch (e->getHash().begin(), &object) != ok ||
+                    ! isSame (object, e))
+                promoted = false;
+        }
+        BEAST_EXPECT(promoted);
+
+        // Once both backends were created by a rotation,
+        // neither is read for a missing object
+        auto const third = makeBackend ("rotation_third");
+        {
+            std::lock_guard <std::mutex> lock (db->peekMutex());
+            db->rotateBackends (third);
+        }
+        auto const missing = createPredictableBatch (
+            numObjectsToTest, seedValue + 1);
+        second->reads = 0;
+        for (auto const& e : missing)
+            BEAST_EXPECT(! db->fetchNode (e->getHash()));
+        BEAST_EXPECT(second->reads < missing.size() / 20);
+        BEAST_EXPECT(third->reads < missing.size() / 20);
+
+        // Objects written after the rotation are found
+        auto const newer = createPredictableBatch (
+            numObjectsToTest, seedValue + 2);
+        storeBatch (database, newer);
+        bool found = true;
+        for (auto const& e : newer)
+        {
+            auto const object = db->fetchNode (e->getHash());
+            if (! object || ! isSame (object, e))
+                found = false;
+        }
+        BEAST_EXPECT(found);
+
+        // The filters are taken out of the cache's memory limit
+        auto const filters = database.getFilterBytes();
+        BEAST_EXPECT(filters > 0);
+        database.setCacheBytes (filters + 1000);
+        BEAST_EXPECT(db->getPositiveCache().getTargetBytes() == 1000);
+        database.setCacheBytes (filters / 2);
+        BEAST_EXPECT(db->getPositiveCache().getTargetBytes() == 1);
+    }
+
+    void
+    run () override
+    {
+        std::int64_t const seedValue = 50;
+
+        testKeyFilter (seedValue);
+        testRotation (seedValue);
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// Reports the time taken to fetch from a rotating database before and
+// after a rotation, for objects in each backend and for missing ones.
+class DatabaseRotatingTiming_test : public TestBase
+{
+public:
+    // Performs scheduled tasks on a thread of its own
+    class ThreadScheduler : public Scheduler
+    {
+    private:
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        std::deque <Task*> tasks_;
+        bool stop_ = false;
+        std::thread thread_;
+
+    public:
+        ThreadScheduler ()
+            : thread_ ([this]{ run(); })
+        {
+        }
+
+        ~ThreadScheduler ()
+        {
+            {
+                std::lock_guard <std::mutex> lock (mutex_);
+                stop_ = true;
+            }
+            cond_.notify_all();
+            thread_.join();
+        }
+
+        void run ()
+        {
+            std::unique_lock <std::mutex> lock (mutex_);
+            for (;;)
+            {
+                cond_.wait (lock, [this]{ return stop_ || ! tasks_.empty(); });
+                if (tasks_.empty())
+                    return;
+                auto const task = tasks_.front();
+                tasks_.pop_front();
+                lock.unlock();
+                task->performScheduledTask();
+                lock.lock();
+            }
+        }
+
+        void scheduleTask (Task& task) override
+        {
+            {
+                std::lock_guard <std::mutex> lock (mutex_);
+                tasks_.push_back (&task);
+            }
+            cond_.notify_one();
+        }
+
+        void onFetch (FetchReport const&) override
+        {
+        }
+
+        void onBatchWrite (BatchWriteReport const&) override
+        {
+        }
+    };
+
+    template <class Function>
+    double
+    microseconds (std::size_t n, Function&& f)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < n; ++i)
+            f (i);
+        return std::chrono::duration_cast <std::chrono::duration<
+            double, std::micro>> (std::chrono::steady_clock::now() -
+                start).count() / n;
+    }
+
+    void
+    run () override
+    {
+        ThreadScheduler scheduler;
+        RootStoppable parent ("TestRootStoppable");
+        beast::Journal j;
+        beast::temp_dir dir;
+
+#ifndef NDEBUG
+        std::size_t const objects = 20000;
+#else
+        std::size_t const objects = 200000;
+#endif
+
+        int next = 0;
+        auto const makeBackend = [&]
+        {
+            Section params;
+            params.set ("type", "nudb");
+            params.set ("path", dir.file (std::to_string (next++)));
+            return std::make_shared <CountingBackend> (
+                Manager::instance().make_Backend (params, scheduler, j));
+        };
+
+        auto const first = makeBackend();
+        auto const db = Manager::instance().make_DatabaseRotating (
+            "test", scheduler, 1, parent, first, makeBackend(),
+                CachePolicy::lru, j);
+        auto& database = dynamic_cast <Database&> (*db);
+
+        auto const stored = createPredictableBatch (objects, 1);
+        auto const missing = createPredictableBatch (objects, 2);
+        storeBatch (database, stored);
+
+        auto const fetch = [&](Batch const& batch, std::size_t offset)
+        {
+            return [&, offset](std::size_t i)
+            {
+                db->fetchNode (batch[offset + i]->getHash());
+            };
+        };
+        auto const rotate = [&]
+        {
+            std::lock_guard <std::mutex> lock (db->peekMutex());
+            db->rotateBackends (makeBackend());
+            db->getPositiveCache().clear();
+        };
+
+        log << std::left << std::setw (48) << "phase" <<
+            std::right << std::setw (12) << "us/fetch" << std::endl;
+        auto const report = [&](std::string const& phase, double us)
+        {
+            log << std::left << std::setw (48) << phase << std::right <<
+                std::setw (12) << std::fixed << std::setprecision (2) <<
+                    us << std::endl;
+        };
+
+        std::size_t const quarter = objects / 4;
+
+        report ("before rotation, stored",
+            microseconds (quarter, fetch (stored, 0)));
+        report ("before rotation, missing",
+            microseconds (quarter, fetch (missing, 0)));
+
+        rotate();
+
+        // fetchNode writes archive hits back before returning,
+        // as every fetch used to
+        report ("after rotation, archived, written back at once",
+            microseconds (quarter, fetch (stored, quarter)));
+
+        auto const second = quarter * 2;
+        report ("after rotation, archived, written back later",
+            microseconds (quarter, [&](std::size_t i)
+            {
+                database.fetch (stored[second + i]->getHash());
+            }));
+        report ("after rotation, missing",
+            microseconds (quarter, fetch (missing, quarter)));
+
+        rotate();
+
+        report ("after two rotations, missing",
+            microseconds (quarter, fetch (missing, second)));
+        pass();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(DatabaseRotating,NodeStore,ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(DatabaseRotatingTiming,NodeStore,ripple);
+
+}
+}
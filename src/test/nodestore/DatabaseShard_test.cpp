@@ -0,0 +1,192 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <test/nodestore/TestBase.h>
+#include <ripple/nodestore/DummyScheduler.h>
+#include <ripple/nodestore/DatabaseShard.h>
+#include <ripple/nodestore/Manager.h>
+#include <ripple/beast/utility/temp_dir.h>
+#include <boost/filesystem.hpp>
+
+namespace ripple {
+namespace NodeStore {
+
+class DatabaseShard_test : public TestBase
+{
+public:
+    static std::uint32_t const ledgersPerShard = 4;
+
+    std::unique_ptr <Database>
+    makeDatabase (Scheduler& scheduler, Stoppable& parent,
+        std::string const& type, std::string const& path)
+    {
+        Section params;
+        params.set ("type", type);
+        params.set ("path", path);
+        params.set ("ledgers_per_shard", std::to_string (ledgersPerShard));
+        return Manager::instance().make_DatabaseShard (
+            "test", scheduler, 2, parent, params, beast::Journal());
+    }
+
+    // Spread the objects over the ledgers of three shards
+    static
+    std::uint32_t
+    seqOf (std::size_t i)
+    {
+        return 1 + i % (3 * ledgersPerShard);
+    }
+
+    void
+    testShards (std::string const& type, std::int64_t const seedValue)
+    {
+        DummyScheduler scheduler;
+        RootStoppable parent ("TestRootStoppable");
+        beast::temp_dir shard_db;
+
+        auto const batch = createPredictableBatch (
+            numObjectsToTest, seedValue);
+
+        {
+            testcase ("store and fetch by ledger with '" + type + "'");
+
+            auto const db = makeDatabase (
+                scheduler, parent, type, shard_db.path());
+            auto& shards = dynamic_cast <DatabaseShard&> (*db);
+
+            BEAST_EXPECT(shards.seqToShardIndex (1) == 0);
+            BEAST_EXPECT(shards.seqToShardIndex (4) == 0);
+            BEAST_EXPECT(shards.seqToShardIndex (5) == 1);
+            BEAST_EXPECT(shards.firstSeq (2) == 9);
+            BEAST_EXPECT(shards.lastSeq (2) == 12);
+
+            for (std::size_t i = 0; i < batch.size (); ++i)
+            {
+                auto const& e = batch[i];
+                Blob data (e->getData ());
+                shards.store (e->getType (), std::move (data),
+                    e->getHash (), seqOf (i));
+            }
+            BEAST_EXPECT(shards.getCompleteShards () == "empty");
+
+            bool routed = true;
+            bool found = true;
+            for (std::size_t i = 0; i < batch.size (); ++i)
+            {
+                auto const& e = batch[i];
+                auto const seq = seqOf (i);
+                auto const object = shards.fetch (e->getHash (), seq);
+                if (! object || ! isSame (object, e))
+                    routed = false;
+
+                // The other shards do not have it
+                auto const other = seq + ledgersPerShard;
+                if (other <= 3 * ledgersPerShard &&
+                        shards.fetch (e->getHash (), other))
+                    routed = false;
+
+                // Without the sequence every open shard is searched
+                if (! db->fetch (e->getHash ()))
+                    found = false;
+            }
+            BEAST_EXPECT(routed);
+            BEAST_EXPECT(found);
+
+            testcase ("complete shards with '" + type + "'");
+
+            for (std::uint32_t seq = 1; seq <= ledgersPerShard; ++seq)
+                shards.setStored (seq);
+            shards.setStored (3 * ledgersPerShard);
+            BEAST_EXPECT(shards.getCompleteShards () == "0");
+            BEAST_EXPECT(shards.contains (1));
+            BEAST_EXPECT(! shards.contains (ledgersPerShard + 1));
+            BEAST_EXPECT(shards.contains (3 * ledgersPerShard));
+
+            // Complete shards are read only
+            auto const extra = createPredictableBatch (1, seedValue + 1);
+            Blob data (extra[0]->getData ());
+            shards.store (extra[0]->getType (), std::move (data),
+                extra[0]->getHash (), 2);
+            BEAST_EXPECT(! shards.fetch (extra[0]->getHash (), 2));
+        }
+
+        {
+            testcase ("reopen shards with '" + type + "'");
+
+            auto const db = makeDatabase (
+                scheduler, parent, type, shard_db.path());
+            auto& shards = dynamic_cast <DatabaseShard&> (*db);
+
+            BEAST_EXPECT(shards.getCompleteShards () == "0");
+            BEAST_EXPECT(shards.contains (3 * ledgersPerShard));
+            BEAST_EXPECT(! shards.contains (3 * ledgersPerShard - 1));
+
+            // A backend is only opened when its shard is read, and
+            // a lookup without the ledger does not open any
+            BEAST_EXPECT(db->fdlimit () == 0);
+            BEAST_EXPECT(! db->fetch (uint256 ()));
+            BEAST_EXPECT(db->fdlimit () == 0);
+            BEAST_EXPECT(shards.fetch (batch[0]->getHash (), seqOf (0)));
+            auto const perShard = db->fdlimit ();
+            BEAST_EXPECT(perShard > 0);
+
+            bool found = true;
+            for (std::size_t i = 0; i < batch.size (); ++i)
+            {
+                if (! shards.fetch (batch[i]->getHash (), seqOf (i)))
+                    found = false;
+            }
+            BEAST_EXPECT(found);
+            BEAST_EXPECT(db->fdlimit () == 3 * perShard);
+
+            Batch copy;
+            fetchCopyOfBatch (*db, &copy, batch);
+            BEAST_EXPECT(areBatchesEqual (batch, copy));
+
+            testcase ("validate and remove shards with '" + type + "'");
+
+            for (std::uint32_t seq = ledgersPerShard + 1;
+                    seq <= 2 * ledgersPerShard; ++seq)
+                shards.setStored (seq);
+            BEAST_EXPECT(shards.getCompleteShards () == "0-1");
+            BEAST_EXPECT(shards.validate (2).empty ());
+
+            BEAST_EXPECT(shards.removeShard (0));
+            BEAST_EXPECT(! shards.removeShard (0));
+            BEAST_EXPECT(shards.getCompleteShards () == "1");
+            BEAST_EXPECT(! shards.contains (1));
+            BEAST_EXPECT(! boost::filesystem::exists (
+                boost::filesystem::path (shard_db.path()) / "0"));
+        }
+    }
+
+    void
+    run () override
+    {
+        std::int64_t const seedValue = 50;
+
+        testShards ("nudb", seedValue);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(DatabaseShard,NodeStore,ripple);
+
+}
+}
@@ -20,8 +20,11 @@
 #include <BeastConfig.h>
 #include <test/nodestore/TestBase.h>
 #include <ripple/nodestore/DummyScheduler.h>
+#include <ripple/nodestore/DatabaseRotating.h>
 #include <ripple/nodestore/Manager.h>
 #include <ripple/beast/utility/temp_dir.h>
+#include <boost/filesystem.hpp>
+#include <fstream>
 
 namespace ripple {
 namespace NodeStore {
@@ -85,6 +88,82 @@ public:
         BEAST_EXPECT(areBatchesEqual (batch, copy));
     }
 
+    void testParallelImport (std::int64_t seedValue)
+    {
+        DummyScheduler scheduler;
+        RootStoppable parent ("TestRootStoppable");
+        beast::Journal j;
+
+        testcase ("parallel import with a checkpoint");
+
+        beast::temp_dir src_db;
+        Section srcParams;
+        srcParams.set ("type", "nudb");
+        srcParams.set ("path", src_db.path());
+
+        auto const batch = createPredictableBatch (
+            numObjectsToTest, seedValue);
+        auto src = Manager::instance().make_Database (
+            "test", scheduler, 2, parent, srcParams, j);
+        storeBatch (*src, batch);
+
+        // The order the source visits its objects in
+        std::vector <uint256> order;
+        src->for_each ([&](std::shared_ptr<NodeObject> object)
+        {
+            order.push_back (object->getHash());
+        });
+        BEAST_EXPECT(order.size() == batch.size());
+
+        auto const importWith = [&](int writeThreads, std::size_t resume,
+            uint256 const& resumeKey)
+        {
+            beast::temp_dir dest_db;
+            Section destParams;
+            destParams.set ("type", "nudb");
+            destParams.set ("path", dest_db.path());
+            auto dest = Manager::instance().make_Database (
+                "test", scheduler, 2, parent, destParams, j);
+
+            ImportOptions options;
+            options.writeThreads = writeThreads;
+            options.checkpoint = dest_db.file ("import.checkpoint");
+            if (resume != 0)
+            {
+                std::ofstream ofs (options.checkpoint);
+                ofs << src->getName() << '\n' << resume << '\n' <<
+                    to_string (resumeKey) << '\n';
+            }
+
+            // A checkpoint which does not match the source's order is
+            // ignored
+            if (resume != 0 && resumeKey != order[resume - 1])
+                resume = 0;
+
+            dest->import (*src, options);
+            BEAST_EXPECT(! boost::filesystem::exists (options.checkpoint));
+
+            // Only the objects after the checkpoint were imported
+            std::size_t skipped = 0;
+            std::size_t imported = 0;
+            for (std::size_t i = 0; i < order.size(); ++i)
+            {
+                bool const found = dest->fetch (order[i]) != nullptr;
+                if (i < resume)
+                    skipped += found ? 0 : 1;
+                else
+                    imported += found ? 1 : 0;
+            }
+            BEAST_EXPECT(skipped == resume);
+            BEAST_EXPECT(imported == order.size() - resume);
+        };
+
+        importWith (1, 0, {});
+        importWith (4, 0, {});
+        importWith (4, order.size() / 3, order[order.size() / 3 - 1]);
+        importWith (4, order.size() / 3, order[order.size() / 3]);
+    }
+
     //--------------------------------------------------------------------------
 
     void testNodeStore (std::string const& type,
@@ -160,9 +239,149 @@ public:
 
     //--------------------------------------------------------------------------
 
+    void testAsyncFetch (std::string const& type, std::int64_t const seedValue)
+    {
+        DummyScheduler scheduler;
+        RootStoppable parent ("TestRootStoppable");
+
+        testcase ("async fetch from '" + type + "'");
+
+        beast::temp_dir node_db;
+        Section nodeParams;
+        nodeParams.set ("type", type);
+        nodeParams.set ("path", node_db.path());
+
+        auto const batch = createPredictableBatch (
+            numObjectsToTest, seedValue);
+        auto const missing = createPredictableBatch (
+            numObjectsToTest / 10, seedValue + 1);
+
+        beast::Journal j;
+
+        {
+            std::unique_ptr <Database> db = Manager::instance().make_Database (
+                "test", scheduler, 2, parent, nodeParams, j);
+            storeBatch (*db, batch);
+        }
+
+        // Re-open the database, so nothing is cached
+        std::unique_ptr <Database> db = Manager::instance().make_Database (
+            "test", scheduler, 4, parent, nodeParams, j);
+
+        auto const postReads = [&]
+        {
+            std::size_t pending = 0;
+            std::shared_ptr<NodeObject> object;
+            for (auto const& e : batch)
+                if (! db->asyncFetch (e->getHash(), object))
+                    ++pending;
+            for (auto const& e : missing)
+                if (! db->asyncFetch (e->getHash(), object))
+                    ++pending;
+            return pending;
+        };
+
+        BEAST_EXPECT(postReads () == batch.size () + missing.size ());
+
+        // Waiting for some of the reads finishes those, even with the
+        // rest still queued
+        {
+            std::vector <uint256> some;
+            for (std::size_t i = 0; i < batch.size (); i += 16)
+                some.push_back (batch[i]->getHash ());
+            some.push_back (missing.front ()->getHash ());
+            db->waitReads (some);
+
+            std::shared_ptr<NodeObject> object;
+            for (auto const& hash : some)
+                BEAST_EXPECT(db->asyncFetch (hash, object));
+        }
+
+        do
+        {
+            db->waitReads ();
+        }
+        while (postReads () != 0);
+
+        std::shared_ptr<NodeObject> object;
+        for (auto const& e : batch)
+        {
+            BEAST_EXPECT(db->asyncFetch (e->getHash(), object));
+            BEAST_EXPECT(object && isSame (object, e));
+        }
+        for (auto const& e : missing)
+        {
+            BEAST_EXPECT(db->asyncFetch (e->getHash(), object));
+            BEAST_EXPECT(! object);
+        }
+    }
+
+    //--------------------------------------------------------------------------
+
+    void testCopyNodes (std::int64_t const seedValue)
+    {
+        DummyScheduler scheduler;
+        RootStoppable parent ("TestRootStoppable");
+
+        testcase ("copy nodes to the writable backend");
+
+        beast::Journal j;
+
+        auto const makeBackend = [&](std::string const& path)
+        {
+            Section params;
+            params.set ("type", "memory");
+            params.set ("path", path);
+            return std::shared_ptr <Backend> (Manager::instance().make_Backend (
+                params, scheduler, j));
+        };
+
+        auto const writable = makeBackend ("copy_writable");
+        auto const archive = makeBackend ("copy_archive");
+
+        auto const db = Manager::instance().make_DatabaseRotating (
+            "test", scheduler, 2, parent, writable, archive,
+            CachePolicy::lru, j);
+
+        // Half the objects are already in the writable backend
+        auto const batch = createPredictableBatch (
+            numObjectsToTest, seedValue);
+        auto const missing = createPredictableBatch (
+            numObjectsToTest / 10, seedValue + 1);
+        Batch const older (batch.begin(), batch.begin() + batch.size() / 2);
+        Batch const newer (batch.begin() + batch.size() / 2, batch.end());
+        archive->storeBatch (older);
+        writable->storeBatch (newer);
+
+        std::vector <uint256> hashes;
+        for (auto const& e : batch)
+            hashes.push_back (e->getHash());
+        for (auto const& e : missing)
+            hashes.push_back (e->getHash());
+
+        BEAST_EXPECT(db->copyNodes (hashes) == older.size());
+        BEAST_EXPECT(db->copyNodes (hashes) == 0);
+
+        for (auto const& e : batch)
+        {
+            std::shared_ptr <NodeObject> object;
+            BEAST_EXPECT(writable->fetch (e->getHash().begin(), &object) == ok);
+            BEAST_EXPECT(object && isSame (object, e));
+        }
+        for (auto const& e : missing)
+        {
+            std::shared_ptr <NodeObject> object;
+            BEAST_EXPECT(writable->fetch (
+                e->getHash().begin(), &object) == notFound);
+        }
+    }
+
+    //--------------------------------------------------------------------------
+
     void runBackendTests (std::int64_t const seedValue)
     {
         testNodeStore ("nudb", true, seedValue);
+        testAsyncFetch ("nudb", seedValue);
 
     #if RIPPLE_ROCKSDB_AVAILABLE
         testNodeStore ("rocksdb", true, seedValue);
@@ -174,6 +393,7 @@ public:
     void runImportTests (std::int64_t const seedValue)
     {
         testImport ("nudb", "nudb", seedValue);
+        testParallelImport (seedValue);
 
     #if RIPPLE_ROCKSDB_AVAILABLE
         testImport ("rocksdb", "rocksdb", seedValue);
@@ -191,6 +411,8 @@ public:
         std::int64_t const seedValue = 50;
 
         testNodeStore ("memory", false, seedValue);
+        testAsyncFetch ("memory", seedValue);
+        testCopyNodes (seedValue);
 
         runBackendTests (seedValue);
 
@@ -143,6 +143,9 @@ public:
     {
         // percent of fetches for missing nodes
         missingNodePercent = 20
+
+        // keys per fetch in the batched fetch test
+        ,fetchBatchSize = 64
     };
 
     std::size_t const default_repeat = 3;
@@ -383,6 +386,80 @@ public:
         backend->close();
     }
 
+    // Fetch existing keys in batches
+    void
+    do_fetch_batch (Section const& config, Params const& params)
+    {
+        beast::Journal journal;
+        DummyScheduler scheduler;
+        auto backend = make_Backend (config, scheduler, journal);
+        BEAST_EXPECT(backend != nullptr);
+
+        class Body
+        {
+        private:
+            suite& suite_;
+            Backend& backend_;
+            Sequence seq1_;
+            beast::xor_shift_engine gen_;
+            std::uniform_int_distribution<std::size_t> dist_;
+
+        public:
+            Body (std::size_t id, suite& s,
+                    Params const& params, Backend& backend)
+                : suite_(s)
+                , backend_ (backend)
+                , seq1_ (1)
+                , gen_ (id + 1)
+                , dist_ (0, params.items - 1)
+            {
+            }
+
+            void
+            operator()(std::size_t i)
+            {
+                // Each call reads a batch, so only do one per batch
+                if (i % fetchBatchSize != 0)
+                    return;
+                try
+                {
+                    std::vector<std::shared_ptr<NodeObject>> objs;
+                    std::vector<void const*> keys;
+                    objs.reserve(fetchBatchSize);
+                    keys.reserve(fetchBatchSize);
+                    for (std::size_t n = 0; n < fetchBatchSize; ++n)
+                    {
+                        objs.push_back(seq1_.obj(dist_(gen_)));
+                        keys.push_back(objs.back()->getHash().data());
+                    }
+                    auto const results =
+                        backend_.fetchBatch(keys.size(), keys.data());
+                    suite_.expect(results.size() == objs.size());
+                    for (std::size_t n = 0; n < results.size(); ++n)
+                        suite_.expect(results[n] &&
+                            isSame(results[n], objs[n]));
+                }
+                catch(std::exception const& e)
+                {
+                    suite_.fail(e.what());
+                }
+            }
+        };
+        try
+        {
+            parallel_for_id<Body>(params.items, params.threads,
+                std::ref(*this), std::ref(params), std::ref(*backend));
+        }
+        catch (std::exception const&)
+        {
+        #if NODESTORE_TIMING_DO_VERIFY
+            backend->verify();
+        #endif
+            Rethrow();
+        }
+        backend->close();
+    }
+
     // Perform lookups of non-existent keys
     void
     do_missing (Section const& config, Params const& params)
@@ -717,6 +794,7 @@ public:
             {
                  { "Insert",    &Timing_test::do_insert }
                 ,{ "Fetch",     &Timing_test::do_fetch }
+                ,{ "Batch",     &Timing_test::do_fetch_batch }
                 ,{ "Missing",   &Timing_test::do_missing }
                 ,{ "Mixed",     &Timing_test::do_mixed }
                 ,{ "Work",      &Timing_test::do_work }
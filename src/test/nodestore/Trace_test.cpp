@@ -0,0 +1,464 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <test/nodestore/TestBase.h>
+#include <ripple/nodestore/DummyScheduler.h>
+#include <ripple/nodestore/Manager.h>
+#include <ripple/nodestore/Trace.h>
+#include <ripple/protocol/digest.h>
+#include <ripple/unity/rocksdb.h>
+#include <ripple/beast/utility/temp_dir.h>
+#include <ripple/beast/xor_shift_engine.h>
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ripple {
+namespace NodeStore {
+
+class NodeStoreTrace_test : public TestBase
+{
+public:
+    void
+    testRecord ()
+    {
+        testcase ("record");
+
+        DummyScheduler scheduler;
+        RootStoppable parent ("TestRootStoppable");
+        beast::Journal j;
+
+        beast::temp_dir dir;
+        auto const path = dir.file ("trace");
+        Section params;
+        params.set ("type", "memory");
+        params.set ("path", dir.path ());
+
+        auto const batch = createPredictableBatch (10, 53);
+        uint256 const missing = sha512Half (std::string ("missing"));
+        {
+            auto db = Manager::instance().make_Database (
+                "test", scheduler, 1, parent, params, j);
+            db->setTrace (std::make_unique<TraceWriter> (path));
+
+            storeBatch (*db, batch);
+            BEAST_EXPECT(db->fetch (batch[3]->getHash ()));
+            BEAST_EXPECT(! db->fetch (missing));
+            std::shared_ptr<NodeObject> object;
+            BEAST_EXPECT(db->asyncFetch (batch[5]->getHash (), object));
+            BEAST_EXPECT(object);
+        }
+
+        TraceReader reader (path);
+        TraceRecord record;
+        std::chrono::microseconds time {0};
+        auto const expectRecord = [&](TraceRecord::Op op,
+            std::shared_ptr<NodeObject> const& object, uint256 const& hash)
+        {
+            if (! BEAST_EXPECT(reader.next (record)))
+                return;
+            BEAST_EXPECT(record.op == op);
+            BEAST_EXPECT(record.hash == hash);
+            BEAST_EXPECT(record.size == (object ?
+                object->getData ().size () : 0));
+            if (op == TraceRecord::Op::store)
+                BEAST_EXPECT(record.type == object->getType ());
+            BEAST_EXPECT(record.time >= time);
+            time = record.time;
+        };
+
+        for (auto const& object : batch)
+            expectRecord (TraceRecord::Op::store, object,
+                object->getHash ());
+        expectRecord (TraceRecord::Op::fetch, batch[3],
+            batch[3]->getHash ());
+        expectRecord (TraceRecord::Op::fetch, nullptr, missing);
+        expectRecord (TraceRecord::Op::asyncFetch, batch[5],
+            batch[5]->getHash ());
+        BEAST_EXPECT(! reader.next (record));
+    }
+
+    void
+    testNotATrace ()
+    {
+        testcase ("not a trace");
+
+        beast::temp_dir dir;
+        auto const path = dir.file ("trace");
+        {
+            std::ofstream ofs (path);
+            ofs << "something else";
+        }
+
+        try
+        {
+            TraceReader reader (path);
+            fail ();
+        }
+        catch (std::runtime_error const&)
+        {
+            pass ();
+        }
+    }
+
+    void
+    run () override
+    {
+        testRecord ();
+        testNotATrace ();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+/*  Replays a node store trace against backend and cache settings.
+
+    The argument is a list of settings separated by ';', each a list
+    of keys separated by ','. Besides the backend keys, these are:
+
+        trace           The trace to replay. The default is a synthetic
+                        trace made from a fixed seed.
+        read_threads    Threads reading ahead of asynchronous fetches.
+        cache_size      The number of objects the cache targets.
+        cache_age       The age in seconds at which objects expire.
+        cache_mb        The memory the cached objects may use.
+        cache_policy    "lru" or "tinylfu".
+        sweep_ops       The caches are swept after this many operations,
+                        as a server sweeps them periodically. The
+                        default is 10000.
+
+    Objects fetched in the trace before they are stored existed when
+    it was recorded. They are stored in the database before the replay
+    starts, with payloads of the recorded size.
+
+    The replay runs faster than the recording, so objects do not
+    expire from the cache by age as they did.
+*/
+class NodeStoreReplay_test : public beast::unit_test::suite
+{
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    // Counts the fetches that had to read the backend
+    class ReplayScheduler : public DummyScheduler
+    {
+    public:
+        std::atomic<std::uint64_t> fetches {0};
+        std::atomic<std::uint64_t> diskFetches {0};
+
+        void
+        onFetch (FetchReport const& report) override
+        {
+            if (report.isAsync)
+                return;
+            ++fetches;
+            if (report.wentToDisk)
+                ++diskFetches;
+        }
+    };
+
+    struct Results
+    {
+        std::uint64_t ops = 0;
+        std::chrono::duration<double> elapsed {0};
+        std::vector<std::chrono::nanoseconds> fetches;
+        std::vector<std::chrono::nanoseconds> stores;
+        double hitRate = 0;
+        std::uint64_t bytesRead = 0;
+    };
+
+    // A deterministic payload for a key
+    static
+    Blob
+    payload (uint256 const& hash, std::size_t size)
+    {
+        std::uint64_t seed;
+        std::memcpy (&seed, hash.data (), sizeof(seed));
+        beast::xor_shift_engine gen (seed);
+        Blob data (size);
+        for (auto& b : data)
+            b = static_cast<std::uint8_t> (gen () % 64);
+        return data;
+    }
+
+    /*  Write a trace resembling a node following the network: most
+        fetches are of recently stored objects, some are of objects that
+        are missing, and some are made ahead of need.
+    */
+    static
+    void
+    makeSyntheticTrace (std::string const& path, std::uint64_t seed,
+        std::size_t initial, std::size_t ops)
+    {
+        TraceWriter trace (path);
+        beast::xor_shift_engine gen (seed);
+
+        std::vector<std::uint32_t> sizes;
+        auto const key = [seed](std::uint64_t n)
+        {
+            return sha512Half (seed, n);
+        };
+        auto const size = [&gen]
+        {
+            return static_cast<std::uint32_t> (100 + gen () % 900);
+        };
+
+        for (std::size_t i = 0; i < initial; ++i)
+            sizes.push_back (size ());
+
+        for (std::size_t i = 0; i < ops; ++i)
+        {
+            auto const r = gen () % 100;
+            if (r < 10)
+            {
+                sizes.push_back (size ());
+                trace.store (hotACCOUNT_NODE, key (sizes.size () - 1),
+                    sizes.back ());
+            }
+            else if (r < 13)
+            {
+                trace.fetch (key (sizes.size () + 1 + gen () % 1000),
+                    0, false);
+            }
+            else
+            {
+                // Skewed towards the newest objects
+                auto const x = gen () % sizes.size ();
+                auto const n = sizes.size () - 1 - (x * x / sizes.size ());
+                trace.fetch (key (n), sizes[n], r < 30);
+            }
+        }
+    }
+
+    static
+    std::chrono::nanoseconds
+    percentile (std::vector<std::chrono::nanoseconds>& v, double p)
+    {
+        if (v.empty ())
+            return {};
+        auto const n = std::min (v.size () - 1,
+            static_cast<std::size_t> (p * v.size ()));
+        std::nth_element (v.begin (), v.begin () + n, v.end ());
+        return v[n];
+    }
+
+    Results
+    replay (Section config, std::string const& trace)
+    {
+        beast::Journal j;
+        RootStoppable parent ("TestRootStoppable");
+        beast::temp_dir dir;
+        config.set ("path", dir.path ());
+
+        int readThreads = 4;
+        get_if_exists (config, "read_threads", readThreads);
+
+        // Store the objects that existed when the trace was recorded
+        {
+            DummyScheduler scheduler;
+            auto db = Manager::instance().make_Database (
+                "replay", scheduler, 0, parent, config, j);
+
+            TraceReader reader (trace);
+            TraceRecord record;
+            std::unordered_set<uint256, beast::uhash<>> seen;
+            while (reader.next (record))
+            {
+                if (! seen.insert (record.hash).second)
+                    continue;
+                if (record.op != TraceRecord::Op::store && record.size != 0)
+                    db->store (hotACCOUNT_NODE,
+                        payload (record.hash, record.size), record.hash);
+            }
+        }
+
+        ReplayScheduler scheduler;
+        auto db = Manager::instance().make_Database (
+            "replay", scheduler, readThreads, parent, config, j);
+
+        int cacheSize = 0;
+        int cacheAge = 0;
+        if (get_if_exists (config, "cache_size", cacheSize) |
+            get_if_exists (config, "cache_age", cacheAge))
+        {
+            db->tune (cacheSize, cacheAge);
+        }
+        std::size_t cacheMB = 0;
+        if (get_if_exists (config, "cache_mb", cacheMB))
+            db->setCacheBytes (cacheMB * 1024 * 1024);
+
+        std::uint64_t sweepOps = 10000;
+        get_if_exists (config, "sweep_ops", sweepOps);
+
+        Results results;
+        auto const fetchSize = db->getFetchSize ();
+
+        TraceReader reader (trace);
+        TraceRecord record;
+        auto const start = clock_type::now ();
+        while (reader.next (record))
+        {
+            if (++results.ops % sweepOps == 0)
+                db->sweep ();
+
+            switch (record.op)
+            {
+            case TraceRecord::Op::store:
+            {
+                auto data = payload (record.hash, record.size);
+                auto const before = clock_type::now ();
+                db->store (record.type, std::move (data), record.hash);
+                results.stores.push_back (clock_type::now () - before);
+                break;
+            }
+            case TraceRecord::Op::fetch:
+            {
+                auto const before = clock_type::now ();
+                db->fetch (record.hash);
+                results.fetches.push_back (clock_type::now () - before);
+                break;
+            }
+            case TraceRecord::Op::asyncFetch:
+            {
+                std::shared_ptr<NodeObject> object;
+                db->asyncFetch (record.hash, object);
+                break;
+            }
+            }
+        }
+        results.elapsed = clock_type::now () - start;
+
+        if (scheduler.fetches != 0)
+            results.hitRate = 1 - double (scheduler.diskFetches) /
+                scheduler.fetches;
+        results.bytesRead = db->getFetchSize () - fetchSize;
+        return results;
+    }
+
+    static
+    std::string
+    to_string (Section const& config)
+    {
+        std::string s;
+        for (auto iter = config.begin(); iter != config.end(); ++iter)
+        {
+            if (iter->first == "trace")
+                continue;
+            s += (s.empty () ? "" : ",") +
+                iter->first + "=" + iter->second;
+        }
+        return s;
+    }
+
+    void
+    run () override
+    {
+        std::string const defaultArgs =
+            "type=nudb"
+            ";type=nudb,cache_size=4096"
+            ";type=nudb,cache_size=4096,cache_policy=tinylfu"
+        #if RIPPLE_ROCKSDB_AVAILABLE
+            ";type=rocksdb,open_files=2000,filter_bits=12,cache_mb=256"
+        #endif
+            ;
+
+        beast::temp_dir dir;
+        std::string synthetic;
+
+        std::vector<std::string> configs;
+        auto const args = arg ().empty () ? defaultArgs : arg ();
+        boost::split (configs, args, boost::algorithm::is_any_of (";"));
+
+        using std::setw;
+        log << std::right <<
+            setw(10) << "ops/sec" <<
+            setw(9) << "fetch50" <<
+            setw(9) << "fetch99" <<
+            setw(9) << "fetch999" <<
+            setw(9) << "store50" <<
+            setw(9) << "store99" <<
+            setw(9) << "store999" <<
+            setw(8) << "hits" <<
+            setw(10) << "MB read" << "   (latencies in us)" << std::endl;
+
+        for (auto const& s : configs)
+        {
+            if (s.empty ())
+                continue;
+
+            Section config;
+            std::vector<std::string> v;
+            boost::split (v, s, boost::algorithm::is_any_of (","));
+            config.append (v);
+
+            std::string trace;
+            if (! get_if_exists (config, "trace", trace))
+            {
+                if (synthetic.empty ())
+                {
+                    synthetic = dir.file ("synthetic.trace");
+                    makeSyntheticTrace (synthetic, 1, 50000, 500000);
+                }
+                trace = synthetic;
+            }
+
+            auto results = replay (config, trace);
+
+            auto const us = [](std::chrono::nanoseconds d)
+            {
+                std::stringstream ss;
+                ss << std::fixed << std::setprecision (1) <<
+                    d.count () / 1000.;
+                return ss.str ();
+            };
+
+            std::stringstream ss;
+            ss << std::right << std::fixed <<
+                setw(10) << std::setprecision (0) <<
+                    results.ops / results.elapsed.count () <<
+                setw(9) << us (percentile (results.fetches, 0.5)) <<
+                setw(9) << us (percentile (results.fetches, 0.99)) <<
+                setw(9) << us (percentile (results.fetches, 0.999)) <<
+                setw(9) << us (percentile (results.stores, 0.5)) <<
+                setw(9) << us (percentile (results.stores, 0.99)) <<
+                setw(9) << us (percentile (results.stores, 0.999)) <<
+                setw(7) << std::setprecision (1) <<
+                    results.hitRate * 100 << "%" <<
+                setw(10) << std::setprecision (1) <<
+                    results.bytesRead / (1024. * 1024) <<
+                "   " << to_string (config);
+            log << ss.str () << std::endl;
+            BEAST_EXPECT(results.ops != 0);
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(NodeStoreTrace,NodeStore,ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(NodeStoreReplay,NodeStore,ripple);
+
+}
+}
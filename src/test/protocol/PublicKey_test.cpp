@@ -382,11 +382,40 @@ public:
         BEAST_EXPECT(pk1 == pk3);
     }
 
+    void testParsedKeys ()
+    {
+        testcase ("Repeated secp256k1 keys");
+
+        // Keys are parsed once and then reused, so check that a
+        // reused key still verifies only its own signatures.
+        std::vector<std::pair<PublicKey, SecretKey>> keys;
+        for (int i = 0; i < 20; ++i)
+            keys.push_back (randomKeyPair (KeyType::secp256k1));
+
+        for (int round = 0; round < 3; ++round)
+        {
+            for (std::size_t i = 0; i < keys.size(); ++i)
+            {
+                auto const m = "round " + std::to_string (round) +
+                    " key " + std::to_string (i);
+                auto const sig = sign (keys[i].first, keys[i].second,
+                    makeSlice (m));
+                auto const& other = keys[(i + 1) % keys.size()].first;
+
+                BEAST_EXPECT(verify (keys[i].first, makeSlice (m), sig));
+                BEAST_EXPECT(! verify (other, makeSlice (m), sig));
+                BEAST_EXPECT(! verify (keys[i].first,
+                    makeSlice (m + "."), sig));
+            }
+        }
+    }
+
     void run() override
     {
         testBase58();
         testCanonical();
         testMiscOperations();
+        testParsedKeys();
     }
 };
 
@@ -0,0 +1,198 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/shamap/SHAMap.h>
+#include <ripple/beast/unit_test.h>
+#include <ripple/beast/xor_shift_engine.h>
+#include <ripple/protocol/digest.h>
+#include <test/shamap/common.h>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+namespace ripple {
+namespace tests {
+
+// Produces a deterministic sequence of account-state sized items
+class FlushItems
+{
+private:
+    beast::xor_shift_engine gen_;
+
+public:
+    explicit
+    FlushItems (std::uint64_t seed)
+        : gen_ (seed)
+    {
+    }
+
+    SHAMapItem
+    next()
+    {
+        Blob data (48);
+        for (auto& b : data)
+            b = static_cast<std::uint8_t>(gen_());
+        auto const key = sha512Half (makeSlice (data));
+        return SHAMapItem (key, data);
+    }
+};
+
+class SHAMapFlush_test : public beast::unit_test::suite
+{
+public:
+    // Build a map, flush it, then dirty `dirty` leaves in a mutable
+    // snapshot. Returns the number of nodes written and the new hash.
+    static
+    std::pair<int, SHAMapHash>
+    flush (TestFamily& f, std::size_t items, std::size_t dirty,
+        std::chrono::nanoseconds* elapsed = nullptr)
+    {
+        FlushItems gen (items);
+
+        auto map = std::make_shared<SHAMap> (SHAMapType::STATE, f,
+            SHAMap::version{1});
+        for (std::size_t i = 0; i < items; ++i)
+            map->addItem (gen.next(), false, false);
+        map->flushDirty (hotACCOUNT_NODE, 1);
+        map->setImmutable ();
+
+        auto next = map->snapShot (true);
+        for (std::size_t i = 0; i < dirty; ++i)
+            next->addItem (gen.next(), false, false);
+
+        auto const start = std::chrono::steady_clock::now();
+        auto const flushed = next->flushDirty (hotACCOUNT_NODE, 2);
+        if (elapsed)
+            *elapsed = std::chrono::steady_clock::now() - start;
+
+        return { flushed, next->getHash() };
+    }
+
+    void
+    testParallelFlush()
+    {
+        testcase ("parallel flush");
+
+        beast::Journal const j;
+
+        for (std::size_t fanout : { 2, 4, 16 })
+        {
+            for (std::size_t dirty : { 0, 1, 5, 500 })
+            {
+                TestFamily serial (j);
+                TestFamily parallel (j);
+                parallel.setFlushFanout (fanout);
+
+                auto const expected = flush (serial, 2000, dirty);
+                auto const actual = flush (parallel, 2000, dirty);
+
+                BEAST_EXPECT(expected.first == actual.first);
+                BEAST_EXPECT(expected.second == actual.second);
+            }
+        }
+    }
+
+    void
+    testFlushedNodesStored()
+    {
+        testcase ("flushed nodes are stored");
+
+        beast::Journal const j;
+        TestFamily f (j);
+        f.setFlushFanout (8);
+
+        FlushItems gen (1);
+        SHAMap map (SHAMapType::STATE, f, SHAMap::version{1});
+        for (int i = 0; i < 1000; ++i)
+            map.addItem (gen.next(), false, false);
+        map.flushDirty (hotACCOUNT_NODE, 1);
+
+        int missing = 0;
+        map.visitNodes (
+            [&f, &missing](SHAMapAbstractNode& node)
+            {
+                if (! f.db().fetch (node.getNodeHash().as_uint256()))
+                    ++missing;
+                return false;
+            });
+        BEAST_EXPECT(missing == 0);
+    }
+
+    void
+    run() override
+    {
+        testParallelFlush();
+        testFlushedNodesStored();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// Reports the time taken by flushDirty as the number of dirty
+// leaves and the number of concurrent subtree flushes increases.
+class SHAMapFlushTiming_test : public beast::unit_test::suite
+{
+public:
+    void
+    run() override
+    {
+        beast::Journal const j;
+
+#ifndef NDEBUG
+        std::size_t const items = 20000;
+#else
+        std::size_t const items = 200000;
+#endif
+
+        log << std::setw(10) << "dirty" <<
+            std::setw(10) << "fanout" <<
+            std::setw(12) << "flushed" <<
+            std::setw(12) << "ms" << std::endl;
+
+        for (std::size_t dirty : { 100, 1000, 10000, 50000 })
+        {
+            for (std::size_t fanout : { 1, 2, 4, 8, 16 })
+            {
+                TestFamily f (j);
+                f.setFlushFanout (fanout);
+
+                std::chrono::nanoseconds elapsed;
+                auto const result = SHAMapFlush_test::flush (
+                    f, items, dirty, &elapsed);
+
+                std::stringstream ss;
+                ss << std::fixed << std::setprecision(3) <<
+                    (elapsed.count() / 1000000.);
+
+                log << std::setw(10) << dirty <<
+                    std::setw(10) << fanout <<
+                    std::setw(12) << result.first <<
+                    std::setw(12) << ss.str() << std::endl;
+            }
+        }
+        pass();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SHAMapFlush,shamap,ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(SHAMapFlushTiming,shamap,ripple);
+
+} // tests
+} // ripple
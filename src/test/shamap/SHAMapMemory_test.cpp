@@ -0,0 +1,115 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/shamap/SHAMap.h>
+#include <ripple/beast/unit_test.h>
+#include <ripple/beast/xor_shift_engine.h>
+#include <ripple/protocol/digest.h>
+#include <test/shamap/common.h>
+#include <array>
+#include <iomanip>
+
+namespace ripple {
+namespace tests {
+
+// Reports the memory used by the inner nodes of a state map,
+// loaded from the node store, per million accounts.
+class SHAMapMemory_test : public beast::unit_test::suite
+{
+public:
+    void
+    run() override
+    {
+        beast::Journal const j;
+        TestFamily f (j);
+
+#ifndef NDEBUG
+        std::size_t const accounts = 100000;
+#else
+        std::size_t const accounts = 1000000;
+#endif
+
+        SHAMapHash hash;
+        {
+            beast::xor_shift_engine gen (accounts);
+            SHAMap map (SHAMapType::STATE, f, SHAMap::version{1});
+            for (std::size_t i = 0; i < accounts; ++i)
+            {
+                Blob data (100);
+                for (auto& b : data)
+                    b = static_cast<std::uint8_t>(gen());
+                auto const key = sha512Half (makeSlice (data));
+                map.addItem (SHAMapItem (key, data), false, false);
+            }
+            map.flushDirty (hotACCOUNT_NODE, 1);
+            hash = map.getHash();
+        }
+
+        // Start from an empty cache so every node is loaded from the store
+        f.treecache().clear();
+
+        SHAMap map (SHAMapType::STATE, hash.as_uint256(), f,
+            SHAMap::version{1});
+        BEAST_EXPECT(map.fetchRoot (hash, nullptr));
+
+        std::array<std::size_t, 17> branches {};
+        std::size_t inner = 0;
+        map.visitNodes (
+            [&](SHAMapAbstractNode& node)
+            {
+                if (node.isInner())
+                {
+                    ++inner;
+                    ++branches[static_cast<SHAMapInnerNode&>(
+                        node).getBranchCount()];
+                }
+                return false;
+            });
+
+        // Each non-empty branch stores a hash and a child pointer
+        std::size_t const slot = sizeof(SHAMapHash) +
+            sizeof(std::shared_ptr<SHAMapAbstractNode>);
+
+        std::size_t bytes = inner * sizeof(SHAMapInnerNode);
+        for (int i = 0; i < branches.size(); ++i)
+            bytes += branches[i] * i * slot;
+
+        double const scale = 1000000.0 / accounts;
+
+        log << "accounts:    " << accounts << std::endl;
+        log << "inner nodes: " << inner << std::endl;
+        for (int i = 1; i < branches.size(); ++i)
+        {
+            log << "  " << std::setw(2) << i << " branches: " <<
+                branches[i] << std::endl;
+        }
+        log << "inner node MB per million accounts: " <<
+            std::fixed << std::setprecision(1) <<
+            (bytes * scale / (1024 * 1024)) << std::endl;
+        log << "  with a slot for every branch:     " <<
+            ((inner * (sizeof(SHAMapInnerNode) + 16 * slot)) * scale /
+                (1024 * 1024)) << std::endl;
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(SHAMapMemory,shamap,ripple);
+
+} // tests
+} // ripple
@@ -0,0 +1,255 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/shamap/SHAMap.h>
+#include <ripple/beast/unit_test.h>
+#include <ripple/beast/xor_shift_engine.h>
+#include <ripple/protocol/digest.h>
+#include <test/shamap/common.h>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace ripple {
+namespace tests {
+
+// Walks maps whose nodes are only in the node store, so that every
+// traversal has to prefetch the children of the inner nodes it visits.
+class SHAMapPrefetch_test : public beast::unit_test::suite
+{
+public:
+    // Every TestFamily shares the same memory backend, so a map
+    // written through one family can be read cold through another.
+    SHAMapHash
+    build (std::size_t items, std::set<uint256>& keys)
+    {
+        beast::Journal const j;
+        TestFamily f (j);
+
+        beast::xor_shift_engine gen (items);
+        SHAMap map (SHAMapType::STATE, f, SHAMap::version{1});
+        for (std::size_t i = 0; i < items; ++i)
+        {
+            Blob data (64);
+            for (auto& b : data)
+                b = static_cast<std::uint8_t>(gen());
+            auto const key = sha512Half (makeSlice (data));
+            keys.insert (key);
+            map.addItem (SHAMapItem (key, data), false, false);
+        }
+        map.flushDirty (hotACCOUNT_NODE, 1);
+        return map.getHash();
+    }
+
+    void
+    testVisitNodes (SHAMapHash const& hash, std::set<uint256> const& keys)
+    {
+        testcase ("visitNodes");
+
+        beast::Journal const j;
+        TestFamily f (j);
+        SHAMap map (SHAMapType::STATE, hash.as_uint256(), f,
+            SHAMap::version{1});
+        BEAST_EXPECT(map.fetchRoot (hash, nullptr));
+
+        std::size_t leaves = 0;
+        std::size_t inner = 0;
+        map.visitNodes (
+            [&](SHAMapAbstractNode& node)
+            {
+                if (node.isInner())
+                    ++inner;
+                else
+                    ++leaves;
+                return false;
+            });
+        BEAST_EXPECT(leaves == keys.size());
+        BEAST_EXPECT(inner > 1);
+    }
+
+    void
+    testVisitSubtree (SHAMapHash const& hash)
+    {
+        testcase ("visitSubtree");
+
+        beast::Journal const j;
+        TestFamily f (j);
+        SHAMap map (SHAMapType::STATE, hash.as_uint256(), f,
+            SHAMap::version{1});
+        BEAST_EXPECT(map.fetchRoot (hash, nullptr));
+
+        std::set<uint256> expected;
+        std::set<uint256> expectedInner;
+        map.visitNodes (
+            [&](SHAMapAbstractNode& node)
+            {
+                auto const& h = node.getNodeHash().as_uint256();
+                if (h != hash.as_uint256())
+                {
+                    expected.insert (h);
+                    if (node.isInner())
+                        expectedInner.insert (h);
+                }
+                return false;
+            });
+
+        // Every branch from its own thread
+        std::mutex m;
+        std::set<uint256> seen;
+        std::set<uint256> done;
+        std::size_t early = 0;
+        std::vector<std::thread> threads;
+        for (int branch = 0; branch < 16; ++branch)
+        {
+            threads.emplace_back (
+                [&, branch]
+                {
+                    std::set<uint256> s;
+                    std::set<uint256> d;
+                    std::size_t e = 0;
+                    map.visitSubtree (branch,
+                        [&s](SHAMapAbstractNode& node)
+                        {
+                            s.insert (node.getNodeHash().as_uint256());
+                            return false;
+                        },
+                        [&](SHAMapInnerNode& node)
+                        {
+                            // Every child was visited first
+                            for (int i = 0; i < 16; ++i)
+                            {
+                                if (! node.isEmptyBranch (i) &&
+                                    ! s.count (node.getChildHash (
+                                        i).as_uint256()))
+                                    ++e;
+                            }
+                            d.insert (node.getNodeHash().as_uint256());
+                        });
+                    std::lock_guard<std::mutex> lock (m);
+                    seen.insert (s.begin(), s.end());
+                    done.insert (d.begin(), d.end());
+                    early += e;
+                });
+        }
+        for (auto& t : threads)
+            t.join();
+
+        BEAST_EXPECT(seen == expected);
+        BEAST_EXPECT(done == expectedInner);
+        BEAST_EXPECT(early == 0);
+
+        // Skipping the children of the first inner node of each branch
+        std::size_t visited = 0;
+        std::size_t finished = 0;
+        for (int branch = 0; branch < 16; ++branch)
+        {
+            map.visitSubtree (branch,
+                [&](SHAMapAbstractNode&)
+                {
+                    ++visited;
+                    return true;
+                },
+                [&](SHAMapInnerNode&)
+                {
+                    ++finished;
+                });
+        }
+        BEAST_EXPECT(visited == 16);
+        BEAST_EXPECT(finished == 0);
+    }
+
+    void
+    testVisitLeaves (SHAMapHash const& hash, std::set<uint256> const& keys)
+    {
+        testcase ("visitLeaves");
+
+        beast::Journal const j;
+        TestFamily f (j);
+        SHAMap map (SHAMapType::STATE, hash.as_uint256(), f,
+            SHAMap::version{1});
+        BEAST_EXPECT(map.fetchRoot (hash, nullptr));
+
+        std::set<uint256> seen;
+        map.visitLeaves (
+            [&seen](std::shared_ptr<SHAMapItem const> const& item)
+            {
+                seen.insert (item->key());
+            });
+        BEAST_EXPECT(seen == keys);
+    }
+
+    void
+    testIterate (SHAMapHash const& hash, std::set<uint256> const& keys)
+    {
+        testcase ("iterate");
+
+        beast::Journal const j;
+        TestFamily f (j);
+        SHAMap map (SHAMapType::STATE, hash.as_uint256(), f,
+            SHAMap::version{1});
+        BEAST_EXPECT(map.fetchRoot (hash, nullptr));
+
+        auto expected = keys.begin();
+        std::size_t mismatches = 0;
+        for (auto const& item : map)
+        {
+            if (expected == keys.end() || item.key() != *expected)
+                ++mismatches;
+            else
+                ++expected;
+        }
+        BEAST_EXPECT(mismatches == 0);
+        BEAST_EXPECT(expected == keys.end());
+    }
+
+    void
+    testWalkMap (SHAMapHash const& hash)
+    {
+        testcase ("walkMap");
+
+        beast::Journal const j;
+        TestFamily f (j);
+        SHAMap map (SHAMapType::STATE, hash.as_uint256(), f,
+            SHAMap::version{1});
+        BEAST_EXPECT(map.fetchRoot (hash, nullptr));
+
+        std::vector<SHAMapMissingNode> missing;
+        map.walkMap (missing, 32);
+        BEAST_EXPECT(missing.empty());
+    }
+
+    void
+    run() override
+    {
+        std::set<uint256> keys;
+        auto const hash = build (5000, keys);
+
+        testVisitNodes (hash, keys);
+        testVisitSubtree (hash);
+        testVisitLeaves (hash, keys);
+        testIterate (hash, keys);
+        testWalkMap (hash);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SHAMapPrefetch,shamap,ripple);
+
+} // tests
+} // ripple
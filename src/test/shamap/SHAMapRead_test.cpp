@@ -0,0 +1,123 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/shamap/SHAMap.h>
+#include <ripple/beast/unit_test.h>
+#include <ripple/beast/xor_shift_engine.h>
+#include <ripple/protocol/digest.h>
+#include <test/shamap/common.h>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+namespace ripple {
+namespace tests {
+
+// Reports how SHAMap lookup throughput scales as more threads
+// traverse the same map concurrently.
+class SHAMapReadTiming_test : public beast::unit_test::suite
+{
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    void
+    run() override
+    {
+        beast::Journal const j;
+        TestFamily f (j);
+
+#ifndef NDEBUG
+        std::size_t const items = 50000;
+        std::size_t const lookups = 50000;
+#else
+        std::size_t const items = 500000;
+        std::size_t const lookups = 500000;
+#endif
+
+        std::vector<uint256> keys;
+        keys.reserve (items);
+
+        SHAMapHash hash;
+        {
+            beast::xor_shift_engine gen (items);
+            SHAMap map (SHAMapType::STATE, f, SHAMap::version{1});
+            for (std::size_t i = 0; i < items; ++i)
+            {
+                Blob data (64);
+                for (auto& b : data)
+                    b = static_cast<std::uint8_t>(gen());
+                keys.push_back (sha512Half (makeSlice (data)));
+                map.addItem (SHAMapItem (keys.back(), data), false, false);
+            }
+            map.flushDirty (hotACCOUNT_NODE, 1);
+            hash = map.getHash();
+        }
+
+        log << std::setw(8) << "threads" <<
+            std::setw(16) << "lookups/sec" << std::endl;
+
+        for (std::size_t threads : { 1, 2, 4, 8, 16, 32 })
+        {
+            // A fresh map, so the nodes are hooked up by the readers
+            SHAMap map (SHAMapType::STATE, hash.as_uint256(), f,
+                SHAMap::version{1});
+            BEAST_EXPECT(map.fetchRoot (hash, nullptr));
+            map.setImmutable();
+
+            std::atomic<std::size_t> found (0);
+            std::vector<std::thread> workers;
+            workers.reserve (threads);
+
+            auto const start = clock_type::now();
+            for (std::size_t t = 0; t < threads; ++t)
+            {
+                workers.emplace_back (
+                    [&map, &keys, &found, t, lookups]
+                    {
+                        beast::xor_shift_engine gen (t + 1);
+                        std::size_t n = 0;
+                        for (std::size_t i = 0; i < lookups; ++i)
+                        {
+                            if (map.hasItem (keys[gen() % keys.size()]))
+                                ++n;
+                        }
+                        found += n;
+                    });
+            }
+            for (auto& w : workers)
+                w.join();
+            auto const elapsed = std::chrono::duration_cast<
+                std::chrono::duration<double>>(clock_type::now() - start);
+
+            BEAST_EXPECT(found == threads * lookups);
+
+            log << std::setw(8) << threads <<
+                std::setw(16) << std::fixed << std::setprecision(0) <<
+                (threads * lookups / elapsed.count()) << std::endl;
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(SHAMapReadTiming,shamap,ripple);
+
+} // tests
+} // ripple
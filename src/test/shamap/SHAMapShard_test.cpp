@@ -0,0 +1,130 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2017 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <ripple/shamap/SHAMap.h>
+#include <ripple/beast/unit_test.h>
+#include <ripple/beast/utility/temp_dir.h>
+#include <ripple/beast/xor_shift_engine.h>
+#include <ripple/nodestore/DatabaseShard.h>
+#include <ripple/protocol/digest.h>
+#include <test/shamap/common.h>
+
+namespace ripple {
+namespace tests {
+
+class SHAMapShard_test : public beast::unit_test::suite
+{
+public:
+    void
+    run() override
+    {
+        testcase ("read a complete map from its shard");
+
+        beast::Journal const j;
+        std::size_t const items = 500;
+        std::uint32_t const seq = 6;
+
+        // Build a map in one family's node store
+        TestFamily built (j, "SHAMapShard_built");
+        SHAMapHash hash;
+        {
+            beast::xor_shift_engine gen (items);
+            SHAMap map (SHAMapType::STATE, built, SHAMap::version{1});
+            for (std::size_t i = 0; i < items; ++i)
+            {
+                Blob data (48);
+                for (auto& b : data)
+                    b = static_cast<std::uint8_t>(gen());
+                map.addItem (SHAMapItem (
+                    sha512Half (makeSlice (data)), data), false, false);
+            }
+            map.flushDirty (hotACCOUNT_NODE, 1);
+            hash = map.getHash();
+        }
+
+        // Copy its nodes to the shard holding its ledger
+        NodeStore::DummyScheduler scheduler;
+        RootStoppable parent ("TestRootStoppable");
+        beast::temp_dir dir;
+        Section params;
+        params.set ("type", "nudb");
+        params.set ("path", dir.path());
+        params.set ("ledgers_per_shard", "4");
+        auto const db = NodeStore::Manager::instance().make_DatabaseShard (
+            "test", scheduler, 1, parent, params, j);
+        auto& shards = dynamic_cast <NodeStore::DatabaseShard&> (*db);
+
+        built.db().for_each (
+            [&](std::shared_ptr<NodeObject> object)
+            {
+                Blob data (object->getData());
+                shards.store (object->getType(), std::move (data),
+                    object->getHash(), seq);
+            });
+        shards.setStored (seq);
+
+        // A map of that ledger is read from the shard when the
+        // node store does not have its nodes
+        {
+            TestFamily f (j, "SHAMapShard_full");
+            f.setShardDb (&shards);
+            SHAMap map (SHAMapType::STATE, hash.as_uint256(), f,
+                SHAMap::version{1});
+            map.setLedgerSeq (seq);
+            BEAST_EXPECT(map.fetchRoot (hash, nullptr));
+
+            std::size_t count = 0;
+            for (auto const& item : map)
+            {
+                (void)item;
+                ++count;
+            }
+            BEAST_EXPECT(count == items);
+        }
+
+        // Maps of no particular ledger are not read from it
+        {
+            TestFamily f (j, "SHAMapShard_none");
+            f.setShardDb (&shards);
+            SHAMap map (SHAMapType::STATE, hash.as_uint256(), f,
+                SHAMap::version{1});
+            BEAST_EXPECT(! map.fetchRoot (hash, nullptr));
+        }
+
+        // Nor are maps of ledgers it does not hold, which are missing
+        {
+            TestFamily f (j, "SHAMapShard_other");
+            f.setShardDb (&shards);
+            SHAMap map (SHAMapType::STATE, hash.as_uint256(), f,
+                SHAMap::version{1});
+            map.setLedgerSeq (seq + 1);
+            except ([&]
+            {
+                map.fetchRoot (hash, nullptr);
+            });
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SHAMapShard,shamap,ripple);
+
+} // tests
+} // ripple
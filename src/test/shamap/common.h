@@ -25,6 +25,9 @@
 #include <ripple/nodestore/DummyScheduler.h>
 #include <ripple/nodestore/Manager.h>
 #include <ripple/shamap/Family.h>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace ripple {
 namespace tests {
@@ -38,10 +41,16 @@ private:
     FullBelowCache fullbelow_;
     RootStoppable parent_;
     std::unique_ptr<NodeStore::Database> db_;
+    NodeStore::DatabaseShard* shards_ = nullptr;
     beast::Journal j_;
+    std::size_t fanout_ = 1;
+    std::mutex threadsLock_;
+    std::vector<std::thread> threads_;
 
 public:
-    TestFamily (beast::Journal j)
+    // Families using the same path share a memory node store
+    explicit
+    TestFamily (beast::Journal j, std::string const& path = "SHAMap_test")
         : treecache_ ("TreeNodeCache", 65536, 60, clock_, j)
         , fullbelow_ ("full_below", clock_)
         , parent_ ("TestRootStoppable")
@@ -49,11 +58,17 @@ public:
     {
         Section testSection;
         testSection.set("type", "memory");
-        testSection.set("Path", "SHAMap_test");
+        testSection.set("Path", path);
         db_ = NodeStore::Manager::instance ().make_Database (
             "test", scheduler_, 1, parent_, testSection, j);
     }
 
+    ~TestFamily()
+    {
+        for (auto& t : threads_)
+            t.join();
+    }
+
     beast::manual_clock <std::chrono::steady_clock>
     clock()
     {
@@ -102,6 +117,18 @@ public:
         return *db_;
     }
 
+    void
+    setShardDb (NodeStore::DatabaseShard* shards)
+    {
+        shards_ = shards;
+    }
+
+    NodeStore::DatabaseShard*
+    shardDb() override
+    {
+        return shards_;
+    }
+
     void
     missing_node (std::uint32_t refNum) override
     {
@@ -113,6 +140,25 @@ public:
     {
         Throw<std::runtime_error> ("missing node");
     }
+
+    void
+    setFlushFanout (std::size_t fanout)
+    {
+        fanout_ = fanout;
+    }
+
+    std::size_t
+    flushFanout() const override
+    {
+        return fanout_;
+    }
+
+    void
+    dispatch (std::function<void()> task) override
+    {
+        std::lock_guard<std::mutex> lock (threadsLock_);
+        threads_.emplace_back (std::move (task));
+    }
 };
 
 } // tests
@@ -20,6 +20,7 @@
 
 #include <test/app/AccountTxPaging_test.cpp>
 #include <test/app/AmendmentTable_test.cpp>
+#include <test/app/BatchVerifier_test.cpp>
 #include <test/app/CrossingLimits_test.cpp>
 #include <test/app/DeliverMin_test.cpp>
 #include <test/app/Discrepancy_test.cpp>
@@ -27,7 +28,9 @@
 #include <test/app/Flow_test.cpp>
 #include <test/app/Freeze_test.cpp>
 #include <test/app/HashRouter_test.cpp>
+#include <test/app/HistoryStore_test.cpp>
 #include <test/app/LedgerLoad_test.cpp>
+#include <test/app/LedgerSQLWriter_test.cpp>
 #include <test/app/LoadFeeTrack_test.cpp>
 #include <test/app/Manifest_test.cpp>
 #include <test/app/MultiSign_test.cpp>
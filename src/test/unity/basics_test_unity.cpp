@@ -20,12 +20,15 @@
 
 #include <test/basics/base_uint_test.cpp>
 #include <test/basics/Buffer_test.cpp>
+#include <test/basics/CachePolicy_test.cpp>
 #include <test/basics/CheckLibraryVersions_test.cpp>
 #include <test/basics/contract_test.cpp>
 #include <test/basics/hardened_hash_test.cpp>
 #include <test/basics/KeyCache_test.cpp>
+#include <test/basics/LatencyHistogram_test.cpp>
 #include <test/basics/mulDiv_test.cpp>
 #include <test/basics/RangeSet_test.cpp>
+#include <test/basics/ShardedTaggedCache_test.cpp>
 #include <test/basics/Slice_test.cpp>
 #include <test/basics/StringUtilities_test.cpp>
 #include <test/basics/TaggedCache_test.cpp>
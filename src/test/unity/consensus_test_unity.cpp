@@ -18,5 +18,6 @@
 //==============================================================================
 
 #include <test/consensus/Consensus_test.cpp>
+#include <test/consensus/ConsensusVerifier_test.cpp>
 #include <test/consensus/LedgerTiming_test.cpp>
 #include <test/consensus/Validations_test.cpp>
@@ -20,7 +20,12 @@
 
 #include <test/nodestore/Backend_test.cpp>
 #include <test/nodestore/Basics_test.cpp>
+#include <test/nodestore/BatchWriter_test.cpp>
+#include <test/nodestore/CodecDictionary_test.cpp>
 #include <test/nodestore/Database_test.cpp>
+#include <test/nodestore/DatabaseRotating_test.cpp>
+#include <test/nodestore/DatabaseShard_test.cpp>
 #include <test/nodestore/import_test.cpp>
 #include <test/nodestore/Timing_test.cpp>
+#include <test/nodestore/Trace_test.cpp>
 #include <test/nodestore/varint_test.cpp>
\ No newline at end of file
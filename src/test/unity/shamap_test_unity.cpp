@@ -19,5 +19,10 @@
 //==============================================================================
 
 #include <test/shamap/FetchPack_test.cpp>
+#include <test/shamap/SHAMapFlush_test.cpp>
+#include <test/shamap/SHAMapMemory_test.cpp>
+#include <test/shamap/SHAMapPrefetch_test.cpp>
+#include <test/shamap/SHAMapRead_test.cpp>
+#include <test/shamap/SHAMapShard_test.cpp>
 #include <test/shamap/SHAMapSync_test.cpp>
 #include <test/shamap/SHAMap_test.cpp>
\ No newline at end of file